@@ -4,9 +4,12 @@
 // System includes --------------------
 #include <random>
 #include <iostream>
+#include <numeric>
 #include <vector>
 #include <utility>
 #include <string>
+#include <iterator>
+#include <stdexcept>
 
 namespace NNet { // begin NNet
 
@@ -37,6 +40,10 @@ namespace NNet { // begin NNet
 		VectorDataPairType const& getTrainingData( ) const { return mTrainingData; }
 		VectorDataPairType& getTestingData( ) { return mTestingData; }
 		VectorDataPairType const& getTestingData( ) const { return mTestingData; }
+		VectorDataPairType& getValidationData( ) { return mValidationData; }
+		VectorDataPairType const& getValidationData( ) const { return mValidationData; }
+		// order in which the training data is visited, indices into the training data
+		std::vector< std::size_t > const& getTrainingOrder( ) const { return mTrainingOrder; }
 
 		auto const& getInput( DataPairType const& dataPair ) { return dataPair.first; }
 		auto const& getTarget( DataPairType const& dataPair ) { return dataPair.second; }
@@ -55,11 +62,13 @@ namespace NNet { // begin NNet
 			};
 			dataPrinter( getTrainingData( ), "#Training Data: size = " + std::to_string( getTrainingData( ).size( ) ) );
 			dataPrinter( getTestingData( ), "#Testing Data: size = " + std::to_string( getTestingData( ).size( ) ) );
+			if ( !getValidationData( ).empty( ) )
+				dataPrinter( getValidationData( ), "#Validation Data: size = " + std::to_string( getValidationData( ).size( ) ) );
 		}
 
 		// random shuffle
 		template< typename IterType, typename RandomEngineType >
-		void shuffleRange( IterType first, IterType last, RandomEngineType&& g ) {
+		static void shuffleRange( IterType first, IterType last, RandomEngineType&& g ) {
 			for( auto i = ( last - first ) - 1; i > 0; --i ) {
 				std::uniform_int_distribution< decltype( i ) > d( 0, i );
 				auto j = d( std::forward< RandomEngineType >( g ) );
@@ -75,12 +84,41 @@ namespace NNet { // begin NNet
 					 std::forward< RandomEngineType >( g ) );
 		}
 
+		// shuffle the training order, the training data itself keeps its order so
+		// that samples can be identified by their index
+		template< typename RandomEngineType >
+		void shuffleTrainingOrder( RandomEngineType&& g ) {
+			if ( mTrainingOrder.size( ) != getTrainingData( ).size( ) ) {
+				mTrainingOrder.resize( getTrainingData( ).size( ) );
+				std::iota( mTrainingOrder.begin( ), mTrainingOrder.end( ), 0 );
+			}
+			shuffleRange( mTrainingOrder.begin( ),
+						  mTrainingOrder.end( ),
+						  std::forward< RandomEngineType >( g ) );
+		}
+
+		// move a random fraction of the training data to the validation data, done
+		// before optimizers that size state by the number of samples are constructed
+		template< typename RandomEngineType >
+		void splitValidationData( double fraction, RandomEngineType&& g ) {
+			if ( fraction < 0.0 || fraction >= 1.0 )
+				throw std::runtime_error( "The validation fraction must be in [0, 1)." );
+			auto& data = getTrainingData( );
+			shuffleRange( data.begin( ), data.end( ), std::forward< RandomEngineType >( g ) );
+			auto numValidation = static_cast< std::size_t >( fraction * static_cast< double >( data.size( ) ) );
+			auto splitIter = data.end( ) - numValidation;
+			mValidationData.insert( mValidationData.end( ), std::make_move_iterator( splitIter ), std::make_move_iterator( data.end( ) ) );
+			data.erase( splitIter, data.end( ) );
+			mTrainingOrder.clear( );
+		}
+
 	private: 	//private member functions
 
 	public: 	//public data members
 
 	private: 	//private data members
-		VectorDataPairType mTrainingData = { }, mTestingData = { };
+		VectorDataPairType mTrainingData = { }, mTestingData = { }, mValidationData = { };
+		std::vector< std::size_t > mTrainingOrder = { };
 	}; // end of class BaseDataHandler
 
 } // end NNet
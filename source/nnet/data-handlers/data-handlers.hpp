@@ -4,10 +4,12 @@
 // System includes --------------------
 #include <iostream>
 #include <fstream>
+#include <vector>
 
 // Own includes --------------------
 #include "data-handlers/base-data-handler.hpp"
 #include "utils/utility-functions.hpp"
+#include "utils/task-scheduler.hpp"
 
 namespace NNet { // begin NNet
 
@@ -149,17 +151,21 @@ namespace NNet { // begin NNet
 
 				image_size = n_rows * n_cols;
 
-				VectorInputDataType dataSet;
-				dataSet.reserve( number_of_images );
-				for ( int i = 0; i < number_of_images; i++ ) {
-					InputDataType imageData( image_size );
-					unsigned char buffer[image_size];
-					file.read( (char*)&buffer[0], image_size );
-					for ( int j = 0; j < image_size; ++j ) {
-						imageData[j] = static_cast<double>(buffer[j]);
+				// read all pixels at once, the images are converted in parallel
+				std::size_t numImages = static_cast< std::size_t >( number_of_images );
+				std::size_t imageSize = static_cast< std::size_t >( image_size );
+				std::vector< unsigned char > pixels( numImages * imageSize );
+				file.read( reinterpret_cast< char* >( pixels.data( ) ), static_cast< std::streamsize >( pixels.size( ) ) );
+				VectorInputDataType dataSet( numImages );
+				Utils::TaskScheduler::getDefault( ) -> parallelFor( 0, numImages, 256, [&]( std::size_t begin, std::size_t end ) {
+					for ( std::size_t i = begin; i < end; ++i ) {
+						InputDataType imageData( image_size );
+						for ( std::size_t j = 0; j < imageSize; ++j ) {
+							imageData[j] = static_cast<double>( pixels[i * imageSize + j] );
+						}
+						dataSet[i] = std::move( imageData );
 					}
-					dataSet.emplace_back( imageData );
-				}
+				} );
 				return dataSet;
 			}
 			else {
@@ -209,6 +215,59 @@ namespace NNet { // begin NNet
 
 	}; // end of class MINSTDataHandler
 
+	/**
+	 *SharedDataHandler. A view of the data sets of another data handler, so that
+	 *trainers running at the same time (e.g. the trials of a HyperparameterSearch)
+	 *share one copy of the data in memory. The data is only read, every view
+	 *shuffles a training order of its own.
+	 */
+	template< typename DataHandlerType >
+	class SharedDataHandler {
+	public: 	// public typedefs
+		using DataPairType = typename DataHandlerType::DataPairType;
+		using VectorDataPairType = typename DataHandlerType::VectorDataPairType;
+
+	private: 	// private typedefs
+
+	public: 	//public member functions
+		SharedDataHandler( ) = delete;
+		explicit SharedDataHandler( DataHandlerType const& dataHandler )
+			: mDataHandler( dataHandler ) {
+		}
+		SharedDataHandler( SharedDataHandler const& other ) = default;
+		~SharedDataHandler( ) = default;
+
+		// get/set member functions
+		DataHandlerType const& getDataHandler( ) const { return mDataHandler; }
+		VectorDataPairType const& getTrainingData( ) const { return mDataHandler.getTrainingData( ); }
+		VectorDataPairType const& getTestingData( ) const { return mDataHandler.getTestingData( ); }
+		VectorDataPairType const& getValidationData( ) const { return mDataHandler.getValidationData( ); }
+		std::vector< std::size_t > const& getTrainingOrder( ) const { return mTrainingOrder; }
+
+		auto const& getInput( DataPairType const& dataPair ) const { return dataPair.first; }
+		auto const& getTarget( DataPairType const& dataPair ) const { return dataPair.second; }
+
+		// shuffle the view's own training order
+		template< typename RandomEngineType >
+		void shuffleTrainingOrder( RandomEngineType&& g ) {
+			if ( mTrainingOrder.size( ) != getTrainingData( ).size( ) ) {
+				mTrainingOrder.resize( getTrainingData( ).size( ) );
+				std::iota( mTrainingOrder.begin( ), mTrainingOrder.end( ), 0 );
+			}
+			DataHandlerType::shuffleRange( mTrainingOrder.begin( ),
+										   mTrainingOrder.end( ),
+										   std::forward< RandomEngineType >( g ) );
+		}
+
+	private: 	//private member functions
+
+	public: 	//public data members
+
+	private: 	//private data members
+		DataHandlerType const& mDataHandler;
+		std::vector< std::size_t > mTrainingOrder = { };
+	}; // end of class SharedDataHandler
+
 
 } // end NNet
 
@@ -20,6 +20,7 @@ namespace NNet { // begin NNet
 		using NumericType = typename NumericTraitsType::NumericType;
 		using VectorXType = typename NumericTraitsType::VectorXType;
 		using MatrixXType = typename NumericTraitsType::MatrixXType;
+		using MatrixRefType = typename NumericTraitsType::MatrixRefType;
 		using RandomEngineType = std::mt19937;
 
 	private: 	// private typedefs
@@ -65,7 +66,7 @@ namespace NNet { // begin NNet
 		NumericType randNormal(  NumericType const mean, NumericType const stdDev ) {
 			return stdDev * randNormal( ) + mean;
 		}
-		virtual void initWeightMat( MatrixXType& weightMat, std::size_t fanIns, std::size_t fanOuts ) = 0;
+		virtual void initWeightMat( MatrixRefType weightMat, std::size_t fanIns, std::size_t fanOuts ) = 0;
 
 	private: 	//private member functions
 
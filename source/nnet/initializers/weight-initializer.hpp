@@ -17,6 +17,7 @@ namespace NNet { // begin NNet
 		using NumericType = typename BaseInitializerType::NumericType;
 		using VectorXType = typename BaseInitializerType::VectorXType;
 		using MatrixXType = typename BaseInitializerType::MatrixXType;
+		using MatrixRefType = typename BaseInitializerType::MatrixRefType;
 
 	private: 	// private typedefs
 
@@ -30,7 +31,7 @@ namespace NNet { // begin NNet
 		GaussInitializer& operator=( GaussInitializer&& rhs ) = default;
 		~GaussInitializer( ) = default;
 
-		void initWeightMat( MatrixXType& weightMat, std::size_t /* fanIns */, std::size_t /* fanOuts */ ) override {
+		void initWeightMat( MatrixRefType weightMat, std::size_t /* fanIns */, std::size_t /* fanOuts */ ) override {
 			weightMat = weightMat.unaryExpr( [this]( auto const& /* dummy */ ) {
 					return this -> randNormal( );
 				} );
@@ -54,6 +55,7 @@ namespace NNet { // begin NNet
 		using NumericType = typename BaseInitializerType::NumericType;
 		using VectorXType = typename BaseInitializerType::VectorXType;
 		using MatrixXType = typename BaseInitializerType::MatrixXType;
+		using MatrixRefType = typename BaseInitializerType::MatrixRefType;
 
 	private: 	// private typedefs
 
@@ -67,7 +69,7 @@ namespace NNet { // begin NNet
 		GlorotInitializer& operator=( GlorotInitializer&& rhs ) = default;
 		~GlorotInitializer( ) = default;
 
-		void initWeightMat( MatrixXType& weightMat, std::size_t fanIns, std::size_t fanOuts ) override {
+		void initWeightMat( MatrixRefType weightMat, std::size_t fanIns, std::size_t fanOuts ) override {
 			NumericType stdDev = 2.0 / ( fanIns + fanOuts );
 			weightMat = weightMat.unaryExpr( [&,this]( auto const& /* dummy */ ) {
 					return this -> randNormal( 0.0, stdDev );
@@ -92,6 +94,7 @@ namespace NNet { // begin NNet
 		using NumericType = typename BaseInitializerType::NumericType;
 		using VectorXType = typename BaseInitializerType::VectorXType;
 		using MatrixXType = typename BaseInitializerType::MatrixXType;
+		using MatrixRefType = typename BaseInitializerType::MatrixRefType;
 
 	private: 	// private typedefs
 
@@ -105,7 +108,7 @@ namespace NNet { // begin NNet
 		HeInitializer& operator=( HeInitializer&& rhs ) = default;
 		~HeInitializer( ) = default;
 
-		void initWeightMat( MatrixXType& weightMat, std::size_t fanIns, std::size_t /* fanOuts */ ) override {
+		void initWeightMat( MatrixRefType weightMat, std::size_t fanIns, std::size_t /* fanOuts */ ) override {
 			NumericType stdDev = 2.0 / ( fanIns );
 			weightMat = weightMat.unaryExpr( [&,this]( auto const& /* dummy */ ) {
 					return this -> randNormal( 0.0, stdDev );
@@ -6,6 +6,7 @@
 #include <algorithm>
 #include <cmath>
 #include <iostream>
+#include <stdexcept>
 
 // Own includes --------------------
 #include "utils/numeric-traits.hpp"
@@ -18,7 +19,11 @@ namespace NNet { // begin NNet
 	struct IdentityActivation {
 		using VectorXType = typename NumericTraitsType::VectorXType;
 
-		void forwardActivate( VectorXType const& inputVec, VectorXType& outputVec ) const {
+		// elementwise activations also take vector segments (for sliced forward computes)
+		static constexpr bool is_elementwise = true;
+
+		template< typename InputVecType, typename OutputVecType >
+		void forwardActivate( InputVecType const& inputVec, OutputVecType&& outputVec ) const {
 			outputVec = inputVec;
 		}
 
@@ -38,7 +43,10 @@ namespace NNet { // begin NNet
 	struct LogisticActivation {
 		using VectorXType = typename NumericTraitsType::VectorXType;
 
-		void forwardActivate( VectorXType const& inputVec, VectorXType& outputVec ) const {
+		static constexpr bool is_elementwise = true;
+
+		template< typename InputVecType, typename OutputVecType >
+		void forwardActivate( InputVecType const& inputVec, OutputVecType&& outputVec ) const {
 			auto fun = []( auto const& input_x ) { return (1.0)/( 1.0 + std::exp( -input_x ) ); };
 			std::transform( inputVec.begin( ), inputVec.end( ), outputVec.begin( ), fun );
 		}
@@ -64,7 +72,10 @@ namespace NNet { // begin NNet
 	struct TanHActivation {
 		using VectorXType = typename NumericTraitsType::VectorXType;
 
-		void forwardActivate( VectorXType const& inputVec, VectorXType& outputVec ) const {
+		static constexpr bool is_elementwise = true;
+
+		template< typename InputVecType, typename OutputVecType >
+		void forwardActivate( InputVecType const& inputVec, OutputVecType&& outputVec ) const {
 			std::transform( inputVec.begin( ), inputVec.end( ), outputVec.begin( ),
 							[]( auto const& x ) { return std::tanh( x ); } );
 		}
@@ -90,7 +101,10 @@ namespace NNet { // begin NNet
 	struct ArcTanActivation {
 		using VectorXType = typename NumericTraitsType::VectorXType;
 
-		void forwardActivate( VectorXType const& inputVec, VectorXType& outputVec ) const {
+		static constexpr bool is_elementwise = true;
+
+		template< typename InputVecType, typename OutputVecType >
+		void forwardActivate( InputVecType const& inputVec, OutputVecType&& outputVec ) const {
 			std::transform( inputVec.begin( ), inputVec.end( ), outputVec.begin( ), []( auto const& x ) {
 					return std::atan( x );
 				} );
@@ -117,7 +131,10 @@ namespace NNet { // begin NNet
 	struct ReLUActivation {
 		using VectorXType = typename NumericTraitsType::VectorXType;
 
-		void forwardActivate( VectorXType const& inputVec, VectorXType& outputVec ) const {
+		static constexpr bool is_elementwise = true;
+
+		template< typename InputVecType, typename OutputVecType >
+		void forwardActivate( InputVecType const& inputVec, OutputVecType&& outputVec ) const {
 			auto fun = []( auto const& input_i ) { return ( input_i < 0.0 ) ? 0.0 : input_i; };
 			std::transform( inputVec.begin( ), inputVec.end( ), outputVec.begin( ), fun );
 		}
@@ -146,7 +163,10 @@ namespace NNet { // begin NNet
 			if ( mAlpha < 0.0 )
 				throw std::runtime_error( "alpha parameter is less then zero, alpha = " << alpha );
 		}
-		void forwardActivate( VectorXType const& inputVec, VectorXType& outputVec ) const {
+		static constexpr bool is_elementwise = true;
+
+		template< typename InputVecType, typename OutputVecType >
+		void forwardActivate( InputVecType const& inputVec, OutputVecType&& outputVec ) const {
 			auto fun = [this]( auto const& input_i ) { return ( input_i < 0.0 ) ? mAlpha * input_i : input_i; };
 			std::transform( inputVec.begin( ), inputVec.end( ), outputVec.begin( ), fun );
 		}
@@ -178,7 +198,10 @@ namespace NNet { // begin NNet
 				throw std::runtime_error( "alpha parameter is less then zero, alpha = " << alpha );
 		}
 
-		void forwardActivate( VectorXType const& inputVec, VectorXType& outputVec ) const {
+		static constexpr bool is_elementwise = true;
+
+		template< typename InputVecType, typename OutputVecType >
+		void forwardActivate( InputVecType const& inputVec, OutputVecType&& outputVec ) const {
 			auto fun = [this]( auto const& input_i ) { return ( input_i < 0.0 ) ? mAlpha * ( std::exp( input_i ) - 1.0 ) : input_i; };
 			std::transform( inputVec.begin( ), inputVec.end( ), outputVec.begin( ), fun );
 		}
@@ -206,6 +229,8 @@ namespace NNet { // begin NNet
 		using VectorXType = typename NumericTraitsType::VectorXType;
 		using MatrixXType = typename NumericTraitsType::MatrixXType;
 
+		static constexpr bool is_elementwise = false;
+
 		void forwardActivate( VectorXType const& inputVec, VectorXType& outputVec ) const {
 			NumericType max = inputVec.maxCoeff( );
 			NumericType sum = 0.0;
@@ -222,8 +247,8 @@ namespace NNet { // begin NNet
 							   VectorXType const& outputVec,
 							   VectorXType const& deltaInputVec,
 							   VectorXType& deltaOutputVec ) const {
-			MatrixXType diagMat = outputVec.asDiagonal( );
-			deltaOutputVec = ( diagMat  - outputVec * outputVec.transpose( ) ) * deltaInputVec;
+			// ( diag( y ) - y y^T ) delta without forming the jacobian
+			deltaOutputVec = outputVec.cwiseProduct( deltaInputVec ) - outputVec * outputVec.dot( deltaInputVec );
 		}
 
 		bool operator==( SoftMaxActivation const& /* other */ ) const {
@@ -237,6 +262,8 @@ namespace NNet { // begin NNet
 		using VectorXType = typename NumericTraitsType::VectorXType;
 		using MatrixXType = typename NumericTraitsType::MatrixXType;
 
+		static constexpr bool is_elementwise = false;
+
 		void forwardActivate( VectorXType const& inputVec, VectorXType& outputVec ) const {
 			NumericType max = inputVec.maxCoeff( );
 			NumericType sum = 0.0;
@@ -278,16 +305,18 @@ namespace NNet { // begin NNet
 		using BaseLayerType = BaseLayer< NumericTraitsType >;
 		using NumericType = typename BaseLayerType::NumericType;
 		using VectorXType = typename BaseLayerType::VectorXType;
+		using MatrixXType = typename BaseLayerType::MatrixXType;
+		using ConstMatrixRefType = typename BaseLayerType::ConstMatrixRefType;
 
 	private: 	// private typedefs
 
 	public: 	//public member functions
 		ActivationLayer( ) = default;
 		explicit ActivationLayer( std::size_t numInputs, std::size_t numOutputs )
-			: BaseLayer< NumericTraitsType >( numInputs, numOutputs, LayerType::ACTIVATION ), mActFun(), mInputVec( numInputs ), mOutputVec( numOutputs ), mOutputDeltaVec( numInputs ) {
+			: BaseLayer< NumericTraitsType >( numInputs, numOutputs, LayerType::ACTIVATION ), mActFun(), mInputVec( VectorXType::Zero( numInputs ) ), mOutputVec( VectorXType::Zero( numOutputs ) ), mOutputDeltaVec( VectorXType::Zero( numInputs ) ) {
 		}
 		explicit ActivationLayer( std::size_t numInputs )
-			: BaseLayer< NumericTraitsType >( numInputs, numInputs, LayerType::ACTIVATION ), mActFun(), mInputVec( numInputs ), mOutputVec( numInputs ), mOutputDeltaVec( numInputs ) {
+			: BaseLayer< NumericTraitsType >( numInputs, numInputs, LayerType::ACTIVATION ), mActFun(), mInputVec( VectorXType::Zero( numInputs ) ), mOutputVec( VectorXType::Zero( numInputs ) ), mOutputDeltaVec( VectorXType::Zero( numInputs ) ) {
 		}
 		explicit ActivationLayer( std::size_t numInputs, std::size_t numOutputs, VectorXType const& inputVec, VectorXType const& outputVec, VectorXType const& outputDeltaVec )
 			: BaseLayer< NumericTraitsType >( numInputs, numOutputs, LayerType::ACTIVATION ), mActFun(), mInputVec( inputVec ), mOutputVec( outputVec ), mOutputDeltaVec( outputDeltaVec ) {
@@ -317,18 +346,76 @@ namespace NNet { // begin NNet
 			std::cout << "Output delta size: " << getOutputDeltaVec( ).size( ) << std::endl;
 		}
 		bool isTrainableLayer( ) const override { return false; }
+		std::shared_ptr< BaseLayerType > clone( ) const override {
+			return std::make_shared< ActivationLayer >( *this );
+		}
 
 		// forward compute
 		void forwardCompute( VectorXType const& inputVec, VectorXType& outputVec ) override {
 			mInputVec = inputVec;
+			outputVec.resize( inputVec.size( ) );
 			mActFun.forwardActivate( inputVec, outputVec );
-			mOutputVec = outputVec;
+			if ( &outputVec != &mOutputVec )
+				mOutputVec = outputVec;
 		}
 
 		// backward compute
 		void backwardCompute( VectorXType const& /* inputVec */, VectorXType const& /* outputVec */, VectorXType const& inputDeltaVec, VectorXType& outputDeltaVec ) override {
 			mActFun.backwardActivate( mInputVec, mOutputVec, inputDeltaVec, mOutputDeltaVec );
-			outputDeltaVec = mOutputDeltaVec;
+			if ( &outputDeltaVec != &mOutputDeltaVec )
+				outputDeltaVec = mOutputDeltaVec;
+		}
+
+		// batched compute, the activation functions work on vectors so every column
+		// passes through the layer's work vectors
+		MatrixXType& getOutputMat( ) override { return mOutputMat; }
+		void forwardComputeBatch( ConstMatrixRefType inputMat ) override {
+			auto batchSize = inputMat.cols( );
+			this -> reserveBatch( mInputMat, inputMat.rows( ), batchSize );
+			this -> reserveBatch( mOutputMat, inputMat.rows( ), batchSize );
+			mInputMat.leftCols( batchSize ) = inputMat;
+			mOutputVec.resize( inputMat.rows( ) );
+			for ( Eigen::Index col = 0; col < batchSize; ++col ) {
+				mInputVec = inputMat.col( col );
+				mActFun.forwardActivate( mInputVec, mOutputVec );
+				mOutputMat.col( col ) = mOutputVec;
+			}
+		}
+
+		MatrixXType& getOutputDeltaMat( ) override { return mOutputDeltaMat; }
+		void backwardComputeBatch( ConstMatrixRefType inputDeltaMat ) override {
+			auto batchSize = inputDeltaMat.cols( );
+			this -> reserveBatch( mOutputDeltaMat, inputDeltaMat.rows( ), batchSize );
+			mOutputDeltaVec.resize( inputDeltaMat.rows( ) );
+			for ( Eigen::Index col = 0; col < batchSize; ++col ) {
+				mInputVec = mInputMat.col( col );
+				mOutputVec = mOutputMat.col( col );
+				mInputDeltaVec = inputDeltaMat.col( col );
+				mActFun.backwardActivate( mInputVec, mOutputVec, mInputDeltaVec, mOutputDeltaVec );
+				mOutputDeltaMat.col( col ) = mOutputDeltaVec;
+			}
+		}
+
+		std::size_t getBatchColumnSize( ) const override { return 3 * this -> getNumInputs( ); }
+		void releaseBatch( bool keepOutput, bool keepOutputDelta ) override {
+			mInputMat.resize( 0, 0 );
+			if ( !keepOutput )
+				mOutputMat.resize( 0, 0 );
+			if ( !keepOutputDelta )
+				mOutputDeltaMat.resize( 0, 0 );
+		}
+
+		// sliced forward compute, only elementwise activation functions take part of the output
+		bool isSliceable( ) const override { return ActFunType::is_elementwise; }
+		void forwardComputeSlice( VectorXType const& inputVec, VectorXType& outputVec, std::size_t begin, std::size_t size ) const override {
+			if constexpr ( ActFunType::is_elementwise ) {
+				mActFun.forwardActivate( inputVec.segment( begin, size ), outputVec.segment( begin, size ) );
+			}
+			else {
+				if ( begin != 0 || size != static_cast< std::size_t >( inputVec.size( ) ) )
+					throw std::runtime_error( "The activation function isn't elementwise, its layer can't compute a slice..." );
+				mActFun.forwardActivate( inputVec, outputVec );
+			}
 		}
 
 		bool operator==( ActivationLayer const& other ) const {
@@ -353,6 +440,9 @@ namespace NNet { // begin NNet
 		ActFunType mActFun;
 		VectorXType mInputVec, mOutputVec;
 		VectorXType mOutputDeltaVec;
+		// batch work matrices and the input delta of a batch column
+		MatrixXType mInputMat, mOutputMat, mOutputDeltaMat;
+		VectorXType mInputDeltaVec;
 	}; // end of class ActivationLayer
 
 } // end NNet
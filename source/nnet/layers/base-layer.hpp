@@ -4,6 +4,10 @@
 // System includes --------------------
 #include <cstddef>
 #include <iostream>
+#include <memory>
+
+// Eigen includes --------------------
+#include <Eigen/Core>
 
 namespace NNet { // begin NNet
 
@@ -32,6 +36,7 @@ namespace NNet { // begin NNet
 		using NumericType = typename NumericTraitsType::NumericType;
 		using VectorXType = typename NumericTraitsType::VectorXType;
 		using MatrixXType = typename NumericTraitsType::MatrixXType;
+		using ConstMatrixRefType = Eigen::Ref< MatrixXType const >;
 
 	private: 	// private typedefs
 
@@ -58,11 +63,18 @@ namespace NNet { // begin NNet
 		virtual void setOutputVec( VectorXType const& outputVec ) = 0;
 		virtual VectorXType& getOutputDeltaVec( ) = 0;
 		virtual VectorXType const& getOutputDeltaVec( ) const = 0;
+		// when false the backward compute skips the output delta, nothing before this
+		// layer needs it (set by NeuralNetwork::updateBackwardPlan)
+		bool getPropagatesDelta( ) const { return mPropagatesDelta; }
+		void setPropagatesDelta( bool propagatesDelta ) { mPropagatesDelta = propagatesDelta; }
 
 		// identifiers and information
 		virtual void printLayerInfo( std::ostream& os = std::cout ) const = 0;
 		virtual bool isTrainableLayer( ) const = 0;
 
+		// deep copy of the layer, a cloned trainable layer owns copies of its weights
+		virtual std::shared_ptr< BaseLayerType > clone( ) const = 0;
+
 		// forward compute
 		virtual void forwardCompute( VectorXType const& inputVec, VectorXType &outputVec ) = 0;
 
@@ -70,6 +82,28 @@ namespace NNet { // begin NNet
 		virtual void backwardCompute( VectorXType const& inputVec, VectorXType const& outputVec,
 									  VectorXType const& inputDeltaVec, VectorXType& outputDeltaVec ) = 0;
 
+		// batched compute, the columns of the matrices are samples
+		// the first inputMat.cols( ) columns of getOutputMat( ) receive the outputs
+		virtual MatrixXType& getOutputMat( ) = 0;
+		virtual void forwardComputeBatch( ConstMatrixRefType inputMat ) = 0;
+		// deltas of the batch last passed to forwardComputeBatch, the first
+		// inputDeltaMat.cols( ) columns of getOutputDeltaMat( ) receive the output deltas
+		virtual MatrixXType& getOutputDeltaMat( ) = 0;
+		virtual void backwardComputeBatch( ConstMatrixRefType inputDeltaMat ) = 0;
+		// elements per batch column of the batch work matrices (inputs, outputs and
+		// output deltas), to plan activation memory
+		virtual std::size_t getBatchColumnSize( ) const = 0;
+		// frees the batch work matrices (activation checkpointing), except getOutputMat( )
+		// with keepOutput and getOutputDeltaMat( ) with keepOutputDelta, the next
+		// forwardComputeBatch recomputes them
+		virtual void releaseBatch( bool keepOutput, bool keepOutputDelta ) = 0;
+
+		// sliced forward compute of one sample, writes the outputs [begin, begin + size) of
+		// outputVec (sized by the caller) and leaves the layer's state alone, so disjoint
+		// slices may run concurrently. Layers that aren't sliceable only take the whole output.
+		virtual bool isSliceable( ) const = 0;
+		virtual void forwardComputeSlice( VectorXType const& inputVec, VectorXType& outputVec, std::size_t begin, std::size_t size ) const = 0;
+
 		bool operator==( BaseLayerType const& other ) const {
 			return ( mNumInputs == other.getNumInputs() &&
 					 mNumOutputs == other.getNumOutputs() &&
@@ -79,6 +113,13 @@ namespace NNet { // begin NNet
 
 		virtual bool equalTo( BaseLayerType const& other ) const = 0;
 
+	protected: 	//protected member functions
+		// batch work matrices only grow, so that a smaller (last) batch does not reallocate
+		static void reserveBatch( MatrixXType& mat, Eigen::Index rows, Eigen::Index cols ) {
+			if ( mat.rows( ) != rows || mat.cols( ) < cols )
+				mat.resize( rows, cols );
+		}
+
 	private: 	//private member functions
 
 	public: 	//public data members
@@ -86,6 +127,7 @@ namespace NNet { // begin NNet
 	private: 	//private data members
 		std::size_t mNumInputs, mNumOutputs;
 		LayerType mLayerType;
+		bool mPropagatesDelta = true;
 	}; // end of class BaseLayer
 
 } // end NNet
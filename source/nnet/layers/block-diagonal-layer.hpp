@@ -0,0 +1,326 @@
+#ifndef BLOCK_DIAGONAL_LAYER_HPP
+#define BLOCK_DIAGONAL_LAYER_HPP
+
+// System includes --------------------
+#include <algorithm>
+#include <iostream>
+#include <memory>
+
+// Own includes --------------------
+#include "utils/numeric-traits.hpp"
+#include "trainable-layer.hpp"
+#include "serialization/serialize.hpp"
+
+namespace NNet { // begin NNet
+
+	/**
+	 *BlockDiagonalLayer. numBlocks independent fully connected layers side by
+	 *side, block b maps inputs [b * blockInputs, (b + 1) * blockInputs) to
+	 *outputs [b * blockOutputs, (b + 1) * blockOutputs). Only the blocks on the
+	 *diagonal are stored: the weight matrix is (blockInputs + 1) x numOutputs,
+	 *the columns of a block are the weight matrix of that block's fully
+	 *connected layer (bias in the last row). A batch is one matrix product
+	 *per block. The layers of a NetworkEnsemble after its first.
+	 */
+	template< typename NumericTraitsType >
+	class BlockDiagonalLayer
+		: public TrainableLayer< NumericTraitsType > {
+	public: 	// public typedefs
+		using TrainableLayerType = TrainableLayer< NumericTraitsType >;
+		using BaseLayerType = typename TrainableLayerType::BaseLayerType;
+		using NumericType = typename BaseLayerType::NumericType;
+		using VectorXType = typename BaseLayerType::VectorXType;
+		using MatrixXType = typename BaseLayerType::MatrixXType;
+		using MatrixMapType = typename TrainableLayerType::MatrixMapType;
+		using ConstMatrixRefType = typename BaseLayerType::ConstMatrixRefType;
+
+	private: 	// private typedefs
+
+	public: 	//public member functions
+		BlockDiagonalLayer( ) = delete;
+		explicit BlockDiagonalLayer( std::size_t numBlocks, std::size_t blockInputs, std::size_t blockOutputs, LayerType layerType )
+			: TrainableLayer< NumericTraitsType >( numBlocks * blockInputs, numBlocks * blockOutputs, layerType ),
+			mNumBlocks( numBlocks ), mBlockInputs( blockInputs ), mBlockOutputs( blockOutputs ),
+			mWeightStorage( blockInputs + 1, numBlocks * blockOutputs ),
+			mWeightGradStorage( blockInputs + 1, numBlocks * blockOutputs ),
+			mWeightMat( mWeightStorage.data( ), blockInputs + 1, numBlocks * blockOutputs ),
+			mWeightGradMat( mWeightGradStorage.data( ), blockInputs + 1, numBlocks * blockOutputs ),
+			mInputVec( VectorXType::Zero( numBlocks * blockInputs ) ),
+			mOutputVec( VectorXType::Zero( numBlocks * blockOutputs ) ),
+			mOutputDeltaVec( VectorXType::Zero( numBlocks * blockInputs ) ) {
+			this -> resetWeightGradMat( );
+		}
+		BlockDiagonalLayer( const BlockDiagonalLayer &c ) = delete;
+		~BlockDiagonalLayer( ) = default;
+
+		// get/set member functions
+		std::size_t getNumBlocks( ) const { return mNumBlocks; }
+		std::size_t getBlockInputs( ) const { return mBlockInputs; }
+		std::size_t getBlockOutputs( ) const { return mBlockOutputs; }
+		VectorXType& getInputVec( ) { return mInputVec; }
+		VectorXType const& getInputVec( ) const { return mInputVec; }
+		VectorXType& getOutputVec( ) override { return mOutputVec; }
+		VectorXType const& getOutputVec( ) const override { return mOutputVec; }
+		void setOutputVec( VectorXType const& outputVec ) override { mOutputVec = outputVec; };
+		VectorXType& getOutputDeltaVec( ) override { return mOutputDeltaVec; }
+		VectorXType const& getOutputDeltaVec( ) const override { return mOutputDeltaVec; }
+		MatrixMapType& getWeightMat( ) override { return mWeightMat; }
+		MatrixMapType const& getWeightMat( ) const override { return mWeightMat; }
+		MatrixMapType& getWeightGradMat( ) override { return mWeightGradMat; }
+		MatrixMapType const& getWeightGradMat( ) const override { return mWeightGradMat; }
+
+		// the weights of block b, a fully connected layer's weight matrix
+		auto getBlockWeightMat( std::size_t b ) { return mWeightMat.middleCols( b * mBlockOutputs, mBlockOutputs ); }
+		auto getBlockWeightMat( std::size_t b ) const { return mWeightMat.middleCols( b * mBlockOutputs, mBlockOutputs ); }
+
+		void resetWeightGradMat( ) override {
+			this -> getWeightGradMat( ).setZero( );
+		}
+
+		std::shared_ptr< BaseLayerType > clone( ) const override {
+			auto layer = std::make_shared< BlockDiagonalLayer >( mNumBlocks, mBlockInputs, mBlockOutputs, this -> getLayerType( ) );
+			layer -> getWeightMat( ) = mWeightMat;
+			layer -> getWeightGradMat( ) = mWeightGradMat;
+			layer -> getInputVec( ) = mInputVec;
+			layer -> getOutputVec( ) = mOutputVec;
+			layer -> getOutputDeltaVec( ) = mOutputDeltaVec;
+			layer -> setFrozen( this -> isFrozen( ) );
+			layer -> setPropagatesDelta( this -> getPropagatesDelta( ) );
+			return layer;
+		}
+
+		std::size_t getNumParameters( ) const override {
+			return static_cast< std::size_t >( mWeightMat.size( ) );
+		}
+
+		void bindParameters( NumericType* weightData, NumericType* weightGradData ) override {
+			auto rows = mWeightMat.rows( );
+			auto cols = mWeightMat.cols( );
+			// re-seat the maps, the layer's own storage is no longer needed
+			new ( &mWeightMat ) MatrixMapType( weightData, rows, cols );
+			new ( &mWeightGradMat ) MatrixMapType( weightGradData, rows, cols );
+			mWeightStorage.resize( 0, 0 );
+			mWeightGradStorage.resize( 0, 0 );
+		}
+
+		// identifiers and information
+		void printLayerInfo( std::ostream& os = std::cout ) const override {
+			os << "Layer Type: " << this -> getLayerType( ) << std::endl;
+			os << "Inputs, Outputs: " << this -> getNumInputs( ) << ", " << this -> getNumOutputs( ) << std::endl;
+			os << "Blocks <count, inputs, outputs>: " << mNumBlocks << ", " << mBlockInputs << ", " << mBlockOutputs << std::endl;
+			os << "Outputs size: " << getOutputVec( ).size( ) << std::endl;
+			os << "Output delta size: " << getOutputDeltaVec( ).size( ) << std::endl;
+			os << "Weight Matrix <rows=#block inputs, cols=#outputs>: " << getWeightMat( ).rows( ) << ", " << getWeightMat( ).cols( ) << std::endl;
+		}
+
+		// forward compute
+		void forwardCompute( VectorXType const& inputVec, VectorXType &outputVec ) override {
+			mInputVec = inputVec;
+			outputVec.resize( this -> getNumOutputs( ) );
+			forwardComputeSlice( inputVec, outputVec, 0, this -> getNumOutputs( ) );
+			if ( &outputVec != &mOutputVec )
+				mOutputVec = outputVec;
+		}
+
+		// backward compute
+		void backwardCompute( VectorXType const& /* inputVec */, VectorXType const& /* outputVec */, VectorXType const& inputDeltaVec, VectorXType& outputDeltaVec ) override {
+			accumulateWeightGrad( inputDeltaVec );
+			backwardComputeDelta( inputDeltaVec, outputDeltaVec );
+		};
+
+		void accumulateWeightGrad( VectorXType const& inputDeltaVec ) override {
+			if ( this -> isFrozen( ) )
+				return;
+			for ( std::size_t b = 0; b < mNumBlocks; ++b ) {
+				auto gradBlock = mWeightGradMat.middleCols( b * mBlockOutputs, mBlockOutputs );
+				auto deltaSegment = inputDeltaVec.segment( b * mBlockOutputs, mBlockOutputs );
+				gradBlock.topRows( mBlockInputs ).noalias( ) += mInputVec.segment( b * mBlockInputs, mBlockInputs ) * deltaSegment.transpose( );
+				gradBlock.row( mBlockInputs ) += deltaSegment.transpose( );
+			}
+		}
+
+		void backwardComputeDelta( VectorXType const& inputDeltaVec, VectorXType& outputDeltaVec ) override {
+			if ( !this -> getPropagatesDelta( ) )
+				return;
+			outputDeltaVec.resize( this -> getNumInputs( ) );
+			for ( std::size_t b = 0; b < mNumBlocks; ++b ) {
+				outputDeltaVec.segment( b * mBlockInputs, mBlockInputs ).noalias( ) =
+					getBlockWeightMat( b ).topRows( mBlockInputs ) * inputDeltaVec.segment( b * mBlockOutputs, mBlockOutputs );
+			}
+			if ( &outputDeltaVec != &mOutputDeltaVec )
+				mOutputDeltaVec = outputDeltaVec;
+		}
+
+		// batched forward compute, one matrix product per block. The input of block b
+		// (with its row of ones) is the b-th group of batchSize columns of mInputMat.
+		MatrixXType& getOutputMat( ) override { return mOutputMat; }
+		void forwardComputeBatch( ConstMatrixRefType inputMat ) override {
+			auto batchSize = inputMat.cols( );
+			auto blockInputs = static_cast< Eigen::Index >( mBlockInputs );
+			auto blockOutputs = static_cast< Eigen::Index >( mBlockOutputs );
+			auto numBlocks = static_cast< Eigen::Index >( mNumBlocks );
+			this -> reserveBatch( mInputMat, blockInputs + 1, numBlocks * batchSize );
+			this -> reserveBatch( mOutputMat, mWeightMat.cols( ), batchSize );
+			for ( Eigen::Index b = 0; b < numBlocks; ++b ) {
+				auto blockInputMat = mInputMat.middleCols( b * batchSize, batchSize );
+				blockInputMat.topRows( blockInputs ) = inputMat.middleRows( b * blockInputs, blockInputs );
+				blockInputMat.row( blockInputs ).setOnes( );
+				mOutputMat.block( b * blockOutputs, 0, blockOutputs, batchSize ).noalias( ) = getBlockWeightMat( b ).transpose( ) * blockInputMat;
+			}
+		}
+
+		// batched backward compute
+		MatrixXType& getOutputDeltaMat( ) override { return mOutputDeltaMat; }
+		void backwardComputeBatch( ConstMatrixRefType inputDeltaMat ) override {
+			accumulateWeightGradBatch( inputDeltaMat );
+			backwardComputeDeltaBatch( inputDeltaMat );
+		}
+
+		void accumulateWeightGradBatch( ConstMatrixRefType inputDeltaMat ) override {
+			if ( this -> isFrozen( ) )
+				return;
+			auto batchSize = inputDeltaMat.cols( );
+			auto blockOutputs = static_cast< Eigen::Index >( mBlockOutputs );
+			auto numBlocks = static_cast< Eigen::Index >( mNumBlocks );
+			for ( Eigen::Index b = 0; b < numBlocks; ++b ) {
+				mWeightGradMat.middleCols( b * blockOutputs, blockOutputs ).noalias( ) +=
+					mInputMat.middleCols( b * batchSize, batchSize ) * inputDeltaMat.middleRows( b * blockOutputs, blockOutputs ).transpose( );
+			}
+		}
+
+		void backwardComputeDeltaBatch( ConstMatrixRefType inputDeltaMat ) override {
+			if ( !this -> getPropagatesDelta( ) )
+				return;
+			auto batchSize = inputDeltaMat.cols( );
+			auto blockInputs = static_cast< Eigen::Index >( mBlockInputs );
+			auto blockOutputs = static_cast< Eigen::Index >( mBlockOutputs );
+			auto numBlocks = static_cast< Eigen::Index >( mNumBlocks );
+			this -> reserveBatch( mOutputDeltaMat, this -> getNumInputs( ), batchSize );
+			for ( Eigen::Index b = 0; b < numBlocks; ++b ) {
+				mOutputDeltaMat.block( b * blockInputs, 0, blockInputs, batchSize ).noalias( ) =
+					getBlockWeightMat( b ).topRows( blockInputs ) * inputDeltaMat.middleRows( b * blockOutputs, blockOutputs );
+			}
+		}
+
+		std::size_t getBatchColumnSize( ) const override {
+			return mNumBlocks * ( 2 * mBlockInputs + 1 + mBlockOutputs );
+		}
+		void releaseBatch( bool keepOutput, bool keepOutputDelta ) override {
+			mInputMat.resize( 0, 0 );
+			if ( !keepOutput )
+				mOutputMat.resize( 0, 0 );
+			if ( !keepOutputDelta )
+				mOutputDeltaMat.resize( 0, 0 );
+		}
+
+		// sliced forward compute, the part of every block the slice covers
+		bool isSliceable( ) const override { return true; }
+		void forwardComputeSlice( VectorXType const& inputVec, VectorXType& outputVec, std::size_t begin, std::size_t size ) const override {
+			for ( std::size_t end = begin + size; begin < end; ) {
+				std::size_t b = begin / mBlockOutputs;
+				std::size_t blockEnd = std::min( end, ( b + 1 ) * mBlockOutputs );
+				auto weightBlock = mWeightMat.middleCols( begin, blockEnd - begin );
+				outputVec.segment( begin, blockEnd - begin ).noalias( ) = weightBlock.topRows( mBlockInputs ).transpose( ) * inputVec.segment( b * mBlockInputs, mBlockInputs );
+				outputVec.segment( begin, blockEnd - begin ) += weightBlock.row( mBlockInputs ).transpose( );
+				begin = blockEnd;
+			}
+		}
+
+		bool operator==( BlockDiagonalLayer const& other ) const {
+			return ( mNumBlocks == other.getNumBlocks( ) &&
+					 mWeightMat == other.getWeightMat( ) &&
+					 mWeightGradMat == other.getWeightGradMat( ) &&
+					 mInputVec == other.getInputVec( ) &&
+					 mOutputVec == other.getOutputVec( ) &&
+					 mOutputDeltaVec == other.getOutputDeltaVec( ) );
+		}
+
+		virtual bool equalTo( BaseLayerType const& other ) const override {
+			bool equals = false;
+			if ( BlockDiagonalLayer const* bdo = dynamic_cast< BlockDiagonalLayer const * >( &other ) ) {
+				equals = operator==( *bdo );
+			}
+			return equals;
+		}
+	private: 	//private member functions
+
+	public: 	//public data members
+
+	private: 	//private data members
+		std::size_t mNumBlocks, mBlockInputs, mBlockOutputs;
+		// own storage, used until the layer is bound to a network's flat parameter buffer
+		MatrixXType mWeightStorage, mWeightGradStorage;
+		MatrixMapType mWeightMat, mWeightGradMat;
+		VectorXType mInputVec, mOutputVec;
+		VectorXType mOutputDeltaVec;
+		// batch work matrices, the blocks' inputs side by side, each with a row of ones
+		MatrixXType mInputMat, mOutputMat, mOutputDeltaMat;
+	}; // end of class BlockDiagonalLayer
+
+} // end NNet
+
+namespace boost::serialization { // begin boost::serialization
+	template< typename ArchiveType, typename NumericTraitsType >
+	void serialize( ArchiveType &ar, NNet::BlockDiagonalLayer< NumericTraitsType >& obj, unsigned const /* version */ ) {
+		ar & boost::serialization::base_object< NNet::TrainableLayer< NumericTraitsType > >( obj );
+		ar & obj.getWeightMat();
+		ar & obj.getWeightGradMat();
+		ar & obj.getInputVec();
+		ar & obj.getOutputVec();
+		ar & obj.getOutputDeltaVec();
+	}
+
+	template< typename ArchiveType, typename NumericTraitsType >
+	void save_construct_data( ArchiveType &ar, NNet::BlockDiagonalLayer< NumericTraitsType > const* obj, unsigned const /* version */ ) {
+		std::size_t numBlocks, blockInputs, blockOutputs;
+		NNet::LayerType layer_type;
+		numBlocks = obj->getNumBlocks();
+		blockInputs = obj->getBlockInputs();
+		blockOutputs = obj->getBlockOutputs();
+		layer_type = obj->getLayerType();
+		ar << numBlocks;
+		ar << blockInputs;
+		ar << blockOutputs;
+		ar << layer_type;
+
+		// saved as plain matrices, the layer may be viewing a network's flat buffer
+		typename NNet::BlockDiagonalLayer< NumericTraitsType >::MatrixXType const weightMat = obj->getWeightMat();
+		typename NNet::BlockDiagonalLayer< NumericTraitsType >::MatrixXType const weightGradMat = obj->getWeightGradMat();
+		auto const& inputVec = obj->getInputVec();
+		auto const& outputVec = obj->getOutputVec();
+		auto const& outputDeltaVec = obj->getOutputDeltaVec();
+		ar << weightMat;
+		ar << weightGradMat;
+		ar << inputVec;
+		ar << outputVec;
+		ar << outputDeltaVec;
+	}
+
+	template< typename ArchiveType, typename NumericTraitsType >
+	void load_construct_data( ArchiveType &ar, NNet::BlockDiagonalLayer< NumericTraitsType >* obj, unsigned const /* version */ ) {
+		std::size_t numBlocks, blockInputs, blockOutputs;
+		NNet::LayerType layer_type;
+		ar >> numBlocks;
+		ar >> blockInputs;
+		ar >> blockOutputs;
+		ar >> layer_type;
+
+		typename NNet::BlockDiagonalLayer< NumericTraitsType >::MatrixXType weightMat, weightGradMat;
+		typename NNet::BlockDiagonalLayer< NumericTraitsType >::VectorXType inputVec, outputVec, outputDeltaVec;
+		ar >> weightMat;
+		ar >> weightGradMat;
+		ar >> inputVec;
+		ar >> outputVec;
+		ar >> outputDeltaVec;
+
+		::new( obj )NNet::BlockDiagonalLayer< NumericTraitsType >( numBlocks, blockInputs, blockOutputs, layer_type );
+		obj->getWeightMat() = weightMat;
+		obj->getWeightGradMat() = weightGradMat;
+		obj->getInputVec() = inputVec;
+		obj->getOutputVec() = outputVec;
+		obj->getOutputDeltaVec() = outputDeltaVec;
+	}
+
+} // end boost::serialization
+
+#endif // BLOCK_DIAGONAL_LAYER_HPP
@@ -23,6 +23,8 @@ namespace NNet { // begin NNet
 		using NumericType = typename BaseLayerType::NumericType;
 		using VectorXType = typename BaseLayerType::VectorXType;
 		using MatrixXType = typename BaseLayerType::MatrixXType;
+		using MatrixMapType = typename TrainableLayerType::MatrixMapType;
+		using ConstMatrixRefType = typename BaseLayerType::ConstMatrixRefType;
 
 	private: 	// private typedefs
 
@@ -30,17 +32,21 @@ namespace NNet { // begin NNet
 		FullyConnectedLayer( ) = delete;
 		explicit FullyConnectedLayer( std::size_t numInputs, std::size_t numOutputs, LayerType layerType )
 			: TrainableLayer< NumericTraitsType >( numInputs, numOutputs, layerType ),
-			mWeightMat( numInputs + 1, numOutputs ),
-			mWeightGradMat( numInputs + 1, numOutputs ),
-			mInputVec( numInputs + 1 ),
-			mOutputVec( numOutputs ),
-			mOutputDeltaVec( numInputs + 1 ) {
+			mWeightStorage( numInputs + 1, numOutputs ),
+			mWeightGradStorage( numInputs + 1, numOutputs ),
+			mWeightMat( mWeightStorage.data( ), numInputs + 1, numOutputs ),
+			mWeightGradMat( mWeightGradStorage.data( ), numInputs + 1, numOutputs ),
+			mInputVec( VectorXType::Zero( numInputs + 1 ) ),
+			mOutputVec( VectorXType::Zero( numOutputs ) ),
+			mOutputDeltaVec( VectorXType::Zero( numInputs ) ) {
 			this -> resetWeightGradMat( );
 		}
 		explicit FullyConnectedLayer( std::size_t numInputs, std::size_t numOutputs, LayerType layerType, MatrixXType const& weightMat, MatrixXType const& weightGradMat, VectorXType const& inputVec, VectorXType const& outputVec, VectorXType const& outputDeltaVec )
 			: TrainableLayer< NumericTraitsType >( numInputs, numOutputs, layerType ),
-			mWeightMat( weightMat ),
-			mWeightGradMat( weightGradMat ),
+			mWeightStorage( weightMat ),
+			mWeightGradStorage( weightGradMat ),
+			mWeightMat( mWeightStorage.data( ), weightMat.rows( ), weightMat.cols( ) ),
+			mWeightGradMat( mWeightGradStorage.data( ), weightGradMat.rows( ), weightGradMat.cols( ) ),
 			mInputVec( inputVec ),
 			mOutputVec( outputVec ),
 			mOutputDeltaVec( outputDeltaVec ) {
@@ -57,16 +63,39 @@ namespace NNet { // begin NNet
 		void setOutputVec( VectorXType const& outputVec ) { mOutputVec = outputVec; };
 		VectorXType& getOutputDeltaVec( ) override { return mOutputDeltaVec; }
 		VectorXType const& getOutputDeltaVec( ) const override { return mOutputDeltaVec; }
-		MatrixXType& getWeightMat( ) override { return mWeightMat; }
-		MatrixXType const& getWeightMat( ) const override { return mWeightMat; }
+		MatrixMapType& getWeightMat( ) override { return mWeightMat; }
+		MatrixMapType const& getWeightMat( ) const override { return mWeightMat; }
 
-		MatrixXType& getWeightGradMat( ) override { return mWeightGradMat; }
-		MatrixXType const& getWeightGradMat( ) const override { return mWeightGradMat; }
+		MatrixMapType& getWeightGradMat( ) override { return mWeightGradMat; }
+		MatrixMapType const& getWeightGradMat( ) const override { return mWeightGradMat; }
 
 		void resetWeightGradMat( ) override {
 			this -> getWeightGradMat( ).setZero( );
 		}
 
+		std::shared_ptr< BaseLayerType > clone( ) const override {
+			auto layer = std::make_shared< FullyConnectedLayer >( this -> getNumInputs( ), this -> getNumOutputs( ), this -> getLayerType( ),
+																  MatrixXType( mWeightMat ), MatrixXType( mWeightGradMat ),
+																  mInputVec, mOutputVec, mOutputDeltaVec );
+			layer -> setFrozen( this -> isFrozen( ) );
+			layer -> setPropagatesDelta( this -> getPropagatesDelta( ) );
+			return layer;
+		}
+
+		std::size_t getNumParameters( ) const override {
+			return static_cast< std::size_t >( mWeightMat.size( ) );
+		}
+
+		void bindParameters( NumericType* weightData, NumericType* weightGradData ) override {
+			auto rows = mWeightMat.rows( );
+			auto cols = mWeightMat.cols( );
+			// re-seat the maps, the layer's own storage is no longer needed
+			new ( &mWeightMat ) MatrixMapType( weightData, rows, cols );
+			new ( &mWeightGradMat ) MatrixMapType( weightGradData, rows, cols );
+			mWeightStorage.resize( 0, 0 );
+			mWeightGradStorage.resize( 0, 0 );
+		}
+
 		// self interface
 		void setNumNeurons( std::size_t n ) {
 			this -> setNumOutputs( n );
@@ -85,8 +114,9 @@ namespace NNet { // begin NNet
 		// forward compute
 		void forwardCompute( VectorXType const& inputVec, VectorXType &outputVec ) override {
 			mInputVec << inputVec, 1.0;
-			outputVec = getWeightMat( ).transpose( ) * mInputVec;
-			mOutputVec = outputVec;
+			outputVec.noalias( ) = getWeightMat( ).transpose( ) * mInputVec;
+			if ( &outputVec != &mOutputVec )
+				mOutputVec = outputVec;
 		}
 
 		// backward compute
@@ -96,15 +126,80 @@ namespace NNet { // begin NNet
 			// 		  << mInputVec << std::endl;
 			// std::cout << "inputDeltaVec: " << std::endl
 			// 		  << inputDeltaVec.transpose( ) << std::endl;
-			mWeightGradMat += mInputVec * inputDeltaVec.transpose( );
+			accumulateWeightGrad( inputDeltaVec );
 			// std::cout << "WeightGradMat: " << std::endl
 			// 		  << mWeightGradMat << std::endl;
-			outputDeltaVec = getWeightMat( ) * inputDeltaVec;
-			auto rows = outputDeltaVec.rows( );
-			outputDeltaVec = outputDeltaVec.segment( 0, rows - 1 );
-			mOutputDeltaVec = outputDeltaVec;
+			backwardComputeDelta( inputDeltaVec, outputDeltaVec );
 		};
 
+		void accumulateWeightGrad( VectorXType const& inputDeltaVec ) override {
+			if ( !this -> isFrozen( ) )
+				mWeightGradMat.noalias( ) += mInputVec * inputDeltaVec.transpose( );
+		}
+
+		void backwardComputeDelta( VectorXType const& inputDeltaVec, VectorXType& outputDeltaVec ) override {
+			if ( !this -> getPropagatesDelta( ) )
+				return;
+			// the bias row does not propagate a delta
+			auto rows = getWeightMat( ).rows( );
+			outputDeltaVec.noalias( ) = getWeightMat( ).topRows( rows - 1 ) * inputDeltaVec;
+			if ( &outputDeltaVec != &mOutputDeltaVec )
+				mOutputDeltaVec = outputDeltaVec;
+		}
+
+		// batched forward compute, one matrix product for the whole batch
+		MatrixXType& getOutputMat( ) override { return mOutputMat; }
+		void forwardComputeBatch( ConstMatrixRefType inputMat ) override {
+			auto batchSize = inputMat.cols( );
+			auto rows = getWeightMat( ).rows( );
+			this -> reserveBatch( mInputMat, rows, batchSize );
+			this -> reserveBatch( mOutputMat, getWeightMat( ).cols( ), batchSize );
+			mInputMat.topLeftCorner( rows - 1, batchSize ) = inputMat;
+			mInputMat.row( rows - 1 ).head( batchSize ).setOnes( );
+			mOutputMat.leftCols( batchSize ).noalias( ) = getWeightMat( ).transpose( ) * mInputMat.leftCols( batchSize );
+		}
+
+		// batched backward compute, the weight gradient of the batch is one matrix product
+		MatrixXType& getOutputDeltaMat( ) override { return mOutputDeltaMat; }
+		void backwardComputeBatch( ConstMatrixRefType inputDeltaMat ) override {
+			accumulateWeightGradBatch( inputDeltaMat );
+			backwardComputeDeltaBatch( inputDeltaMat );
+		}
+
+		void accumulateWeightGradBatch( ConstMatrixRefType inputDeltaMat ) override {
+			if ( !this -> isFrozen( ) )
+				mWeightGradMat.noalias( ) += mInputMat.leftCols( inputDeltaMat.cols( ) ) * inputDeltaMat.transpose( );
+		}
+
+		void backwardComputeDeltaBatch( ConstMatrixRefType inputDeltaMat ) override {
+			if ( !this -> getPropagatesDelta( ) )
+				return;
+			auto batchSize = inputDeltaMat.cols( );
+			auto rows = getWeightMat( ).rows( );
+			this -> reserveBatch( mOutputDeltaMat, rows - 1, batchSize );
+			mOutputDeltaMat.leftCols( batchSize ).noalias( ) = getWeightMat( ).topRows( rows - 1 ) * inputDeltaMat;
+		}
+
+		std::size_t getBatchColumnSize( ) const override {
+			return static_cast< std::size_t >( 2 * getWeightMat( ).rows( ) - 1 + getWeightMat( ).cols( ) );
+		}
+		void releaseBatch( bool keepOutput, bool keepOutputDelta ) override {
+			mInputMat.resize( 0, 0 );
+			if ( !keepOutput )
+				mOutputMat.resize( 0, 0 );
+			if ( !keepOutputDelta )
+				mOutputDeltaMat.resize( 0, 0 );
+		}
+
+		// sliced forward compute, a slice of outputs is a block of the weight matrix's columns
+		bool isSliceable( ) const override { return true; }
+		void forwardComputeSlice( VectorXType const& inputVec, VectorXType& outputVec, std::size_t begin, std::size_t size ) const override {
+			auto rows = getWeightMat( ).rows( );
+			auto weightBlock = getWeightMat( ).middleCols( begin, size );
+			outputVec.segment( begin, size ).noalias( ) = weightBlock.topRows( rows - 1 ).transpose( ) * inputVec;
+			outputVec.segment( begin, size ) += weightBlock.row( rows - 1 ).transpose( );
+		}
+
 		bool operator==( FullyConnectedLayer const& other ) const {
 			return ( mWeightMat == other.getWeightMat() &&
 					 mWeightGradMat == other.getWeightGradMat() &&
@@ -125,9 +220,13 @@ namespace NNet { // begin NNet
 	public: 	//public data members
 
 	private: 	//private data members
-		MatrixXType mWeightMat, mWeightGradMat;
+		// own storage, used until the layer is bound to a network's flat parameter buffer
+		MatrixXType mWeightStorage, mWeightGradStorage;
+		MatrixMapType mWeightMat, mWeightGradMat;
 		VectorXType mInputVec, mOutputVec;
 		VectorXType mOutputDeltaVec;
+		// batch work matrices, the input carries a row of ones for the bias
+		MatrixXType mInputMat, mOutputMat, mOutputDeltaMat;
 	}; // end of class FullyConnectedLayer
 
 } // end NNet
@@ -154,8 +253,9 @@ namespace boost::serialization { // begin boost::serialization
 		ar << numOutputs;
 		ar << layer_type;
 
-		auto const& weightMat = obj->getWeightMat();
-		auto const& weightGradMat = obj->getWeightGradMat();
+		// saved as plain matrices, the layer may be viewing a network's flat buffer
+		typename NNet::FullyConnectedLayer< NumericTraitsType >::MatrixXType const weightMat = obj->getWeightMat();
+		typename NNet::FullyConnectedLayer< NumericTraitsType >::MatrixXType const weightGradMat = obj->getWeightGradMat();
 		auto const& inputVec = obj->getInputVec();
 		auto const& outputVec = obj->getOutputVec();
 		auto const& outputDeltaVec = obj->getOutputDeltaVec();
@@ -22,6 +22,8 @@ namespace NNet { // begin NNet
 		using NumericType = typename BaseLayerType::NumericType;
 		using VectorXType = typename BaseLayerType::VectorXType;
 		using MatrixXType = typename BaseLayerType::MatrixXType;
+		using MatrixMapType = typename NumericTraitsType::MatrixMapType;
+		using ConstMatrixRefType = typename BaseLayerType::ConstMatrixRefType;
 
 	private: 	// private typedefs
 
@@ -34,11 +36,30 @@ namespace NNet { // begin NNet
 		~TrainableLayer( ) = default;
 
 		// get/set member functions
-		virtual MatrixXType& getWeightMat( ) = 0;
-		virtual MatrixXType const& getWeightMat( ) const = 0;
-		virtual MatrixXType& getWeightGradMat( ) = 0;
-		virtual MatrixXType const& getWeightGradMat( ) const = 0;
+		virtual MatrixMapType& getWeightMat( ) = 0;
+		virtual MatrixMapType const& getWeightMat( ) const = 0;
+		virtual MatrixMapType& getWeightGradMat( ) = 0;
+		virtual MatrixMapType const& getWeightGradMat( ) const = 0;
 		virtual void resetWeightGradMat( ) = 0;
+		// a frozen layer accumulates no weight gradient and is skipped by the optimizers,
+		// freeze through NeuralNetwork::setFrozen so that the backward plan is updated
+		bool isFrozen( ) const { return mFrozen; }
+		void setFrozen( bool frozen ) { mFrozen = frozen; }
+
+		// parameter storage
+		// number of weight (and weight gradient) elements
+		virtual std::size_t getNumParameters( ) const = 0;
+		// view external, suitably aligned storage of getNumParameters( ) elements as the
+		// weight and weight gradient matrices (column major); the values are not copied
+		virtual void bindParameters( NumericType* weightData, NumericType* weightGradData ) = 0;
+
+		// the two independent halves of the backward compute, the weight gradient and the
+		// delta propagated to the layer before (backwardCompute( Batch ) does both). Both only
+		// read the layer's input and inputDelta, so they may run concurrently.
+		virtual void accumulateWeightGrad( VectorXType const& inputDeltaVec ) = 0;
+		virtual void backwardComputeDelta( VectorXType const& inputDeltaVec, VectorXType& outputDeltaVec ) = 0;
+		virtual void accumulateWeightGradBatch( ConstMatrixRefType inputDeltaMat ) = 0;
+		virtual void backwardComputeDeltaBatch( ConstMatrixRefType inputDeltaMat ) = 0;
 
 		bool isTrainableLayer( ) const override { return true; }
 
@@ -47,7 +68,7 @@ namespace NNet { // begin NNet
 	public: 	//public data members
 
 	private: 	//private data members
-
+		bool mFrozen = false;
 	}; // end of class TrainableLayer
 
 } // end NNet
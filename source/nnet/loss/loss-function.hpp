@@ -21,6 +21,11 @@ namespace NNet { // begin NNet
 			return ( outputVec - targetVec );
 		}
 
+		// gradLoss into a preallocated vector
+		void gradLoss( VectorXType const& outputVec, VectorXType const& targetVec, VectorXType& gradLossVec ) const {
+			gradLossVec = outputVec - targetVec;
+		}
+
 	};
 
 	template< typename NumericTraitsType >
@@ -39,6 +44,11 @@ namespace NNet { // begin NNet
 			return ( outputVec - targetVec ).cwiseQuotient( outputVec.cwiseProduct( onesVec - outputVec ) );
 		}
 
+		// gradLoss into a preallocated vector
+		void gradLoss( VectorXType const& outputVec, VectorXType const& targetVec, VectorXType& gradLossVec ) const {
+			gradLossVec = ( outputVec - targetVec ).cwiseQuotient( outputVec.cwiseProduct( VectorXType::Ones( outputVec.size( ) ) - outputVec ) );
+		}
+
 	};
 
 	template< typename NumericTraitsType >
@@ -56,6 +66,11 @@ namespace NNet { // begin NNet
 			return -targetVec.cwiseQuotient( outputVec );
 		}
 
+		// gradLoss into a preallocated vector
+		void gradLoss( VectorXType const& outputVec, VectorXType const& targetVec, VectorXType& gradLossVec ) const {
+			gradLossVec = -targetVec.cwiseQuotient( outputVec );
+		}
+
 	};
 
 	template< typename NumericTraitsType >
@@ -73,6 +88,11 @@ namespace NNet { // begin NNet
 			return -targetVec;
 		}
 
+		// gradLoss into a preallocated vector
+		void gradLoss( VectorXType const& /* outputVec */, VectorXType const& targetVec, VectorXType& gradLossVec ) const {
+			gradLossVec = -targetVec;
+		}
+
 	};
 
 	/**
@@ -101,6 +121,11 @@ namespace NNet { // begin NNet
 		VectorXType gradLoss( VectorXType const& outputVec, VectorXType const& targetVec ) const {
 			return mLossFun.gradLoss( outputVec, targetVec );
 		}
+
+		// gradLoss into a preallocated vector, no allocation once gradLossVec is sized
+		void gradLoss( VectorXType const& outputVec, VectorXType const& targetVec, VectorXType& gradLossVec ) const {
+			mLossFun.gradLoss( outputVec, targetVec, gradLossVec );
+		}
 	private: 	//private member functions
 
 	public: 	//public data members
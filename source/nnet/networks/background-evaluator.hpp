@@ -0,0 +1,194 @@
+#ifndef BACKGROUND_EVALUATOR_HPP
+#define BACKGROUND_EVALUATOR_HPP
+
+// System includes --------------------
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+// Own includes --------------------
+#include "utils/task-scheduler.hpp"
+
+namespace NNet { // begin NNet
+
+	// the data sets of a data handler
+	enum class DataSet { TRAINING, VALIDATION, TESTING };
+
+	/**
+	 *BackgroundEvaluator. Evaluates a network on data sets of its data handler,
+	 *as tasks on a task scheduler (the trainer's), while the network trains on.
+	 *evaluate( epoch ) takes a snapshot of the weights and returns: the snapshot
+	 *is a copy of the network kept between evaluations, so taking it is one copy
+	 *of the flat parameter buffer and training may change the weights right
+	 *after. numParts tasks each run a contiguous part of each data set on a
+	 *replica of the snapshot, the task that finishes last sums the parts in
+	 *order and calls the callback with the mean loss and the accuracy (the
+	 *output's largest element is the target's) of every data set. The tasks run
+	 *on idle threads of the scheduler or on a thread waiting for the scheduler,
+	 *at the latest in wait( ). An evaluation waits for the one before it to be
+	 *delivered.
+	 */
+	template< typename NetworkType, typename LossFunctionType, typename DataHandlerType >
+	class BackgroundEvaluator {
+	public: 	// public typedefs
+		using NumericType = typename NetworkType::NumericType;
+		using VectorXType = typename NetworkType::VectorXType;
+
+		struct Result {
+			DataSet dataSet = DataSet::VALIDATION;
+			// mean loss
+			NumericType loss = 0.0;
+			std::size_t numCorrect = 0, numSamples = 0;
+
+			NumericType getAccuracy( ) const {
+				return numSamples > 0 ? static_cast< NumericType >( numCorrect ) / static_cast< NumericType >( numSamples ) : 0.0;
+			}
+		};
+		// called on a thread of the scheduler with the epoch passed to evaluate and a result per data set
+		using CallbackType = std::function< void( std::size_t epoch, std::vector< Result > const& results ) >;
+
+	private: 	// private typedefs
+
+	public: 	//public member functions
+		BackgroundEvaluator( ) = delete;
+		explicit BackgroundEvaluator( NetworkType& network, LossFunctionType const& lossFun, DataHandlerType& dataHandler,
+									  std::vector< DataSet > dataSets, CallbackType callback,
+									  std::shared_ptr< Utils::TaskScheduler > scheduler, std::size_t numParts = 1 )
+			: mNetwork( network ), mLossFun( lossFun ), mDataHandler( dataHandler ), mDataSets( std::move( dataSets ) ),
+			  mCallback( std::move( callback ) ), mScheduler( std::move( scheduler ) ), mNumParts( std::max< std::size_t >( numParts, 1 ) ),
+			  mPartResults( mNumParts, std::vector< Result >( mDataSets.size( ) ) ), mResults( mDataSets.size( ) ),
+			  mReplicas( mNumParts ) {
+			if ( !mCallback )
+				throw std::runtime_error( "A background evaluation needs a callback." );
+			if ( !mScheduler )
+				throw std::runtime_error( "A background evaluation needs a task scheduler." );
+		}
+		BackgroundEvaluator( BackgroundEvaluator const& other ) = delete;
+		/// Finishes the running evaluation
+		~BackgroundEvaluator( ) {
+			try {
+				wait( );
+			}
+			catch ( ... ) {
+			}
+		}
+
+		// get/set member functions
+		std::vector< DataSet > const& getDataSets( ) const { return mDataSets; }
+		bool evaluates( DataSet dataSet ) const { return std::find( mDataSets.begin( ), mDataSets.end( ), dataSet ) != mDataSets.end( ); }
+		std::size_t getNumParts( ) const { return mNumParts; }
+		std::shared_ptr< Utils::TaskScheduler > const& getScheduler( ) const { return mScheduler; }
+		void setScheduler( std::shared_ptr< Utils::TaskScheduler > scheduler ) {
+			if ( !scheduler )
+				throw std::runtime_error( "A background evaluation needs a task scheduler." );
+			wait( );
+			mScheduler = std::move( scheduler );
+		}
+
+		// the results of the last evaluation (after wait( )), a result per data set, and
+		// the snapshot of the weights they are for (nullptr before the first evaluation)
+		std::vector< Result > const& getResults( ) const { return mResults; }
+		NetworkType const* getSnapshot( ) const { return mSnapshot.get( ); }
+
+		// Snapshots the network's current weights and starts evaluating them
+		void evaluate( std::size_t epoch ) {
+			wait( );
+			if ( !mNetwork.isPacked( ) )
+				mNetwork.packParameters( );
+			if ( !mSnapshot || mSnapshot -> getNumLayers( ) != mNetwork.getNumLayers( ) || mSnapshot -> getNumParameters( ) != mNetwork.getNumParameters( ) )
+				mSnapshot = mNetwork.makeCopy( );
+			else
+				mSnapshot -> getParameterVec( ) = mNetwork.getParameterVec( );
+			for ( auto& replica : mReplicas ) {
+				if ( !replica || !replica -> sharesParameters( *mSnapshot ) )
+					replica = mSnapshot -> makeReplica( );
+			}
+			mEpoch = epoch;
+			mNumPartsLeft.store( mNumParts );
+			for ( std::size_t part = 0; part < mNumParts; ++part ) {
+				mScheduler -> run( mGroup, [this, part]( ) { evaluatePart( part ); } );
+			}
+		}
+
+		// Runs the tasks of the running evaluation that are left until it has been
+		// delivered, rethrows what it (or the callback) threw
+		void wait( ) { mScheduler -> wait( mGroup ); }
+
+	private: 	//private member functions
+		auto const& getData( DataSet dataSet ) const {
+			switch ( dataSet ) {
+			case DataSet::TRAINING: return mDataHandler.getTrainingData( );
+			case DataSet::VALIDATION: return mDataHandler.getValidationData( );
+			default: return mDataHandler.getTestingData( );
+			}
+		}
+
+		void evaluatePart( std::size_t part ) {
+			auto& network = *mReplicas[part];
+			for ( std::size_t set = 0; set < mDataSets.size( ); ++set ) {
+				auto const& data = getData( mDataSets[set] );
+				auto& result = mPartResults[part][set];
+				result = Result{ mDataSets[set] };
+				std::size_t begin = data.size( ) * part / mNumParts;
+				std::size_t end = data.size( ) * ( part + 1 ) / mNumParts;
+				for ( std::size_t i = begin; i < end; ++i ) {
+					VectorXType const* layerInput = &mDataHandler.getInput( data[i] );
+					for ( auto& layer : network ) {
+						layer -> forwardCompute( *layerInput, layer -> getOutputVec( ) );
+						layerInput = &layer -> getOutputVec( );
+					}
+					auto const& target = mDataHandler.getTarget( data[i] );
+					result.loss += mLossFun.loss( *layerInput, target );
+					Eigen::Index outputLabel, targetLabel;
+					layerInput -> maxCoeff( &outputLabel );
+					target.maxCoeff( &targetLabel );
+					result.numCorrect += outputLabel == targetLabel;
+					++result.numSamples;
+				}
+			}
+			if ( mNumPartsLeft.fetch_sub( 1 ) != 1 )
+				return;
+			// the last part sums the parts in order, the results don't depend on which that is
+			for ( std::size_t set = 0; set < mDataSets.size( ); ++set ) {
+				auto& result = mResults[set];
+				result = Result{ mDataSets[set] };
+				for ( auto const& partResults : mPartResults ) {
+					result.loss += partResults[set].loss;
+					result.numCorrect += partResults[set].numCorrect;
+					result.numSamples += partResults[set].numSamples;
+				}
+				if ( result.numSamples > 0 )
+					result.loss /= static_cast< NumericType >( result.numSamples );
+			}
+			mCallback( mEpoch, mResults );
+		}
+
+	public: 	//public data members
+
+	private: 	//private data members
+		NetworkType& mNetwork;
+		LossFunctionType const& mLossFun;
+		DataHandlerType& mDataHandler;
+		std::vector< DataSet > mDataSets;
+		CallbackType mCallback;
+		std::shared_ptr< Utils::TaskScheduler > mScheduler;
+		std::size_t mNumParts;
+		std::size_t mEpoch = 0;
+		// the results of every part and data set, and their sums
+		std::vector< std::vector< Result > > mPartResults;
+		std::vector< Result > mResults;
+		std::atomic< std::size_t > mNumPartsLeft { 0 };
+		// the snapshot of the weights and its replicas (one per part)
+		std::unique_ptr< NetworkType > mSnapshot;
+		std::vector< std::unique_ptr< NetworkType > > mReplicas;
+		// the tasks of the running evaluation
+		Utils::TaskGroup mGroup;
+	}; // end of class BackgroundEvaluator
+
+} // end NNet
+
+#endif // BACKGROUND_EVALUATOR_HPP
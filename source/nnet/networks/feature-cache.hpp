@@ -0,0 +1,136 @@
+#ifndef FEATURE_CACHE_HPP
+#define FEATURE_CACHE_HPP
+
+// System includes --------------------
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <string>
+
+// Own includes --------------------
+#include "utils/aligned-buffer.hpp"
+#include "utils/mapped-file.hpp"
+
+namespace NNet { // begin NNet
+
+	/**
+	 *FeatureCache. Holds the outputs of a network's frozen leading layers (the
+	 *inputs of its first layer that is trained) for every training sample,
+	 *one cache line aligned column per sample. Up to the memory limit the
+	 *features are kept in memory, larger caches live in a memory mapped file.
+	 *The cache remembers what the features were computed from, the number of
+	 *leading layers, a fingerprint of the training inputs and the leading
+	 *layers' weights, so the trainer can tell when it has to be rebuilt.
+	 */
+	template< typename NumericTraitsType >
+	class FeatureCache {
+	public: 	// public typedefs
+		using NumericType = typename NumericTraitsType::NumericType;
+		using VectorMapType = typename NumericTraitsType::VectorMapType;
+		using ConstVectorMapType = typename NumericTraitsType::ConstVectorMapType;
+		using ParameterBufferType = Utils::AlignedBuffer< NumericType >;
+
+	private: 	// private typedefs
+
+	public: 	// public static data members
+		static constexpr std::size_t default_memory_limit = std::size_t( 1 ) << 30;
+		static constexpr std::uint64_t initial_fingerprint = 14695981039346656037ull;
+
+	public: 	//public member functions
+		FeatureCache( ) = default;
+		FeatureCache( FeatureCache const& other ) = delete;
+		~FeatureCache( ) = default;
+
+		// get/set member functions
+		// largest cache (in bytes) kept in memory
+		std::size_t getMemoryLimit( ) const { return mMemoryLimit; }
+		void setMemoryLimit( std::size_t memoryLimit ) { mMemoryLimit = memoryLimit; }
+		// directory of the mapped file, the system's temporary directory by default
+		std::string getDirectory( ) const { return mDirectory.empty( ) ? std::filesystem::temp_directory_path( ).string( ) : mDirectory; }
+		void setDirectory( std::string const& directory ) { mDirectory = directory; }
+		std::size_t getNumPrefixLayers( ) const { return mNumPrefixLayers; }
+		std::size_t getNumFeatures( ) const { return mNumFeatures; }
+		std::size_t getNumSamples( ) const { return mNumSamples; }
+		bool isValid( ) const { return mValid; }
+		bool isMapped( ) const { return !mMappedFile.empty( ); }
+
+		void invalidate( ) { mValid = false; }
+
+		// Order sensitive (FNV-1a) fingerprint of values, chained over the samples from
+		// initial_fingerprint. Reordering or changing the samples changes it.
+		static std::uint64_t fingerprint( std::uint64_t hash, NumericType const* values, std::size_t size ) {
+			for ( std::size_t i = 0; i < size; ++i ) {
+				std::uint64_t bits = 0;
+				std::memcpy( &bits, values + i, sizeof( NumericType ) );
+				hash = ( hash ^ bits ) * 1099511628211ull;
+			}
+			return hash;
+		}
+
+		// true when the cache holds the features computed by numPrefixLayers layers with
+		// the weights prefixParameterVec for the numSamples samples of the given fingerprint
+		template< typename ParameterVecType >
+		bool matches( std::size_t numPrefixLayers, std::uint64_t dataFingerprint, std::size_t numSamples, ParameterVecType const& prefixParameterVec ) const {
+			return mValid && numPrefixLayers == mNumPrefixLayers && dataFingerprint == mDataFingerprint && numSamples == mNumSamples
+				&& static_cast< std::size_t >( prefixParameterVec.size( ) ) == mPrefixParameters.size( )
+				&& std::equal( mPrefixParameters.data( ), mPrefixParameters.data( ) + mPrefixParameters.size( ), prefixParameterVec.data( ) );
+		}
+
+		// Sizes the storage for numSamples features of numFeatures elements (reusing it
+		// when large enough) and records what the features are computed from. The cache
+		// is valid once the features have been written and validate( ) is called.
+		template< typename ParameterVecType >
+		void reset( std::size_t numPrefixLayers, std::size_t numFeatures, std::uint64_t dataFingerprint, std::size_t numSamples, ParameterVecType const& prefixParameterVec ) {
+			mValid = false;
+			std::size_t stride = ParameterBufferType::paddedSize( numFeatures );
+			std::size_t numElements = stride * numSamples;
+			if ( numElements * sizeof( NumericType ) <= mMemoryLimit ) {
+				mMappedFile = Utils::MappedFile( );
+				if ( mMemory.size( ) < numElements )
+					mMemory = ParameterBufferType( numElements );
+				mData = mMemory.data( );
+			}
+			else {
+				mMemory = ParameterBufferType( );
+				if ( mMappedFile.size( ) < numElements * sizeof( NumericType ) )
+					mMappedFile = Utils::MappedFile( numElements * sizeof( NumericType ), getDirectory( ) );
+				mData = static_cast< NumericType* >( mMappedFile.data( ) );
+			}
+			mNumPrefixLayers = numPrefixLayers;
+			mNumFeatures = numFeatures;
+			mStride = stride;
+			mDataFingerprint = dataFingerprint;
+			mNumSamples = numSamples;
+			if ( mPrefixParameters.size( ) != static_cast< std::size_t >( prefixParameterVec.size( ) ) )
+				mPrefixParameters = ParameterBufferType( prefixParameterVec.size( ) );
+			std::copy( prefixParameterVec.data( ), prefixParameterVec.data( ) + prefixParameterVec.size( ), mPrefixParameters.data( ) );
+		}
+		void validate( ) { mValid = true; }
+
+		VectorMapType getFeatureVec( std::size_t sample ) { return VectorMapType( mData + sample * mStride, mNumFeatures ); }
+		ConstVectorMapType getFeatureVec( std::size_t sample ) const { return ConstVectorMapType( mData + sample * mStride, mNumFeatures ); }
+
+	private: 	//private member functions
+
+	public: 	//public data members
+
+	private: 	//private data members
+		std::size_t mMemoryLimit = default_memory_limit;
+		std::string mDirectory;
+		ParameterBufferType mMemory;
+		Utils::MappedFile mMappedFile;
+		NumericType* mData = nullptr;
+		std::size_t mNumPrefixLayers = 0;
+		std::size_t mNumFeatures = 0;
+		std::size_t mStride = 0;
+		std::uint64_t mDataFingerprint = 0;
+		std::size_t mNumSamples = 0;
+		ParameterBufferType mPrefixParameters;
+		bool mValid = false;
+	}; // end of class FeatureCache
+
+} // end NNet
+
+#endif // FEATURE_CACHE_HPP
@@ -0,0 +1,362 @@
+#ifndef HYPERPARAMETER_SEARCH_HPP
+#define HYPERPARAMETER_SEARCH_HPP
+
+// System includes --------------------
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Own includes --------------------
+#include "data-handlers/data-handlers.hpp"
+#include "networks/network-trainer.hpp"
+#include "utils/numa-topology.hpp"
+#include "utils/task-scheduler.hpp"
+
+namespace NNet { // begin NNet
+
+	/**
+	 *SearchSpace. The hyperparameters of a search by name, each one a list of
+	 *values (an axis of the grid, random search draws one of them) or a range
+	 *random search draws from, uniformly or log uniformly (e.g. learning rates).
+	 */
+	class SearchSpace {
+	public: 	// public typedefs
+		// the value of every hyperparameter, by name
+		using ConfigurationType = std::map< std::string, double >;
+
+	private: 	// private typedefs
+		struct Parameter {
+			std::string name;
+			std::vector< double > values;
+			double low = 0.0, high = 0.0;
+			bool logScale = false;
+		};
+
+	public: 	//public member functions
+		SearchSpace( ) = default;
+		~SearchSpace( ) = default;
+
+		std::size_t getNumParameters( ) const { return mParameters.size( ); }
+
+		SearchSpace& addValues( std::string const& name, std::vector< double > values ) {
+			if ( values.empty( ) )
+				throw std::runtime_error( "The hyperparameter " + name + " has no values." );
+			mParameters.push_back( Parameter{ name, std::move( values ) } );
+			return *this;
+		}
+		SearchSpace& addRange( std::string const& name, double low, double high, bool logScale = false ) {
+			if ( !( low <= high ) || ( logScale && low <= 0.0 ) )
+				throw std::runtime_error( "The hyperparameter " + name + " has an invalid range." );
+			mParameters.push_back( Parameter{ name, { }, low, high, logScale } );
+			return *this;
+		}
+
+		// every combination of the values, the last hyperparameter added varies fastest
+		std::vector< ConfigurationType > getGrid( ) const {
+			std::vector< ConfigurationType > grid( 1 );
+			for ( auto const& parameter : mParameters ) {
+				if ( parameter.values.empty( ) )
+					throw std::runtime_error( "A grid needs lists of values, " + parameter.name + " is a range." );
+				std::vector< ConfigurationType > extended;
+				for ( auto const& configuration : grid ) {
+					for ( double value : parameter.values ) {
+						extended.push_back( configuration );
+						extended.back( )[parameter.name] = value;
+					}
+				}
+				grid.swap( extended );
+			}
+			return grid;
+		}
+
+		template< typename RandomEngineType >
+		ConfigurationType sample( RandomEngineType& g ) const {
+			ConfigurationType configuration;
+			for ( auto const& parameter : mParameters ) {
+				double& value = configuration[parameter.name];
+				if ( !parameter.values.empty( ) ) {
+					std::uniform_int_distribution< std::size_t > d( 0, parameter.values.size( ) - 1 );
+					value = parameter.values[d( g )];
+				}
+				else if ( parameter.logScale ) {
+					std::uniform_real_distribution< double > d( std::log( parameter.low ), std::log( parameter.high ) );
+					value = std::exp( d( g ) );
+				}
+				else {
+					std::uniform_real_distribution< double > d( parameter.low, parameter.high );
+					value = d( g );
+				}
+			}
+			return configuration;
+		}
+		template< typename RandomEngineType >
+		std::vector< ConfigurationType > sample( std::size_t numConfigurations, RandomEngineType& g ) const {
+			std::vector< ConfigurationType > configurations;
+			for ( std::size_t i = 0; i < numConfigurations; ++i ) {
+				configurations.push_back( sample( g ) );
+			}
+			return configurations;
+		}
+
+	private: 	//private member functions
+
+	public: 	//public data members
+
+	private: 	//private data members
+		std::vector< Parameter > mParameters;
+	}; // end of class SearchSpace
+
+	/**
+	 *HyperparameterSearch. Trains a NetworkTrainer per configuration (a trial),
+	 *many at the same time, and ranks them by their mean validation loss. The
+	 *factories make a trial's network and optimizer from its configuration, a
+	 *"batch_size" entry overrides the batch size. All trials train on views
+	 *(SharedDataHandler) of one data handler, so the data is held in memory
+	 *once, split the validation data off it first. numThreads is the thread
+	 *budget of the whole search: the trials are tasks on one task scheduler of
+	 *numThreads threads (pinned to the nodes given a NUMA topology), and the
+	 *trials' trainers run their own parallel work as tasks on the same
+	 *scheduler, so at most numThreads trials train at once. When fewer trials
+	 *are left than threads, the threads of stopped trials go to the trials
+	 *left (overlapped updates and weight gradients, the results don't change).
+	 *The trials don't draw progress bars.
+	 *
+	 *Grid and random search train every trial for numEpochs. Successive
+	 *halving trains the trials for minEpochs, keeps the best 1 / eta of them,
+	 *stops the others and trains the trials left eta times as long (up to
+	 *maxEpochs), until maxEpochs. Hyperband runs brackets of successive
+	 *halving from many trials and few epochs to few trials trained for
+	 *maxEpochs from the start.
+	 */
+	template< typename NetworkType,
+			  typename OptimizerType,
+			  template< typename > class LossFunType,
+			  typename DataHandlerType >
+	class HyperparameterSearch {
+	public: 	// public typedefs
+		using NumericType = typename NetworkType::NumericType;
+		using ConfigurationType = SearchSpace::ConfigurationType;
+		using SharedDataHandlerType = SharedDataHandler< DataHandlerType >;
+		using TrainerType = NetworkTrainer< NetworkType, OptimizerType, LossFunType, SharedDataHandlerType >;
+		using NetworkFactoryType = std::function< std::unique_ptr< NetworkType >( ConfigurationType const& ) >;
+		using OptimizerFactoryType = std::function< std::unique_ptr< OptimizerType >( NetworkType&, ConfigurationType const& ) >;
+		// called on a trial's trainer after it is made, e.g. to set a micro batch size
+		using TrainerSetupType = std::function< void( TrainerType&, ConfigurationType const& ) >;
+
+		struct Result {
+			ConfigurationType configuration;
+			// epochs trained and the mean validation loss after them
+			std::size_t numEpochs = 0;
+			NumericType loss = 0.0;
+			// stopped by successive halving before the full budget
+			bool stopped = false;
+			// the trained network of a trial that was not stopped
+			std::unique_ptr< NetworkType > network;
+		};
+
+	private: 	// private typedefs
+		struct Trial {
+			std::size_t resultIndex = 0;
+			std::size_t batchSize = 0;
+			std::unique_ptr< NetworkType > network;
+			std::unique_ptr< OptimizerType > optimizer;
+			std::unique_ptr< SharedDataHandlerType > dataHandler;
+			std::unique_ptr< TrainerType > trainer;
+		};
+
+	public: 	// public static data members
+		static constexpr std::size_t default_batch_size = 32;
+
+	public: 	//public member functions
+		HyperparameterSearch( ) = delete;
+		explicit HyperparameterSearch( DataHandlerType const& dataHandler, NetworkFactoryType networkFactory, OptimizerFactoryType optimizerFactory,
+									   std::size_t numThreads = std::thread::hardware_concurrency( ),
+									   std::shared_ptr< Utils::NumaTopology const > topology = nullptr )
+			: mDataHandler( dataHandler ), mNetworkFactory( std::move( networkFactory ) ), mOptimizerFactory( std::move( optimizerFactory ) ),
+			  mNumThreads( std::max< std::size_t >( numThreads, 1 ) ),
+			  mScheduler( std::make_shared< Utils::TaskScheduler >( mNumThreads, Utils::TaskScheduler::default_deque_capacity, std::move( topology ) ) ) {
+			if ( !mNetworkFactory || !mOptimizerFactory )
+				throw std::runtime_error( "A hyperparameter search needs a network and an optimizer factory." );
+		}
+		HyperparameterSearch( HyperparameterSearch const& other ) = delete;
+		~HyperparameterSearch( ) = default;
+
+		// get/set member functions
+		std::size_t getNumThreads( ) const { return mNumThreads; }
+		std::size_t getBatchSize( ) const { return mBatchSize; }
+		void setBatchSize( std::size_t batchSize ) { mBatchSize = std::max< std::size_t >( batchSize, 1 ); }
+		void setTrainerSetup( TrainerSetupType trainerSetup ) { mTrainerSetup = std::move( trainerSetup ); }
+
+		// the results of the last search, in the order the trials were made
+		std::vector< Result >& getResults( ) { return mResults; }
+		std::vector< Result > const& getResults( ) const { return mResults; }
+		// the trial with the lowest loss of those that were not stopped
+		Result& getBest( ) {
+			auto best = mResults.end( );
+			for ( auto iter = mResults.begin( ); iter != mResults.end( ); ++iter ) {
+				if ( !iter -> stopped && ( best == mResults.end( ) || isBetter( iter -> loss, best -> loss ) ) )
+					best = iter;
+			}
+			if ( best == mResults.end( ) )
+				throw std::runtime_error( "No trial has finished..." );
+			return *best;
+		}
+
+		std::vector< Result >& gridSearch( SearchSpace const& space, std::size_t numEpochs ) {
+			return search( space.getGrid( ), numEpochs );
+		}
+
+		std::vector< Result >& randomSearch( SearchSpace const& space, std::size_t numTrials, std::size_t numEpochs, unsigned seed = 0 ) {
+			std::mt19937 g( seed );
+			return search( space.sample( numTrials, g ), numEpochs );
+		}
+
+		// trains every configuration for numEpochs
+		std::vector< Result >& search( std::vector< ConfigurationType > const& configurations, std::size_t numEpochs ) {
+			mResults.clear( );
+			runBracket( configurations, numEpochs, numEpochs, 2 );
+			return mResults;
+		}
+
+		std::vector< Result >& successiveHalving( std::vector< ConfigurationType > const& configurations, std::size_t minEpochs,
+												  std::size_t maxEpochs, std::size_t eta = 3 ) {
+			mResults.clear( );
+			runBracket( configurations, minEpochs, maxEpochs, eta );
+			return mResults;
+		}
+
+		// Hyperband with brackets s = s_max, ..., 0 (s_max = floor( log_eta( maxEpochs ) )),
+		// bracket s draws ceil( ( s_max + 1 ) / ( s + 1 ) * eta^s ) configurations and halves
+		// them from maxEpochs / eta^s epochs
+		std::vector< Result >& hyperband( SearchSpace const& space, std::size_t maxEpochs, std::size_t eta = 3, unsigned seed = 0 ) {
+			if ( eta < 2 || maxEpochs == 0 )
+				throw std::runtime_error( "Hyperband needs eta > 1 and at least an epoch." );
+			std::mt19937 g( seed );
+			std::size_t maxBracket = 0;
+			for ( std::size_t epochs = maxEpochs; epochs >= eta; epochs /= eta ) {
+				++maxBracket;
+			}
+			mResults.clear( );
+			for ( std::size_t s = maxBracket + 1; s-- > 0; ) {
+				std::size_t power = 1;
+				for ( std::size_t i = 0; i < s; ++i ) {
+					power *= eta;
+				}
+				std::size_t numTrials = ( ( maxBracket + 1 ) * power + s ) / ( s + 1 );
+				runBracket( space.sample( numTrials, g ), std::max< std::size_t >( maxEpochs / power, 1 ), maxEpochs, eta );
+			}
+			return mResults;
+		}
+
+	private: 	//private member functions
+		// lower losses are better, losses that aren't numbers (diverged trials) are worst
+		static bool isBetter( NumericType loss, NumericType other ) {
+			return loss < other || ( std::isnan( other ) && !std::isnan( loss ) );
+		}
+
+		std::unique_ptr< Trial > makeTrial( ConfigurationType const& configuration ) {
+			auto trial = std::make_unique< Trial >( );
+			trial -> resultIndex = mResults.size( );
+			mResults.emplace_back( );
+			mResults.back( ).configuration = configuration;
+			auto batchSize = configuration.find( "batch_size" );
+			trial -> batchSize = batchSize != configuration.end( ) ? std::max< std::size_t >( static_cast< std::size_t >( batchSize -> second ), 1 ) : mBatchSize;
+			trial -> network = mNetworkFactory( configuration );
+			trial -> optimizer = mOptimizerFactory( *trial -> network, configuration );
+			trial -> dataHandler = std::make_unique< SharedDataHandlerType >( mDataHandler );
+			trial -> trainer = std::make_unique< TrainerType >( *trial -> network, *trial -> optimizer, *trial -> dataHandler, mScheduler );
+			// a replica (and evaluation part) per core would multiply the memory of every trial
+			trial -> trainer -> setNumGradientThreads( 1 );
+			// concurrent trials would draw over each other's progress bars
+			trial -> trainer -> setShowProgress( false );
+			if ( mTrainerSetup )
+				mTrainerSetup( *trial -> trainer, configuration );
+			return trial;
+		}
+
+		void trainTrial( Trial& trial, std::size_t numEpochs ) {
+			auto& result = mResults[trial.resultIndex];
+			while ( result.numEpochs < numEpochs ) {
+				trial.trainer -> trainEpoch( trial.batchSize );
+				++result.numEpochs;
+			}
+			result.loss = trial.trainer -> evaluateLoss( trial.dataHandler -> getValidationData( ) );
+		}
+
+		// a trial is done, the network of one that wasn't stopped goes to its result
+		void finishTrial( std::unique_ptr< Trial >& trial, bool stopped ) {
+			auto& result = mResults[trial -> resultIndex];
+			result.stopped = stopped;
+			trial -> trainer.reset( );
+			trial -> optimizer.reset( );
+			if ( !stopped )
+				result.network = std::move( trial -> network );
+			trial.reset( );
+		}
+
+		// successive halving of the configurations from minEpochs to maxEpochs
+		void runBracket( std::vector< ConfigurationType > const& configurations, std::size_t minEpochs, std::size_t maxEpochs, std::size_t eta ) {
+			if ( mDataHandler.getValidationData( ).empty( ) )
+				throw std::runtime_error( "A hyperparameter search ranks the trials on validation data, split some off first." );
+			if ( minEpochs == 0 || minEpochs > maxEpochs || eta < 2 )
+				throw std::runtime_error( "Successive halving needs 0 < minEpochs <= maxEpochs and eta > 1." );
+			std::vector< std::unique_ptr< Trial > > trials;
+			for ( auto const& configuration : configurations ) {
+				trials.push_back( makeTrial( configuration ) );
+			}
+			std::size_t numEpochs = minEpochs;
+			while ( !trials.empty( ) ) {
+				// a trial with a share of more than a thread overlaps its updates with
+				// backprop, the tasks go to the search's threads
+				std::size_t threadsPerTrial = std::max< std::size_t >( mNumThreads / trials.size( ), 1 );
+				for ( auto& trial : trials ) {
+					trial -> trainer -> setNumUpdateThreads( threadsPerTrial - 1 );
+				}
+				mScheduler -> parallelFor( 0, trials.size( ), 1, [&]( std::size_t begin, std::size_t end ) {
+					for ( std::size_t i = begin; i < end; ++i ) {
+						trainTrial( *trials[i], numEpochs );
+					}
+				} );
+				if ( numEpochs >= maxEpochs )
+					break;
+				// the best 1 / eta go on, the others are stopped and free their threads
+				std::stable_sort( trials.begin( ), trials.end( ), [this]( auto const& lhs, auto const& rhs ) {
+					return isBetter( mResults[lhs -> resultIndex].loss, mResults[rhs -> resultIndex].loss );
+				} );
+				std::size_t numKept = std::max< std::size_t >( trials.size( ) / eta, 1 );
+				for ( std::size_t i = numKept; i < trials.size( ); ++i ) {
+					finishTrial( trials[i], true );
+				}
+				trials.resize( numKept );
+				numEpochs = std::min( maxEpochs, numEpochs * eta );
+			}
+			for ( auto& trial : trials ) {
+				finishTrial( trial, false );
+			}
+		}
+
+	public: 	//public data members
+
+	private: 	//private data members
+		DataHandlerType const& mDataHandler;
+		NetworkFactoryType mNetworkFactory;
+		OptimizerFactoryType mOptimizerFactory;
+		TrainerSetupType mTrainerSetup;
+		std::size_t mNumThreads;
+		std::size_t mBatchSize = default_batch_size;
+		std::vector< Result > mResults;
+		// runs the trials and their trainers' tasks, numThreads threads in all
+		std::shared_ptr< Utils::TaskScheduler > mScheduler;
+	}; // end of class HyperparameterSearch
+
+} // end NNet
+
+#endif // HYPERPARAMETER_SEARCH_HPP
@@ -0,0 +1,266 @@
+#ifndef NETWORK_ENSEMBLE_HPP
+#define NETWORK_ENSEMBLE_HPP
+
+// System includes --------------------
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <typeinfo>
+#include <vector>
+
+// Own includes --------------------
+#include "layers/fully-connected-layer.hpp"
+#include "layers/block-diagonal-layer.hpp"
+#include "utils/task-scheduler.hpp"
+
+namespace NNet { // begin NNet
+
+	/**
+	 *NetworkEnsemble. Evaluates and trains N networks with the same layers
+	 *(e.g. an ensemble of small regression networks) as one stacked network,
+	 *so that a batch is a few large matrix products rather than N times many
+	 *small ones. The stacked network's activations are the members' stacked
+	 *(member m's units of layer i are rows [m * n_i, (m + 1) * n_i)):
+	 *  - the first fully connected layer reads the shared input once, its
+	 *    weight matrix is the members' weight matrices side by side,
+	 *  - the later fully connected layers are BlockDiagonalLayers, a matrix
+	 *    product per member on that member's rows,
+	 *  - activation layers are the members', elementwise ones run on the
+	 *    stacked rows and the others (softmax) on a member's column at a time,
+	 *  - layers before the first fully connected layer run once on the input.
+	 *The stacked network is a NeuralNetwork with packed parameters, so the
+	 *optimizers train it: an optimizer made on getNetwork( ) and trainBatch( )
+	 *train every member as it would be trained alone on the same batches, for
+	 *every optimizer with an elementwise update rule (the layerwise trust
+	 *ratios of LARS and LAMB see the stacked layers). Only fully connected
+	 *layers are stacked. extract( m ) copies member m back out as a network of
+	 *its own, the stacked network serializes as it is. Batch predictions are
+	 *split across the threads of a task scheduler.
+	 */
+	template< typename NetworkType >
+	class NetworkEnsemble {
+	public: 	// public typedefs
+		using NumericTraitsType = typename NetworkType::NumericTraitsType;
+		using NumericType = typename NetworkType::NumericType;
+		using VectorXType = typename NetworkType::VectorXType;
+		using MatrixXType = typename NetworkType::MatrixXType;
+		using BaseLayerType = typename NetworkType::BaseLayerType;
+		using TrainableLayerType = typename NetworkType::TrainableLayerType;
+		using ConstMatrixRefType = typename BaseLayerType::ConstMatrixRefType;
+		using FullyConnectedLayerType = FullyConnectedLayer< NumericTraitsType >;
+		using BlockDiagonalLayerType = BlockDiagonalLayer< NumericTraitsType >;
+
+	private: 	// private typedefs
+		using ConstMatrixViewType = Eigen::Map< MatrixXType const >;
+
+	public: 	//public member functions
+		NetworkEnsemble( ) = delete;
+		explicit NetworkEnsemble( std::vector< NetworkType* > const& members,
+								  std::shared_ptr< Utils::TaskScheduler > scheduler = Utils::TaskScheduler::getDefault( ) )
+			: mNumMembers( members.size( ) ), mScheduler( std::move( scheduler ) ) {
+			if ( !mScheduler )
+				throw std::runtime_error( "An ensemble needs a task scheduler." );
+			if ( members.empty( ) || members.front( ) -> getNumLayers( ) == 0 )
+				throw std::runtime_error( "Can't make an ensemble without members or layers..." );
+			stack( members );
+		}
+		NetworkEnsemble( NetworkEnsemble const& other ) = delete;
+		~NetworkEnsemble( ) = default;
+
+		// get/set member functions
+		std::size_t getNumMembers( ) const { return mNumMembers; }
+		// inputs and outputs of a member
+		std::size_t getNumInputs( ) const { return mNumInputs; }
+		std::size_t getNumOutputs( ) const { return mNumOutputs; }
+		// the stacked network, make the optimizer for trainBatch on it
+		NetworkType& getNetwork( ) { return *mNetwork; }
+		NetworkType const& getNetwork( ) const { return *mNetwork; }
+
+		// Copies member's current weights out into a network of its own
+		std::unique_ptr< NetworkType > extract( std::size_t member ) {
+			if ( member >= mNumMembers )
+				throw std::runtime_error( "The ensemble has no such member..." );
+			auto network = mPrototype -> makeCopy( );
+			auto& layers = network -> getTrainableLayers( );
+			auto const& stackedLayers = mNetwork -> getTrainableLayers( );
+			for ( std::size_t t = 0; t < layers.size( ); ++t ) {
+				auto& weightMat = layers[t] -> getWeightMat( );
+				weightMat = stackedLayers[t] -> getWeightMat( ).middleCols( member * weightMat.cols( ), weightMat.cols( ) );
+			}
+			return network;
+		}
+
+		// The predictions of every member for the columns of inputMat, member m's
+		// are rows [m * getNumOutputs( ), (m + 1) * getNumOutputs( )) of outputMat
+		void predictBatch( ConstMatrixRefType inputMat, MatrixXType& outputMat ) {
+			auto batchSize = static_cast< std::size_t >( inputMat.cols( ) );
+			auto numOutputs = static_cast< Eigen::Index >( mNumMembers * mNumOutputs );
+			outputMat.resize( numOutputs, inputMat.cols( ) );
+			std::size_t numParts = std::clamp< std::size_t >( batchSize, 1, mScheduler -> getNumThreads( ) );
+			mReplicas.resize( numParts );
+			mScheduler -> parallelForAffine( numParts, [&]( std::size_t part ) {
+				auto& replica = mReplicas[part];
+				if ( !replica || !replica -> sharesParameters( *mNetwork ) )
+					replica = mNetwork -> makeReplica( );
+				auto begin = static_cast< Eigen::Index >( batchSize * part / numParts );
+				auto end = static_cast< Eigen::Index >( batchSize * ( part + 1 ) / numParts );
+				if ( begin == end )
+					return;
+				forwardBatch( *replica, inputMat.middleCols( begin, end - begin ) );
+				outputMat.middleCols( begin, end - begin ) = getOutputView( *replica, end - begin );
+			} );
+		}
+
+		// The members' mean prediction for the columns of inputMat
+		void predictMean( ConstMatrixRefType inputMat, MatrixXType& meanMat ) {
+			predictBatch( inputMat, mPredictionMat );
+			auto numOutputs = static_cast< Eigen::Index >( mNumOutputs );
+			meanMat = mPredictionMat.topRows( numOutputs );
+			for ( std::size_t m = 1; m < mNumMembers; ++m ) {
+				meanMat += mPredictionMat.middleRows( m * numOutputs, numOutputs );
+			}
+			meanMat /= static_cast< NumericType >( mNumMembers );
+		}
+
+		// One optimizer step of every member on the batch of the columns of inputMat.
+		// targetMat holds a target per column shared by the members (getNumOutputs( )
+		// rows) or every member's own (getNumMembers( ) * getNumOutputs( ) rows, e.g.
+		// bootstrap resamples). Returns every member's summed loss over the batch.
+		template< typename OptimizerType, typename LossFunctionType >
+		VectorXType const& trainBatch( OptimizerType& optimizer, LossFunctionType const& lossFun,
+									   ConstMatrixRefType inputMat, ConstMatrixRefType targetMat ) {
+			if ( &optimizer.getNetwork( ) != mNetwork.get( ) )
+				throw std::runtime_error( "The optimizer of an ensemble must be made on its stacked network..." );
+			auto numOutputs = static_cast< Eigen::Index >( mNumOutputs );
+			bool sharedTargets = targetMat.rows( ) == numOutputs;
+			if ( targetMat.cols( ) != inputMat.cols( ) || ( !sharedTargets && targetMat.rows( ) != numOutputs * static_cast< Eigen::Index >( mNumMembers ) ) )
+				throw std::runtime_error( "The targets don't match the ensemble's outputs..." );
+			auto batchSize = inputMat.cols( );
+			forwardBatch( *mNetwork, inputMat );
+			auto outputMat = getOutputView( *mNetwork, batchSize );
+			if ( mGradLossMat.rows( ) != outputMat.rows( ) || mGradLossMat.cols( ) < batchSize )
+				mGradLossMat.resize( outputMat.rows( ), batchSize );
+			mMemberLosses.setZero( mNumMembers );
+			for ( Eigen::Index col = 0; col < batchSize; ++col ) {
+				for ( std::size_t m = 0; m < mNumMembers; ++m ) {
+					auto row = static_cast< Eigen::Index >( m ) * numOutputs;
+					mOutputVec = outputMat.col( col ).segment( row, numOutputs );
+					mTargetVec = targetMat.col( col ).segment( sharedTargets ? 0 : row, numOutputs );
+					mMemberLosses( m ) += lossFun.loss( mOutputVec, mTargetVec );
+					lossFun.gradLoss( mOutputVec, mTargetVec, mGradLossVec );
+					mGradLossMat.col( col ).segment( row, numOutputs ) = mGradLossVec;
+				}
+			}
+			backwardBatch( *mNetwork, batchSize );
+			optimizer.applyWeightUpdate( static_cast< std::size_t >( batchSize ) );
+			optimizer.resetGradients( );
+			return mMemberLosses;
+		}
+
+	private: 	//private member functions
+		// builds the stacked network from the members' layers and weights
+		void stack( std::vector< NetworkType* > const& members ) {
+			auto& first = *members.front( );
+			mPrototype = first.makeCopy( );
+			mNetwork = std::make_unique< NetworkType >( first.getInitializer( ) );
+			mNumInputs = first.getLayer( 0 ) -> getNumInputs( );
+			mNumOutputs = first.getLayers( ).back( ) -> getNumOutputs( );
+			bool shared = true;
+			for ( std::size_t i = 0; i < first.getNumLayers( ); ++i ) {
+				auto const& layer = first.getLayer( i );
+				std::size_t numInputs = layer -> getNumInputs( );
+				std::size_t numOutputs = layer -> getNumOutputs( );
+				for ( auto member : members ) {
+					auto const& other = member -> getLayer( i );
+					if ( member -> getNumLayers( ) != first.getNumLayers( ) || typeid( *other ) != typeid( *layer )
+						 || other -> getNumInputs( ) != numInputs || other -> getNumOutputs( ) != numOutputs )
+						throw std::runtime_error( "The members of an ensemble must have the same layers..." );
+				}
+				std::size_t blockRows = 0;
+				if ( layer -> isTrainableLayer( ) ) {
+					if ( !dynamic_cast< FullyConnectedLayerType const* >( layer.get( ) ) )
+						throw std::runtime_error( "An ensemble only stacks fully connected layers..." );
+					std::shared_ptr< TrainableLayerType > stackedLayer;
+					if ( shared )
+						stackedLayer = std::make_shared< FullyConnectedLayerType >( numInputs, mNumMembers * numOutputs, layer -> getLayerType( ) );
+					else
+						stackedLayer = std::make_shared< BlockDiagonalLayerType >( mNumMembers, numInputs, numOutputs, layer -> getLayerType( ) );
+					for ( std::size_t m = 0; m < mNumMembers; ++m ) {
+						auto const& memberLayer = std::static_pointer_cast< TrainableLayerType >( members[m] -> getLayer( i ) );
+						stackedLayer -> getWeightMat( ).middleCols( m * numOutputs, numOutputs ) = memberLayer -> getWeightMat( );
+					}
+					mNetwork -> addLayer( stackedLayer );
+					shared = false;
+				}
+				else {
+					auto stackedLayer = layer -> clone( );
+					if ( !shared ) {
+						stackedLayer -> setNumInputs( mNumMembers * numInputs );
+						stackedLayer -> setNumOutputs( mNumMembers * numOutputs );
+						// a member's units are a column of their own
+						if ( !layer -> isSliceable( ) )
+							blockRows = numInputs;
+					}
+					mNetwork -> addLayer( stackedLayer );
+				}
+				mBlockRows.push_back( blockRows );
+			}
+			if ( shared )
+				throw std::runtime_error( "An ensemble needs a fully connected layer..." );
+			mNetwork -> packParameters( );
+		}
+
+		// the first columns of mat as layer i's batch matrix of numUnits rows per sample
+		ConstMatrixViewType viewBatch( MatrixXType const& mat, std::size_t i, std::size_t numUnits, Eigen::Index batchSize ) const {
+			auto rows = static_cast< Eigen::Index >( mBlockRows[i] > 0 ? mBlockRows[i] : numUnits );
+			return ConstMatrixViewType( mat.data( ), rows, static_cast< Eigen::Index >( numUnits ) / rows * batchSize );
+		}
+
+		// the stacked outputs of the last forward pass of network
+		ConstMatrixViewType getOutputView( NetworkType& network, Eigen::Index batchSize ) const {
+			return ConstMatrixViewType( network.getLayers( ).back( ) -> getOutputMat( ).data( ),
+										static_cast< Eigen::Index >( mNumMembers * mNumOutputs ), batchSize );
+		}
+
+		void forwardBatch( NetworkType& network, ConstMatrixRefType inputMat ) {
+			auto batchSize = inputMat.cols( );
+			network.getLayer( 0 ) -> forwardComputeBatch( inputMat );
+			for ( std::size_t i = 1; i < network.getNumLayers( ); ++i ) {
+				auto& layer = network.getLayer( i );
+				layer -> forwardComputeBatch( viewBatch( network.getLayer( i - 1 ) -> getOutputMat( ), i, layer -> getNumInputs( ), batchSize ) );
+			}
+		}
+
+		// backward pass of the loss gradients in mGradLossMat after forwardBatch
+		void backwardBatch( NetworkType& network, Eigen::Index batchSize ) {
+			std::size_t numLayers = network.getNumLayers( );
+			for ( std::size_t k = 0; k < network.getNumBackwardLayers( ); ++k ) {
+				std::size_t i = numLayers - 1 - k;
+				auto& layer = network.getLayer( i );
+				MatrixXType const& deltaMat = ( k == 0 ) ? mGradLossMat : network.getLayer( i + 1 ) -> getOutputDeltaMat( );
+				layer -> backwardComputeBatch( viewBatch( deltaMat, i, layer -> getNumOutputs( ), batchSize ) );
+			}
+		}
+
+	public: 	//public data members
+
+	private: 	//private data members
+		std::size_t mNumMembers;
+		std::size_t mNumInputs = 0, mNumOutputs = 0;
+		std::shared_ptr< Utils::TaskScheduler > mScheduler;
+		// a copy of the first member, the structure extracted members are made from
+		std::unique_ptr< NetworkType > mPrototype;
+		std::unique_ptr< NetworkType > mNetwork;
+		// rows of a layer's batch matrices per member column, 0 when the members are stacked
+		std::vector< std::size_t > mBlockRows;
+		// the work vectors of every prediction part
+		std::vector< std::unique_ptr< NetworkType > > mReplicas;
+		// training work buffers
+		MatrixXType mGradLossMat, mPredictionMat;
+		VectorXType mOutputVec, mTargetVec, mGradLossVec, mMemberLosses;
+	}; // end of class NetworkEnsemble
+
+} // end NNet
+
+#endif // NETWORK_ENSEMBLE_HPP
@@ -0,0 +1,401 @@
+#ifndef NETWORK_PIPELINE_HPP
+#define NETWORK_PIPELINE_HPP
+
+// System includes --------------------
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// Eigen includes --------------------
+#include <Eigen/Dense>
+
+// Own includes --------------------
+#include "utils/spsc-queue.hpp"
+#include "utils/worker-team.hpp"
+
+namespace NNet { // begin NNet
+
+	// Order of the forward and backward passes of a training step's micro batches on
+	// every stage. GPIPE runs all forward passes, then all backward passes. ONE_F_ONE_B
+	// alternates them after a warmup of ( numStages - 1 - stage ) forward passes, so
+	// the backward passes start (and gradients complete) earlier.
+	enum class PipelineSchedule { GPIPE, ONE_F_ONE_B };
+
+	/**
+	 *NetworkPipeline. Partitions a network into contiguous stages of layers,
+	 *each run by its own member of a worker team (with pinThreads pinned to
+	 *its own cpu of the cpuset), so
+	 *that the weights of a stage stay in that core's private caches when the
+	 *whole network does not fit. Micro batches of samples (matrices whose
+	 *columns are samples) flow from stage to stage through bounded lock free
+	 *queues. Inference streams the micro batches through the stages, training
+	 *runs a GPipe or 1F1B schedule. For training a stage keeps the inputs of
+	 *all micro batches of the step and recomputes a micro batch's activations
+	 *before its backward pass (rematerialization) unless they are still the
+	 *stage's latest. The stage boundaries are balanced on measured per layer
+	 *costs, the weight gradients of a step accumulate in the network's
+	 *gradient buffer (stages own disjoint layers).
+	 */
+	template< typename NetworkType >
+	class NetworkPipeline {
+	public: 	// public typedefs
+		using NumericType = typename NetworkType::NumericType;
+		using MatrixXType = typename NetworkType::MatrixXType;
+		using ConstMatrixRefType = Eigen::Ref< MatrixXType const >;
+		using QueueType = Utils::SpscQueue< std::size_t >;
+
+	private: 	// private typedefs
+
+	public: 	// public static data members
+		// micro batches in flight between two stages when streaming
+		static constexpr std::size_t default_queue_capacity = 4;
+
+	public: 	//public member functions
+		NetworkPipeline( ) = delete;
+		explicit NetworkPipeline( NetworkType& network, std::size_t numStages, bool pinThreads = false )
+			: mNetwork( network ),
+			  mNumStages( std::clamp< std::size_t >( numStages, 1, std::max< std::size_t >( network.getNumLayers( ), 1 ) ) ),
+			  mTeam( mNumStages, Utils::WorkerTeam::default_spin_count, pinThreads ),
+			  mLastForward( mNumStages, no_micro_batch ), mActivations( mNumStages ), mDeltas( mNumStages ) {
+			if ( network.getNumLayers( ) == 0 )
+				throw std::runtime_error( "Can't build a pipeline for a network without layers..." );
+			resizeQueues( default_queue_capacity );
+			balanceStages( measureLayerCosts( ) );
+		}
+		NetworkPipeline( NetworkPipeline const& other ) = delete;
+		~NetworkPipeline( ) = default;
+
+		// get/set member functions
+		std::size_t getNumStages( ) const { return mNumStages; }
+		// stage s runs the layers [boundaries[s], boundaries[s + 1])
+		std::vector< std::size_t > const& getStageBoundaries( ) const { return mBoundaries; }
+		void setStageBoundaries( std::vector< std::size_t > const& boundaries ) {
+			bool valid = boundaries.size( ) == mNumStages + 1 && boundaries.front( ) == 0 && boundaries.back( ) == mNetwork.getNumLayers( );
+			for ( std::size_t s = 0; valid && s < mNumStages; ++s ) {
+				valid = boundaries[s] < boundaries[s + 1];
+			}
+			if ( !valid )
+				throw std::runtime_error( "The stage boundaries must split the layers into non empty contiguous stages." );
+			mBoundaries = boundaries;
+		}
+		std::vector< double > const& getLayerCosts( ) const { return mLayerCosts; }
+
+		// Seconds of a forward and backward pass of a batch of batchSize random samples
+		// through every layer (the best of repetitions), measured on a replica of the
+		// network so that the network's gradients are left alone.
+		std::vector< double > measureLayerCosts( std::size_t batchSize = 32, std::size_t repetitions = 3 ) {
+			using ClockType = std::chrono::steady_clock;
+			auto replica = mNetwork.makeReplica( );
+			std::size_t numLayers = replica -> getNumLayers( );
+			auto cols = static_cast< Eigen::Index >( std::max< std::size_t >( batchSize, 1 ) );
+			MatrixXType inputMat = MatrixXType::Random( replica -> getLayer( 0 ) -> getNumInputs( ), cols );
+			MatrixXType gradLossMat = MatrixXType::Random( replica -> getLayers( ).back( ) -> getNumOutputs( ), cols );
+			std::size_t firstBackward = numLayers - replica -> getNumBackwardLayers( );
+			std::vector< double > costs( numLayers, std::numeric_limits< double >::infinity( ) );
+			for ( std::size_t repetition = 0; repetition < std::max< std::size_t >( repetitions, 1 ); ++repetition ) {
+				std::vector< double > times( numLayers, 0.0 );
+				for ( std::size_t i = 0; i < numLayers; ++i ) {
+					auto start = ClockType::now( );
+					if ( i == 0 )
+						replica -> getLayer( i ) -> forwardComputeBatch( inputMat );
+					else
+						replica -> getLayer( i ) -> forwardComputeBatch( replica -> getLayer( i - 1 ) -> getOutputMat( ).leftCols( cols ) );
+					times[i] += std::chrono::duration< double >( ClockType::now( ) - start ).count( );
+				}
+				for ( std::size_t i = numLayers; i-- > firstBackward; ) {
+					auto start = ClockType::now( );
+					if ( i + 1 == numLayers )
+						replica -> getLayer( i ) -> backwardComputeBatch( gradLossMat );
+					else
+						replica -> getLayer( i ) -> backwardComputeBatch( replica -> getLayer( i + 1 ) -> getOutputDeltaMat( ).leftCols( cols ) );
+					times[i] += std::chrono::duration< double >( ClockType::now( ) - start ).count( );
+				}
+				for ( std::size_t i = 0; i < numLayers; ++i ) {
+					costs[i] = std::min( costs[i], times[i] );
+				}
+			}
+			return costs;
+		}
+
+		// Contiguous non empty stages minimizing the cost of the most expensive stage
+		// (linear partition, dynamic programming over the layer prefixes).
+		void balanceStages( std::vector< double > const& layerCosts ) {
+			std::size_t numLayers = mNetwork.getNumLayers( );
+			if ( layerCosts.size( ) != numLayers )
+				throw std::runtime_error( "There must be one cost per layer." );
+			mLayerCosts = layerCosts;
+			std::vector< double > prefixCosts( numLayers + 1, 0.0 );
+			for ( std::size_t i = 0; i < numLayers; ++i ) {
+				prefixCosts[i + 1] = prefixCosts[i] + layerCosts[i];
+			}
+			// bestCost[k][j], the least cost of k + 1 stages over the first j layers
+			constexpr double infinity = std::numeric_limits< double >::infinity( );
+			std::vector< std::vector< double > > bestCost( mNumStages, std::vector< double >( numLayers + 1, infinity ) );
+			std::vector< std::vector< std::size_t > > bestSplit( mNumStages, std::vector< std::size_t >( numLayers + 1, 0 ) );
+			for ( std::size_t j = 1; j <= numLayers; ++j ) {
+				bestCost[0][j] = prefixCosts[j];
+			}
+			for ( std::size_t k = 1; k < mNumStages; ++k ) {
+				for ( std::size_t j = k + 1; j <= numLayers; ++j ) {
+					for ( std::size_t i = k; i < j; ++i ) {
+						double cost = std::max( bestCost[k - 1][i], prefixCosts[j] - prefixCosts[i] );
+						if ( cost < bestCost[k][j] ) {
+							bestCost[k][j] = cost;
+							bestSplit[k][j] = i;
+						}
+					}
+				}
+			}
+			std::vector< std::size_t > boundaries( mNumStages + 1, 0 );
+			boundaries[mNumStages] = numLayers;
+			for ( std::size_t k = mNumStages - 1; k > 0; --k ) {
+				boundaries[k] = bestSplit[k][boundaries[k + 1]];
+			}
+			setStageBoundaries( boundaries );
+		}
+
+		// Streams the columns (samples) of inputMat through the stages in micro batches
+		// of microBatchSize samples, the network's outputs are written to outputMat.
+		void predict( ConstMatrixRefType inputMat, MatrixXType& outputMat, std::size_t microBatchSize = 32 ) {
+			auto numOutputs = static_cast< Eigen::Index >( mNetwork.getLayers( ).back( ) -> getNumOutputs( ) );
+			if ( outputMat.rows( ) != numOutputs || outputMat.cols( ) != inputMat.cols( ) )
+				outputMat.resize( numOutputs, inputMat.cols( ) );
+			stream( static_cast< std::size_t >( inputMat.cols( ) ), microBatchSize,
+					[&]( std::size_t begin, auto&& microInputMat ) { microInputMat = inputMat.middleCols( begin, microInputMat.cols( ) ); },
+					[&]( std::size_t begin, auto const& microOutputMat ) { outputMat.middleCols( begin, microOutputMat.cols( ) ) = microOutputMat; } );
+		}
+
+		// Inference on numSamples samples in micro batches of microBatchSize samples.
+		// The first stage calls input( begin, inputMat ) to fill the inputs of the
+		// samples [begin, begin + inputMat.cols( )), the last stage calls
+		// output( begin, outputMat ) with their outputs.
+		template< typename InputType, typename OutputType >
+		void stream( std::size_t numSamples, std::size_t microBatchSize, InputType&& input, OutputType&& output ) {
+			if ( numSamples == 0 )
+				return;
+			microBatchSize = std::max< std::size_t >( microBatchSize, 1 );
+			std::size_t numMicroBatches = ( numSamples + microBatchSize - 1 ) / microBatchSize;
+			// a slot may be reused once the next stage has moved past it
+			std::size_t numSlots = mForwardQueues.empty( ) ? 1 : mForwardQueues[0] -> capacity( ) + 2;
+			prepareRun( numSlots );
+			mTeam.run( [&,this]( std::size_t stage ) {
+				runStage( [&,this]( ) {
+					for ( std::size_t microBatch = 0; microBatch < numMicroBatches; ++microBatch ) {
+						if ( !forwardOperation( stage, microBatch, microBatch % numSlots, numSamples, microBatchSize, input,
+												[&]( std::size_t begin, auto const& outputMat, std::size_t ) { output( begin, outputMat ); } ) )
+							return;
+					}
+				} );
+			} );
+		}
+
+		// One training step over numSamples samples in micro batches of microBatchSize
+		// samples. The first stage calls input( begin, inputMat ) as for stream, the
+		// last stage calls loss( begin, outputMat, gradLossMat ), which writes the loss
+		// gradients of the outputs to gradLossMat. The weight gradients of all samples
+		// accumulate in the network's gradient buffer, the update is left to the caller.
+		template< typename InputType, typename LossType >
+		void train( std::size_t numSamples, std::size_t microBatchSize, InputType&& input, LossType&& loss,
+					PipelineSchedule schedule = PipelineSchedule::ONE_F_ONE_B ) {
+			if ( numSamples == 0 )
+				return;
+			microBatchSize = std::max< std::size_t >( microBatchSize, 1 );
+			std::size_t numMicroBatches = ( numSamples + microBatchSize - 1 ) / microBatchSize;
+			// the inputs (and loss gradients) of all micro batches of the step are kept
+			if ( !mForwardQueues.empty( ) && mForwardQueues[0] -> capacity( ) < numMicroBatches )
+				resizeQueues( numMicroBatches );
+			prepareRun( numMicroBatches );
+			std::size_t firstBackward = mNetwork.getNumLayers( ) - mNetwork.getNumBackwardLayers( );
+			auto lossOperation = [&,this]( std::size_t begin, auto const& outputMat, std::size_t slot ) {
+				auto& gradLossMat = mDeltas[mNumStages - 1][slot];
+				reserveSlot( gradLossMat, outputMat.rows( ), outputMat.cols( ) );
+				loss( begin, outputMat, gradLossMat.leftCols( outputMat.cols( ) ) );
+			};
+			mTeam.run( [&,this]( std::size_t stage ) {
+				runStage( [&,this]( ) {
+					bool hasBackward = mBoundaries[stage + 1] > firstBackward;
+					std::size_t warmup = numMicroBatches;
+					if ( hasBackward && schedule == PipelineSchedule::ONE_F_ONE_B )
+						warmup = std::min( mNumStages - 1 - stage, numMicroBatches );
+					for ( std::size_t microBatch = 0; microBatch < warmup; ++microBatch ) {
+						if ( !forwardOperation( stage, microBatch, microBatch, numSamples, microBatchSize, input, lossOperation ) )
+							return;
+					}
+					if ( !hasBackward )
+						return;
+					if ( schedule == PipelineSchedule::GPIPE ) {
+						for ( std::size_t microBatch = numMicroBatches; microBatch-- > 0; ) {
+							if ( !backwardOperation( stage, microBatch, numSamples, microBatchSize, firstBackward ) )
+								return;
+						}
+						return;
+					}
+					for ( std::size_t microBatch = 0; microBatch < numMicroBatches; ++microBatch ) {
+						if ( warmup + microBatch < numMicroBatches
+							 && !forwardOperation( stage, warmup + microBatch, warmup + microBatch, numSamples, microBatchSize, input, lossOperation ) )
+							return;
+						if ( !backwardOperation( stage, microBatch, numSamples, microBatchSize, firstBackward ) )
+							return;
+					}
+				} );
+			} );
+		}
+
+	private: 	//private member functions
+		static constexpr std::size_t no_micro_batch = std::numeric_limits< std::size_t >::max( );
+
+		// slot matrices only grow, so that a smaller (last) micro batch does not reallocate
+		static void reserveSlot( MatrixXType& mat, Eigen::Index rows, Eigen::Index cols ) {
+			if ( mat.rows( ) != rows || mat.cols( ) < cols )
+				mat.resize( rows, cols );
+		}
+
+		void resizeQueues( std::size_t capacity ) {
+			mForwardQueues.clear( );
+			mBackwardQueues.clear( );
+			for ( std::size_t stage = 0; stage + 1 < mNumStages; ++stage ) {
+				mForwardQueues.emplace_back( std::make_unique< QueueType >( capacity ) );
+				mBackwardQueues.emplace_back( std::make_unique< QueueType >( capacity ) );
+			}
+		}
+
+		void prepareRun( std::size_t numSlots ) {
+			for ( std::size_t stage = 0; stage < mNumStages; ++stage ) {
+				if ( mActivations[stage].size( ) < numSlots )
+					mActivations[stage].resize( numSlots );
+				if ( mDeltas[stage].size( ) < numSlots )
+					mDeltas[stage].resize( numSlots );
+				mLastForward[stage] = no_micro_batch;
+			}
+			for ( std::size_t stage = 0; stage + 1 < mNumStages; ++stage ) {
+				mForwardQueues[stage] -> clear( );
+				mBackwardQueues[stage] -> clear( );
+			}
+			mAborted.store( false );
+		}
+
+		// runs a stage's operations, a failing stage makes the others give up
+		template< typename OperationsType >
+		void runStage( OperationsType&& operations ) {
+			try {
+				operations( );
+			}
+			catch ( ... ) {
+				mAborted.store( true );
+				throw;
+			}
+		}
+
+		// false when the pipeline was aborted while waiting
+		bool pop( QueueType& queue, std::size_t& microBatch ) {
+			while ( !queue.tryPop( microBatch ) ) {
+				if ( mAborted.load( std::memory_order_relaxed ) )
+					return false;
+				std::this_thread::yield( );
+			}
+			return true;
+		}
+		bool push( QueueType& queue, std::size_t microBatch ) {
+			while ( !queue.tryPush( microBatch ) ) {
+				if ( mAborted.load( std::memory_order_relaxed ) )
+					return false;
+				std::this_thread::yield( );
+			}
+			return true;
+		}
+
+		// forward pass of a micro batch through the stage's layers, from the stage's
+		// input slot
+		void forwardStage( std::size_t stage, std::size_t microBatch, std::size_t slot, Eigen::Index cols ) {
+			std::size_t begin = mBoundaries[stage], end = mBoundaries[stage + 1];
+			mNetwork.getLayer( begin ) -> forwardComputeBatch( mActivations[stage][slot].leftCols( cols ) );
+			for ( std::size_t i = begin + 1; i < end; ++i ) {
+				mNetwork.getLayer( i ) -> forwardComputeBatch( mNetwork.getLayer( i - 1 ) -> getOutputMat( ).leftCols( cols ) );
+			}
+			mLastForward[stage] = microBatch;
+		}
+
+		// Receives (or on the first stage reads) the inputs of a micro batch, runs the
+		// stage forward and hands the outputs to the next stage, the last stage calls
+		// last( begin, outputMat, slot ). False when the pipeline was aborted.
+		template< typename InputType, typename LastType >
+		bool forwardOperation( std::size_t stage, std::size_t microBatch, std::size_t slot, std::size_t numSamples,
+							   std::size_t microBatchSize, InputType& input, LastType&& last ) {
+			std::size_t sampleBegin = microBatch * microBatchSize;
+			auto cols = static_cast< Eigen::Index >( std::min( microBatchSize, numSamples - sampleBegin ) );
+			if ( stage == 0 ) {
+				auto& inputMat = mActivations[0][slot];
+				reserveSlot( inputMat, static_cast< Eigen::Index >( mNetwork.getLayer( 0 ) -> getNumInputs( ) ), cols );
+				input( sampleBegin, inputMat.leftCols( cols ) );
+			}
+			else {
+				std::size_t received;
+				if ( !pop( *mForwardQueues[stage - 1], received ) )
+					return false;
+			}
+			forwardStage( stage, microBatch, slot, cols );
+			auto const& outputMat = mNetwork.getLayer( mBoundaries[stage + 1] - 1 ) -> getOutputMat( );
+			if ( stage + 1 == mNumStages ) {
+				last( sampleBegin, outputMat.leftCols( cols ), slot );
+				return true;
+			}
+			auto& nextInputMat = mActivations[stage + 1][slot];
+			reserveSlot( nextInputMat, outputMat.rows( ), cols );
+			nextInputMat.leftCols( cols ) = outputMat.leftCols( cols );
+			return push( *mForwardQueues[stage], microBatch );
+		}
+
+		// Receives (or on the last stage takes) the output gradients of a micro batch,
+		// recomputes the stage's activations when they were overwritten, runs the stage
+		// backward and hands the input gradients to the previous stage. Training keeps
+		// a slot per micro batch. False when the pipeline was aborted.
+		bool backwardOperation( std::size_t stage, std::size_t microBatch, std::size_t numSamples, std::size_t microBatchSize, std::size_t firstBackward ) {
+			std::size_t sampleBegin = microBatch * microBatchSize;
+			auto cols = static_cast< Eigen::Index >( std::min( microBatchSize, numSamples - sampleBegin ) );
+			if ( stage + 1 < mNumStages ) {
+				std::size_t received;
+				if ( !pop( *mBackwardQueues[stage], received ) )
+					return false;
+			}
+			if ( mLastForward[stage] != microBatch )
+				forwardStage( stage, microBatch, microBatch, cols );
+			std::size_t begin = std::max( mBoundaries[stage], firstBackward ), end = mBoundaries[stage + 1];
+			mNetwork.getLayer( end - 1 ) -> backwardComputeBatch( mDeltas[stage][microBatch].leftCols( cols ) );
+			for ( std::size_t i = end - 1; i-- > begin; ) {
+				mNetwork.getLayer( i ) -> backwardComputeBatch( mNetwork.getLayer( i + 1 ) -> getOutputDeltaMat( ).leftCols( cols ) );
+			}
+			if ( stage == 0 || mBoundaries[stage] <= firstBackward )
+				return true;
+			auto const& deltaMat = mNetwork.getLayer( mBoundaries[stage] ) -> getOutputDeltaMat( );
+			auto& previousDeltaMat = mDeltas[stage - 1][microBatch];
+			reserveSlot( previousDeltaMat, deltaMat.rows( ), cols );
+			previousDeltaMat.leftCols( cols ) = deltaMat.leftCols( cols );
+			return push( *mBackwardQueues[stage - 1], microBatch );
+		}
+
+	public: 	//public data members
+
+	private: 	//private data members
+		NetworkType& mNetwork;
+		std::size_t mNumStages;
+		Utils::WorkerTeam mTeam;
+		std::vector< std::size_t > mBoundaries;
+		std::vector< double > mLayerCosts;
+		// mForwardQueues[s] carries micro batches from stage s to s + 1, mBackwardQueues[s]
+		// from stage s + 1 back to s
+		std::vector< std::unique_ptr< QueueType > > mForwardQueues, mBackwardQueues;
+		std::vector< std::size_t > mLastForward;
+		// inputs of stage s and gradients of its outputs, one matrix per slot
+		std::vector< std::vector< MatrixXType > > mActivations, mDeltas;
+		std::atomic< bool > mAborted { false };
+	}; // end of class NetworkPipeline
+
+} // end NNet
+
+#endif // NETWORK_PIPELINE_HPP
@@ -2,11 +2,35 @@
 #define NETWORK_TRAINER_HPP
 
 // System includes --------------------
+#include <algorithm>
+#include <cstdint>
 #include <filesystem>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <vector>
 
 // Own includes --------------------
 #include "loss/loss-function.hpp"
+#include "layers/fully-connected-layer.hpp"
+#include "networks/background-evaluator.hpp"
+#include "networks/feature-cache.hpp"
+#include "networks/network-pipeline.hpp"
+#include "networks/tensor-parallel.hpp"
+#include "optimizers/base-optimizer.hpp"
+#include "schedules/learning-rate-schedules.hpp"
+#include "schedules/early-stopping.hpp"
+#include "samplers/samplers.hpp"
 #include "utils/progress-bar.hpp"
+#include "utils/allocation-counter.hpp"
+#include "utils/thread-pool.hpp"
+#include "utils/task-scheduler.hpp"
+#include "utils/cache-info.hpp"
+#include "utils/process-group.hpp"
+#include "utils/parameter-socket.hpp"
 
 namespace NNet { // begin NNet
 
@@ -22,13 +46,70 @@ namespace NNet { // begin NNet
 		using NumericTraitsType = typename NetworkType::NumericTraitsType;
 		using NumericType = typename NetworkType::NumericType;
 		using VectorXType = typename NetworkType::VectorXType;
+		using MatrixXType = typename NetworkType::MatrixXType;
+		using ConstMatrixRefType = Eigen::Ref< MatrixXType const >;
+		using DataPairType = typename DataHandlerType::DataPairType;
+		using VectorDataPairType = typename DataHandlerType::VectorDataPairType;
+		using LearningRateScheduleType = BaseLearningRateSchedule< NumericType >;
+		using EarlyStoppingType = EarlyStopping< NumericType >;
+		using FeatureCacheType = FeatureCache< NumericTraitsType >;
+		using SamplerType = BaseSampler< NumericType >;
+		using PipelineType = NetworkPipeline< NetworkType >;
+		using TensorParallelType = TensorParallelPredictor< NetworkType >;
+		using BackgroundEvaluatorType = BackgroundEvaluator< NetworkType, LossFunction< NumericTraitsType, LossFunType >, DataHandlerType >;
+		using EvaluationResultType = typename BackgroundEvaluatorType::Result;
+
+		// per epoch losses recorded by train( ), validation losses only with validation data
+		struct TrainingHistory {
+			std::vector< NumericType > trainingLoss;
+			std::vector< NumericType > validationLoss;
+			std::size_t bestEpoch = 0;
+			bool stoppedEarly = false;
+		};
 
 	private: 	// private typedefs
+		using BaseLayerPtrType = typename NetworkType::BaseLayerPtrType;
+		using TrainableLayerType = typename NetworkType::TrainableLayerType;
+		// a layer's weight gradient run as a task of the backward pass, with the delta it
+		// reads (a sample's or a batch's)
+		struct WeightGradJob {
+			TrainableLayerType* layer = nullptr;
+			VectorXType const* deltaVec = nullptr;
+			std::optional< ConstMatrixRefType > deltaMat;
+			Utils::TaskGroup group;
+		};
+		// work vectors and matrices of a training thread
+		struct WorkBuffers {
+			VectorXType featureVec, gradLossVec, outputVec;
+			MatrixXType inputMat, gradLossMat;
+			// one per layer the backward pass visits
+			std::vector< std::unique_ptr< WeightGradJob > > weightGradJobs;
+		};
+		// full batch gradient evaluation and data parallel training
+		struct Replica {
+			std::unique_ptr< NetworkType > network;
+			VectorXType gradLossVec;
+			NumericType loss = 0.0;
+			MatrixXType featureMat, targetMat, gramMat, crossMat;
+			WorkBuffers work;
+			std::vector< std::pair< std::size_t, NumericType > > sampleLosses;
+			std::size_t numSteps = 0;
+		};
+
+	public: 	// public static data members
+		// multiply adds of a weight gradient worth a task of the backward pass
+		static constexpr std::size_t default_min_weight_grad_task_work = std::size_t( 1 ) << 14;
 
 	public: 	//public member functions
 		NetworkTrainer( ) = default;
-		explicit NetworkTrainer( NetworkType& network, OptimizerType& optimizer, DataHandlerType& dataHandler )
-			: mNetwork( network ), mOptimizer( optimizer ), mDataHandler( dataHandler ) {
+		// the trainer's parallel work runs on scheduler, the shared default one unless given
+		explicit NetworkTrainer( NetworkType& network, OptimizerType& optimizer, DataHandlerType& dataHandler,
+								 std::shared_ptr< Utils::TaskScheduler > scheduler = nullptr )
+			: mNetwork( network ), mOptimizer( optimizer ), mDataHandler( dataHandler ),
+			  mScheduler( scheduler ? std::move( scheduler ) : Utils::TaskScheduler::getDefault( ) ) {
+			// the calling thread keeps running backprop, the others apply updates
+			auto numThreads = mScheduler -> getNumThreads( );
+			setNumUpdateThreads( numThreads > 1 ? numThreads - 1 : 0 );
 		}
 		NetworkTrainer(const NetworkTrainer &c) = delete;
 		~NetworkTrainer( ) = default;
@@ -38,23 +119,259 @@ namespace NNet { // begin NNet
 		auto const& getNetwork( ) const { return mNetwork; }
 		auto& getOptimizer( ) const { return mOptimizer; }
 		auto const& getLossFun( ) const { return mLossFun; }
+		// heap allocations made by the last trainBatch/trainSingleSample step,
+		// only counted when built with NNET_COUNT_ALLOCATIONS
+		Utils::AllocationStats const& getStepAllocationStats( ) const { return mStepAllocationStats; }
+		// trainEpoch draws a progress bar on the console unless turned off, e.g. for
+		// trainers running side by side
+		bool getShowProgress( ) const { return mShowProgress; }
+		void setShowProgress( bool showProgress ) { mShowProgress = showProgress; }
+
+		// Task scheduler all of the trainer's parallel work runs on (the gradient
+		// threads' parts and the overlapped updates), the shared default scheduler
+		// unless set. Pipeline stages, tensor parallel inference and multi-process
+		// communication keep threads of their own.
+		std::shared_ptr< Utils::TaskScheduler > getScheduler( ) const { return mScheduler; }
+		void setScheduler( std::shared_ptr< Utils::TaskScheduler > scheduler ) {
+			if ( !scheduler )
+				throw std::runtime_error( "A trainer needs a task scheduler." );
+			mScheduler = std::move( scheduler );
+			if ( mBackgroundEvaluator )
+				mBackgroundEvaluator -> setScheduler( mScheduler );
+		}
+
+		// Non zero applies the per layer optimizer updates as tasks on the scheduler
+		// while the backward pass of a batch's last sample continues into earlier
+		// layers. Zero applies the update for the whole network after the backward pass.
+		std::size_t getNumUpdateThreads( ) const { return mNumUpdateThreads; }
+		void setNumUpdateThreads( std::size_t numThreads ) { mNumUpdateThreads = numThreads; }
+
+		// A layer's weight gradient and the delta it propagates are independent. The
+		// weight gradient of a layer with at least minWork multiply adds (per sample
+		// times the micro batch size) runs as a task on the scheduler while the backward
+		// pass continues with the delta into the earlier layers. The results don't change,
+		// every gradient is still summed in the same order. The maximum size_t keeps the
+		// backward pass on the calling thread, as does a single threaded scheduler.
+		std::size_t getMinWeightGradTaskWork( ) const { return mMinWeightGradTaskWork; }
+		void setMinWeightGradTaskWork( std::size_t minWork ) { mMinWeightGradTaskWork = minWork; }
+
+		// Number of parts (and network replicas) the full training set loss and
+		// gradient, data parallel batches, Hogwild epochs and evaluations are split
+		// into, run as tasks on the scheduler. The results depend on the number of
+		// parts, how many of them run at once on the scheduler's threads.
+		std::size_t getNumGradientThreads( ) const { return mNumGradientThreads; }
+		void setNumGradientThreads( std::size_t numThreads ) {
+			mNumGradientThreads = std::max< std::size_t >( numThreads, 1 );
+			mReplicas.clear( );
+		}
+
+		// Data parallel training, trainBatch splits every batch into one contiguous part
+		// per gradient thread. Each part runs (sample by sample or in micro batches) on a
+		// network replica with its own activations and cache line aligned gradient buffer,
+		// the replica gradients are summed before the optimizer update. Results
+		// depend on the number of gradient threads only, not on scheduling.
+		bool getDataParallel( ) const { return mDataParallel; }
+		void setDataParallel( bool dataParallel ) {
+			if ( dataParallel && ( OptimizerType::requires_sample_gradients || OptimizerType::requires_snapshot_gradients ) )
+				throw std::runtime_error( "Data parallel training does not support optimizers with sample or snapshot gradients." );
+			mDataParallel = dataParallel;
+		}
+
+		// Multi-process data parallel training, every process of the group runs the same
+		// trainer on the same data and trainBatch runs its rank's contiguous part of every
+		// batch on a network replica. Setting the group is collective, every process then
+		// has rank 0's weights and random engine seed (so that all draw the same epochs).
+		// The gradient of a layer is summed over the processes with a ring all-reduce (on
+		// a communication thread) as soon as the backward pass of the part's last sample
+		// has passed the layer, before the optimizer update every process applies. The
+		// sums are in rank order, so the weights are the same bits on every process and
+		// as single process data parallel training on as many gradient threads. Samplers
+		// only see the losses of their own process's parts. nullptr leaves the group.
+		std::shared_ptr< Utils::ProcessGroup > getProcessGroup( ) const { return mProcessGroup; }
+		void setProcessGroup( std::shared_ptr< Utils::ProcessGroup > processGroup ) {
+			if ( processGroup && ( OptimizerType::requires_sample_gradients || OptimizerType::requires_snapshot_gradients || OptimizerType::is_full_batch ) )
+				throw std::runtime_error( "Multi-process training does not support full batch optimizers or optimizers with sample or snapshot gradients." );
+			if ( processGroup && mParameterServer )
+				throw std::runtime_error( "A trainer can't be in a process group and work for a parameter server." );
+			mProcessGroup = std::move( processGroup );
+			if ( !mProcessGroup )
+				return;
+			if ( !mCommunicationPool )
+				mCommunicationPool = std::make_unique< Utils::ThreadPool >( 1 );
+			auto parameterVec = getNetwork( ).getParameterVec( );
+			mProcessGroup -> broadcast( parameterVec.data( ), static_cast< std::size_t >( parameterVec.size( ) ) );
+			auto& randomEngine = getNetwork( ).getInitializer( ).getRandomEngine( );
+			std::uint64_t seed = randomEngine( );
+			mProcessGroup -> broadcast( &seed, 1 );
+			randomEngine.seed( seed );
+		}
+
+		// Asynchronous parameter server training (see ParameterServer), the trainer is a
+		// worker. Setting the connection pulls the server's weights, trainBatch then only
+		// computes the batch gradient (on a network replica) and pushes it, the server's
+		// optimizer applies it and the weights it replies with replace the network's.
+		// The trainer's own optimizer takes no steps. Once the server has asked to stop,
+		// trainBatch returns at once, trainEpoch and train keep going through their
+		// batches, so a worker should check isStopped( ) after every epoch.
+		std::shared_ptr< Utils::ParameterServerConnection > getParameterServer( ) const { return mParameterServer; }
+		void setParameterServer( std::shared_ptr< Utils::ParameterServerConnection > connection ) {
+			if ( connection && ( OptimizerType::requires_sample_gradients || OptimizerType::requires_snapshot_gradients || OptimizerType::is_full_batch ) )
+				throw std::runtime_error( "Parameter server training does not support full batch optimizers or optimizers with sample or snapshot gradients." );
+			if ( connection && mProcessGroup )
+				throw std::runtime_error( "A trainer can't be in a process group and work for a parameter server." );
+			mParameterServer = std::move( connection );
+			if ( !mParameterServer )
+				return;
+			auto parameterVec = getNetwork( ).getParameterVec( );
+			mParameterServer -> pull( parameterVec.data( ), static_cast< std::size_t >( parameterVec.size( ) ) * sizeof( NumericType ) );
+		}
+
+		// Asynchronous (Hogwild) training, trainEpoch splits the epoch's samples into one
+		// contiguous part per gradient thread. Every thread runs its part on a network
+		// replica with its own activations and gradient buffer and applies the gradient
+		// of each of its batches straight to the shared weights (and optimizer state)
+		// without locks, RACY with plain loads and stores, RELAXED_ATOMIC with relaxed
+		// atomic read-modify-writes. Only for optimizers with supports_async_updates
+		// set (SGDOptimizer, MomentumOptimizer), results are not reproducible.
+		AsyncUpdateMode getAsyncUpdateMode( ) const { return mAsyncUpdateMode; }
+		void setAsyncUpdateMode( AsyncUpdateMode asyncUpdateMode ) {
+			if ( asyncUpdateMode != AsyncUpdateMode::OFF && !OptimizerType::supports_async_updates )
+				throw std::runtime_error( "The optimizer does not support asynchronous updates." );
+			mAsyncUpdateMode = asyncUpdateMode;
+		}
+
+		// Pipeline parallel training, trainBatch runs every batch through numStages
+		// contiguous stages of layers on their own threads, in micro batches (of the
+		// micro batch size when set, else about 4 per stage) and with the given schedule,
+		// see NetworkPipeline. The stage boundaries are balanced on measured layer costs.
+		// The pipeline always runs from the first layer (frozen features are not cached).
+		// With pinThreads every stage is pinned to its own cpu. With less than two stages
+		// the pipeline is removed.
+		PipelineType* getPipeline( ) { return mPipeline.get( ); }
+		PipelineSchedule getPipelineSchedule( ) const { return mPipelineSchedule; }
+		void setPipelineStages( std::size_t numStages, PipelineSchedule schedule = PipelineSchedule::ONE_F_ONE_B, bool pinThreads = false ) {
+			if ( numStages > 1 && ( OptimizerType::requires_sample_gradients || OptimizerType::requires_snapshot_gradients ) )
+				throw std::runtime_error( "Pipeline training does not support optimizers with sample or snapshot gradients." );
+			mPipeline.reset( );
+			if ( numStages > 1 )
+				mPipeline = std::make_unique< PipelineType >( getNetwork( ), numStages, pinThreads );
+			mPipelineSchedule = schedule;
+		}
+
+		// Tensor parallel inference, computePrediction splits the large layers of the
+		// network across numThreads threads (see TensorParallelPredictor), layers with
+		// less than minParallelWork multiply adds per thread stay on the calling thread.
+		// With pinThreads the threads are pinned to cpus of the cpuset. With less than two
+		// threads the predictor is removed.
+		TensorParallelType* getTensorParallel( ) { return mTensorParallel.get( ); }
+		void setInferenceThreads( std::size_t numThreads, std::size_t minParallelWork = TensorParallelType::default_min_parallel_work,
+								  bool pinThreads = false ) {
+			mTensorParallel.reset( );
+			if ( numThreads > 1 )
+				mTensorParallel = std::make_unique< TensorParallelType >( getNetwork( ), numThreads, minParallelWork, pinThreads );
+		}
+
+		// Micro batching, a batch passed to trainBatch is run through the network in
+		// micro batches of this many samples as matrices (one matrix product per layer
+		// and micro batch), the gradients accumulate over the micro batches and the
+		// optimizer update is applied once for the whole batch. Zero runs the samples
+		// one by one.
+		std::size_t getMicroBatchSize( ) const { return mMicroBatchSize; }
+		void setMicroBatchSize( std::size_t microBatchSize ) { mMicroBatchSize = microBatchSize; }
+		// Sets the micro batch size to the largest one whose working set of the largest
+		// layer (weights and batch matrices) fits half of the L2 cache, or of the L3
+		// cache for layers whose weights alone do not fit the L2 cache.
+		std::size_t chooseMicroBatchSize( ) {
+			std::size_t weightBytes = 0, columnBytes = 0;
+			for ( auto const& layer : getNetwork( ) ) {
+				std::size_t layerColumnBytes = ( 2 * layer -> getNumInputs( ) + 2 * layer -> getNumOutputs( ) + 1 ) * sizeof( NumericType );
+				std::size_t layerWeightBytes = layer -> isTrainableLayer( ) ? ( layer -> getNumInputs( ) + 1 ) * layer -> getNumOutputs( ) * sizeof( NumericType ) : 0;
+				weightBytes = std::max( weightBytes, layerWeightBytes );
+				columnBytes = std::max( columnBytes, layerColumnBytes );
+			}
+			std::size_t budget = Utils::getCacheSize( 2 ) / 2;
+			if ( weightBytes >= budget )
+				budget = Utils::getCacheSize( 3 ) / 2;
+			std::size_t microBatchSize = weightBytes < budget ? ( budget - weightBytes ) / std::max< std::size_t >( columnBytes, 1 ) : 1;
+			mMicroBatchSize = std::clamp< std::size_t >( microBatchSize, 1, max_micro_batch_size );
+			return mMicroBatchSize;
+		}
+
+		// Learning rate schedule, sets the optimizer's learning rate before every step,
+		// advanced after every step and (by train( )) after every epoch.
+		auto const& getLearningRateSchedule( ) const { return mLearningRateSchedule; }
+		void setLearningRateSchedule( std::shared_ptr< LearningRateScheduleType > schedule ) {
+			static_assert( has_learning_rate< OptimizerType >::value, "The optimizer has no learning rate to schedule." );
+			mLearningRateSchedule = std::move( schedule );
+		}
+		// early stopping on the validation loss (the training loss without validation data)
+		auto const& getEarlyStopping( ) const { return mEarlyStopping; }
+		void setEarlyStopping( std::shared_ptr< EarlyStoppingType > earlyStopping ) { mEarlyStopping = std::move( earlyStopping ); }
+
+		// Background evaluation (see BackgroundEvaluator), after every epoch train( )
+		// snapshots the weights and evaluates them on dataSets in numParts tasks on the
+		// trainer's scheduler while the next epoch trains, callback( epoch, results )
+		// receives the results on a thread of the scheduler. When dataSets include the
+		// validation data train( ) takes the validation loss from there rather than
+		// evaluating it again. train( ) returns once the last epoch's results are
+		// delivered. An empty callback turns background evaluation off.
+		void setBackgroundEvaluation( std::vector< DataSet > dataSets, typename BackgroundEvaluatorType::CallbackType callback,
+									  std::size_t numParts = 1 ) {
+			mBackgroundEvaluator.reset( );
+			if ( callback )
+				mBackgroundEvaluator = std::make_unique< BackgroundEvaluatorType >( getNetwork( ), mLossFun, mDataHandler, std::move( dataSets ),
+																				   std::move( callback ), mScheduler, numParts );
+		}
+		BackgroundEvaluatorType* getBackgroundEvaluator( ) { return mBackgroundEvaluator.get( ); }
+
+		// Frozen prefix feature caching (off by default). The outputs of the frozen leading
+		// layers do not change during training, trainEpoch computes them once per training
+		// sample and then only runs the layers from the first trained one on. The cache is
+		// rebuilt when the frozen layers, their weights or the training inputs change (a
+		// fingerprint of the inputs is taken every epoch, so in place changes such as
+		// shuffleTrainingData are noticed).
+		bool getCacheFrozenFeatures( ) const { return mCacheFrozenFeatures; }
+		void setCacheFrozenFeatures( bool cacheFrozenFeatures ) {
+			mCacheFrozenFeatures = cacheFrozenFeatures;
+			mFeatureCache.invalidate( );
+		}
+		// memory limit and mapped file directory of the cache
+		FeatureCacheType& getFeatureCache( ) { return mFeatureCache; }
+		FeatureCacheType const& getFeatureCache( ) const { return mFeatureCache; }
+		void invalidateFeatureCache( ) { mFeatureCache.invalidate( ); }
+
+		// Sampler choosing the samples of every epoch and the weights of their gradients,
+		// its loss table is updated with the loss of every sample trained on (batches of
+		// indices into the training data). Without one every sample is visited once per
+		// epoch in a shuffled order.
+		auto const& getSampler( ) const { return mSampler; }
+		void setSampler( std::shared_ptr< SamplerType > sampler ) {
+			static_assert( !OptimizerType::requires_sample_gradients, "The optimizer's sample gradient table assumes uniform sampling." );
+			mSampler = std::move( sampler );
+		}
 
 		// training
 		// compute forward
 		void computeForward( VectorXType const& inputVec ) {
-			// run forward compute
-			VectorXType inputWorkVec, outputWorkVec;
-			if ( auto firstLayer = getNetwork( ).getFirstLayer( ) ) {
-				(*firstLayer) -> forwardCompute( inputVec, outputWorkVec );
-				inputWorkVec = outputWorkVec;
-			}
-			else {
+			computeForward( getNetwork( ), inputVec );
+		}
+
+		// compute forward on the given network (or replica), through the layers
+		// [firstLayer, endLayer) (all by default), inputVec is the input of firstLayer
+		void computeForward( NetworkType& network, VectorXType const& inputVec, std::size_t firstLayer = 0,
+							 std::size_t endLayer = std::numeric_limits< std::size_t >::max( ) ) {
+			endLayer = std::min( endLayer, network.getNumLayers( ) );
+			if ( firstLayer >= endLayer ) {
 				throw std::runtime_error( "Can't forward compute on first layer..." );
 			}
-			for ( auto layerIter = getNetwork( ).begin( ) + 1; layerIter != getNetwork( ).end( ); ++layerIter ) {
+			// run forward compute, every layer writes into its own output vector
+			// so that no work vectors are reallocated between layers
+			VectorXType const* inputWorkVec = &inputVec;
+			for ( auto layerIter = network.begin( ) + firstLayer; layerIter != network.begin( ) + endLayer; ++layerIter ) {
 				auto& layerPtr = (*layerIter);
-				layerPtr -> forwardCompute( inputWorkVec, outputWorkVec );
-				inputWorkVec = outputWorkVec;
+				auto& outputWorkVec = layerPtr -> getOutputVec( );
+				layerPtr -> forwardCompute( *inputWorkVec, outputWorkVec );
+				inputWorkVec = &outputWorkVec;
 			}
 		}
 
@@ -68,38 +385,195 @@ namespace NNet { // begin NNet
 			return std::make_pair( loss, gradLoss );
 		}
 
+		// compute loss, writing the loss gradient into gradLossVec
+		NumericType computeLoss( VectorXType const& outputVec,
+								 VectorXType const& targetVec,
+								 VectorXType& gradLossVec ) {
+			NumericType loss = getLossFun( ).loss( outputVec, targetVec );
+			getLossFun( ).gradLoss( outputVec, targetVec, gradLossVec );
+			return loss;
+		}
+
 		// compute backward
 		void computeBackward( VectorXType const& gradLoss ) {
+			computeBackward( gradLoss, []( std::size_t ) { } );
+		}
+
+		// compute backward, calling layerDone( trainableLayerIndex ) as soon as a
+		// trainable layer's weight gradient is complete
+		template< typename LayerDoneType >
+		void computeBackward( VectorXType const& gradLoss, LayerDoneType&& layerDone ) {
+			computeBackward( getNetwork( ), mWork, gradLoss, std::forward< LayerDoneType >( layerDone ) );
+		}
+
+		// compute backward on the given network (or replica) with the work buffers of
+		// the calling thread
+		template< typename LayerDoneType >
+		void computeBackward( NetworkType& network, WorkBuffers& work, VectorXType const& gradLoss, LayerDoneType&& layerDone ) {
+			if ( !network.getLastLayer( ) ) {
+				throw std::runtime_error( "Can't backward compute on last layer...");
+			}
 			// run backward compute
+			// every layer writes into its own output delta vector
 			VectorXType dummyVec;
-			VectorXType	inputDeltaWorkVec = gradLoss, outputDeltaWorkVec;
-			if ( auto lastLayer = getNetwork( ).getLastLayer( ) ) {
-				(*lastLayer) -> backwardCompute( dummyVec, dummyVec, inputDeltaWorkVec, outputDeltaWorkVec );
-				inputDeltaWorkVec = outputDeltaWorkVec;
+			VectorXType const* inputDeltaWorkVec = &gradLoss;
+			runBackwardGraph( network, work, 1, []( std::size_t, auto&& ) { }, [&]( auto& layerPtr, WeightGradJob* job ) {
+				auto& outputDeltaWorkVec = layerPtr -> getOutputDeltaVec( );
+				if ( job ) {
+					job -> deltaVec = inputDeltaWorkVec;
+					mScheduler -> run( job -> group, [job]( ) { job -> layer -> accumulateWeightGrad( *job -> deltaVec ); } );
+					job -> layer -> backwardComputeDelta( *inputDeltaWorkVec, outputDeltaWorkVec );
+				}
+				else {
+					layerPtr -> backwardCompute( dummyVec, dummyVec, *inputDeltaWorkVec, outputDeltaWorkVec );
+				}
+				inputDeltaWorkVec = &outputDeltaWorkVec;
+			}, layerDone );
+		}
+
+		// Backward task graph over the layers the backward pass visits (layers before
+		// the earliest one that still needs a gradient are not). step( layerPtr, job )
+		// runs a layer's backward compute, or with a job only its delta after queueing
+		// its weight gradient on the scheduler. So the chain of deltas runs on the calling
+		// thread and the weight gradients of the later layers run beside it. layerDone(
+		// trainableLayerIndex ) is called on the calling thread, in backward order, as
+		// soon as a layer's weight gradient is complete. beginLayer( layerIndex, finish )
+		// is called before a layer's step, finish( ) waits until the later layers are done.
+		template< typename BeginLayerType, typename StepType, typename LayerDoneType >
+		void runBackwardGraph( NetworkType& network, WorkBuffers& work, Eigen::Index batchSize, BeginLayerType&& beginLayer,
+							   StepType&& step, LayerDoneType&& layerDone ) {
+			std::size_t numLayers = network.getNumBackwardLayers( );
+			while ( work.weightGradJobs.size( ) < numLayers ) {
+				work.weightGradJobs.push_back( std::make_unique< WeightGradJob >( ) );
 			}
-			else {
-				throw std::runtime_error( "Can't backward compute on last layer...");
+			std::size_t trainableIndex = network.getTrainableLayers( ).size( );
+			// layers [0, numDone) (in backward order) are done
+			std::size_t numDone = 0;
+			auto finishLayers = [&]( std::size_t end, bool block ) {
+				for ( ; numDone < end; ++numDone ) {
+					if ( !network.rbegin( )[numDone] -> isTrainableLayer( ) )
+						continue;
+					auto& job = *work.weightGradJobs[numDone];
+					if ( job.layer ) {
+						if ( !block && !job.group.isDone( ) )
+							return;
+						mScheduler -> wait( job.group );
+						job.layer = nullptr;
+					}
+					layerDone( --trainableIndex );
+				}
+			};
+			try {
+				for ( std::size_t i = 0; i < numLayers; ++i ) {
+					beginLayer( network.getNumLayers( ) - 1 - i, [&]( ) { finishLayers( i, true ); } );
+					auto& layerPtr = network.rbegin( )[i];
+					WeightGradJob* job = nullptr;
+					if ( runsWeightGradTask( *layerPtr, batchSize ) ) {
+						job = work.weightGradJobs[i].get( );
+						job -> layer = static_cast< TrainableLayerType* >( layerPtr.get( ) );
+					}
+					step( layerPtr, job );
+					finishLayers( i + 1, false );
+				}
+				finishLayers( numLayers, true );
 			}
-			for ( auto layerIter = getNetwork( ).rbegin( ) + 1; layerIter != getNetwork( ).rend( ); ++layerIter ) {
-				auto& layerPtr = (*layerIter);
-				layerPtr -> backwardCompute( dummyVec, dummyVec, inputDeltaWorkVec, outputDeltaWorkVec );
-				inputDeltaWorkVec = outputDeltaWorkVec;
+			catch ( ... ) {
+				// the queued weight gradients refer to the layers' work vectors
+				for ( std::size_t i = 0; i < numLayers; ++i ) {
+					auto& job = *work.weightGradJobs[i];
+					if ( job.layer ) {
+						try {
+							mScheduler -> wait( job.group );
+						}
+						catch ( ... ) {
+						}
+						job.layer = nullptr;
+					}
+				}
+				throw;
+			}
+		}
+
+		// true when a layer's weight gradient is worth a task of its own, i.e. it is large
+		// and there is a delta to compute beside it
+		template< typename LayerPtrType >
+		bool runsWeightGradTask( LayerPtrType const& layer, Eigen::Index batchSize ) const {
+			if ( mScheduler -> getNumThreads( ) == 1 || !layer.isTrainableLayer( ) || !layer.getPropagatesDelta( ) )
+				return false;
+			auto const& trainableLayer = static_cast< TrainableLayerType const& >( layer );
+			return !trainableLayer.isFrozen( )
+				&& trainableLayer.getNumParameters( ) * static_cast< std::size_t >( batchSize ) >= mMinWeightGradTaskWork;
+		}
+
+		// batched forward compute, the columns of inputMat are samples (inputs of
+		// firstLayer), the outputs are the first inputMat.cols( ) columns of the last
+		// layer's getOutputMat( ). A checkpointing network releases the batch matrices
+		// of the layers outside its last segment as it goes, but for the checkpoints.
+		void computeForwardBatch( NetworkType& network, ConstMatrixRefType inputMat, std::size_t firstLayer = 0 ) {
+			if ( firstLayer >= network.getNumLayers( ) )
+				throw std::runtime_error( "Can't forward compute on first layer..." );
+			auto batchSize = inputMat.cols( );
+			network.getLayer( firstLayer ) -> forwardComputeBatch( inputMat );
+			for ( std::size_t i = firstLayer + 1; i < network.getNumLayers( ); ++i ) {
+				network.getLayer( i ) -> forwardComputeBatch( network.getLayer( i - 1 ) -> getOutputMat( ).leftCols( batchSize ) );
+				if ( network.releasesBatch( i - 1 ) )
+					network.getLayer( i - 1 ) -> releaseBatch( network.isCheckpoint( i - 1 ), false );
 			}
 		}
 
+		// batched backward compute after computeForwardBatch( network, inputMat, firstLayer ),
+		// calling layerDone( trainableLayerIndex ) as soon as a trainable layer's weight
+		// gradient is complete. A checkpointing network's segments are recomputed from
+		// inputMat and the checkpoints as the pass enters them.
+		template< typename LayerDoneType >
+		void computeBackwardBatch( NetworkType& network, WorkBuffers& work, ConstMatrixRefType inputMat, std::size_t firstLayer,
+								   ConstMatrixRefType gradLossMat, LayerDoneType&& layerDone ) {
+			if ( network.getLayers( ).empty( ) )
+				throw std::runtime_error( "Can't backward compute on last layer...");
+			auto batchSize = gradLossMat.cols( );
+			BaseLayerPtrType const* previousLayer = nullptr;
+			auto beginLayer = [&]( std::size_t layerIndex, auto&& finish ) {
+				if ( !network.isCheckpoint( layerIndex ) )
+					return;
+				// the later layers' weight gradients read their batch matrices
+				finish( );
+				recomputeSegment( network, layerIndex, inputMat, firstLayer );
+			};
+			runBackwardGraph( network, work, batchSize, beginLayer, [&]( auto& layerPtr, WeightGradJob* job ) {
+				ConstMatrixRefType inputDeltaMat = previousLayer ? ConstMatrixRefType( (*previousLayer) -> getOutputDeltaMat( ).leftCols( batchSize ) ) : gradLossMat;
+				if ( job ) {
+					job -> deltaMat.emplace( inputDeltaMat );
+					mScheduler -> run( job -> group, [job]( ) { job -> layer -> accumulateWeightGradBatch( *job -> deltaMat ); } );
+					job -> layer -> backwardComputeDeltaBatch( inputDeltaMat );
+				}
+				else {
+					layerPtr -> backwardComputeBatch( inputDeltaMat );
+				}
+				previousLayer = &layerPtr;
+			}, layerDone );
+		}
+
 		//compute single prediction
-		auto computePrediction( VectorXType const& inputVec ) {
+		VectorXType computePrediction( VectorXType const& inputVec ) {
+			if ( mTensorParallel )
+				return mTensorParallel -> predict( inputVec );
 			computeForward( inputVec );
 			auto const& lastOutput = getNetwork( ).getLastOutput( );
 			return lastOutput;
 		}
 
+		// with firstLayer > 0, inputVec is the input of that layer (e.g. a cached feature),
+		// the gradient is multiplied by sampleWeight, returns the (unweighted) loss
 		NumericType runSingleSample( VectorXType const& inputVec,
-									 VectorXType const& targetVec ) {
-			computeForward( inputVec );
-			auto [loss, gradLoss] = computeLoss( getNetwork( ).getLastOutput( ), targetVec );
+									 VectorXType const& targetVec,
+									 std::size_t firstLayer = 0,
+									 NumericType sampleWeight = 1.0 ) {
+			computeForward( getNetwork( ), inputVec, firstLayer );
+			NumericType loss = computeLoss( getNetwork( ).getLastOutput( ), targetVec, mGradLossVec );
 			// std::cout << "Single Sample Loss: " << loss << std::endl;
-			computeBackward( gradLoss );
+			if ( sampleWeight != 1.0 )
+				mGradLossVec *= sampleWeight;
+			computeBackward( mGradLossVec );
 			return loss;
 		}
 
@@ -118,56 +592,245 @@ namespace NNet { // begin NNet
 		}
 
 		NumericType trainEpoch( std::size_t batchSize ) {
+			if constexpr ( OptimizerType::is_full_batch ) {
+				// an epoch is one pass over the data, i.e. one full batch iteration
+				return trainFullBatch( );
+			}
+			// the layers before firstLayer are frozen and their outputs are cached
+			std::size_t firstLayer = updateFeatureCache( );
 			NumericType epochLoss = 0.0;
 			std::size_t batchCtr = 1;
 			std::size_t sampleCtr = 0;
-			mDataHandler.shuffleTrainingData( getNetwork( ).getInitializer( ).getRandomEngine( ) );
-			auto& data = mDataHandler.getTrainingData( );
-			std::size_t num_batchs = data.size() / batchSize + 1;
-			Utils::ProgressBar progress_bar( num_batchs, "" );
-			for_each_batch( data.begin( ), data.end( ), batchSize,
+			// visit the training data in a shuffled (or sampled) order of sample indices
+			auto const& order = sampleTrainingOrder( );
+			if constexpr ( OptimizerType::requires_snapshot_gradients ) {
+				if ( getOptimizer( ).getSnapshotInterval( ) == 0 )
+					getOptimizer( ).requestSnapshot( );
+			}
+			if constexpr ( OptimizerType::supports_async_updates ) {
+				if ( mAsyncUpdateMode != AsyncUpdateMode::OFF )
+					return trainEpochAsync( order, batchSize, firstLayer );
+			}
+			std::size_t num_batchs = order.size() / batchSize + 1;
+			std::optional< Utils::ProgressBar > progress_bar;
+			if ( mShowProgress )
+				progress_bar.emplace( num_batchs, "" );
+			for_each_batch( order.begin( ), order.end( ), batchSize,
 							[&,this]( auto& iterFrom, auto& iterTo ) {
-								progress_bar.updateLastPrintedMessage( "Training on batch " + std::to_string( batchCtr ) + "/" + std::to_string( num_batchs ) );
-								getOptimizer( ).applyInterimUpdate( );
-								NumericType batchLoss = 0.0;
-								std::size_t realBatchSize = 0;
-								for ( auto& iter = iterFrom; iter < iterTo; ++iter ) {
-									auto const& inputVec = mDataHandler.getInput( *iter );
-									auto const& targetVec = mDataHandler.getTarget( *iter );
-									// std::cout << "inputVec, targetVec: "
-									// 		  << inputVec << ", " << targetVec << std::endl;
-									batchLoss += runSingleSample( inputVec, targetVec );
-									// std::cout << "BatchLoss, batchCtr, sampleCtr: " << batchLoss << ", " << batchCtr << ", " << sampleCtr << std::endl;
-									++sampleCtr;
-									++realBatchSize;
-								}
-								// update weights
-								batchLoss /= static_cast< NumericType >( realBatchSize );
-								epochLoss += batchLoss;
-								getOptimizer( ).applyWeightUpdate( realBatchSize );
-
-								// reset gradients
-								getOptimizer( ).resetGradients( );
-
+								if ( progress_bar )
+									progress_bar -> updateLastPrintedMessage( "Training on batch " + std::to_string( batchCtr ) + "/" + std::to_string( num_batchs ) );
+								epochLoss += trainBatch( iterFrom, iterTo, firstLayer );
+								sampleCtr += std::distance( iterFrom, iterTo );
 								++batchCtr;
-								++progress_bar;
+								if ( progress_bar )
+									++*progress_bar;
 							} );
 			epochLoss /= static_cast< NumericType >( batchCtr );
 			return epochLoss;
 		}
 
+		// train a single batch [iterFrom, iterTo) of data pairs or of indices into the
+		// training data, returns the mean batch loss
+		// once the layer and optimizer buffers are sized (after the first batch) a step
+		// makes no heap allocations
+		template< typename IterType >
+		NumericType trainBatch( IterType iterFrom, IterType iterTo ) {
+			return trainBatch( iterFrom, iterTo, 0 );
+		}
+
 		NumericType trainSingleSample( VectorXType const& inputVec,
 									   VectorXType const& targetVec ) {
+			if constexpr ( OptimizerType::requires_sample_gradients ) {
+				throw std::runtime_error( "The optimizer needs sample indices, train with trainBatch over the training data." );
+			}
+			Utils::AllocationScope allocationScope;
+			if constexpr ( OptimizerType::requires_snapshot_gradients ) {
+				if ( getOptimizer( ).isSnapshotDue( ) )
+					takeSnapshot( );
+			}
 			getOptimizer( ).applyInterimUpdate( );
-			NumericType loss = runSingleSample( inputVec, targetVec );
-			// update weights
+			applyLearningRateSchedule( );
+			// update weights and reset gradients
 			std::size_t batchSize = 1;
-			getOptimizer( ).applyWeightUpdate( batchSize );
-			// reset gradients
-			getOptimizer( ).resetGradients( );
+			NumericType loss;
+			if constexpr ( OptimizerType::requires_snapshot_gradients ) {
+				loss = runSingleSample( inputVec, targetVec );
+				getOptimizer( ).beginSnapshotGradients( );
+				runSingleSample( inputVec, targetVec );
+				getOptimizer( ).endSnapshotGradients( );
+				getOptimizer( ).applyWeightUpdate( batchSize );
+				getOptimizer( ).resetGradients( );
+			}
+			else {
+				loss = runLastSample( inputVec, targetVec, batchSize );
+			}
+			if ( mLearningRateSchedule )
+				mLearningRateSchedule -> step( );
+			mStepAllocationStats = allocationScope.getStats( );
 			return loss;
 		}
 
+		// Trains up to maxEpochs epochs. After every epoch the validation loss is evaluated
+		// (when the data handler has validation data), the learning rate schedule is
+		// advanced with it and the early stopping controller decides whether to stop,
+		// the best weights are restored when it does or when the epochs run out.
+		// epochDone( epoch, trainingLoss, validationLoss ) is called after every epoch.
+		// A background evaluation starts on the weights of every epoch before the
+		// validation loss. When it covers the validation data, an epoch's validation
+		// loss is the background one, delivered while the next epoch trains: the
+		// schedule, epochDone and early stopping see an epoch after the next one has
+		// trained (the best weights are those of the evaluated snapshot).
+		template< typename EpochDoneType >
+		TrainingHistory train( std::size_t maxEpochs, std::size_t batchSize, EpochDoneType&& epochDone ) {
+			TrainingHistory history;
+			auto const& validationData = mDataHandler.getValidationData( );
+			bool backgroundValidation = mBackgroundEvaluator && !validationData.empty( ) && mBackgroundEvaluator -> evaluates( DataSet::VALIDATION );
+			if ( mEarlyStopping )
+				mEarlyStopping -> reset( );
+			for ( std::size_t epoch = 0; epoch < maxEpochs; ++epoch ) {
+				NumericType trainingLoss = trainEpoch( batchSize );
+				history.trainingLoss.push_back( trainingLoss );
+				if ( backgroundValidation ) {
+					// the previous epoch was evaluated while this one trained
+					if ( epoch > 0 && endBackgroundEpoch( history, epoch - 1, epochDone ) )
+						break;
+					mBackgroundEvaluator -> evaluate( epoch );
+					continue;
+				}
+				if ( mBackgroundEvaluator )
+					mBackgroundEvaluator -> evaluate( epoch );
+				NumericType monitoredLoss = trainingLoss;
+				if ( !validationData.empty( ) ) {
+					monitoredLoss = evaluateLoss( validationData );
+					history.validationLoss.push_back( monitoredLoss );
+				}
+				if ( endEpoch( history, epoch, monitoredLoss, getNetwork( ).getParameterVec( ), epochDone ) )
+					break;
+			}
+			if ( mBackgroundEvaluator ) {
+				mBackgroundEvaluator -> wait( );
+				if ( backgroundValidation && !history.stoppedEarly && !history.trainingLoss.empty( ) )
+					endBackgroundEpoch( history, history.trainingLoss.size( ) - 1, epochDone );
+			}
+			if ( mEarlyStopping ) {
+				history.bestEpoch = mEarlyStopping -> getBestEpoch( );
+				if ( mEarlyStopping -> getRestoreBestWeights( ) )
+					mEarlyStopping -> restoreBestWeights( getNetwork( ).getParameterVec( ) );
+			}
+			else if ( !history.trainingLoss.empty( ) ) {
+				history.bestEpoch = history.trainingLoss.size( ) - 1;
+			}
+			return history;
+		}
+
+		TrainingHistory train( std::size_t maxEpochs, std::size_t batchSize ) {
+			return train( maxEpochs, batchSize, []( std::size_t, NumericType, NumericType ) { } );
+		}
+
+		// mean loss over data (e.g. the validation data) at the current weights, the
+		// forward passes are split across the gradient threads
+		NumericType evaluateLoss( VectorDataPairType const& data ) {
+			if ( data.empty( ) )
+				return 0.0;
+			prepareReplicas( );
+			runOnGradientThreads( [this, &data]( std::size_t part ) {
+				auto& replica = mReplicas[part];
+				auto& network = *replica.network;
+				std::size_t begin = data.size( ) * part / mReplicas.size( );
+				std::size_t end = data.size( ) * ( part + 1 ) / mReplicas.size( );
+				replica.loss = 0.0;
+				for ( std::size_t i = begin; i < end; ++i ) {
+					computeForward( network, mDataHandler.getInput( data[i] ) );
+					replica.loss += getLossFun( ).loss( network.getLastOutput( ), mDataHandler.getTarget( data[i] ) );
+				}
+			} );
+			NumericType loss = 0.0;
+			for ( auto const& replica : mReplicas ) {
+				loss += replica.loss;
+			}
+			return loss / static_cast< NumericType >( data.size( ) );
+		}
+
+		// Full batch training for optimizers with is_full_batch set (LBFGSOptimizer),
+		// runs numIterations optimizer steps and returns the mean training loss at the
+		// final weights.
+		NumericType trainFullBatch( std::size_t numIterations = 1 ) {
+			static_assert( OptimizerType::is_full_batch, "trainFullBatch needs a full batch optimizer." );
+			NumericType loss = 0.0;
+			for ( std::size_t i = 0; i < numIterations; ++i ) {
+				Utils::AllocationScope allocationScope;
+				loss = getOptimizer( ).step( [this]( ) { return computeFullBatchGradient( ); } );
+				mStepAllocationStats = allocationScope.getStats( );
+			}
+			return loss;
+		}
+
+		// Mean loss over the training data at the current weights, the mean gradient is
+		// written to the network's gradient buffer. The data is split into one contiguous
+		// part per gradient thread, each part is run on a network replica with its own
+		// gradient buffer. The replica gradients are then summed, each thread summing a
+		// slice of the parameters, in a fixed order so that the result does not depend
+		// on scheduling.
+		NumericType computeFullBatchGradient( ) {
+			auto const& data = mDataHandler.getTrainingData( );
+			if ( data.empty( ) )
+				throw std::runtime_error( "Can't compute the full batch gradient without training data..." );
+			prepareReplicas( );
+			runOnGradientThreads( [this]( std::size_t part ) { accumulateReplicaGradient( part ); } );
+			NumericType coeff = 1.0 / static_cast< NumericType >( data.size( ) );
+			runOnGradientThreads( [this, coeff]( std::size_t part ) { reduceReplicaGradients( part, coeff ); } );
+			NumericType loss = 0.0;
+			for ( auto const& replica : mReplicas ) {
+				loss += replica.loss;
+			}
+			return loss / static_cast< NumericType >( data.size( ) );
+		}
+
+		// Closed form fit of the output layer. With the earlier layers fixed, the output
+		// layer's weights minimizing the mean squared error are a linear least squares
+		// problem in the hidden features h (the last layer's inputs plus the bias one),
+		//   min_W 1/N sum_i || W^T h_i - y_i ||^2 + ridge || W ||^2 (bias row not penalized).
+		// The features are computed in batches of batchSize samples per gradient thread
+		// and accumulated into the normal equations H^T H, H^T Y, which are solved with
+		// an LDLT factorization. Returns the mean training loss at the new weights.
+		NumericType solveOutputLayer( NumericType ridge = 1e-8, std::size_t batchSize = 256 ) {
+			static_assert( std::is_same_v< LossFunType< NumericTraitsType >, MSELossFuction< NumericTraitsType > >,
+						   "solveOutputLayer needs the mean squared error loss." );
+			using FullyConnectedLayerType = FullyConnectedLayer< NumericTraitsType >;
+			auto lastLayer = getNetwork( ).getLastLayer( );
+			auto outputLayer = lastLayer ? std::dynamic_pointer_cast< FullyConnectedLayerType >( *lastLayer ) : nullptr;
+			if ( !outputLayer )
+				throw std::runtime_error( "solveOutputLayer needs a fully connected output layer..." );
+			auto const& data = mDataHandler.getTrainingData( );
+			if ( data.empty( ) )
+				throw std::runtime_error( "Can't solve for the output layer without training data..." );
+			prepareReplicas( );
+			mFeatureBatchSize = std::max< std::size_t >( batchSize, 1 );
+			runOnGradientThreads( [this]( std::size_t part ) { accumulateNormalEquations( part ); } );
+			// reduce in a fixed order, only the lower triangle of H^T H is accumulated
+			MatrixXType gramMat = mReplicas[0].gramMat;
+			MatrixXType crossMat = mReplicas[0].crossMat;
+			NumericType targetSquaredNorm = mReplicas[0].loss;
+			for ( std::size_t r = 1; r < mReplicas.size( ); ++r ) {
+				gramMat += mReplicas[r].gramMat;
+				crossMat += mReplicas[r].crossMat;
+				targetSquaredNorm += mReplicas[r].loss;
+			}
+			NumericType numSamples = static_cast< NumericType >( data.size( ) );
+			auto numFeatures = gramMat.rows( );
+			MatrixXType systemMat = gramMat;
+			systemMat.diagonal( ).head( numFeatures - 1 ).array( ) += ridge * numSamples;
+			Eigen::LDLT< MatrixXType, Eigen::Lower > ldlt( systemMat );
+			if ( ldlt.info( ) != Eigen::Success )
+				throw std::runtime_error( "solveOutputLayer failed to factorize the normal equations, increase the ridge..." );
+			MatrixXType weightMat = ldlt.solve( crossMat );
+			outputLayer -> getWeightMat( ) = weightMat;
+			// sum_i || W^T h_i - y_i ||^2 = tr( Y^T Y ) - 2 tr( W^T H^T Y ) + tr( W^T H^T H W )
+			NumericType residual = targetSquaredNorm - 2.0 * weightMat.cwiseProduct( crossMat ).sum( )
+				+ weightMat.cwiseProduct( gramMat.template selfadjointView< Eigen::Lower >( ) * weightMat ).sum( );
+			return std::max< NumericType >( residual, 0.0 ) / numSamples;
+		}
+
 		bool saveNetwork( std::string const& file_path ) {
 			auto path = std::filesystem::path( file_path );
 			std::string ext = path.extension().string();
@@ -223,6 +886,714 @@ namespace NNet { // begin NNet
 		}
 
 	private: 	//private member functions
+		// a batch run from firstLayer on, the batch elements then are indices into the
+		// training data whose features (inputs of firstLayer) are cached
+		template< typename IterType >
+		NumericType trainBatch( IterType iterFrom, IterType iterTo, std::size_t firstLayer ) {
+			Utils::AllocationScope allocationScope;
+			if constexpr ( OptimizerType::requires_snapshot_gradients ) {
+				if ( getOptimizer( ).isSnapshotDue( ) )
+					takeSnapshot( );
+			}
+			getOptimizer( ).applyInterimUpdate( );
+			NumericType batchLoss = 0.0;
+			std::size_t realBatchSize = std::distance( iterFrom, iterTo );
+			if ( realBatchSize == 0 )
+				return batchLoss;
+			applyLearningRateSchedule( );
+			if constexpr ( OptimizerType::requires_sample_gradients || OptimizerType::requires_snapshot_gradients ) {
+				for ( auto iter = iterFrom; iter != iterTo; ++iter ) {
+					auto const& dataPair = getDataPair( *iter );
+					NumericType sampleWeight = getSampleWeight( *iter );
+					NumericType loss = runSingleSample( getSampleInput( *iter, firstLayer, mWork.featureVec ), mDataHandler.getTarget( dataPair ), firstLayer, sampleWeight );
+					recordSampleLoss( *iter, loss );
+					batchLoss += sampleWeight * loss;
+					if constexpr ( OptimizerType::requires_sample_gradients )
+						getOptimizer( ).accumulateSampleGradient( getSampleIndex( *iter ) );
+				}
+				if constexpr ( OptimizerType::requires_snapshot_gradients ) {
+					// the same batch at the snapshot weights
+					getOptimizer( ).beginSnapshotGradients( );
+					for ( auto iter = iterFrom; iter != iterTo; ++iter ) {
+						auto const& dataPair = getDataPair( *iter );
+						runSingleSample( getSampleInput( *iter, firstLayer, mWork.featureVec ), mDataHandler.getTarget( dataPair ), firstLayer, getSampleWeight( *iter ) );
+					}
+					getOptimizer( ).endSnapshotGradients( );
+				}
+				getOptimizer( ).applyWeightUpdate( realBatchSize );
+				getOptimizer( ).resetGradients( );
+			}
+			else if ( mPipeline ) {
+				batchLoss = runPipelineBatch( iterFrom, realBatchSize );
+			}
+			else if ( mProcessGroup ) {
+				batchLoss = runProcessGroupBatch( iterFrom, realBatchSize, firstLayer );
+			}
+			else if ( mParameterServer ) {
+				batchLoss = runParameterServerBatch( iterFrom, realBatchSize, firstLayer );
+			}
+			else if ( mDataParallel ) {
+				batchLoss = runDataParallelBatch( iterFrom, realBatchSize, firstLayer );
+			}
+			else if ( mMicroBatchSize > 0 ) {
+				// the last micro batch completes the gradients and applies the update
+				auto iter = iterFrom;
+				for ( std::size_t remaining = realBatchSize; remaining > 0; ) {
+					std::size_t microBatchSize = std::min( mMicroBatchSize, remaining );
+					remaining -= microBatchSize;
+					batchLoss += runMicroBatch( iter, microBatchSize, remaining == 0 ? realBatchSize : 0, firstLayer );
+					std::advance( iter, microBatchSize );
+				}
+			}
+			else {
+				auto lastIter = std::next( iterFrom, realBatchSize - 1 );
+				for ( auto iter = iterFrom; iter != lastIter; ++iter ) {
+					auto const& dataPair = getDataPair( *iter );
+					NumericType sampleWeight = getSampleWeight( *iter );
+					NumericType loss = runSingleSample( getSampleInput( *iter, firstLayer, mWork.featureVec ), mDataHandler.getTarget( dataPair ), firstLayer, sampleWeight );
+					recordSampleLoss( *iter, loss );
+					batchLoss += sampleWeight * loss;
+				}
+				// the last sample completes the gradients, update weights and reset gradients
+				auto const& lastPair = getDataPair( *lastIter );
+				NumericType sampleWeight = getSampleWeight( *lastIter );
+				NumericType loss = runLastSample( getSampleInput( *lastIter, firstLayer, mWork.featureVec ), mDataHandler.getTarget( lastPair ), realBatchSize, firstLayer, sampleWeight );
+				recordSampleLoss( *lastIter, loss );
+				batchLoss += sampleWeight * loss;
+			}
+			batchLoss /= static_cast< NumericType >( realBatchSize );
+			if ( mLearningRateSchedule )
+				mLearningRateSchedule -> step( );
+			mStepAllocationStats = allocationScope.getStats( );
+			return batchLoss;
+		}
+
+		// a batch element is either a data pair or an index into the training data
+		template< typename ValueType >
+		DataPairType const& getDataPair( ValueType const& value ) const {
+			if constexpr ( std::is_integral_v< ValueType > )
+				return mDataHandler.getTrainingData( )[value];
+			else
+				return value;
+		}
+		// the input of a batch element, its cached feature (copied to featureVec) when
+		// training from firstLayer > 0
+		template< typename ValueType >
+		VectorXType const& getSampleInput( ValueType const& value, std::size_t firstLayer, VectorXType& featureVec ) {
+			if constexpr ( std::is_integral_v< ValueType > ) {
+				if ( firstLayer > 0 ) {
+					featureVec = mFeatureCache.getFeatureVec( static_cast< std::size_t >( value ) );
+					return featureVec;
+				}
+			}
+			return mDataHandler.getInput( getDataPair( value ) );
+		}
+		// gradient weight of a batch element from the sampler, one without
+		template< typename ValueType >
+		NumericType getSampleWeight( ValueType const& value ) const {
+			if constexpr ( std::is_integral_v< ValueType > ) {
+				if ( mSampler )
+					return mSampler -> getSampleWeight( static_cast< std::size_t >( value ) );
+			}
+			return 1.0;
+		}
+		template< typename ValueType >
+		void recordSampleLoss( ValueType const& value, NumericType loss ) {
+			if constexpr ( std::is_integral_v< ValueType > ) {
+				if ( mSampler )
+					mSampler -> recordLoss( static_cast< std::size_t >( value ), loss );
+			}
+		}
+
+		// the samples of the next epoch, from the sampler or a shuffle of all samples
+		std::vector< std::size_t > const& sampleTrainingOrder( ) {
+			auto& randomEngine = getNetwork( ).getInitializer( ).getRandomEngine( );
+			if ( mSampler )
+				return mSampler -> sampleEpoch( mDataHandler.getTrainingData( ).size( ), randomEngine );
+			mDataHandler.shuffleTrainingOrder( randomEngine );
+			return mDataHandler.getTrainingOrder( );
+		}
+
+		template< typename ValueType >
+		std::size_t getSampleIndex( ValueType const& value ) const {
+			if constexpr ( std::is_integral_v< ValueType > ) {
+				return static_cast< std::size_t >( value );
+			}
+			else {
+				auto const& data = mDataHandler.getTrainingData( );
+				if ( data.empty( ) || &value < data.data( ) || &value >= data.data( ) + data.size( ) )
+					throw std::runtime_error( "Sample is not part of the training data." );
+				return static_cast< std::size_t >( &value - data.data( ) );
+			}
+		}
+
+		// full training set gradient at the current weights, for snapshot optimizers
+		void takeSnapshot( ) {
+			auto const& data = mDataHandler.getTrainingData( );
+			getOptimizer( ).beginSnapshot( );
+			for ( auto const& dataPair : data ) {
+				runSingleSample( mDataHandler.getInput( dataPair ), mDataHandler.getTarget( dataPair ) );
+			}
+			getOptimizer( ).endSnapshot( data.size( ) );
+		}
+
+		void applyLearningRateSchedule( ) {
+			if constexpr ( has_learning_rate< OptimizerType >::value ) {
+				if ( mLearningRateSchedule )
+					getOptimizer( ).setLearningRate( mLearningRateSchedule -> getLearningRate( ) );
+			}
+		}
+
+		// Brings the feature cache up to date for an epoch and returns the layer training
+		// starts from, zero when no leading layers are frozen or caching is off. The
+		// features are computed on the gradient threads' replicas.
+		std::size_t updateFeatureCache( ) {
+			auto& network = getNetwork( );
+			auto const& data = mDataHandler.getTrainingData( );
+			std::size_t numPrefixLayers = network.getNumLayers( ) - network.getNumBackwardLayers( );
+			if ( !mCacheFrozenFeatures || mPipeline || numPrefixLayers == 0 || numPrefixLayers >= network.getNumLayers( ) || data.empty( ) )
+				return 0;
+			// the prefix's weights lie in front of those of the first trained layer
+			auto numPrefixTrainable = std::count_if( network.begin( ), network.begin( ) + numPrefixLayers,
+													 []( auto const& layer ) { return layer -> isTrainableLayer( ); } );
+			auto const& range = network.getParameterRanges( )[static_cast< std::size_t >( numPrefixTrainable )];
+			auto prefixParameterVec = network.getParameterVec( ).head( range.offset );
+			std::uint64_t dataFingerprint = FeatureCacheType::initial_fingerprint;
+			for ( auto const& dataPair : data ) {
+				auto const& input = mDataHandler.getInput( dataPair );
+				dataFingerprint = FeatureCacheType::fingerprint( dataFingerprint, input.data( ), static_cast< std::size_t >( input.size( ) ) );
+			}
+			if ( !mFeatureCache.matches( numPrefixLayers, dataFingerprint, data.size( ), prefixParameterVec ) ) {
+				mFeatureCache.reset( numPrefixLayers, network.getLayer( numPrefixLayers ) -> getNumInputs( ),
+									 dataFingerprint, data.size( ), prefixParameterVec );
+				prepareReplicas( );
+				runOnGradientThreads( [this]( std::size_t part ) { computeReplicaFeatures( part ); } );
+				mFeatureCache.validate( );
+			}
+			return numPrefixLayers;
+		}
+
+		// the end of an epoch in train( ): advances the learning rate schedule, calls
+		// epochDone and updates early stopping with the loss of the weights in
+		// parameterVec, returns whether training stops
+		template< typename EpochDoneType, typename ParameterVecType >
+		bool endEpoch( TrainingHistory& history, std::size_t epoch, NumericType monitoredLoss,
+					   ParameterVecType const& parameterVec, EpochDoneType& epochDone ) {
+			if ( mLearningRateSchedule )
+				mLearningRateSchedule -> endEpoch( monitoredLoss );
+			epochDone( epoch, history.trainingLoss[epoch], monitoredLoss );
+			if ( mEarlyStopping ) {
+				mEarlyStopping -> update( monitoredLoss, parameterVec );
+				if ( mEarlyStopping -> shouldStop( ) ) {
+					history.stoppedEarly = true;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		// ends an epoch on the validation loss of its background evaluation
+		template< typename EpochDoneType >
+		bool endBackgroundEpoch( TrainingHistory& history, std::size_t epoch, EpochDoneType& epochDone ) {
+			mBackgroundEvaluator -> wait( );
+			auto const& results = mBackgroundEvaluator -> getResults( );
+			auto validation = std::find_if( results.begin( ), results.end( ), []( auto const& result ) { return result.dataSet == DataSet::VALIDATION; } );
+			history.validationLoss.push_back( validation -> loss );
+			return endEpoch( history, epoch, validation -> loss, mBackgroundEvaluator -> getSnapshot( ) -> getParameterVec( ), epochDone );
+		}
+
+		void computeReplicaFeatures( std::size_t part ) {
+			auto& network = *mReplicas[part].network;
+			auto const& data = mDataHandler.getTrainingData( );
+			std::size_t numPrefixLayers = mFeatureCache.getNumPrefixLayers( );
+			std::size_t begin = data.size( ) * part / mReplicas.size( );
+			std::size_t end = data.size( ) * ( part + 1 ) / mReplicas.size( );
+			auto const& featureVec = network.getLayer( numPrefixLayers - 1 ) -> getOutputVec( );
+			for ( std::size_t i = begin; i < end; ++i ) {
+				computeForward( network, mDataHandler.getInput( data[i] ), 0, numPrefixLayers );
+				mFeatureCache.getFeatureVec( i ) = featureVec;
+			}
+		}
+
+		// one replica per gradient thread, (re)built by the part that uses it so that its
+		// buffers are first touched on the thread (and NUMA node) the part runs on
+		void prepareReplicas( ) {
+			if ( mReplicas.size( ) != mNumGradientThreads )
+				mReplicas.resize( mNumGradientThreads );
+			bool stale = std::any_of( mReplicas.begin( ), mReplicas.end( ), [this]( Replica const& replica ) { return isReplicaStale( replica ); } );
+			if ( stale ) {
+				if ( !getNetwork( ).isPacked( ) )
+					getNetwork( ).packParameters( );
+				runOnGradientThreads( [this]( std::size_t part ) { prepareReplica( mReplicas[part] ); } );
+			}
+			else {
+				for ( auto& replica : mReplicas ) {
+					prepareReplica( replica );
+				}
+			}
+		}
+
+		// a replica needs rebuilding when the network was repacked or its layers changed
+		bool isReplicaStale( Replica const& replica ) const {
+			return !replica.network || !replica.network -> sharesParameters( getNetwork( ) )
+				|| replica.network -> getNumLayers( ) != getNetwork( ).getNumLayers( );
+		}
+
+		// (re)builds a stale replica, it follows the network's frozen layers and checkpoints
+		void prepareReplica( Replica& replica ) {
+			if ( isReplicaStale( replica ) ) {
+				replica.network = getNetwork( ).makeReplica( );
+				if ( mScheduler -> isNumaAware( ) ) {
+					// keeps the gradient buffer on the node even where first touch doesn't
+					auto gradientVec = replica.network -> getGradientVec( );
+					Utils::bindMemoryToNode( gradientVec.data( ), static_cast< std::size_t >( gradientVec.size( ) ) * sizeof( NumericType ),
+											 mScheduler -> getTopology( ) -> getNodeId( mScheduler -> getCurrentNode( ) ) );
+				}
+			}
+			auto& replicaLayers = replica.network -> getTrainableLayers( );
+			auto const& layers = getNetwork( ).getTrainableLayers( );
+			bool changed = false;
+			for ( std::size_t i = 0; i < layers.size( ); ++i ) {
+				changed = changed || replicaLayers[i] -> isFrozen( ) != layers[i] -> isFrozen( );
+				replicaLayers[i] -> setFrozen( layers[i] -> isFrozen( ) );
+			}
+			if ( changed )
+				replica.network -> updateBackwardPlan( );
+			if ( replica.network -> getSegmentEnds( ) != getNetwork( ).getSegmentEnds( ) )
+				replica.network -> setSegmentEnds( getNetwork( ).getSegmentEnds( ) );
+		}
+
+		// runs task( part ) for every replica as tasks on the scheduler, the calling
+		// thread takes part. A replica's part keeps to the same scheduler thread (unless
+		// stolen), where its activations and gradient buffer are cache and NUMA local.
+		template< typename TaskType >
+		void runOnGradientThreads( TaskType const& task ) {
+			mScheduler -> parallelForAffine( mReplicas.size( ), task );
+		}
+
+		// features of a sample, i.e. the input of the last layer
+		VectorXType const& computeFeatures( NetworkType& network, VectorXType const& inputVec ) {
+			VectorXType const* inputWorkVec = &inputVec;
+			for ( auto layerIter = network.begin( ); layerIter + 1 < network.end( ); ++layerIter ) {
+				auto& outputWorkVec = (*layerIter) -> getOutputVec( );
+				(*layerIter) -> forwardCompute( *inputWorkVec, outputWorkVec );
+				inputWorkVec = &outputWorkVec;
+			}
+			return *inputWorkVec;
+		}
+
+		// normal equations of one part of the training data, replica.loss holds sum || y_i ||^2
+		void accumulateNormalEquations( std::size_t part ) {
+			auto const& data = mDataHandler.getTrainingData( );
+			auto& replica = mReplicas[part];
+			auto& network = *replica.network;
+			auto const& lastLayer = network.getLayers( ).back( );
+			auto numFeatures = static_cast< Eigen::Index >( lastLayer -> getNumInputs( ) + 1 );
+			auto numOutputs = static_cast< Eigen::Index >( lastLayer -> getNumOutputs( ) );
+			auto batchSize = static_cast< Eigen::Index >( mFeatureBatchSize );
+			replica.featureMat.resize( numFeatures, batchSize );
+			replica.targetMat.resize( numOutputs, batchSize );
+			replica.gramMat.setZero( numFeatures, numFeatures );
+			replica.crossMat.setZero( numFeatures, numOutputs );
+			replica.loss = 0.0;
+			std::size_t begin = data.size( ) * part / mReplicas.size( );
+			std::size_t end = data.size( ) * ( part + 1 ) / mReplicas.size( );
+			// samples are stored as columns, a batch is one rank update
+			Eigen::Index column = 0;
+			auto flush = [&]( ) {
+				auto featureBatch = replica.featureMat.leftCols( column );
+				replica.gramMat.template selfadjointView< Eigen::Lower >( ).rankUpdate( featureBatch );
+				replica.crossMat.noalias( ) += featureBatch * replica.targetMat.leftCols( column ).transpose( );
+				column = 0;
+			};
+			for ( std::size_t i = begin; i < end; ++i ) {
+				auto const& targetVec = mDataHandler.getTarget( data[i] );
+				replica.featureMat.col( column ) << computeFeatures( network, mDataHandler.getInput( data[i] ) ), 1.0;
+				replica.targetMat.col( column ) = targetVec;
+				replica.loss += targetVec.squaredNorm( );
+				if ( ++column == batchSize )
+					flush( );
+			}
+			if ( column > 0 )
+				flush( );
+		}
+
+		void accumulateReplicaGradient( std::size_t part ) {
+			auto const& data = mDataHandler.getTrainingData( );
+			auto& replica = mReplicas[part];
+			auto& network = *replica.network;
+			std::size_t begin = data.size( ) * part / mReplicas.size( );
+			std::size_t end = data.size( ) * ( part + 1 ) / mReplicas.size( );
+			network.getGradientVec( ).setZero( );
+			replica.loss = 0.0;
+			for ( std::size_t i = begin; i < end; ++i ) {
+				computeForward( network, mDataHandler.getInput( data[i] ) );
+				replica.loss += computeLoss( network.getLastOutput( ), mDataHandler.getTarget( data[i] ), replica.gradLossVec );
+				computeBackward( network, replica.work, replica.gradLossVec, []( std::size_t ) { } );
+			}
+		}
+
+		// Writes coeff times the sum of the replica gradients to the network's gradient
+		// buffer and zeroes the replica gradients. Thread part reduces a slice of the
+		// parameters, L1 sized chunk by chunk, the replicas are summed in replica order
+		// (so the result does not depend on scheduling and matches the rank ordered sum
+		// of multi-process training).
+		void reduceReplicaGradients( std::size_t part, NumericType coeff ) {
+			auto gradientVec = getNetwork( ).getGradientVec( );
+			std::size_t numParameters = gradientVec.size( );
+			std::size_t numReplicas = mReplicas.size( );
+			// slices start on a cache line so threads don't share lines
+			constexpr std::size_t lineElements = Utils::cache_line_size / sizeof( NumericType );
+			auto sliceBegin = [&]( std::size_t k ) {
+				return std::min( numParameters, ( numParameters * k / numReplicas ) / lineElements * lineElements );
+			};
+			std::size_t begin = part == 0 ? 0 : sliceBegin( part );
+			std::size_t end = part + 1 == numReplicas ? numParameters : sliceBegin( part + 1 );
+			constexpr std::size_t chunk_size = 8192 / sizeof( NumericType );
+			for ( std::size_t chunkBegin = begin; chunkBegin < end; chunkBegin += chunk_size ) {
+				std::size_t chunkSize = std::min( chunk_size, end - chunkBegin );
+				for ( std::size_t r = 1; r < numReplicas; ++r ) {
+					mReplicas[0].network -> getGradientVec( ).segment( chunkBegin, chunkSize )
+						+= mReplicas[r].network -> getGradientVec( ).segment( chunkBegin, chunkSize );
+				}
+				gradientVec.segment( chunkBegin, chunkSize ) = coeff * mReplicas[0].network -> getGradientVec( ).segment( chunkBegin, chunkSize );
+				for ( auto& replica : mReplicas ) {
+					replica.network -> getGradientVec( ).segment( chunkBegin, chunkSize ).setZero( );
+				}
+			}
+		}
+
+		// Forward and backward passes of the part-th contiguous share of a batch on the
+		// part-th replica, the gradients accumulate in the replica's gradient buffer and
+		// the sample losses are kept for the sampler.
+		template< typename IterType >
+		void accumulateReplicaBatch( std::size_t part, IterType iterFrom, std::size_t batchSize, std::size_t firstLayer ) {
+			auto& replica = mReplicas[part];
+			std::size_t begin = batchSize * part / mReplicas.size( );
+			std::size_t end = batchSize * ( part + 1 ) / mReplicas.size( );
+			replica.loss = 0.0;
+			replica.sampleLosses.clear( );
+			accumulateReplicaSamples( replica, std::next( iterFrom, begin ), end - begin, firstLayer );
+		}
+
+		// forward and backward passes of numSamples samples from iter on a replica
+		template< typename IterType >
+		void accumulateReplicaSamples( Replica& replica, IterType iter, std::size_t numSamples, std::size_t firstLayer ) {
+			accumulateReplicaSamples( replica, iter, numSamples, firstLayer, []( std::size_t ) { } );
+		}
+
+		// as above, calling lastLayerDone( trainableLayerIndex ) as soon as a trainable
+		// layer's gradient is complete, in the backward pass of the last sample or micro batch
+		template< typename IterType, typename LayerDoneType >
+		void accumulateReplicaSamples( Replica& replica, IterType iter, std::size_t numSamples, std::size_t firstLayer, LayerDoneType&& lastLayerDone ) {
+			auto& network = *replica.network;
+			auto record = [this, &replica]( auto const& value, NumericType loss ) {
+				if constexpr ( std::is_integral_v< std::decay_t< decltype( value ) > > ) {
+					if ( mSampler )
+						replica.sampleLosses.emplace_back( static_cast< std::size_t >( value ), loss );
+				}
+			};
+			if ( mMicroBatchSize > 0 ) {
+				for ( std::size_t remaining = numSamples; remaining > 0; ) {
+					std::size_t microBatchSize = std::min( mMicroBatchSize, remaining );
+					remaining -= microBatchSize;
+					replica.loss += forwardMicroBatch( network, replica.work, iter, microBatchSize, firstLayer, record );
+					if ( remaining > 0 )
+						computeBackwardBatch( network, replica.work, replica.work.inputMat.leftCols( microBatchSize ), firstLayer,
+											  replica.work.gradLossMat.leftCols( microBatchSize ), []( std::size_t ) { } );
+					else
+						computeBackwardBatch( network, replica.work, replica.work.inputMat.leftCols( microBatchSize ), firstLayer,
+											  replica.work.gradLossMat.leftCols( microBatchSize ), lastLayerDone );
+					std::advance( iter, microBatchSize );
+				}
+				return;
+			}
+			for ( std::size_t i = 0; i < numSamples; ++i, ++iter ) {
+				NumericType sampleWeight = getSampleWeight( *iter );
+				computeForward( network, getSampleInput( *iter, firstLayer, replica.work.featureVec ), firstLayer );
+				NumericType loss = computeLoss( network.getLastOutput( ), mDataHandler.getTarget( getDataPair( *iter ) ), replica.work.gradLossVec );
+				if ( sampleWeight != 1.0 )
+					replica.work.gradLossVec *= sampleWeight;
+				if ( i + 1 < numSamples )
+					computeBackward( network, replica.work, replica.work.gradLossVec, []( std::size_t ) { } );
+				else
+					computeBackward( network, replica.work, replica.work.gradLossVec, lastLayerDone );
+				record( *iter, loss );
+				replica.loss += sampleWeight * loss;
+			}
+		}
+
+		// Hogwild training of the part-th contiguous share of an epoch's samples on the
+		// part-th replica, in batches of batchSize samples whose gradient is applied to
+		// the shared weights without locks.
+		template< typename IterType >
+		void trainReplicaAsync( std::size_t part, IterType iterFrom, std::size_t numSamples, std::size_t batchSize, std::size_t firstLayer ) {
+			auto& replica = mReplicas[part];
+			auto gradientVec = replica.network -> getGradientVec( );
+			std::size_t begin = numSamples * part / mReplicas.size( );
+			std::size_t end = numSamples * ( part + 1 ) / mReplicas.size( );
+			replica.loss = 0.0;
+			replica.numSteps = 0;
+			replica.sampleLosses.clear( );
+			gradientVec.setZero( );
+			auto iter = std::next( iterFrom, begin );
+			for ( std::size_t remaining = end - begin; remaining > 0; ) {
+				std::size_t realBatchSize = std::min( batchSize, remaining );
+				remaining -= realBatchSize;
+				accumulateReplicaSamples( replica, iter, realBatchSize, firstLayer );
+				getOptimizer( ).applyAsyncUpdate( gradientVec, realBatchSize, mAsyncUpdateMode );
+				gradientVec.setZero( );
+				std::advance( iter, realBatchSize );
+				++replica.numSteps;
+			}
+		}
+
+		// Hogwild epoch over order, returns the mean (weighted) sample loss
+		template< typename OrderType >
+		NumericType trainEpochAsync( OrderType const& order, std::size_t batchSize, std::size_t firstLayer ) {
+			if ( order.empty( ) )
+				return 0.0;
+			// the learning rate is fixed for the epoch, the schedule is advanced afterwards
+			applyLearningRateSchedule( );
+			prepareReplicas( );
+			runOnGradientThreads( [&,this]( std::size_t part ) {
+				trainReplicaAsync( part, order.begin( ), order.size( ), std::max< std::size_t >( batchSize, 1 ), firstLayer );
+			} );
+			NumericType loss = 0.0;
+			for ( auto const& replica : mReplicas ) {
+				loss += replica.loss;
+				for ( auto const& [sample, sampleLoss] : replica.sampleLosses ) {
+					mSampler -> recordLoss( sample, sampleLoss );
+				}
+				for ( std::size_t step = 0; step < replica.numSteps && mLearningRateSchedule; ++step ) {
+					mLearningRateSchedule -> step( );
+				}
+			}
+			return loss / static_cast< NumericType >( order.size( ) );
+		}
+
+		// pipeline parallel batch, returns the summed weighted loss
+		template< typename IterType >
+		NumericType runPipelineBatch( IterType iterFrom, std::size_t batchSize ) {
+			std::size_t numStages = mPipeline -> getNumStages( );
+			std::size_t microBatchSize = mMicroBatchSize > 0 ? mMicroBatchSize : std::max< std::size_t >( batchSize / ( 4 * numStages ), 1 );
+			NumericType loss = 0.0;
+			// the losses are computed by the last stage only
+			mPipeline -> train( batchSize, microBatchSize,
+				[&,this]( std::size_t begin, auto inputMat ) {
+					auto iter = std::next( iterFrom, begin );
+					for ( Eigen::Index col = 0; col < inputMat.cols( ); ++col, ++iter ) {
+						inputMat.col( col ) = mDataHandler.getInput( getDataPair( *iter ) );
+					}
+				},
+				[&,this]( std::size_t begin, auto const& outputMat, auto gradLossMat ) {
+					auto iter = std::next( iterFrom, begin );
+					for ( Eigen::Index col = 0; col < outputMat.cols( ); ++col, ++iter ) {
+						mWork.outputVec = outputMat.col( col );
+						NumericType sampleLoss = computeLoss( mWork.outputVec, mDataHandler.getTarget( getDataPair( *iter ) ), mWork.gradLossVec );
+						NumericType sampleWeight = getSampleWeight( *iter );
+						recordSampleLoss( *iter, sampleLoss );
+						loss += sampleWeight * sampleLoss;
+						gradLossMat.col( col ) = sampleWeight * mWork.gradLossVec;
+					}
+				}, mPipelineSchedule );
+			getOptimizer( ).applyWeightUpdate( batchSize );
+			getOptimizer( ).resetGradients( );
+			return loss;
+		}
+
+		// data parallel batch, returns the summed weighted loss
+		template< typename IterType >
+		NumericType runDataParallelBatch( IterType iterFrom, std::size_t batchSize, std::size_t firstLayer ) {
+			prepareReplicas( );
+			runOnGradientThreads( [&,this]( std::size_t part ) { accumulateReplicaBatch( part, iterFrom, batchSize, firstLayer ); } );
+			runOnGradientThreads( [this]( std::size_t part ) { reduceReplicaGradients( part, 1.0 ); } );
+			getOptimizer( ).applyWeightUpdate( batchSize );
+			getOptimizer( ).resetGradients( );
+			NumericType loss = 0.0;
+			for ( auto const& replica : mReplicas ) {
+				loss += replica.loss;
+				for ( auto const& [sample, sampleLoss] : replica.sampleLosses ) {
+					mSampler -> recordLoss( sample, sampleLoss );
+				}
+			}
+			return loss;
+		}
+
+		// multi-process data parallel batch, returns the summed weighted loss of all processes
+		template< typename IterType >
+		NumericType runProcessGroupBatch( IterType iterFrom, std::size_t batchSize, std::size_t firstLayer ) {
+			auto& processGroup = *mProcessGroup;
+			auto& replica = mProcessReplica;
+			prepareReplica( replica );
+			std::size_t begin = batchSize * processGroup.getRank( ) / processGroup.getSize( );
+			std::size_t end = batchSize * ( processGroup.getRank( ) + 1 ) / processGroup.getSize( );
+			replica.loss = 0.0;
+			replica.sampleLosses.clear( );
+			// layers from numPending on are handed to the communication thread, last layer
+			// first (in the same order on every process)
+			std::size_t numPending = getNetwork( ).getParameterRanges( ).size( );
+			auto allReduceLayers = [this, &numPending]( std::size_t layerIndex ) {
+				while ( numPending > layerIndex ) {
+					// captures fit std::function's local storage, no allocation
+					mCommunicationPool -> submit( [this, index = --numPending]( ) {
+						auto const& range = getNetwork( ).getParameterRanges( )[index];
+						mProcessGroup -> allReduceSum( mProcessReplica.network -> getGradientVec( ).data( ) + range.offset, range.size );
+					} );
+				}
+			};
+			accumulateReplicaSamples( replica, std::next( iterFrom, begin ), end - begin, firstLayer, allReduceLayers );
+			// layers the backward pass didn't reach (or all, without samples)
+			allReduceLayers( 0 );
+			mCommunicationPool -> wait( );
+			NumericType loss = replica.loss;
+			processGroup.allReduceSum( &loss, 1 );
+			auto replicaGradientVec = replica.network -> getGradientVec( );
+			getNetwork( ).getGradientVec( ) = replicaGradientVec;
+			replicaGradientVec.setZero( );
+			getOptimizer( ).applyWeightUpdate( batchSize );
+			getOptimizer( ).resetGradients( );
+			for ( auto const& [sample, sampleLoss] : replica.sampleLosses ) {
+				mSampler -> recordLoss( sample, sampleLoss );
+			}
+			return loss;
+		}
+
+		// parameter server batch, pushes the batch gradient and takes the server's weights,
+		// returns the summed weighted loss (zero once the server has asked to stop)
+		template< typename IterType >
+		NumericType runParameterServerBatch( IterType iterFrom, std::size_t batchSize, std::size_t firstLayer ) {
+			if ( mParameterServer -> isStopped( ) )
+				return 0.0;
+			auto& replica = mProcessReplica;
+			prepareReplica( replica );
+			replica.loss = 0.0;
+			replica.sampleLosses.clear( );
+			accumulateReplicaSamples( replica, iterFrom, batchSize, firstLayer );
+			// the replica shares the network's weights, the reply overwrites both
+			auto replicaGradientVec = replica.network -> getGradientVec( );
+			auto parameterVec = getNetwork( ).getParameterVec( );
+			mParameterServer -> push( replicaGradientVec.data( ), static_cast< std::size_t >( replicaGradientVec.size( ) ) * sizeof( NumericType ),
+									  batchSize, static_cast< double >( replica.loss ), parameterVec.data( ) );
+			replicaGradientVec.setZero( );
+			for ( auto const& [sample, sampleLoss] : replica.sampleLosses ) {
+				mSampler -> recordLoss( sample, sampleLoss );
+			}
+			return replica.loss;
+		}
+
+		// Activation checkpointing, before the backward pass enters the segment that ends
+		// at layer checkpoint: the later layers release their batch matrices (but for the
+		// delta layer checkpoint + 1 still passes on) and the segment is recomputed from
+		// the checkpoint before it, or from inputMat (the input of firstLayer).
+		void recomputeSegment( NetworkType& network, std::size_t checkpoint, ConstMatrixRefType inputMat, std::size_t firstLayer ) {
+			auto batchSize = inputMat.cols( );
+			network.getLayer( checkpoint + 1 ) -> releaseBatch( false, true );
+			for ( std::size_t i = checkpoint + 2; i < network.getNumLayers( ); ++i ) {
+				network.getLayer( i ) -> releaseBatch( false, false );
+			}
+			for ( std::size_t i = std::max( network.getSegmentBegin( checkpoint ), firstLayer ); i <= checkpoint; ++i ) {
+				if ( i == firstLayer )
+					network.getLayer( i ) -> forwardComputeBatch( inputMat );
+				else
+					network.getLayer( i ) -> forwardComputeBatch( network.getLayer( i - 1 ) -> getOutputMat( ).leftCols( batchSize ) );
+			}
+		}
+
+		// Forward pass of a micro batch of samples starting at iter as matrices, writes
+		// the (weighted) loss gradients to the first columns of work.gradLossMat, calls
+		// record( sample, loss ) for every sample and returns the summed weighted loss.
+		template< typename IterType, typename RecordType >
+		NumericType forwardMicroBatch( NetworkType& network, WorkBuffers& work, IterType iter, std::size_t microBatchSize,
+									   std::size_t firstLayer, RecordType&& record ) {
+			auto batchSize = static_cast< Eigen::Index >( microBatchSize );
+			auto numInputs = static_cast< Eigen::Index >( network.getLayer( firstLayer ) -> getNumInputs( ) );
+			auto numOutputs = static_cast< Eigen::Index >( network.getLayers( ).back( ) -> getNumOutputs( ) );
+			if ( work.inputMat.rows( ) != numInputs || work.inputMat.cols( ) < batchSize )
+				work.inputMat.resize( numInputs, batchSize );
+			if ( work.gradLossMat.rows( ) != numOutputs || work.gradLossMat.cols( ) < batchSize )
+				work.gradLossMat.resize( numOutputs, batchSize );
+			auto sampleIter = iter;
+			for ( Eigen::Index col = 0; col < batchSize; ++col, ++sampleIter ) {
+				work.inputMat.col( col ) = getSampleInput( *sampleIter, firstLayer, work.featureVec );
+			}
+			computeForwardBatch( network, work.inputMat.leftCols( batchSize ), firstLayer );
+			auto const& outputMat = network.getLayers( ).back( ) -> getOutputMat( );
+			NumericType loss = 0.0;
+			sampleIter = iter;
+			for ( Eigen::Index col = 0; col < batchSize; ++col, ++sampleIter ) {
+				work.outputVec = outputMat.col( col );
+				NumericType sampleLoss = computeLoss( work.outputVec, mDataHandler.getTarget( getDataPair( *sampleIter ) ), work.gradLossVec );
+				NumericType sampleWeight = getSampleWeight( *sampleIter );
+				record( *sampleIter, sampleLoss );
+				loss += sampleWeight * sampleLoss;
+				work.gradLossMat.col( col ) = sampleWeight * work.gradLossVec;
+			}
+			return loss;
+		}
+
+		// Runs a micro batch of samples starting at iter as matrices, returns the summed
+		// loss. With updateBatchSize > 0 it is the last micro batch of a batch of that
+		// size and applies the optimizer update (per layer on the update threads).
+		template< typename IterType >
+		NumericType runMicroBatch( IterType iter, std::size_t microBatchSize, std::size_t updateBatchSize, std::size_t firstLayer = 0 ) {
+			auto& network = getNetwork( );
+			auto batchSize = static_cast< Eigen::Index >( microBatchSize );
+			NumericType loss = forwardMicroBatch( network, mWork, iter, microBatchSize, firstLayer,
+												  [this]( auto const& value, NumericType sampleLoss ) { recordSampleLoss( value, sampleLoss ); } );
+			auto inputMat = mWork.inputMat.leftCols( batchSize );
+			auto gradLossMat = mWork.gradLossMat.leftCols( batchSize );
+			if ( updateBatchSize == 0 ) {
+				computeBackwardBatch( network, mWork, inputMat, firstLayer, gradLossMat, []( std::size_t ) { } );
+			}
+			else if ( mNumUpdateThreads == 0 ) {
+				computeBackwardBatch( network, mWork, inputMat, firstLayer, gradLossMat, []( std::size_t ) { } );
+				getOptimizer( ).applyWeightUpdate( updateBatchSize );
+				getOptimizer( ).resetGradients( );
+			}
+			else {
+				mUpdateBatchSize = updateBatchSize;
+				getOptimizer( ).beginStep( );
+				computeBackwardBatch( network, mWork, inputMat, firstLayer, gradLossMat, [this]( std::size_t layerIndex ) { submitLayerUpdate( layerIndex ); } );
+				mScheduler -> wait( mUpdateGroup );
+			}
+			return loss;
+		}
+
+		// Runs the last sample of a batch and applies the optimizer update. With
+		// update threads, each layer's update and gradient reset is queued as soon
+		// as backprop is done with the layer, later layers are updated while
+		// backprop continues into earlier ones.
+		NumericType runLastSample( VectorXType const& inputVec,
+								   VectorXType const& targetVec,
+								   std::size_t batchSize,
+								   std::size_t firstLayer = 0,
+								   NumericType sampleWeight = 1.0 ) {
+			if ( mNumUpdateThreads == 0 ) {
+				NumericType loss = runSingleSample( inputVec, targetVec, firstLayer, sampleWeight );
+				getOptimizer( ).applyWeightUpdate( batchSize );
+				getOptimizer( ).resetGradients( );
+				return loss;
+			}
+			computeForward( getNetwork( ), inputVec, firstLayer );
+			NumericType loss = computeLoss( getNetwork( ).getLastOutput( ), targetVec, mGradLossVec );
+			if ( sampleWeight != 1.0 )
+				mGradLossVec *= sampleWeight;
+			mUpdateBatchSize = batchSize;
+			getOptimizer( ).beginStep( );
+			computeBackward( mGradLossVec, [this]( std::size_t layerIndex ) { submitLayerUpdate( layerIndex ); } );
+			mScheduler -> wait( mUpdateGroup );
+			return loss;
+		}
+
+		// queues a trainable layer's optimizer update and gradient reset
+		void submitLayerUpdate( std::size_t layerIndex ) {
+			// captures fit std::function's local storage, no allocation
+			mScheduler -> run( mUpdateGroup, [this, layerIndex]( ) {
+				getOptimizer( ).applyLayerUpdate( layerIndex, mUpdateBatchSize );
+				getOptimizer( ).resetLayerGradients( layerIndex );
+			} );
+		}
 
 	public: 	//public data members
 
@@ -231,6 +1602,39 @@ namespace NNet { // begin NNet
 		OptimizerType& mOptimizer;
 		LossFunction< NumericTraitsType, LossFunType > mLossFun;
 		DataHandlerType& mDataHandler;
+		VectorXType mGradLossVec;
+		Utils::AllocationStats mStepAllocationStats;
+		bool mShowProgress = true;
+		std::shared_ptr< Utils::TaskScheduler > mScheduler = Utils::TaskScheduler::getDefault( );
+		std::size_t mNumUpdateThreads = 0;
+		std::size_t mMinWeightGradTaskWork = default_min_weight_grad_task_work;
+		Utils::TaskGroup mUpdateGroup;
+		std::size_t mUpdateBatchSize = 1;
+		std::vector< Replica > mReplicas;
+		std::size_t mNumGradientThreads = std::max< std::size_t >( std::thread::hardware_concurrency( ), 1 );
+		std::size_t mFeatureBatchSize = 256;
+		// micro batching
+		static constexpr std::size_t max_micro_batch_size = 256;
+		std::size_t mMicroBatchSize = 0;
+		WorkBuffers mWork;
+		bool mDataParallel = false;
+		AsyncUpdateMode mAsyncUpdateMode = AsyncUpdateMode::OFF;
+		std::unique_ptr< PipelineType > mPipeline;
+		PipelineSchedule mPipelineSchedule = PipelineSchedule::ONE_F_ONE_B;
+		std::unique_ptr< TensorParallelType > mTensorParallel;
+		std::shared_ptr< Utils::ProcessGroup > mProcessGroup;
+		// the replica of multi-process and parameter server training
+		Replica mProcessReplica;
+		std::unique_ptr< Utils::ThreadPool > mCommunicationPool;
+		std::shared_ptr< Utils::ParameterServerConnection > mParameterServer;
+		std::shared_ptr< LearningRateScheduleType > mLearningRateSchedule;
+		std::shared_ptr< EarlyStoppingType > mEarlyStopping;
+		// frozen prefix features
+		bool mCacheFrozenFeatures = false;
+		FeatureCacheType mFeatureCache;
+		std::shared_ptr< SamplerType > mSampler;
+		// last, its evaluation tasks use the members above
+		std::unique_ptr< BackgroundEvaluatorType > mBackgroundEvaluator;
 	}; // end of class NetworkTrainer
 
 
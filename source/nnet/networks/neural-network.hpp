@@ -5,13 +5,19 @@
 #include <iostream>
 #include <algorithm>
 #include <cmath>
+#include <functional>
+#include <limits>
 #include <memory>
+#include <stdexcept>
 #include <vector>
 #include <optional>
 
 // Own includes --------------------
 #include "utils/numeric-traits.hpp"
+#include "utils/aligned-buffer.hpp"
 #include "layers/base-layer.hpp"
+#include "layers/trainable-layer.hpp"
+#include "layers/block-diagonal-layer.hpp"
 
 namespace NNet { // begin NNet
 
@@ -29,6 +35,16 @@ namespace NNet { // begin NNet
 		using BaseLayerType = BaseLayer< NumericTraitsType >;
 		using TrainableLayerType = TrainableLayer< NumericTraitsType >;
 		using BaseLayerPtrType = std::shared_ptr< BaseLayerType >;
+		using TrainableLayerPtrType = std::shared_ptr< TrainableLayerType >;
+		using VectorMapType = typename NumericTraitsType::VectorMapType;
+		using ConstVectorMapType = typename NumericTraitsType::ConstVectorMapType;
+		using ParameterBufferType = Utils::AlignedBuffer< NumericType >;
+
+		// location of a trainable layer's weights in the flat parameter buffer
+		struct ParameterRange {
+			std::size_t offset = 0;
+			std::size_t size = 0;
+		};
 
 	private: 	// private typedefs
 
@@ -87,6 +103,8 @@ namespace NNet { // begin NNet
 					}
 				}
 			}
+			// the segments were planned for the old layers
+			mSegmentEnds.clear( );
 		}
 
 		void finalize( ) {
@@ -100,8 +118,250 @@ namespace NNet { // begin NNet
 					weightMat.row( weightMat.rows( ) -1 ).setZero( ); // bias set to zero...
 				}
 			}
+			packParameters( );
+		}
+
+		// flat parameter storage
+		// Lays out the weights and weight gradients of all trainable layers in two
+		// contiguous, cache line aligned buffers (each layer starting on a cache line)
+		// and binds the layers' matrices to them, current values are preserved.
+		void packParameters( ) {
+			std::vector< TrainableLayerPtrType > trainableLayers;
+			std::vector< ParameterRange > parameterRanges;
+			std::size_t numParameters = 0;
+			for ( auto& layer : getLayers( ) ) {
+				if ( layer -> isTrainableLayer( ) ) {
+					auto trainableLayerPtr = std::static_pointer_cast< TrainableLayerType >( layer );
+					ParameterRange range{ numParameters, trainableLayerPtr -> getNumParameters( ) };
+					numParameters += ParameterBufferType::paddedSize( range.size );
+					trainableLayers.emplace_back( trainableLayerPtr );
+					parameterRanges.emplace_back( range );
+				}
+			}
+			auto parameterBuffer = std::make_shared< ParameterBufferType >( numParameters );
+			auto gradientBuffer = std::make_shared< ParameterBufferType >( numParameters );
+			for ( std::size_t i = 0; i < trainableLayers.size( ); ++i ) {
+				auto& layerPtr = trainableLayers[i];
+				auto const& range = parameterRanges[i];
+				NumericType* weightData = parameterBuffer -> data( ) + range.offset;
+				NumericType* weightGradData = gradientBuffer -> data( ) + range.offset;
+				auto const& weightMat = layerPtr -> getWeightMat( );
+				auto const& weightGradMat = layerPtr -> getWeightGradMat( );
+				std::copy( weightMat.data( ), weightMat.data( ) + range.size, weightData );
+				std::copy( weightGradMat.data( ), weightGradMat.data( ) + range.size, weightGradData );
+				layerPtr -> bindParameters( weightData, weightGradData );
+			}
+			// the previous buffers (if any) are released only after all layers are re-bound
+			mParameterBuffer = parameterBuffer;
+			mGradientBuffer = gradientBuffer;
+			mTrainableLayers = std::move( trainableLayers );
+			mParameterRanges = std::move( parameterRanges );
+			updateBackwardPlan( );
+		}
+
+		// layer freezing
+		// Freezes (or unfreezes) the trainableIndex-th trainable layer and updates the
+		// backward plan. Frozen layers keep their weights, backprop skips their weight
+		// gradients and stops at the earliest layer that still needs a gradient.
+		void setFrozen( std::size_t trainableIndex, bool frozen = true ) {
+			mTrainableLayers.at( trainableIndex ) -> setFrozen( frozen );
+			updateBackwardPlan( );
+		}
+		bool isFrozen( std::size_t trainableIndex ) const { return mTrainableLayers.at( trainableIndex ) -> isFrozen( ); }
+
+		// Dead gradient pruning. Backprop only has to visit the layers from the last one
+		// down to the earliest trainable layer that is not frozen, and a layer only
+		// propagates a delta when a layer before it is visited too (so never the first).
+		void updateBackwardPlan( ) {
+			std::size_t numLayers = getNumLayers( );
+			std::size_t earliest = numLayers;
+			for ( std::size_t i = 0; i < numLayers; ++i ) {
+				auto const& layer = getLayer( i );
+				if ( layer -> isTrainableLayer( ) && !std::static_pointer_cast< TrainableLayerType >( layer ) -> isFrozen( ) ) {
+					earliest = i;
+					break;
+				}
+			}
+			for ( std::size_t i = 0; i < numLayers; ++i ) {
+				getLayer( i ) -> setPropagatesDelta( i > earliest );
+			}
+			mNumBackwardLayers = numLayers - earliest;
+		}
+		// number of layers (counted from the last) the backward pass visits
+		std::size_t getNumBackwardLayers( ) const { return mNumBackwardLayers; }
+
+		// activation checkpointing
+		// Splits the layers into segments for the trainer's batched (micro batch) passes.
+		// After the forward pass only the last layer of a segment keeps its batch output
+		// (the checkpoint), the other layers release their batch matrices, and before the
+		// backward pass enters a segment the segment is recomputed from the checkpoint
+		// before it. The last segment is kept whole, its backward pass comes first. The
+		// batch matrices then take the checkpoints and one segment rather than all layers,
+		// for up to one more forward pass. Every interval-th layer is a checkpoint, 0 turns
+		// checkpointing off (the default).
+		void setCheckpointInterval( std::size_t interval ) {
+			mSegmentEnds.clear( );
+			if ( interval == 0 || interval >= getNumLayers( ) )
+				return;
+			for ( std::size_t end = interval; end < getNumLayers( ); end += interval ) {
+				mSegmentEnds.push_back( end );
+			}
+			mSegmentEnds.push_back( getNumLayers( ) );
+		}
+
+		// Places the segments so that the batch matrices of batchSize samples take at most
+		// memoryBudget bytes with as little recomputation as possible, checkpointing is off
+		// when all layers fit. Throws when no placement fits.
+		void setActivationMemoryBudget( std::size_t memoryBudget, std::size_t batchSize ) {
+			std::size_t numLayers = getNumLayers( );
+			std::size_t columnBudget = memoryBudget / std::max< std::size_t >( batchSize, 1 );
+			mSegmentEnds.clear( );
+			if ( numLayers == 0 || computeColumnMemory( { numLayers } ) <= columnBudget )
+				return;
+			std::vector< std::size_t > columnSizes, limits;
+			for ( auto const& layer : getLayers( ) ) {
+				columnSizes.push_back( layer -> getBatchColumnSize( ) * sizeof( NumericType ) );
+			}
+			// the candidate limits of a segment's memory are the sums of runs of layers
+			for ( std::size_t begin = 0; begin < numLayers; ++begin ) {
+				std::size_t sum = 0;
+				for ( std::size_t i = begin; i < numLayers; ++i ) {
+					sum += columnSizes[i];
+					limits.push_back( sum );
+				}
+			}
+			std::sort( limits.begin( ), limits.end( ) );
+			limits.erase( std::unique( limits.begin( ), limits.end( ) ), limits.end( ) );
+			std::size_t bestRecompute = std::numeric_limits< std::size_t >::max( );
+			std::size_t bestMemory = bestRecompute;
+			std::vector< std::size_t > ends;
+			for ( std::size_t limit : limits ) {
+				if ( limit > columnBudget )
+					break;
+				// segments as long as the limit allows from the back, so that the last
+				// segment (which is never recomputed) is as long as possible
+				ends.clear( );
+				std::size_t sum = 0;
+				bool fits = true;
+				for ( std::size_t i = numLayers; fits && i-- > 0; ) {
+					fits = columnSizes[i] <= limit;
+					if ( sum + columnSizes[i] > limit ) {
+						ends.insert( ends.begin( ), i + 1 );
+						sum = 0;
+					}
+					sum += columnSizes[i];
+				}
+				if ( !fits || ends.empty( ) )
+					continue;
+				ends.push_back( numLayers );
+				std::size_t memory = computeColumnMemory( ends );
+				std::size_t recompute = 0;
+				for ( std::size_t i = 0; i < ends[ends.size( ) - 2]; ++i ) {
+					auto const& layer = getLayer( i );
+					recompute += layer -> isTrainableLayer( ) ? ( layer -> getNumInputs( ) + 1 ) * layer -> getNumOutputs( ) : layer -> getNumOutputs( );
+				}
+				if ( memory <= columnBudget && ( recompute < bestRecompute || ( recompute == bestRecompute && memory < bestMemory ) ) ) {
+					bestRecompute = recompute;
+					bestMemory = memory;
+					mSegmentEnds = ends;
+				}
+			}
+			if ( mSegmentEnds.empty( ) )
+				throw std::runtime_error( "The batch activations don't fit the memory budget, not even checkpointed..." );
+		}
+
+		bool isCheckpointing( ) const { return !mSegmentEnds.empty( ); }
+		// one past the last layer of every segment, empty without checkpointing
+		auto const& getSegmentEnds( ) const { return mSegmentEnds; }
+		void setSegmentEnds( std::vector< std::size_t > const& segmentEnds ) {
+			if ( !segmentEnds.empty( ) && ( segmentEnds.size( ) < 2 || segmentEnds.front( ) == 0 || segmentEnds.back( ) != getNumLayers( )
+											|| !std::is_sorted( segmentEnds.begin( ), segmentEnds.end( ), std::less_equal< std::size_t >( ) ) ) )
+				throw std::runtime_error( "Invalid checkpoint segments..." );
+			mSegmentEnds = segmentEnds;
+		}
+		// the first layer of layer i's segment
+		std::size_t getSegmentBegin( std::size_t i ) const {
+			auto segmentEnd = std::upper_bound( mSegmentEnds.begin( ), mSegmentEnds.end( ), i );
+			return segmentEnd == mSegmentEnds.begin( ) ? 0 : *( segmentEnd - 1 );
+		}
+		// true when layer i releases its batch matrices after the forward pass, i.e. it
+		// isn't in the last segment
+		bool releasesBatch( std::size_t i ) const {
+			return isCheckpointing( ) && i < mSegmentEnds[mSegmentEnds.size( ) - 2];
+		}
+		// true when layer i keeps its batch output as a checkpoint
+		bool isCheckpoint( std::size_t i ) const {
+			return releasesBatch( i ) && std::binary_search( mSegmentEnds.begin( ), mSegmentEnds.end( ), i + 1 );
+		}
+		// estimated peak bytes of the batch matrices for batchSize samples
+		std::size_t getActivationMemory( std::size_t batchSize ) const {
+			return batchSize * computeColumnMemory( isCheckpointing( ) ? mSegmentEnds : std::vector< std::size_t >{ getNumLayers( ) } );
+		}
+
+		// A replica has its own copies of the layers, and so its own forward and backward
+		// work vectors, but views this network's parameter buffer. It accumulates
+		// gradients into a private gradient buffer, so replicas may run backprop on
+		// different samples concurrently.
+		std::unique_ptr< NeuralNetwork > makeReplica( ) {
+			if ( !isPacked( ) )
+				packParameters( );
+			auto replica = std::make_unique< NeuralNetwork >( mInitializer );
+			for ( auto const& layer : getLayers( ) ) {
+				replica -> mLayers.emplace_back( layer -> clone( ) );
+			}
+			replica -> mParameterBuffer = mParameterBuffer;
+			replica -> mGradientBuffer = std::make_shared< ParameterBufferType >( getNumParameters( ) );
+			replica -> mParameterRanges = mParameterRanges;
+			replica -> mSegmentEnds = mSegmentEnds;
+			for ( auto& layer : replica -> getLayers( ) ) {
+				if ( layer -> isTrainableLayer( ) ) {
+					auto trainableLayerPtr = std::static_pointer_cast< TrainableLayerType >( layer );
+					auto const& range = mParameterRanges[replica -> mTrainableLayers.size( )];
+					trainableLayerPtr -> bindParameters( mParameterBuffer -> data( ) + range.offset,
+														 replica -> mGradientBuffer -> data( ) + range.offset );
+					replica -> mTrainableLayers.emplace_back( trainableLayerPtr );
+				}
+			}
+			replica -> updateBackwardPlan( );
+			return replica;
 		}
 
+		// A copy is a replica with its own copy of the parameters, allocated (and so
+		// first touched) by the calling thread, e.g. weights read on another NUMA node.
+		std::unique_ptr< NeuralNetwork > makeCopy( ) {
+			auto copy = makeReplica( );
+			copy -> mParameterBuffer = std::make_shared< ParameterBufferType >( *mParameterBuffer );
+			for ( std::size_t i = 0; i < copy -> mTrainableLayers.size( ); ++i ) {
+				auto const& range = mParameterRanges[i];
+				copy -> mTrainableLayers[i] -> bindParameters( copy -> mParameterBuffer -> data( ) + range.offset,
+															   copy -> mGradientBuffer -> data( ) + range.offset );
+			}
+			return copy;
+		}
+
+		// true when both networks view the same parameter buffer
+		bool sharesParameters( NeuralNetwork const& other ) const {
+			return mParameterBuffer && mParameterBuffer == other.mParameterBuffer;
+		}
+
+		bool isPacked( ) const {
+			if ( !mParameterBuffer )
+				return false;
+			auto numTrainable = std::count_if( getLayers( ).begin( ), getLayers( ).end( ),
+											   []( auto const& layer ) { return layer -> isTrainableLayer( ); } );
+			return static_cast< std::size_t >( numTrainable ) == mTrainableLayers.size( );
+		}
+
+		// total number of elements (including cache line padding) of the flat buffers
+		std::size_t getNumParameters( ) const { return mParameterBuffer ? mParameterBuffer -> size( ) : 0; }
+		VectorMapType getParameterVec( ) { return VectorMapType( mParameterBuffer -> data( ), getNumParameters( ) ); }
+		ConstVectorMapType getParameterVec( ) const { return ConstVectorMapType( mParameterBuffer -> data( ), getNumParameters( ) ); }
+		VectorMapType getGradientVec( ) { return VectorMapType( mGradientBuffer -> data( ), getNumParameters( ) ); }
+		ConstVectorMapType getGradientVec( ) const { return ConstVectorMapType( mGradientBuffer -> data( ), getNumParameters( ) ); }
+		auto& getTrainableLayers( ) { return mTrainableLayers; }
+		auto const& getTrainableLayers( ) const { return mTrainableLayers; }
+		auto const& getParameterRanges( ) const { return mParameterRanges; }
+
 		void printNetworkInfo( std::ostream& os = std::cout ) {
 			for ( auto const& layer : mLayers ) {
 				layer -> printLayerInfo( os );
@@ -121,12 +381,34 @@ namespace NNet { // begin NNet
 		}
 
 	private: 	//private member functions
+		// peak bytes per batch column of the batch matrices with the segments ending at
+		// segmentEnds: the checkpoints and the largest segment
+		std::size_t computeColumnMemory( std::vector< std::size_t > const& segmentEnds ) const {
+			std::size_t checkpoints = 0, largest = 0, begin = 0;
+			for ( std::size_t segment = 0; segment < segmentEnds.size( ); ++segment ) {
+				std::size_t size = 0;
+				for ( std::size_t i = begin; i < segmentEnds[segment]; ++i ) {
+					size += getLayer( i ) -> getBatchColumnSize( );
+				}
+				largest = std::max( largest, size );
+				if ( segment + 1 < segmentEnds.size( ) )
+					checkpoints += getLayer( segmentEnds[segment] - 1 ) -> getNumOutputs( );
+				begin = segmentEnds[segment];
+			}
+			return ( checkpoints + largest ) * sizeof( NumericType );
+		}
 
 	public: 	//public data members
 
 	private: 	//private data members
 		std::vector< BaseLayerPtrType > mLayers;
 		InitializerType mInitializer;
+		std::shared_ptr< ParameterBufferType > mParameterBuffer = nullptr, mGradientBuffer = nullptr;
+		std::vector< TrainableLayerPtrType > mTrainableLayers = { };
+		std::vector< ParameterRange > mParameterRanges = { };
+		std::size_t mNumBackwardLayers = 0;
+		// activation checkpointing segments, see setCheckpointInterval
+		std::vector< std::size_t > mSegmentEnds = { };
 	}; // end of class NeuralNetwork
 
 
@@ -148,10 +430,16 @@ namespace boost::serialization { // begin boost::serialization
 		ar.template register_type< NNet::ActivationLayer< NumericTraitsType, NNet::ELUActivation > >();
 		ar.template register_type< NNet::ActivationLayer< NumericTraitsType, NNet::SoftMaxActivation > >();
 		ar.template register_type< NNet::ActivationLayer< NumericTraitsType, NNet::LogSoftMaxActivation > >();
+		// register the stacked layers of ensembles, after the others so that older archives keep their class ids
+		ar.template register_type< NNet::BlockDiagonalLayer< NumericTraitsType > >();
 
 		// serialize the network
 		ar & obj.getLayers();
 		ar & obj.getInitializer();
+
+		// loaded layers own their weights, gather them into the flat buffers
+		if constexpr ( ArchiveType::is_loading::value )
+			obj.packParameters();
 	}
 } // end boost::serialization
 
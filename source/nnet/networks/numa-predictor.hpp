@@ -0,0 +1,132 @@
+#ifndef NUMA_PREDICTOR_HPP
+#define NUMA_PREDICTOR_HPP
+
+// System includes --------------------
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// Own includes --------------------
+#include "utils/numa-topology.hpp"
+#include "utils/task-scheduler.hpp"
+
+namespace NNet { // begin NNet
+
+	/**
+	 *NumaPredictor. Batch inference (serving) on a task scheduler, the samples
+	 *are split into one part per scheduler thread and every part predicts on a
+	 *replica of its own. On a NUMA aware scheduler the read only weights are
+	 *replicated per node: a copy of the network's parameters is made by a
+	 *thread pinned to each node (and bound to it), and a part's replica views
+	 *the copy of the node its thread runs on, so no thread streams its weights
+	 *from another socket. Without NUMA the replicas view the network's own
+	 *weights. The copies are taken when the predictor is made and by
+	 *syncWeights( ), e.g. after further training.
+	 */
+	template< typename NetworkType >
+	class NumaPredictor {
+	public: 	// public typedefs
+		using NumericType = typename NetworkType::NumericType;
+		using VectorXType = typename NetworkType::VectorXType;
+
+	private: 	// private typedefs
+
+	public: 	//public member functions
+		NumaPredictor( ) = delete;
+		explicit NumaPredictor( NetworkType& network, std::shared_ptr< Utils::TaskScheduler > scheduler = Utils::TaskScheduler::getDefault( ) )
+			: mNetwork( network ), mScheduler( std::move( scheduler ) ) {
+			if ( !mScheduler )
+				throw std::runtime_error( "A predictor needs a task scheduler." );
+			if ( network.getNumLayers( ) == 0 )
+				throw std::runtime_error( "Can't predict with a network without layers..." );
+			syncWeights( );
+		}
+		NumaPredictor( NumaPredictor const& other ) = delete;
+		~NumaPredictor( ) = default;
+
+		// get/set member functions
+		std::shared_ptr< Utils::TaskScheduler > const& getScheduler( ) const { return mScheduler; }
+		// number of per node weight copies, zero unless the scheduler is NUMA aware
+		std::size_t getNumCopies( ) const { return mCopies.size( ); }
+		NetworkType const& getCopy( std::size_t node ) const { return *mCopies[node]; }
+
+		// Copies the network's current weights to every node
+		void syncWeights( ) {
+			if ( !mNetwork.isPacked( ) )
+				mNetwork.packParameters( );
+			if ( !mScheduler -> isNumaAware( ) ) {
+				mCopies.clear( );
+				return;
+			}
+			auto const& topology = *mScheduler -> getTopology( );
+			mCopies.resize( topology.getNumNodes( ) );
+			std::vector< std::thread > copiers;
+			for ( std::size_t node = 0; node < topology.getNumNodes( ); ++node ) {
+				copiers.emplace_back( [this, &topology, node]( ) {
+					Utils::pinCurrentThreadToCpus( topology.getCpus( node ) );
+					auto& copy = mCopies[node];
+					if ( !copy || copy -> getNumParameters( ) != mNetwork.getNumParameters( ) || copy -> getNumLayers( ) != mNetwork.getNumLayers( ) )
+						copy = mNetwork.makeCopy( );
+					else
+						copy -> getParameterVec( ) = mNetwork.getParameterVec( );
+					auto parameterVec = copy -> getParameterVec( );
+					Utils::bindMemoryToNode( parameterVec.data( ), static_cast< std::size_t >( parameterVec.size( ) ) * sizeof( NumericType ),
+											 topology.getNodeId( node ) );
+				} );
+			}
+			for ( auto& copier : copiers ) {
+				copier.join( );
+			}
+		}
+
+		// Predicts every input into outputs (resized to match)
+		void predict( std::vector< VectorXType > const& inputs, std::vector< VectorXType >& outputs ) {
+			outputs.resize( inputs.size( ) );
+			std::size_t numParts = mScheduler -> getNumThreads( );
+			mReplicas.resize( numParts );
+			mScheduler -> parallelForAffine( numParts, [&]( std::size_t part ) {
+				NetworkType& network = prepareReplica( part );
+				std::size_t begin = inputs.size( ) * part / numParts;
+				std::size_t end = inputs.size( ) * ( part + 1 ) / numParts;
+				for ( std::size_t i = begin; i < end; ++i ) {
+					VectorXType const* layerInput = &inputs[i];
+					for ( auto& layer : network ) {
+						layer -> forwardCompute( *layerInput, layer -> getOutputVec( ) );
+						layerInput = &layer -> getOutputVec( );
+					}
+					outputs[i] = *layerInput;
+				}
+			} );
+		}
+
+	private: 	//private member functions
+		// the replica of a part, (re)made on the thread the part runs on from the
+		// weights of its node
+		NetworkType& prepareReplica( std::size_t part ) {
+			auto& replica = mReplicas[part];
+			bool current = replica && replica -> getNumLayers( ) == mNetwork.getNumLayers( )
+				&& ( mCopies.empty( ) ? replica -> sharesParameters( mNetwork )
+					 : std::any_of( mCopies.begin( ), mCopies.end( ), [&]( auto const& copy ) { return replica -> sharesParameters( *copy ); } ) );
+			// a stolen part keeps its replica rather than rebuilding it on every node it visits
+			if ( !current )
+				replica = ( mCopies.empty( ) ? mNetwork : *mCopies[mScheduler -> getCurrentNode( )] ).makeReplica( );
+			return *replica;
+		}
+
+	public: 	//public data members
+
+	private: 	//private data members
+		NetworkType& mNetwork;
+		std::shared_ptr< Utils::TaskScheduler > mScheduler;
+		// the weights of every node
+		std::vector< std::unique_ptr< NetworkType > > mCopies;
+		// the work vectors of every part
+		std::vector< std::unique_ptr< NetworkType > > mReplicas;
+	}; // end of class NumaPredictor
+
+} // end NNet
+
+#endif // NUMA_PREDICTOR_HPP
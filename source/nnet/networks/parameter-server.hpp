@@ -0,0 +1,105 @@
+#ifndef PARAMETER_SERVER_HPP
+#define PARAMETER_SERVER_HPP
+
+// System includes --------------------
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Own includes --------------------
+#include "utils/parameter-socket.hpp"
+
+namespace NNet { // begin NNet
+
+	/**
+	 *ParameterServer. Owns the weights and the optimizer of asynchronous
+	 *parameter server training. Workers (NetworkTrainer with a parameter server
+	 *connection) pull the weights, compute a batch gradient on their own data
+	 *and push it. The server applies every pushed gradient with one optimizer
+	 *step as it arrives and answers with the new weights, so a slow worker
+	 *holds up no one. The version counts the applied steps. A gradient computed
+	 *at weights more than maxStaleness versions old is dropped, the worker just
+	 *gets the current weights. The weights sent out carry the optimizer's
+	 *interim update (the Nesterov look ahead), as in local training.
+	 */
+	template< typename NetworkType, typename OptimizerType >
+	class ParameterServer {
+	public: 	// public typedefs
+		using NumericType = typename NetworkType::NumericType;
+		using RequestType = Utils::ParameterServerSocket::RequestType;
+
+	private: 	// private typedefs
+
+	public: 	// public static data members
+		static constexpr std::size_t default_max_staleness = 4;
+
+	public: 	//public member functions
+		ParameterServer( ) = delete;
+		explicit ParameterServer( NetworkType& network, OptimizerType& optimizer, std::string const& socketPath, std::size_t numWorkers,
+								  std::size_t maxStaleness = default_max_staleness, double timeoutSeconds = 30.0 )
+			: mNetwork( network ), mOptimizer( optimizer ), mSocket( socketPath, numWorkers, timeoutSeconds ), mMaxStaleness( maxStaleness ) {
+			static_assert( !OptimizerType::requires_sample_gradients && !OptimizerType::requires_snapshot_gradients && !OptimizerType::is_full_batch,
+						   "A parameter server applies batch gradients, the optimizer can't need sample or snapshot gradients or full batches." );
+		}
+		ParameterServer( ParameterServer const& other ) = delete;
+		~ParameterServer( ) = default;
+
+		// get/set member functions
+		std::uint64_t getVersion( ) const { return mVersion; }
+		std::size_t getMaxStaleness( ) const { return mMaxStaleness; }
+		void setMaxStaleness( std::size_t maxStaleness ) { mMaxStaleness = maxStaleness; }
+		std::size_t getNumWorkers( ) const { return mSocket.getNumWorkers( ); }
+		std::size_t getNumDropped( ) const { return mNumDropped; }
+		// mean batch loss of every applied gradient
+		std::vector< NumericType > const& getLosses( ) const { return mLosses; }
+
+		// Serves the workers until numUpdates steps have been applied, the following
+		// replies ask the workers to stop. Returns once all workers have disconnected.
+		void serve( std::size_t numUpdates ) {
+			auto parameterVec = mNetwork.getParameterVec( );
+			auto gradientVec = mNetwork.getGradientVec( );
+			std::size_t numBytes = static_cast< std::size_t >( parameterVec.size( ) ) * sizeof( NumericType );
+			Utils::ParameterServerSocket::Request request;
+			mOptimizer.resetGradients( );
+			// the workers compute their gradients at the interim (e.g. Nesterov look ahead) weights
+			mOptimizer.applyInterimUpdate( );
+			while ( mSocket.receiveRequest( request, gradientVec.data( ), numBytes ) ) {
+				bool accepted = false;
+				if ( request.type == RequestType::PUSH ) {
+					// the gradient was received into the network's gradient buffer
+					if ( mVersion < numUpdates && mVersion - request.version <= mMaxStaleness && request.batchSize > 0 ) {
+						mOptimizer.applyWeightUpdate( request.batchSize );
+						mLosses.push_back( static_cast< NumericType >( request.loss / static_cast< double >( request.batchSize ) ) );
+						++mVersion;
+						accepted = true;
+						// the final weights are left without
+						if ( mVersion < numUpdates )
+							mOptimizer.applyInterimUpdate( );
+					}
+					else if ( mVersion < numUpdates ) {
+						++mNumDropped;
+					}
+					mOptimizer.resetGradients( );
+				}
+				mSocket.sendReply( request.worker, mVersion, accepted, mVersion >= numUpdates, parameterVec.data( ), numBytes );
+			}
+		}
+
+	private: 	//private member functions
+
+	public: 	//public data members
+
+	private: 	//private data members
+		NetworkType& mNetwork;
+		OptimizerType& mOptimizer;
+		Utils::ParameterServerSocket mSocket;
+		std::size_t mMaxStaleness;
+		std::uint64_t mVersion = 0;
+		std::size_t mNumDropped = 0;
+		std::vector< NumericType > mLosses;
+	}; // end of class ParameterServer
+
+} // end NNet
+
+#endif // PARAMETER_SERVER_HPP
@@ -0,0 +1,132 @@
+#ifndef TENSOR_PARALLEL_HPP
+#define TENSOR_PARALLEL_HPP
+
+// System includes --------------------
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+// Own includes --------------------
+#include "utils/aligned-buffer.hpp"
+#include "utils/worker-team.hpp"
+
+namespace NNet { // begin NNet
+
+	/**
+	 *TensorParallelPredictor. Computes the prediction of a single sample with
+	 *every large layer split across the members of a worker team, a fully
+	 *connected layer by blocks of its output columns (slices of its matrix
+	 *vector product) and an elementwise activation layer by segments of its
+	 *outputs. The layers run one after the other, a layer's run of the team
+	 *is the barrier before the next one. A layer is split in as many slices
+	 *as it has minParallelWork multiply adds (at most one per member), smaller
+	 *layers and layers that can't be split (softmax) run on the calling
+	 *thread alone. The workers spin for spinCount polls after a layer before
+	 *they block, so that back to back layers and predictions find them awake.
+	 *The layers' own state is left alone, the outputs live in the predictor.
+	 */
+	template< typename NetworkType >
+	class TensorParallelPredictor {
+	public: 	// public typedefs
+		using NumericType = typename NetworkType::NumericType;
+		using VectorXType = typename NetworkType::VectorXType;
+
+	private: 	// private typedefs
+
+	public: 	// public static data members
+		// multiply adds of a slice worth handing to another member
+		static constexpr std::size_t default_min_parallel_work = std::size_t( 1 ) << 14;
+		// polls a worker stays awake after a layer, more than a worker team waits by default
+		static constexpr std::size_t default_spin_count = std::size_t( 1 ) << 16;
+		// cost of an activation output in multiply adds
+		static constexpr std::size_t activation_work = 8;
+		// slices start on cache lines of the output vectors
+		static constexpr std::size_t slice_alignment = ( Utils::cache_line_size >= sizeof( NumericType ) ) ? Utils::cache_line_size / sizeof( NumericType ) : 1;
+
+	public: 	//public member functions
+		TensorParallelPredictor( ) = delete;
+		explicit TensorParallelPredictor( NetworkType& network, std::size_t numThreads,
+										  std::size_t minParallelWork = default_min_parallel_work, bool pinThreads = false )
+			: mNetwork( network ), mTeam( std::max< std::size_t >( numThreads, 1 ), default_spin_count, pinThreads ),
+			  mMinParallelWork( std::max< std::size_t >( minParallelWork, 1 ) ) {
+			if ( network.getNumLayers( ) == 0 )
+				throw std::runtime_error( "Can't predict with a network without layers..." );
+			plan( );
+		}
+		TensorParallelPredictor( TensorParallelPredictor const& other ) = delete;
+		~TensorParallelPredictor( ) = default;
+
+		// get/set member functions
+		std::size_t getNumThreads( ) const { return mTeam.getNumThreads( ); }
+		std::size_t getMinParallelWork( ) const { return mMinParallelWork; }
+		void setMinParallelWork( std::size_t minParallelWork ) {
+			mMinParallelWork = std::max< std::size_t >( minParallelWork, 1 );
+			plan( );
+		}
+		std::size_t getSpinCount( ) const { return mTeam.getSpinCount( ); }
+		void setSpinCount( std::size_t spinCount ) { mTeam.setSpinCount( spinCount ); }
+		// number of slices layer i is computed in, one when it stays on the calling thread
+		std::size_t getNumSlices( std::size_t i ) const { return mSlices[i].size( ) - 1; }
+
+		// Splits the layers into slices and sizes the outputs, needed again after the
+		// network's layers change.
+		void plan( ) {
+			std::size_t numLayers = mNetwork.getNumLayers( );
+			mSlices.assign( numLayers, std::vector< std::size_t >( ) );
+			mOutputs.resize( numLayers );
+			for ( std::size_t i = 0; i < numLayers; ++i ) {
+				auto const& layer = mNetwork.getLayer( i );
+				std::size_t numOutputs = layer -> getNumOutputs( );
+				std::size_t work = numOutputs * ( layer -> isTrainableLayer( ) ? layer -> getNumInputs( ) + 1 : activation_work );
+				std::size_t numLines = std::max< std::size_t >( ( numOutputs + slice_alignment - 1 ) / slice_alignment, 1 );
+				std::size_t numSlices = layer -> isSliceable( ) ? std::clamp< std::size_t >( work / mMinParallelWork, 1, std::min( getNumThreads( ), numLines ) ) : 1;
+				auto& slices = mSlices[i];
+				for ( std::size_t s = 0; s < numSlices; ++s ) {
+					slices.push_back( std::min( numOutputs, ( s * numLines / numSlices ) * slice_alignment ) );
+				}
+				slices.push_back( numOutputs );
+				mOutputs[i].resize( numOutputs );
+			}
+		}
+
+		// the prediction of inputVec, valid until the next call
+		VectorXType const& predict( VectorXType const& inputVec ) {
+			if ( mSlices.size( ) != mNetwork.getNumLayers( ) )
+				plan( );
+			VectorXType const* layerInput = &inputVec;
+			for ( std::size_t i = 0; i < mSlices.size( ); ++i ) {
+				auto const& layer = *mNetwork.getLayer( i );
+				auto const& slices = mSlices[i];
+				VectorXType& layerOutput = mOutputs[i];
+				std::size_t numSlices = slices.size( ) - 1;
+				if ( numSlices == 1 ) {
+					layer.forwardComputeSlice( *layerInput, layerOutput, 0, slices.back( ) );
+				}
+				else {
+					mTeam.run( [&]( std::size_t member ) {
+						if ( member < numSlices )
+							layer.forwardComputeSlice( *layerInput, layerOutput, slices[member], slices[member + 1] - slices[member] );
+					} );
+				}
+				layerInput = &layerOutput;
+			}
+			return *layerInput;
+		}
+
+	private: 	//private member functions
+
+	public: 	//public data members
+
+	private: 	//private data members
+		NetworkType& mNetwork;
+		Utils::WorkerTeam mTeam;
+		std::size_t mMinParallelWork;
+		// boundaries of the output slices of every layer
+		std::vector< std::vector< std::size_t > > mSlices;
+		std::vector< VectorXType > mOutputs;
+	}; // end of class TensorParallelPredictor
+
+} // end NNet
+
+#endif // TENSOR_PARALLEL_HPP
@@ -4,9 +4,22 @@
 // System includes --------------------
 #include <vector>
 #include <memory>
+#include <algorithm>
+#include <stdexcept>
+
+// Eigen includes --------------------
+#include <Eigen/Core>
+
+// Own includes --------------------
+#include "utils/aligned-buffer.hpp"
 
 namespace NNet { // begin NNet
 
+	// Lock free (Hogwild) updates of the shared weights by several training threads,
+	// RACY updates with plain loads and stores (concurrent updates of an element may
+	// be lost), RELAXED_ATOMIC updates with relaxed atomic read-modify-writes.
+	enum class AsyncUpdateMode { OFF, RACY, RELAXED_ATOMIC };
+
 	/**
 	 *BaseOptimizer.
 	 */
@@ -15,13 +28,33 @@ namespace NNet { // begin NNet
 	public: 	// public typedefs
 		using TrainableLayerType = typename NetworkType::TrainableLayerType;
 		using TrainableLayerVecType = std::vector< std::shared_ptr< TrainableLayerType > >;
+		using NumericType = typename NetworkType::NumericType;
+		using VectorMapType = typename NetworkType::VectorMapType;
+		using MatrixMapType = typename NetworkType::NumericTraitsType::MatrixMapType;
+		using StateBufferType = Utils::AlignedBuffer< NumericType >;
+		using IndexType = Eigen::Index;
 
 	private: 	// private typedefs
 
+	public: 	// public static data members
+		// Optimizers that need more than the summed batch gradient hide these flags.
+		// The trainer then hands per sample gradients to accumulateSampleGradient( index )
+		// or recomputes batch gradients at snapshot weights (see SAGAOptimizer, SVRGOptimizer).
+		static constexpr bool requires_sample_gradients = false;
+		static constexpr bool requires_snapshot_gradients = false;
+		// Full batch optimizers take steps through step( evaluate ) with the loss and
+		// gradient over the whole training set instead of batch updates (see LBFGSOptimizer).
+		static constexpr bool is_full_batch = false;
+		// Optimizers with an applyAsyncUpdate( gradientVec, batchSize, mode ) that
+		// applies a thread's own gradient without locks set this flag.
+		static constexpr bool supports_async_updates = false;
+
 	public: 	//public member functions
 		BaseOptimizer( ) = delete;
 		BaseOptimizer( NetworkType& network )
 			: mNetwork( network ) {
+			if ( !network.isPacked( ) )
+				network.packParameters( );
 			for ( auto const& layerPtr : this -> getNetwork( ) ) {
 				if ( layerPtr -> isTrainableLayer( ) ) {
 					auto trainableLayerPtr = std::static_pointer_cast< TrainableLayerType >( layerPtr );
@@ -36,19 +69,119 @@ namespace NNet { // begin NNet
 		NetworkType& getNetwork( ) { return mNetwork; }
 		TrainableLayerVecType& getTrainableLayers( ) { return mTrainableLayers; };
 
+		// flat views of all trainable parameters and their gradients
+		VectorMapType getParameterVec( ) { return getNetwork( ).getParameterVec( ); }
+		VectorMapType getGradientVec( ) { return getNetwork( ).getGradientVec( ); }
+		std::size_t getNumParameters( ) const { return mNetwork.getNumParameters( ); }
+
+		std::size_t getNumTrainableLayers( ) const { return mTrainableLayers.size( ); }
+
 		// interface
 		virtual void resetGradients( ) {
-			for ( auto& trainableLayerPtr : getTrainableLayers( ) ) {
-				trainableLayerPtr -> resetWeightGradMat( );
-			}
+			getGradientVec( ).setZero( );
 		}
 		virtual void applyInterimUpdate( ) { }
-		virtual void applyWeightUpdate( std::size_t bachSize ) = 0;
+		// called once per optimizer step, before the step's range or layer updates
+		virtual void beginStep( ) { }
+		virtual void applyWeightUpdate( std::size_t batchSize ) {
+			beginStep( );
+			forEachActiveRange( [&,this]( IndexType begin, IndexType size ) {
+				applyRangeUpdate( begin, size, batchSize );
+			} );
+		}
+
+		// Per layer update and reset, layerIndex counts trainable layers only. Updates
+		// of different layers touch disjoint parts of the flat buffers and may run
+		// concurrently, a layer may be updated as soon as its gradient is complete.
+		// beginStep( ) must be called once before the layer updates of a step. Frozen
+		// layers are not updated.
+		void applyLayerUpdate( std::size_t layerIndex, std::size_t batchSize ) {
+			if ( mTrainableLayers[layerIndex] -> isFrozen( ) )
+				return;
+			auto const& range = getNetwork( ).getParameterRanges( )[layerIndex];
+			applyRangeUpdate( static_cast< IndexType >( range.offset ), static_cast< IndexType >( range.size ), batchSize );
+		}
+		void resetLayerGradients( std::size_t layerIndex ) {
+			auto const& range = getNetwork( ).getParameterRanges( )[layerIndex];
+			getGradientVec( ).segment( range.offset, range.size ).setZero( );
+		}
+
+	protected: 	//protected member functions
+		// update rule applied to the parameters [begin, begin + size) of the flat buffers
+		virtual void applyRangeUpdate( IndexType begin, IndexType size, std::size_t batchSize ) = 0;
+
+		// whole network update for rules that need layer statistics (e.g. trust ratios),
+		// every range passed to applyRangeUpdate is then exactly one layer
+		void applyLayerwiseUpdate( std::size_t batchSize ) {
+			beginStep( );
+			for ( std::size_t layerIndex = 0; layerIndex < getNumTrainableLayers( ); ++layerIndex ) {
+				applyLayerUpdate( layerIndex, batchSize );
+			}
+		}
+
+		// optimizer state laid out like the flat parameter buffer
+		StateBufferType makeStateBuffer( ) const {
+			return StateBufferType( getNumParameters( ) );
+		}
+		static VectorMapType viewState( StateBufferType& stateBuffer ) {
+			return VectorMapType( stateBuffer.data( ), stateBuffer.size( ) );
+		}
+
+		// Runs kernel( begin, size ) over the maximal runs of consecutive layers that are
+		// not frozen, the whole flat buffer in one call when nothing is frozen.
+		template< typename KernelType >
+		void forEachActiveRange( KernelType&& kernel ) {
+			auto const& ranges = getNetwork( ).getParameterRanges( );
+			IndexType runBegin = 0;
+			bool inRun = false;
+			for ( std::size_t layerIndex = 0; layerIndex < ranges.size( ); ++layerIndex ) {
+				auto offset = static_cast< IndexType >( ranges[layerIndex].offset );
+				if ( mTrainableLayers[layerIndex] -> isFrozen( ) ) {
+					if ( inRun )
+						kernel( runBegin, offset - runBegin );
+					inRun = false;
+				}
+				else if ( !inRun ) {
+					runBegin = offset;
+					inRun = true;
+				}
+			}
+			if ( inRun )
+				kernel( runBegin, static_cast< IndexType >( getNumParameters( ) ) - runBegin );
+		}
+
+		// The parameters [begin, begin + size) of a single layer (as passed by applyLayerUpdate)
+		// in flatVec (the parameters, gradients or a state buffer), viewed as the layer's
+		// column major weight matrix. Its last row holds the layer's biases.
+		MatrixMapType viewLayer( VectorMapType& flatVec, IndexType begin, IndexType size ) {
+			auto const& ranges = getNetwork( ).getParameterRanges( );
+			auto range = std::lower_bound( ranges.begin( ), ranges.end( ), begin, []( auto const& lhs, IndexType offset ) {
+				return static_cast< IndexType >( lhs.offset ) < offset;
+			} );
+			if ( range == ranges.end( ) || static_cast< IndexType >( range -> offset ) != begin || static_cast< IndexType >( range -> size ) != size )
+				throw std::runtime_error( "The parameter range is not a single layer." );
+			IndexType numRows = mTrainableLayers[range - ranges.begin( )] -> getWeightMat( ).rows( );
+			return MatrixMapType( flatVec.data( ) + begin, numRows, size / numRows );
+		}
+
+		// Runs kernel( begin, size ) over L1 sized chunks of the flat buffers. Kernels
+		// made of several Eigen statements on the same chunk then read and write main
+		// memory only once per element instead of once per statement.
+		template< typename KernelType >
+		void forEachChunk( IndexType begin, IndexType size, KernelType&& kernel ) {
+			IndexType end = begin + size;
+			for ( IndexType chunkBegin = begin; chunkBegin < end; chunkBegin += chunk_size ) {
+				kernel( chunkBegin, std::min( chunk_size, end - chunkBegin ) );
+			}
+		}
+
 	private: 	//private member functions
 
 	public: 	//public data members
 
 	private: 	//private data members
+		// chunk of 8KB per operand, a few operands stay resident in L1
+		static constexpr IndexType chunk_size = 8192 / sizeof( NumericType );
 		NetworkType& mNetwork;
 		TrainableLayerVecType mTrainableLayers = { };
 
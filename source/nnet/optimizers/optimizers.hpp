@@ -1,11 +1,17 @@
 #ifndef OPTIMIZERS_HPP
 #define OPTIMIZERS_HPP
 
+// System includes --------------------
+#include <cmath>
+#include <stdexcept>
+
 // Eigen includes --------------------
 #include <Eigen/Dense>
 
 // Own includes --------------------
 #include "optimizers/base-optimizer.hpp"
+#include "utils/atomic-ops.hpp"
+#include "serialization/serialize.hpp"
 
 namespace NNet { // begin NNet
 
@@ -19,9 +25,14 @@ namespace NNet { // begin NNet
 		using NumericType = typename NetworkType::NumericType;
 		using VectorXType = typename NetworkType::VectorXType;
 		using MatrixXType = typename NetworkType::MatrixXType;
+		using IndexType = typename BaseOptimizer< NetworkType >::IndexType;
+		using VectorMapType = typename BaseOptimizer< NetworkType >::VectorMapType;
 
 	private: 	// private typedefs
 
+	public: 	// public static data members
+		static constexpr bool supports_async_updates = true;
+
 	public: 	//public member functions
 		SGDOptimizer( ) = delete;
 		explicit SGDOptimizer( NetworkType& network, NumericType learningRate = 0.001 )
@@ -32,20 +43,31 @@ namespace NNet { // begin NNet
 
 		//get/set member functions
 		NumericType getLearningRate( ) { return mLearningRate; }
+		void setLearningRate( NumericType learningRate ) { mLearningRate = learningRate; }
 
 		// interface
-		void applyWeightUpdate( std::size_t batchSize ) override {
-			for ( auto& layerPtr : this -> getTrainableLayers( ) ) {
-				MatrixXType& weightMat = layerPtr -> getWeightMat( );
-				MatrixXType const& weightGradMat = layerPtr -> getWeightGradMat( );
-				auto coeff = 1.0 / static_cast< NumericType >( batchSize );
-				// std::cout << "LearningRate, coeff: " << mLearningRate << ", " << coeff << std::endl;
-				// std::cout << "WeightMat Before: " << weightMat.rows( ) << ", " << weightMat.cols( ) << std::endl
-				// 		  << weightMat << std::endl;
-				// std::cout << "WeightGradMat Before: " << std::endl
-				// 		  << weightGradMat << std::endl;
-				weightMat = weightMat - mLearningRate * coeff * weightGradMat;
-			}
+		void applyRangeUpdate( IndexType begin, IndexType size, std::size_t batchSize ) override {
+			auto weightVec = this -> getParameterVec( );
+			auto weightGradVec = this -> getGradientVec( );
+			auto coeff = 1.0 / static_cast< NumericType >( batchSize );
+			// single pass over the range of the flat parameter buffer
+			weightVec.segment( begin, size ) -= mLearningRate * coeff * weightGradVec.segment( begin, size );
+		}
+		// Hogwild update of the shared weights from a training thread's gradient buffer,
+		// may run concurrently with the updates of other threads
+		void applyAsyncUpdate( VectorMapType const& gradientVec, std::size_t batchSize, AsyncUpdateMode mode ) {
+			auto weightVec = this -> getParameterVec( );
+			NumericType stepCoeff = mLearningRate / static_cast< NumericType >( batchSize );
+			this -> forEachActiveRange( [&]( IndexType begin, IndexType size ) {
+				if ( mode == AsyncUpdateMode::RELAXED_ATOMIC ) {
+					for ( IndexType i = begin; i < begin + size; ++i ) {
+						Utils::atomicAddRelaxed( &weightVec[i], -stepCoeff * gradientVec[i] );
+					}
+				}
+				else {
+					weightVec.segment( begin, size ) -= stepCoeff * gradientVec.segment( begin, size );
+				}
+			} );
 		}
 	private: 	//private member functions
 
@@ -66,21 +88,20 @@ namespace NNet { // begin NNet
 		using NumericType = typename NetworkType::NumericType;
 		using VectorXType = typename NetworkType::VectorXType;
 		using MatrixXType = typename NetworkType::MatrixXType;
+		using StateBufferType = typename BaseOptimizer< NetworkType >::StateBufferType;
+		using IndexType = typename BaseOptimizer< NetworkType >::IndexType;
+		using VectorMapType = typename BaseOptimizer< NetworkType >::VectorMapType;
 
 	private: 	// private typedefs
 
+	public: 	// public static data members
+		static constexpr bool supports_async_updates = true;
+
 	public: 	//public member functions
 		MomentumOptimizer( ) = delete;
 		explicit MomentumOptimizer( NetworkType& network, NumericType learningRate = 0.001, NumericType momentum = 0.9 )
-			: BaseOptimizer< NetworkType >( network ), mLearningRate( learningRate ), mMomentum( momentum ) {
-			for ( auto const& layer : this -> getTrainableLayers( ) ) {
-				MatrixXType const& weightGradMat = layer -> getWeightGradMat( );
-				auto numRows = weightGradMat.rows( );
-				auto numCols = weightGradMat.cols( );
-				MatrixXType mat( numRows, numCols );
-				mat.setZero( );
-				mWeightGradMatSaves.emplace_back( mat );
-			}
+			: BaseOptimizer< NetworkType >( network ), mLearningRate( learningRate ), mMomentum( momentum ),
+			  mWeightGradSaves( this -> makeStateBuffer( ) ) {
 		}
 		MomentumOptimizer( MomentumOptimizer const& other ) = delete;
 		~MomentumOptimizer( ) = default;
@@ -92,19 +113,41 @@ namespace NNet { // begin NNet
 		void setMomentum( NumericType momentum ) { mMomentum = momentum; }
 
 		// interface
-		void applyWeightUpdate( std::size_t batchSize ) override {
-			auto v_iter = mWeightGradMatSaves.begin( );
-			for ( auto& layerPtr : this -> getTrainableLayers( ) ) {
-				MatrixXType& weightMat = layerPtr -> getWeightMat( );
-				MatrixXType const& weightGradMat = layerPtr -> getWeightGradMat( );
-				NumericType coeff = 1.0 / static_cast< NumericType >( batchSize );
+		void applyRangeUpdate( IndexType begin, IndexType size, std::size_t batchSize ) override {
+			auto weightVec = this -> getParameterVec( );
+			auto weightGradVec = this -> getGradientVec( );
+			auto vVec = this -> viewState( mWeightGradSaves );
+			NumericType coeff = 1.0 / static_cast< NumericType >( batchSize );
+			this -> forEachChunk( begin, size, [&,this]( IndexType chunkBegin, IndexType chunkSize ) {
+				auto v = vVec.segment( chunkBegin, chunkSize );
 				// compute the velocity v_{t+1} at time t+1
-				// note that v_iter at t = 0 is zero
-				MatrixXType v = mMomentum * (*v_iter) - mLearningRate * coeff * weightGradMat;
-				*v_iter = v;
-				weightMat = weightMat + v;
-				++v_iter;
-			}
+				// note that v at t = 0 is zero
+				v = mMomentum * v - mLearningRate * coeff * weightGradVec.segment( chunkBegin, chunkSize );
+				weightVec.segment( chunkBegin, chunkSize ) += v;
+			} );
+		}
+		// Hogwild update of the shared weights and velocity from a training thread's
+		// gradient buffer, may run concurrently with the updates of other threads
+		void applyAsyncUpdate( VectorMapType const& gradientVec, std::size_t batchSize, AsyncUpdateMode mode ) {
+			auto weightVec = this -> getParameterVec( );
+			auto vVec = this -> viewState( mWeightGradSaves );
+			NumericType stepCoeff = mLearningRate / static_cast< NumericType >( batchSize );
+			this -> forEachActiveRange( [&,this]( IndexType begin, IndexType size ) {
+				if ( mode == AsyncUpdateMode::RELAXED_ATOMIC ) {
+					for ( IndexType i = begin; i < begin + size; ++i ) {
+						NumericType step = -stepCoeff * gradientVec[i];
+						NumericType v = Utils::atomicUpdateRelaxed( &vVec[i], [&,this]( NumericType current ) { return mMomentum * current + step; } );
+						Utils::atomicAddRelaxed( &weightVec[i], v );
+					}
+				}
+				else {
+					this -> forEachChunk( begin, size, [&,this]( IndexType chunkBegin, IndexType chunkSize ) {
+						auto v = vVec.segment( chunkBegin, chunkSize );
+						v = mMomentum * v - stepCoeff * gradientVec.segment( chunkBegin, chunkSize );
+						weightVec.segment( chunkBegin, chunkSize ) += v;
+					} );
+				}
+			} );
 		}
 	private: 	//private member functions
 
@@ -112,7 +155,7 @@ namespace NNet { // begin NNet
 
 	private: 	//private data members
 		NumericType mLearningRate, mMomentum;
-		std::vector< MatrixXType > mWeightGradMatSaves = { };
+		StateBufferType mWeightGradSaves;
 	}; // end of class MomentumOptimizer
 
 	/**
@@ -125,21 +168,16 @@ namespace NNet { // begin NNet
 		using NumericType = typename NetworkType::NumericType;
 		using VectorXType = typename NetworkType::VectorXType;
 		using MatrixXType = typename NetworkType::MatrixXType;
+		using StateBufferType = typename BaseOptimizer< NetworkType >::StateBufferType;
+		using IndexType = typename BaseOptimizer< NetworkType >::IndexType;
 
 	private: 	// private typedefs
 
 	public: 	//public member functions
 		NesterovMomentumOptimizer( ) = delete;
 		explicit NesterovMomentumOptimizer( NetworkType& network, NumericType learningRate = 0.001, NumericType momentum = 0.9 )
-			: BaseOptimizer< NetworkType >( network ), mLearningRate( learningRate ), mMomentum( momentum ) {
-			for ( auto const& layer : this -> getTrainableLayers( ) ) {
-				MatrixXType const& weightGradMat = layer -> getWeightGradMat( );
-				auto numRows = weightGradMat.rows( );
-				auto numCols = weightGradMat.cols( );
-				MatrixXType mat( numRows, numCols );
-				mat.setZero( );
-				mWeightGradMatSaves.emplace_back( mat );
-			}
+			: BaseOptimizer< NetworkType >( network ), mLearningRate( learningRate ), mMomentum( momentum ),
+			  mWeightGradSaves( this -> makeStateBuffer( ) ) {
 		}
 		NesterovMomentumOptimizer( NesterovMomentumOptimizer const& other ) = delete;
 		~NesterovMomentumOptimizer( ) = default;
@@ -152,24 +190,24 @@ namespace NNet { // begin NNet
 
 		// interface
 		void applyInterimUpdate( ) override {
-			auto v_iter = mWeightGradMatSaves.begin( );
-			for ( auto& layerPtr : this -> getTrainableLayers( ) ) {
-				MatrixXType& weightMat = layerPtr -> getWeightMat( );
-				weightMat = weightMat + mMomentum * ( *v_iter );
-				++v_iter;
-			}
+			// frozen layers keep their weights, their velocity is stale
+			auto weightVec = this -> getParameterVec( );
+			auto velocityVec = this -> viewState( mWeightGradSaves );
+			this -> forEachActiveRange( [&,this]( IndexType begin, IndexType size ) {
+				weightVec.segment( begin, size ) += mMomentum * velocityVec.segment( begin, size );
+			} );
 		}
-		void applyWeightUpdate( std::size_t batchSize ) override {
-			auto v_iter = mWeightGradMatSaves.begin( );
-			for ( auto& layerPtr : this -> getTrainableLayers( ) ) {
-				MatrixXType& weightMat = layerPtr -> getWeightMat( );
-				MatrixXType const& weightGradMat = layerPtr -> getWeightGradMat( );
-				NumericType coeff = 1.0 / static_cast< NumericType >( batchSize );
-				MatrixXType v = mMomentum * (*v_iter) - mLearningRate * coeff * weightGradMat;
-				*v_iter = v;
-				weightMat = weightMat - mLearningRate * coeff * weightGradMat;
-				++v_iter;
-			}
+		void applyRangeUpdate( IndexType begin, IndexType size, std::size_t batchSize ) override {
+			auto weightVec = this -> getParameterVec( );
+			auto weightGradVec = this -> getGradientVec( );
+			auto vVec = this -> viewState( mWeightGradSaves );
+			NumericType coeff = 1.0 / static_cast< NumericType >( batchSize );
+			this -> forEachChunk( begin, size, [&,this]( IndexType chunkBegin, IndexType chunkSize ) {
+				auto g = weightGradVec.segment( chunkBegin, chunkSize );
+				auto v = vVec.segment( chunkBegin, chunkSize );
+				v = mMomentum * v - mLearningRate * coeff * g;
+				weightVec.segment( chunkBegin, chunkSize ) -= mLearningRate * coeff * g;
+			} );
 		}
 	private: 	//private member functions
 
@@ -177,7 +215,7 @@ namespace NNet { // begin NNet
 
 	private: 	//private data members
 		NumericType mLearningRate, mMomentum;
-		std::vector< MatrixXType > mWeightGradMatSaves = { };
+		StateBufferType mWeightGradSaves;
 	}; // end of class NesterovMomentumOptimizer
 
 	/**
@@ -190,21 +228,16 @@ namespace NNet { // begin NNet
 		using NumericType = typename NetworkType::NumericType;
 		using VectorXType = typename NetworkType::VectorXType;
 		using MatrixXType = typename NetworkType::MatrixXType;
+		using StateBufferType = typename BaseOptimizer< NetworkType >::StateBufferType;
+		using IndexType = typename BaseOptimizer< NetworkType >::IndexType;
 
 	private: 	// private typedefs
 
 	public: 	//public member functions
 		AdaGradOptimizer() = delete;
 		explicit AdaGradOptimizer( NetworkType& network, NumericType learningRate = 0.01 )
-			: BaseOptimizer< NetworkType >( network ), mLearningRate( learningRate ) {
-			for ( auto const& layer : this -> getTrainableLayers( ) ) {
-				MatrixXType const& weightGradMat = layer -> getWeightGradMat( );
-				auto numRows = weightGradMat.rows( );
-				auto numCols = weightGradMat.cols( );
-				MatrixXType mat( numRows, numCols );
-				mat.setZero( );
-				mGradMatAccumSaves.emplace_back( mat );
-			}
+			: BaseOptimizer< NetworkType >( network ), mLearningRate( learningRate ),
+			  mGradAccumSaves( this -> makeStateBuffer( ) ) {
 		}
 		AdaGradOptimizer(const AdaGradOptimizer &c) = delete;
 		~AdaGradOptimizer() = default;
@@ -214,22 +247,21 @@ namespace NNet { // begin NNet
 		void setLearningRate( NumericType learningRate ) { mLearningRate = learningRate; }
 
 		// interface
-		void applyWeightUpdate( std::size_t batchSize ) override {
-			auto r_iter = mGradMatAccumSaves.begin( );
-			for ( auto& layerPtr : this -> getTrainableLayers( ) ) {
-				MatrixXType& weightMat = layerPtr -> getWeightMat( );
-				MatrixXType const& weightGradMat = layerPtr -> getWeightGradMat( );
-				NumericType coeff = 1.0 / static_cast< NumericType >( batchSize );
+		void applyRangeUpdate( IndexType begin, IndexType size, std::size_t batchSize ) override {
+			auto weightVec = this -> getParameterVec( );
+			auto weightGradVec = this -> getGradientVec( );
+			auto rVec = this -> viewState( mGradAccumSaves );
+			NumericType coeff = 1.0 / static_cast< NumericType >( batchSize );
+			this -> forEachChunk( begin, size, [&,this]( IndexType chunkBegin, IndexType chunkSize ) {
+				auto g = weightGradVec.segment( chunkBegin, chunkSize );
+				auto r = rVec.segment( chunkBegin, chunkSize );
 				// accumulate squared gradient
-				MatrixXType grad_sq = coeff * coeff * weightGradMat.cwiseProduct( weightGradMat );
-				*r_iter = (*r_iter) + grad_sq;
-				MatrixXType r = *r_iter;
-				r = r.unaryExpr( [this]( auto const& ele ) {
+				r += coeff * coeff * g.cwiseProduct( g );
+				auto rate = r.unaryExpr( [this]( NumericType ele ) -> NumericType {
 					return ( mLearningRate / ( 1.0e-7 + std::sqrt( ele ) ) );
 				} );
-				weightMat = weightMat - r.cwiseProduct( coeff * weightGradMat );
-				++r_iter;
-			}
+				weightVec.segment( chunkBegin, chunkSize ) -= rate.cwiseProduct( coeff * g );
+			} );
 		}
 
 	private: 	//private member functions
@@ -238,7 +270,7 @@ namespace NNet { // begin NNet
 
 	private: 	//private data members
 		NumericType mLearningRate;
-		std::vector< MatrixXType > mGradMatAccumSaves = { };
+		StateBufferType mGradAccumSaves;
 	}; // end of class AdaGradOptimizer
 
 	/**
@@ -251,21 +283,16 @@ namespace NNet { // begin NNet
 		using NumericType = typename NetworkType::NumericType;
 		using VectorXType = typename NetworkType::VectorXType;
 		using MatrixXType = typename NetworkType::MatrixXType;
+		using StateBufferType = typename BaseOptimizer< NetworkType >::StateBufferType;
+		using IndexType = typename BaseOptimizer< NetworkType >::IndexType;
 
 	private: 	// private typedefs
 
 	public: 	//public member functions
 		RMSPropOptimizer() = delete;
 		explicit RMSPropOptimizer( NetworkType& network, NumericType learningRate = 0.001, NumericType decayRate = 0.9 )
-			: BaseOptimizer< NetworkType >( network ), mLearningRate( learningRate ), mDecayRate( decayRate ) {
-			for ( auto const& layer : this -> getTrainableLayers( ) ) {
-				MatrixXType const& weightGradMat = layer -> getWeightGradMat( );
-				auto numRows = weightGradMat.rows( );
-				auto numCols = weightGradMat.cols( );
-				MatrixXType mat( numRows, numCols );
-				mat.setZero( );
-				mGradMatAccumSaves.emplace_back( mat );
-			}
+			: BaseOptimizer< NetworkType >( network ), mLearningRate( learningRate ), mDecayRate( decayRate ),
+			  mGradAccumSaves( this -> makeStateBuffer( ) ) {
 		}
 		RMSPropOptimizer( RMSPropOptimizer const& other ) = delete;
 		~RMSPropOptimizer() = default;
@@ -277,22 +304,21 @@ namespace NNet { // begin NNet
 		void setDecayRate( NumericType decayRate ) { mDecayRate = decayRate; }
 
 		// interface
-		void applyWeightUpdate( std::size_t batchSize ) override {
-			auto r_iter = mGradMatAccumSaves.begin( );
-			for ( auto& layerPtr : this -> getTrainableLayers( ) ) {
-				MatrixXType& weightMat = layerPtr -> getWeightMat( );
-				MatrixXType const& weightGradMat = layerPtr -> getWeightGradMat( );
-				NumericType coeff = 1.0 / static_cast< NumericType >( batchSize );
+		void applyRangeUpdate( IndexType begin, IndexType size, std::size_t batchSize ) override {
+			auto weightVec = this -> getParameterVec( );
+			auto weightGradVec = this -> getGradientVec( );
+			auto rVec = this -> viewState( mGradAccumSaves );
+			NumericType coeff = 1.0 / static_cast< NumericType >( batchSize );
+			this -> forEachChunk( begin, size, [&,this]( IndexType chunkBegin, IndexType chunkSize ) {
+				auto g = weightGradVec.segment( chunkBegin, chunkSize );
+				auto r = rVec.segment( chunkBegin, chunkSize );
 				// accumulate squared gradient
-				MatrixXType grad_sq = coeff * coeff * weightGradMat.cwiseProduct( weightGradMat );
-				*r_iter = mDecayRate * (*r_iter) + (1.0 - mDecayRate ) * grad_sq;
-				MatrixXType r = *r_iter;
-				r = r.unaryExpr( [this]( auto const& ele ) {
+				r = mDecayRate * r + ( 1.0 - mDecayRate ) * coeff * coeff * g.cwiseProduct( g );
+				auto rate = r.unaryExpr( [this]( NumericType ele ) -> NumericType {
 					return ( mLearningRate / ( 1.0e-6 + std::sqrt( ele ) ) );
 				} );
-				weightMat = weightMat - r.cwiseProduct( coeff * weightGradMat );
-				++r_iter;
-			}
+				weightVec.segment( chunkBegin, chunkSize ) -= rate.cwiseProduct( coeff * g );
+			} );
 		}
 
 	private: 	//private member functions
@@ -301,7 +327,7 @@ namespace NNet { // begin NNet
 
 	private: 	//private data members
 		NumericType mLearningRate, mDecayRate;
-		std::vector< MatrixXType > mGradMatAccumSaves = { };
+		StateBufferType mGradAccumSaves;
 	}; // end of class RMSPropOptimizer
 
 	/**
@@ -314,22 +340,16 @@ namespace NNet { // begin NNet
 		using NumericType = typename NetworkType::NumericType;
 		using VectorXType = typename NetworkType::VectorXType;
 		using MatrixXType = typename NetworkType::MatrixXType;
+		using StateBufferType = typename BaseOptimizer< NetworkType >::StateBufferType;
+		using IndexType = typename BaseOptimizer< NetworkType >::IndexType;
 
 	private: 	// private typedefs
 
 	public: 	//public member functions
 		RMSPropNestMomOptimizer() = delete;
 		explicit RMSPropNestMomOptimizer( NetworkType& network, NumericType learningRate = 0.001, NumericType momentum = 0.9, NumericType decayRate = 0.9 )
-			: BaseOptimizer< NetworkType >( network ), mLearningRate( learningRate ), mMomentum( momentum ), mDecayRate( decayRate ) {
-			for ( auto const& layer : this -> getTrainableLayers( ) ) {
-				MatrixXType const& weightGradMat = layer -> getWeightGradMat( );
-				auto numRows = weightGradMat.rows( );
-				auto numCols = weightGradMat.cols( );
-				MatrixXType mat( numRows, numCols );
-				mat.setZero( );
-				mWeightGradMatSaves.emplace_back( mat );
-				mGradMatAccumSaves.emplace_back( mat );
-			}
+			: BaseOptimizer< NetworkType >( network ), mLearningRate( learningRate ), mMomentum( momentum ), mDecayRate( decayRate ),
+			  mWeightGradSaves( this -> makeStateBuffer( ) ), mGradAccumSaves( this -> makeStateBuffer( ) ) {
 		}
 		RMSPropNestMomOptimizer( RMSPropNestMomOptimizer const& other ) = delete;
 		~RMSPropNestMomOptimizer() = default;
@@ -344,33 +364,31 @@ namespace NNet { // begin NNet
 
 		// interface
 		void applyInterimUpdate( ) override {
-			auto v_iter = mWeightGradMatSaves.begin( );
-			for ( auto& layerPtr : this -> getTrainableLayers( ) ) {
-				MatrixXType& weightMat = layerPtr -> getWeightMat( );
-				weightMat = weightMat + mMomentum * ( *v_iter );
-				++v_iter;
-			}
+			// frozen layers keep their weights, their velocity is stale
+			auto weightVec = this -> getParameterVec( );
+			auto velocityVec = this -> viewState( mWeightGradSaves );
+			this -> forEachActiveRange( [&,this]( IndexType begin, IndexType size ) {
+				weightVec.segment( begin, size ) += mMomentum * velocityVec.segment( begin, size );
+			} );
 		}
-		void applyWeightUpdate( std::size_t batchSize ) override {
-			auto v_iter = mWeightGradMatSaves.begin( );
-			auto r_iter = mGradMatAccumSaves.begin( );
-			for ( auto& layerPtr : this -> getTrainableLayers( ) ) {
-				MatrixXType& weightMat = layerPtr -> getWeightMat( );
-				MatrixXType const& weightGradMat = layerPtr -> getWeightGradMat( );
-				NumericType coeff = 1.0 / static_cast< NumericType >( batchSize );
+		void applyRangeUpdate( IndexType begin, IndexType size, std::size_t batchSize ) override {
+			auto weightVec = this -> getParameterVec( );
+			auto weightGradVec = this -> getGradientVec( );
+			auto vVec = this -> viewState( mWeightGradSaves );
+			auto rVec = this -> viewState( mGradAccumSaves );
+			NumericType coeff = 1.0 / static_cast< NumericType >( batchSize );
+			this -> forEachChunk( begin, size, [&,this]( IndexType chunkBegin, IndexType chunkSize ) {
+				auto g = weightGradVec.segment( chunkBegin, chunkSize );
+				auto v = vVec.segment( chunkBegin, chunkSize );
+				auto r = rVec.segment( chunkBegin, chunkSize );
 				// accumulate squared gradient
-				MatrixXType grad_sq = coeff * coeff * weightGradMat.cwiseProduct( weightGradMat );
-				*r_iter = mDecayRate * (*r_iter) + (1.0 - mDecayRate ) * grad_sq;
-				MatrixXType r = *r_iter;
-				r = r.unaryExpr( [this]( auto const& ele ) {
+				r = mDecayRate * r + ( 1.0 - mDecayRate ) * coeff * coeff * g.cwiseProduct( g );
+				auto rate = r.unaryExpr( [this]( NumericType ele ) -> NumericType {
 					return ( mLearningRate / ( 1.0e-7 + std::sqrt( ele ) ) );
 				} );
-				MatrixXType v = mMomentum * ( *v_iter ) - r.cwiseProduct( coeff * weightGradMat );
-				*v_iter = v;
-				weightMat = weightMat - r.cwiseProduct( coeff * weightGradMat );
-				++v_iter;
-				++r_iter;
-			}
+				v = mMomentum * v - rate.cwiseProduct( coeff * g );
+				weightVec.segment( chunkBegin, chunkSize ) -= rate.cwiseProduct( coeff * g );
+			} );
 		}
 
 	private: 	//private member functions
@@ -379,9 +397,366 @@ namespace NNet { // begin NNet
 
 	private: 	//private data members
 		NumericType mLearningRate, mMomentum, mDecayRate;
-		std::vector< MatrixXType > mWeightGradMatSaves = { }, mGradMatAccumSaves = { };
+		StateBufferType mWeightGradSaves, mGradAccumSaves;
 	}; // end of class RMSPropNestMomOptimizer
 
+	/**
+	 *AdamOptimizer. A non zero weight decay is applied decoupled from the
+	 *adaptive step (AdamW).
+	 */
+	template< typename NetworkType >
+	class AdamOptimizer
+		: public BaseOptimizer< NetworkType > {
+	public: 	// public typedefs
+		using NumericType = typename NetworkType::NumericType;
+		using VectorXType = typename NetworkType::VectorXType;
+		using MatrixXType = typename NetworkType::MatrixXType;
+		using StateBufferType = typename BaseOptimizer< NetworkType >::StateBufferType;
+		using IndexType = typename BaseOptimizer< NetworkType >::IndexType;
+
+	private: 	// private typedefs
+
+	public: 	//public member functions
+		AdamOptimizer() = delete;
+		explicit AdamOptimizer( NetworkType& network, NumericType learningRate = 0.001, NumericType beta1 = 0.9, NumericType beta2 = 0.999, NumericType weightDecay = 0.0, NumericType epsilon = 1.0e-8 )
+			: BaseOptimizer< NetworkType >( network ), mLearningRate( learningRate ), mBeta1( beta1 ), mBeta2( beta2 ), mWeightDecay( weightDecay ), mEpsilon( epsilon ),
+			  mFirstMoments( this -> makeStateBuffer( ) ), mSecondMoments( this -> makeStateBuffer( ) ) {
+		}
+		AdamOptimizer( AdamOptimizer const& other ) = delete;
+		~AdamOptimizer() = default;
+
+		//get/set member functions
+		NumericType getLearningRate( ) const { return mLearningRate; }
+		void setLearningRate( NumericType learningRate ) { mLearningRate = learningRate; }
+		NumericType getBeta1( ) const { return mBeta1; }
+		void setBeta1( NumericType beta1 ) { mBeta1 = beta1; }
+		NumericType getBeta2( ) const { return mBeta2; }
+		void setBeta2( NumericType beta2 ) { mBeta2 = beta2; }
+		NumericType getWeightDecay( ) const { return mWeightDecay; }
+		void setWeightDecay( NumericType weightDecay ) { mWeightDecay = weightDecay; }
+		NumericType getEpsilon( ) const { return mEpsilon; }
+		void setEpsilon( NumericType epsilon ) { mEpsilon = epsilon; }
+		std::size_t getStep( ) const { return mStep; }
+		void setStep( std::size_t step ) { mStep = step; }
+		StateBufferType& getFirstMoments( ) { return mFirstMoments; }
+		StateBufferType& getSecondMoments( ) { return mSecondMoments; }
+
+		// interface
+		void beginStep( ) override {
+			++mStep;
+			mBiasCorrection1 = 1.0 - std::pow( mBeta1, static_cast< NumericType >( mStep ) );
+			mBiasCorrection2 = 1.0 - std::pow( mBeta2, static_cast< NumericType >( mStep ) );
+		}
+		void applyRangeUpdate( IndexType begin, IndexType size, std::size_t batchSize ) override {
+			auto weightVec = this -> getParameterVec( );
+			auto weightGradVec = this -> getGradientVec( );
+			auto mVec = this -> viewState( mFirstMoments );
+			auto vVec = this -> viewState( mSecondMoments );
+			NumericType coeff = 1.0 / static_cast< NumericType >( batchSize );
+			this -> forEachChunk( begin, size, [&,this]( IndexType chunkBegin, IndexType chunkSize ) {
+				auto g = weightGradVec.segment( chunkBegin, chunkSize );
+				auto m = mVec.segment( chunkBegin, chunkSize );
+				auto v = vVec.segment( chunkBegin, chunkSize );
+				auto w = weightVec.segment( chunkBegin, chunkSize );
+				m = mBeta1 * m + ( 1.0 - mBeta1 ) * coeff * g;
+				v = mBeta2 * v + ( 1.0 - mBeta2 ) * coeff * coeff * g.cwiseProduct( g );
+				w.array( ) -= mLearningRate * ( ( m.array( ) / mBiasCorrection1 ) / ( ( v.array( ) / mBiasCorrection2 ).sqrt( ) + mEpsilon )
+												+ mWeightDecay * w.array( ) );
+			} );
+		}
+
+	private: 	//private member functions
+
+	public: 	//public data members
+
+	private: 	//private data members
+		NumericType mLearningRate, mBeta1, mBeta2, mWeightDecay, mEpsilon;
+		std::size_t mStep = 0;
+		NumericType mBiasCorrection1 = 1.0, mBiasCorrection2 = 1.0;
+		StateBufferType mFirstMoments, mSecondMoments;
+	}; // end of class AdamOptimizer
+
+	/**
+	 *AdamWOptimizer is Adam with decoupled weight decay enabled by default.
+	 */
+	template< typename NetworkType >
+	class AdamWOptimizer
+		: public AdamOptimizer< NetworkType > {
+	public: 	// public typedefs
+		using NumericType = typename NetworkType::NumericType;
+
+	private: 	// private typedefs
+
+	public: 	//public member functions
+		AdamWOptimizer() = delete;
+		explicit AdamWOptimizer( NetworkType& network, NumericType learningRate = 0.001, NumericType weightDecay = 0.01, NumericType beta1 = 0.9, NumericType beta2 = 0.999, NumericType epsilon = 1.0e-8 )
+			: AdamOptimizer< NetworkType >( network, learningRate, beta1, beta2, weightDecay, epsilon ) {
+		}
+		AdamWOptimizer( AdamWOptimizer const& other ) = delete;
+		~AdamWOptimizer() = default;
+
+	private: 	//private member functions
+
+	public: 	//public data members
+
+	private: 	//private data members
+
+	}; // end of class AdamWOptimizer
+
+	/**
+	 *LAMBOptimizer (layer-wise adaptive moments). The AdamW step of the weights
+	 *of every trainable layer is rescaled by the trust ratio ||w|| / ||step||
+	 *of the layer, which keeps large batch training stable. The biases are
+	 *excluded from the norms and the weight decay and take the plain Adam step.
+	 */
+	template< typename NetworkType >
+	class LAMBOptimizer
+		: public BaseOptimizer< NetworkType > {
+	public: 	// public typedefs
+		using NumericType = typename NetworkType::NumericType;
+		using VectorXType = typename NetworkType::VectorXType;
+		using MatrixXType = typename NetworkType::MatrixXType;
+		using StateBufferType = typename BaseOptimizer< NetworkType >::StateBufferType;
+		using IndexType = typename BaseOptimizer< NetworkType >::IndexType;
+
+	private: 	// private typedefs
+
+	public: 	//public member functions
+		LAMBOptimizer() = delete;
+		explicit LAMBOptimizer( NetworkType& network, NumericType learningRate = 0.001, NumericType weightDecay = 0.01, NumericType beta1 = 0.9, NumericType beta2 = 0.999, NumericType epsilon = 1.0e-6 )
+			: BaseOptimizer< NetworkType >( network ), mLearningRate( learningRate ), mBeta1( beta1 ), mBeta2( beta2 ), mWeightDecay( weightDecay ), mEpsilon( epsilon ),
+			  mFirstMoments( this -> makeStateBuffer( ) ), mSecondMoments( this -> makeStateBuffer( ) ) {
+		}
+		LAMBOptimizer( LAMBOptimizer const& other ) = delete;
+		~LAMBOptimizer() = default;
+
+		//get/set member functions
+		NumericType getLearningRate( ) const { return mLearningRate; }
+		void setLearningRate( NumericType learningRate ) { mLearningRate = learningRate; }
+		NumericType getBeta1( ) const { return mBeta1; }
+		void setBeta1( NumericType beta1 ) { mBeta1 = beta1; }
+		NumericType getBeta2( ) const { return mBeta2; }
+		void setBeta2( NumericType beta2 ) { mBeta2 = beta2; }
+		NumericType getWeightDecay( ) const { return mWeightDecay; }
+		void setWeightDecay( NumericType weightDecay ) { mWeightDecay = weightDecay; }
+		NumericType getEpsilon( ) const { return mEpsilon; }
+		void setEpsilon( NumericType epsilon ) { mEpsilon = epsilon; }
+		std::size_t getStep( ) const { return mStep; }
+		void setStep( std::size_t step ) { mStep = step; }
+		StateBufferType& getFirstMoments( ) { return mFirstMoments; }
+		StateBufferType& getSecondMoments( ) { return mSecondMoments; }
+
+		// interface
+		void beginStep( ) override {
+			++mStep;
+			mBiasCorrection1 = 1.0 - std::pow( mBeta1, static_cast< NumericType >( mStep ) );
+			mBiasCorrection2 = 1.0 - std::pow( mBeta2, static_cast< NumericType >( mStep ) );
+		}
+		void applyWeightUpdate( std::size_t batchSize ) override {
+			this -> applyLayerwiseUpdate( batchSize );
+		}
+		// the range is a single layer, the trust ratio is taken over its weights
+		void applyRangeUpdate( IndexType begin, IndexType size, std::size_t batchSize ) override {
+			auto weightVec = this -> getParameterVec( );
+			auto weightGradVec = this -> getGradientVec( );
+			auto mVec = this -> viewState( mFirstMoments );
+			auto vVec = this -> viewState( mSecondMoments );
+			NumericType coeff = 1.0 / static_cast< NumericType >( batchSize );
+			// update the moments
+			this -> forEachChunk( begin, size, [&,this]( IndexType chunkBegin, IndexType chunkSize ) {
+				auto g = weightGradVec.segment( chunkBegin, chunkSize );
+				auto m = mVec.segment( chunkBegin, chunkSize );
+				auto v = vVec.segment( chunkBegin, chunkSize );
+				m = mBeta1 * m + ( 1.0 - mBeta1 ) * coeff * g;
+				v = mBeta2 * v + ( 1.0 - mBeta2 ) * coeff * coeff * g.cwiseProduct( g );
+			} );
+			// the weights (all but the last row) and the biases (the last row) of the layer
+			auto w = this -> viewLayer( weightVec, begin, size );
+			auto m = this -> viewLayer( mVec, begin, size );
+			auto v = this -> viewLayer( vVec, begin, size );
+			IndexType numWeightRows = w.rows( ) - 1;
+			auto adamStep = ( m.array( ) / mBiasCorrection1 ) / ( ( v.array( ) / mBiasCorrection2 ).sqrt( ) + mEpsilon );
+			NumericType weightNormSq = w.topRows( numWeightRows ).squaredNorm( );
+			NumericType stepNormSq = ( adamStep.topRows( numWeightRows ) + mWeightDecay * w.topRows( numWeightRows ).array( ) ).matrix( ).squaredNorm( );
+			NumericType trustRatio = 1.0;
+			if ( weightNormSq > 0.0 && stepNormSq > 0.0 )
+				trustRatio = std::sqrt( weightNormSq / stepNormSq );
+			// apply the rescaled step to the weights and the plain Adam step to the biases
+			w.topRows( numWeightRows ).array( ) -= mLearningRate * trustRatio * ( adamStep.topRows( numWeightRows ) + mWeightDecay * w.topRows( numWeightRows ).array( ) );
+			w.bottomRows( 1 ).array( ) -= mLearningRate * adamStep.bottomRows( 1 );
+		}
+
+	private: 	//private member functions
+
+	public: 	//public data members
+
+	private: 	//private data members
+		NumericType mLearningRate, mBeta1, mBeta2, mWeightDecay, mEpsilon;
+		std::size_t mStep = 0;
+		NumericType mBiasCorrection1 = 1.0, mBiasCorrection2 = 1.0;
+		StateBufferType mFirstMoments, mSecondMoments;
+	}; // end of class LAMBOptimizer
+
+	/**
+	 *LARSOptimizer (layer-wise adaptive rate scaling). Momentum SGD where the
+	 *learning rate of the weights of every trainable layer is scaled by the
+	 *trust ratio eta ||w|| / ( ||g|| + weightDecay ||w|| ) of the layer. The
+	 *biases are excluded from the norms and the weight decay and take the
+	 *plain momentum SGD step.
+	 */
+	template< typename NetworkType >
+	class LARSOptimizer
+		: public BaseOptimizer< NetworkType > {
+	public: 	// public typedefs
+		using NumericType = typename NetworkType::NumericType;
+		using VectorXType = typename NetworkType::VectorXType;
+		using MatrixXType = typename NetworkType::MatrixXType;
+		using StateBufferType = typename BaseOptimizer< NetworkType >::StateBufferType;
+		using IndexType = typename BaseOptimizer< NetworkType >::IndexType;
+
+	private: 	// private typedefs
+
+	public: 	//public member functions
+		LARSOptimizer() = delete;
+		explicit LARSOptimizer( NetworkType& network, NumericType learningRate = 0.1, NumericType momentum = 0.9, NumericType weightDecay = 0.0005, NumericType trustCoefficient = 0.001 )
+			: BaseOptimizer< NetworkType >( network ), mLearningRate( learningRate ), mMomentum( momentum ), mWeightDecay( weightDecay ), mTrustCoefficient( trustCoefficient ),
+			  mWeightGradSaves( this -> makeStateBuffer( ) ) {
+		}
+		LARSOptimizer( LARSOptimizer const& other ) = delete;
+		~LARSOptimizer() = default;
+
+		//get/set member functions
+		NumericType getLearningRate( ) const { return mLearningRate; }
+		void setLearningRate( NumericType learningRate ) { mLearningRate = learningRate; }
+		NumericType getMomentum( ) const { return mMomentum; }
+		void setMomentum( NumericType momentum ) { mMomentum = momentum; }
+		NumericType getWeightDecay( ) const { return mWeightDecay; }
+		void setWeightDecay( NumericType weightDecay ) { mWeightDecay = weightDecay; }
+		NumericType getTrustCoefficient( ) const { return mTrustCoefficient; }
+		void setTrustCoefficient( NumericType trustCoefficient ) { mTrustCoefficient = trustCoefficient; }
+		StateBufferType& getVelocities( ) { return mWeightGradSaves; }
+
+		// interface
+		void applyWeightUpdate( std::size_t batchSize ) override {
+			this -> applyLayerwiseUpdate( batchSize );
+		}
+		// the range is a single layer, the trust ratio is taken over its weights
+		void applyRangeUpdate( IndexType begin, IndexType size, std::size_t batchSize ) override {
+			auto weightVec = this -> getParameterVec( );
+			auto weightGradVec = this -> getGradientVec( );
+			auto vVec = this -> viewState( mWeightGradSaves );
+			NumericType coeff = 1.0 / static_cast< NumericType >( batchSize );
+			// the weights (all but the last row) and the biases (the last row) of the layer
+			auto w = this -> viewLayer( weightVec, begin, size );
+			auto g = this -> viewLayer( weightGradVec, begin, size );
+			auto v = this -> viewLayer( vVec, begin, size );
+			IndexType numWeightRows = w.rows( ) - 1;
+			NumericType weightNorm = w.topRows( numWeightRows ).norm( );
+			NumericType gradNorm = coeff * g.topRows( numWeightRows ).norm( );
+			NumericType localRate = 1.0;
+			if ( weightNorm > 0.0 && gradNorm > 0.0 )
+				localRate = mTrustCoefficient * weightNorm / ( gradNorm + mWeightDecay * weightNorm );
+			NumericType rate = mLearningRate * localRate;
+			v.topRows( numWeightRows ) = mMomentum * v.topRows( numWeightRows ) + rate * ( coeff * g.topRows( numWeightRows ) + mWeightDecay * w.topRows( numWeightRows ) );
+			v.bottomRows( 1 ) = mMomentum * v.bottomRows( 1 ) + mLearningRate * coeff * g.bottomRows( 1 );
+			w -= v;
+		}
+
+	private: 	//private member functions
+
+	public: 	//public data members
+
+	private: 	//private data members
+		NumericType mLearningRate, mMomentum, mWeightDecay, mTrustCoefficient;
+		StateBufferType mWeightGradSaves;
+	}; // end of class LARSOptimizer
+
 } // end NNet
 
+namespace boost::serialization { // begin boost::serialization
+	// Optimizer state is serialized into an existing optimizer constructed on the same
+	// network, training resumes exactly where the saved optimizer stopped.
+	template< typename OptimizerType >
+	void checkOptimizerStateSize( OptimizerType const& obj, typename OptimizerType::StateBufferType const& buffer ) {
+		if ( buffer.size( ) != obj.getNumParameters( ) )
+			throw std::runtime_error( "Optimizer state does not match the network's parameters." );
+	}
+
+	template< typename ArchiveType, typename NetworkType >
+	void serialize( ArchiveType &ar, NNet::AdamOptimizer< NetworkType >& obj, unsigned const /* version */ ) {
+		auto learningRate = obj.getLearningRate( );
+		auto beta1 = obj.getBeta1( );
+		auto beta2 = obj.getBeta2( );
+		auto weightDecay = obj.getWeightDecay( );
+		auto epsilon = obj.getEpsilon( );
+		auto step = obj.getStep( );
+		ar & learningRate;
+		ar & beta1;
+		ar & beta2;
+		ar & weightDecay;
+		ar & epsilon;
+		ar & step;
+		ar & obj.getFirstMoments( );
+		ar & obj.getSecondMoments( );
+		// note that these are set for the loaded object, c.f. BaseLayer
+		obj.setLearningRate( learningRate );
+		obj.setBeta1( beta1 );
+		obj.setBeta2( beta2 );
+		obj.setWeightDecay( weightDecay );
+		obj.setEpsilon( epsilon );
+		obj.setStep( step );
+		checkOptimizerStateSize( obj, obj.getFirstMoments( ) );
+		checkOptimizerStateSize( obj, obj.getSecondMoments( ) );
+	}
+
+	template< typename ArchiveType, typename NetworkType >
+	void serialize( ArchiveType &ar, NNet::AdamWOptimizer< NetworkType >& obj, unsigned const /* version */ ) {
+		ar & boost::serialization::base_object< NNet::AdamOptimizer< NetworkType > >( obj );
+	}
+
+	template< typename ArchiveType, typename NetworkType >
+	void serialize( ArchiveType &ar, NNet::LAMBOptimizer< NetworkType >& obj, unsigned const /* version */ ) {
+		auto learningRate = obj.getLearningRate( );
+		auto beta1 = obj.getBeta1( );
+		auto beta2 = obj.getBeta2( );
+		auto weightDecay = obj.getWeightDecay( );
+		auto epsilon = obj.getEpsilon( );
+		auto step = obj.getStep( );
+		ar & learningRate;
+		ar & beta1;
+		ar & beta2;
+		ar & weightDecay;
+		ar & epsilon;
+		ar & step;
+		ar & obj.getFirstMoments( );
+		ar & obj.getSecondMoments( );
+		obj.setLearningRate( learningRate );
+		obj.setBeta1( beta1 );
+		obj.setBeta2( beta2 );
+		obj.setWeightDecay( weightDecay );
+		obj.setEpsilon( epsilon );
+		obj.setStep( step );
+		checkOptimizerStateSize( obj, obj.getFirstMoments( ) );
+		checkOptimizerStateSize( obj, obj.getSecondMoments( ) );
+	}
+
+	template< typename ArchiveType, typename NetworkType >
+	void serialize( ArchiveType &ar, NNet::LARSOptimizer< NetworkType >& obj, unsigned const /* version */ ) {
+		auto learningRate = obj.getLearningRate( );
+		auto momentum = obj.getMomentum( );
+		auto weightDecay = obj.getWeightDecay( );
+		auto trustCoefficient = obj.getTrustCoefficient( );
+		ar & learningRate;
+		ar & momentum;
+		ar & weightDecay;
+		ar & trustCoefficient;
+		ar & obj.getVelocities( );
+		obj.setLearningRate( learningRate );
+		obj.setMomentum( momentum );
+		obj.setWeightDecay( weightDecay );
+		obj.setTrustCoefficient( trustCoefficient );
+		checkOptimizerStateSize( obj, obj.getVelocities( ) );
+	}
+} // end boost::serialization
+
 #endif // OPTIMIZERS_HPP
@@ -0,0 +1,194 @@
+#ifndef QUASI_NEWTON_OPTIMIZERS_HPP
+#define QUASI_NEWTON_OPTIMIZERS_HPP
+
+// System includes --------------------
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+// Eigen includes --------------------
+#include <Eigen/Dense>
+
+// Own includes --------------------
+#include "optimizers/base-optimizer.hpp"
+#include "utils/aligned-buffer.hpp"
+
+namespace NNet { // begin NNet
+
+	/**
+	 *LBFGSOptimizer (limited memory BFGS). Takes full batch steps along the
+	 *quasi-Newton direction built from the last historySize weight and
+	 *gradient differences (two loop recursion), the step length is found by a
+	 *backtracking line search on the Armijo condition
+	 *  f( w + t d ) <= f( w ) + c1 t grad f( w ) . d.
+	 *A step evaluates the loss and gradient over the whole training set
+	 *through a callback, see NetworkTrainer::trainFullBatch.
+	 */
+	template< typename NetworkType >
+	class LBFGSOptimizer
+		: public BaseOptimizer< NetworkType > {
+	public: 	// public typedefs
+		using NumericType = typename NetworkType::NumericType;
+		using VectorXType = typename NetworkType::VectorXType;
+		using MatrixXType = typename NetworkType::MatrixXType;
+		using VectorMapType = typename NetworkType::VectorMapType;
+		using StateBufferType = typename BaseOptimizer< NetworkType >::StateBufferType;
+		using IndexType = typename BaseOptimizer< NetworkType >::IndexType;
+
+	private: 	// private typedefs
+
+	public: 	// public static data members
+		static constexpr bool is_full_batch = true;
+
+	public: 	//public member functions
+		LBFGSOptimizer() = delete;
+		explicit LBFGSOptimizer( NetworkType& network, std::size_t historySize = 10, std::size_t maxLineSearchSteps = 20, NumericType sufficientDecrease = 1e-4 )
+			: BaseOptimizer< NetworkType >( network ), mHistorySize( std::max< std::size_t >( historySize, 1 ) ),
+			  mMaxLineSearchSteps( maxLineSearchSteps ), mSufficientDecrease( sufficientDecrease ),
+			  mWeightDiffs( mHistorySize * this -> getNumParameters( ) ), mGradientDiffs( mHistorySize * this -> getNumParameters( ) ),
+			  mRho( mHistorySize, 0.0 ), mAlpha( mHistorySize, 0.0 ),
+			  mWeights( this -> makeStateBuffer( ) ), mGradient( this -> makeStateBuffer( ) ), mDirection( this -> makeStateBuffer( ) ) {
+		}
+		LBFGSOptimizer( LBFGSOptimizer const& other ) = delete;
+		~LBFGSOptimizer() = default;
+
+		//get/set member functions
+		std::size_t getHistorySize( ) const { return mHistorySize; }
+		std::size_t getNumStoredPairs( ) const { return mNumPairs; }
+		std::size_t getMaxLineSearchSteps( ) const { return mMaxLineSearchSteps; }
+		void setMaxLineSearchSteps( std::size_t maxLineSearchSteps ) { mMaxLineSearchSteps = maxLineSearchSteps; }
+		NumericType getSufficientDecrease( ) const { return mSufficientDecrease; }
+		void setSufficientDecrease( NumericType sufficientDecrease ) { mSufficientDecrease = sufficientDecrease; }
+		// number of loss and gradient evaluations made by the last step
+		std::size_t getNumEvaluations( ) const { return mNumEvaluations; }
+
+		// forget the curvature pairs, the next step is a steepest descent step
+		void resetHistory( ) {
+			mNumPairs = 0;
+			mNextSlot = 0;
+		}
+
+		// One L-BFGS iteration. evaluate( ) must return the loss at the network's current
+		// weights and write the matching gradient to the network's gradient buffer.
+		// Returns the loss at the weights the step ends on. When the line search fails
+		// the weights are left unchanged and the history is reset.
+		template< typename EvaluateType >
+		NumericType step( EvaluateType&& evaluate ) {
+			auto weightVec = this -> getParameterVec( );
+			auto gradientVec = this -> getGradientVec( );
+			auto currentWeightVec = this -> viewState( mWeights );
+			auto currentGradientVec = this -> viewState( mGradient );
+			auto directionVec = this -> viewState( mDirection );
+			mNumEvaluations = 0;
+			// the evaluation at the end of the last step is reused unless the weights were changed since
+			if ( !mHasEvaluation || currentWeightVec != weightVec ) {
+				mLoss = evaluate( );
+				++mNumEvaluations;
+				currentWeightVec = weightVec;
+				currentGradientVec = gradientVec;
+				mHasEvaluation = true;
+			}
+			computeDirection( );
+			NumericType slope = currentGradientVec.dot( directionVec );
+			if ( !( slope < 0.0 ) ) {
+				// not a descent direction, restart from steepest descent
+				resetHistory( );
+				directionVec = -currentGradientVec;
+				slope = -currentGradientVec.squaredNorm( );
+			}
+			if ( slope == 0.0 )
+				return mLoss;
+			// without curvature information the first trial step has unit length
+			NumericType stepLength = 1.0;
+			if ( mNumPairs == 0 )
+				stepLength = std::min< NumericType >( 1.0, 1.0 / directionVec.norm( ) );
+			for ( std::size_t trial = 0; trial < mMaxLineSearchSteps; ++trial, stepLength *= 0.5 ) {
+				weightVec = currentWeightVec + stepLength * directionVec;
+				NumericType trialLoss = evaluate( );
+				++mNumEvaluations;
+				if ( std::isfinite( trialLoss ) && trialLoss <= mLoss + mSufficientDecrease * stepLength * slope ) {
+					storePair( weightVec, gradientVec );
+					currentWeightVec = weightVec;
+					currentGradientVec = gradientVec;
+					mLoss = trialLoss;
+					return mLoss;
+				}
+			}
+			// line search failed, restore the weights (the stored gradient still matches them)
+			weightVec = currentWeightVec;
+			resetHistory( );
+			return mLoss;
+		}
+
+		// interface
+		void applyRangeUpdate( IndexType /* begin */, IndexType /* size */, std::size_t /* batchSize */ ) override {
+			throw std::runtime_error( "LBFGSOptimizer takes full batch steps, train with NetworkTrainer::trainFullBatch." );
+		}
+
+	private: 	//private member functions
+		VectorMapType historyRow( StateBufferType& buffer, std::size_t slot ) {
+			auto numParameters = this -> getNumParameters( );
+			return VectorMapType( buffer.data( ) + slot * numParameters, numParameters );
+		}
+
+		// two loop recursion, direction = -H grad
+		void computeDirection( ) {
+			auto directionVec = this -> viewState( mDirection );
+			directionVec = this -> viewState( mGradient );
+			for ( std::size_t k = 0; k < mNumPairs; ++k ) {
+				std::size_t slot = ( mNextSlot + mHistorySize - 1 - k ) % mHistorySize;
+				mAlpha[slot] = mRho[slot] * historyRow( mWeightDiffs, slot ).dot( directionVec );
+				directionVec -= mAlpha[slot] * historyRow( mGradientDiffs, slot );
+			}
+			if ( mNumPairs > 0 ) {
+				// initial Hessian gamma I from the newest pair
+				std::size_t newest = ( mNextSlot + mHistorySize - 1 ) % mHistorySize;
+				auto gradientDiffVec = historyRow( mGradientDiffs, newest );
+				directionVec *= 1.0 / ( mRho[newest] * gradientDiffVec.squaredNorm( ) );
+			}
+			for ( std::size_t k = mNumPairs; k > 0; --k ) {
+				std::size_t slot = ( mNextSlot + mHistorySize - k ) % mHistorySize;
+				NumericType beta = mRho[slot] * historyRow( mGradientDiffs, slot ).dot( directionVec );
+				directionVec += ( mAlpha[slot] - beta ) * historyRow( mWeightDiffs, slot );
+			}
+			directionVec = -directionVec;
+		}
+
+		// keeps the pair only if it has positive curvature, so H stays positive definite
+		void storePair( VectorMapType const& weightVec, VectorMapType const& gradientVec ) {
+			auto currentWeightVec = this -> viewState( mWeights );
+			auto currentGradientVec = this -> viewState( mGradient );
+			NumericType curvature = ( weightVec - currentWeightVec ).dot( gradientVec - currentGradientVec );
+			NumericType gradientDiffNorm = ( gradientVec - currentGradientVec ).squaredNorm( );
+			if ( !( curvature > std::numeric_limits< NumericType >::epsilon( ) * gradientDiffNorm ) )
+				return;
+			historyRow( mWeightDiffs, mNextSlot ) = weightVec - currentWeightVec;
+			historyRow( mGradientDiffs, mNextSlot ) = gradientVec - currentGradientVec;
+			mRho[mNextSlot] = 1.0 / curvature;
+			mNextSlot = ( mNextSlot + 1 ) % mHistorySize;
+			mNumPairs = std::min( mNumPairs + 1, mHistorySize );
+		}
+
+	public: 	//public data members
+
+	private: 	//private data members
+		std::size_t mHistorySize;
+		std::size_t mMaxLineSearchSteps;
+		NumericType mSufficientDecrease;
+		// ring buffers of historySize rows laid out like the flat parameter buffer
+		StateBufferType mWeightDiffs, mGradientDiffs;
+		std::vector< NumericType > mRho, mAlpha;
+		std::size_t mNumPairs = 0;
+		std::size_t mNextSlot = 0;
+		// weights, gradient and loss at the current iterate
+		StateBufferType mWeights, mGradient, mDirection;
+		NumericType mLoss = 0.0;
+		bool mHasEvaluation = false;
+		std::size_t mNumEvaluations = 0;
+	}; // end of class LBFGSOptimizer
+
+} // end NNet
+
+#endif // QUASI_NEWTON_OPTIMIZERS_HPP
@@ -0,0 +1,280 @@
+#ifndef VARIANCE_REDUCED_OPTIMIZERS_HPP
+#define VARIANCE_REDUCED_OPTIMIZERS_HPP
+
+// System includes --------------------
+#include <algorithm>
+#include <stdexcept>
+
+// Eigen includes --------------------
+#include <Eigen/Dense>
+
+// Own includes --------------------
+#include "optimizers/base-optimizer.hpp"
+#include "utils/aligned-buffer.hpp"
+
+namespace NNet { // begin NNet
+
+	/**
+	 *SVRGOptimizer (stochastic variance reduced gradient). A snapshot of the
+	 *weights and the full training set gradient at the snapshot are taken
+	 *periodically, a step then uses
+	 *  g = mean_B( grad f_i( w ) - grad f_i( w_snapshot ) ) + full gradient.
+	 *The trainer recomputes every batch at the snapshot weights between
+	 *beginSnapshotGradients( ) and endSnapshotGradients( ).
+	 */
+	template< typename NetworkType >
+	class SVRGOptimizer
+		: public BaseOptimizer< NetworkType > {
+	public: 	// public typedefs
+		using NumericType = typename NetworkType::NumericType;
+		using VectorXType = typename NetworkType::VectorXType;
+		using MatrixXType = typename NetworkType::MatrixXType;
+		using StateBufferType = typename BaseOptimizer< NetworkType >::StateBufferType;
+		using IndexType = typename BaseOptimizer< NetworkType >::IndexType;
+
+	private: 	// private typedefs
+
+	public: 	// public static data members
+		static constexpr bool requires_snapshot_gradients = true;
+
+	public: 	//public member functions
+		SVRGOptimizer() = delete;
+		// snapshotInterval is the number of steps between snapshots, zero takes a
+		// snapshot at the start of every epoch
+		explicit SVRGOptimizer( NetworkType& network, NumericType learningRate = 0.01, std::size_t snapshotInterval = 0 )
+			: BaseOptimizer< NetworkType >( network ), mLearningRate( learningRate ), mSnapshotInterval( snapshotInterval ),
+			  mSnapshotWeights( this -> makeStateBuffer( ) ), mFullGradient( this -> makeStateBuffer( ) ), mBatchGradient( this -> makeStateBuffer( ) ) {
+		}
+		SVRGOptimizer( SVRGOptimizer const& other ) = delete;
+		~SVRGOptimizer() = default;
+
+		//get/set member functions
+		NumericType getLearningRate( ) const { return mLearningRate; }
+		void setLearningRate( NumericType learningRate ) { mLearningRate = learningRate; }
+		std::size_t getSnapshotInterval( ) const { return mSnapshotInterval; }
+		void setSnapshotInterval( std::size_t snapshotInterval ) { mSnapshotInterval = snapshotInterval; }
+
+		// snapshot protocol
+		bool isSnapshotDue( ) const {
+			return !mHasSnapshot || ( mSnapshotInterval > 0 && mStepsSinceSnapshot >= mSnapshotInterval );
+		}
+		void requestSnapshot( ) { mHasSnapshot = false; }
+		// the trainer accumulates the gradient of every training sample in between
+		void beginSnapshot( ) {
+			this -> resetGradients( );
+			this -> viewState( mSnapshotWeights ) = this -> getParameterVec( );
+		}
+		void endSnapshot( std::size_t numSamples ) {
+			NumericType coeff = 1.0 / static_cast< NumericType >( std::max< std::size_t >( numSamples, 1 ) );
+			this -> viewState( mFullGradient ) = coeff * this -> getGradientVec( );
+			this -> resetGradients( );
+			mHasSnapshot = true;
+			mStepsSinceSnapshot = 0;
+		}
+		// the trainer recomputes the batch gradient at the snapshot weights in between
+		void beginSnapshotGradients( ) {
+			this -> viewState( mBatchGradient ) = this -> getGradientVec( );
+			this -> resetGradients( );
+			this -> getParameterVec( ).swap( this -> viewState( mSnapshotWeights ) );
+		}
+		void endSnapshotGradients( ) {
+			this -> getParameterVec( ).swap( this -> viewState( mSnapshotWeights ) );
+		}
+
+		// interface
+		void beginStep( ) override {
+			++mStepsSinceSnapshot;
+		}
+		// the gradient buffer holds the batch gradient at the snapshot weights
+		void applyRangeUpdate( IndexType begin, IndexType size, std::size_t batchSize ) override {
+			auto weightVec = this -> getParameterVec( );
+			auto snapshotGradVec = this -> getGradientVec( );
+			auto batchGradVec = this -> viewState( mBatchGradient );
+			auto fullGradVec = this -> viewState( mFullGradient );
+			NumericType coeff = 1.0 / static_cast< NumericType >( batchSize );
+			this -> forEachChunk( begin, size, [&,this]( IndexType chunkBegin, IndexType chunkSize ) {
+				weightVec.segment( chunkBegin, chunkSize ) -= mLearningRate * ( coeff * ( batchGradVec.segment( chunkBegin, chunkSize ) - snapshotGradVec.segment( chunkBegin, chunkSize ) )
+																				+ fullGradVec.segment( chunkBegin, chunkSize ) );
+			} );
+		}
+
+	private: 	//private member functions
+
+	public: 	//public data members
+
+	private: 	//private data members
+		NumericType mLearningRate;
+		std::size_t mSnapshotInterval;
+		std::size_t mStepsSinceSnapshot = 0;
+		bool mHasSnapshot = false;
+		StateBufferType mSnapshotWeights, mFullGradient, mBatchGradient;
+	}; // end of class SVRGOptimizer
+
+	// parameters covered by the SAGA gradient table
+	enum class GradientTableScope { ALL_LAYERS, LAST_LAYER };
+	// storage of the SAGA gradient table, REDUCED stores single precision
+	enum class GradientTablePrecision { FULL, REDUCED };
+
+	/**
+	 *SAGAOptimizer. Keeps the last gradient phi_i of every training sample and
+	 *their mean, a step uses
+	 *  g = mean_B( grad f_i( w ) - phi_i ) + mean( phi ).
+	 *To keep the table small it may cover the last trainable layer only
+	 *(earlier layers then take plain SGD steps) and may be stored in single
+	 *precision.
+	 */
+	template< typename NetworkType >
+	class SAGAOptimizer
+		: public BaseOptimizer< NetworkType > {
+	public: 	// public typedefs
+		using NumericType = typename NetworkType::NumericType;
+		using VectorXType = typename NetworkType::VectorXType;
+		using MatrixXType = typename NetworkType::MatrixXType;
+		using StateBufferType = typename BaseOptimizer< NetworkType >::StateBufferType;
+		using IndexType = typename BaseOptimizer< NetworkType >::IndexType;
+
+	private: 	// private typedefs
+		using ReducedType = float;
+		using TableRowMapType = Eigen::Map< Eigen::Matrix< NumericType, Eigen::Dynamic, 1 > >;
+		using ReducedTableRowMapType = Eigen::Map< Eigen::Matrix< ReducedType, Eigen::Dynamic, 1 > >;
+
+	public: 	// public static data members
+		static constexpr bool requires_sample_gradients = true;
+
+	public: 	//public member functions
+		SAGAOptimizer() = delete;
+		explicit SAGAOptimizer( NetworkType& network,
+								std::size_t numSamples,
+								NumericType learningRate = 0.01,
+								GradientTableScope tableScope = GradientTableScope::ALL_LAYERS,
+								GradientTablePrecision tablePrecision = GradientTablePrecision::FULL )
+			: BaseOptimizer< NetworkType >( network ), mLearningRate( learningRate ), mNumSamples( numSamples ),
+			  mTableScope( tableScope ), mTablePrecision( tablePrecision ),
+			  mAverageGradient( this -> makeStateBuffer( ) ), mCorrectionSum( this -> makeStateBuffer( ) ) {
+			if ( mTableScope == GradientTableScope::LAST_LAYER && this -> getNumTrainableLayers( ) > 0 ) {
+				auto const& range = this -> getNetwork( ).getParameterRanges( ).back( );
+				mTableBegin = static_cast< IndexType >( range.offset );
+				mTableSize = static_cast< IndexType >( range.size );
+			}
+			else {
+				mTableBegin = 0;
+				mTableSize = static_cast< IndexType >( this -> getNumParameters( ) );
+			}
+			std::size_t tableEntries = mNumSamples * static_cast< std::size_t >( mTableSize );
+			if ( mTablePrecision == GradientTablePrecision::REDUCED ) {
+				mReducedTable = Utils::AlignedBuffer< ReducedType >( tableEntries );
+				mTableChangeSum = this -> makeStateBuffer( );
+			}
+			else
+				mTable = StateBufferType( tableEntries );
+		}
+		SAGAOptimizer( SAGAOptimizer const& other ) = delete;
+		~SAGAOptimizer() = default;
+
+		//get/set member functions
+		NumericType getLearningRate( ) const { return mLearningRate; }
+		void setLearningRate( NumericType learningRate ) { mLearningRate = learningRate; }
+		std::size_t getNumSamples( ) const { return mNumSamples; }
+		GradientTableScope getTableScope( ) const { return mTableScope; }
+		GradientTablePrecision getTablePrecision( ) const { return mTablePrecision; }
+		// bytes used by the gradient table
+		std::size_t getTableBytes( ) const {
+			return mTable.size( ) * sizeof( NumericType ) + mReducedTable.size( ) * sizeof( ReducedType );
+		}
+		// the mean of the table rows, laid out like the flat parameter buffer
+		StateBufferType& getAverageGradient( ) { return mAverageGradient; }
+		// the stored gradient of a sample, the table range of the parameters
+		VectorXType getTableRow( std::size_t sampleIndex ) const {
+			std::size_t rowOffset = sampleIndex * static_cast< std::size_t >( mTableSize );
+			if ( mTablePrecision == GradientTablePrecision::REDUCED )
+				return Eigen::Map< Eigen::Matrix< ReducedType, Eigen::Dynamic, 1 > const >( mReducedTable.data( ) + rowOffset, mTableSize ).template cast< NumericType >( );
+			return Eigen::Map< VectorXType const >( mTable.data( ) + rowOffset, mTableSize );
+		}
+		IndexType getTableBegin( ) const { return mTableBegin; }
+		IndexType getTableSize( ) const { return mTableSize; }
+
+		// Consumes the gradient of a single training sample: the table range of the
+		// gradient buffer is moved into the table and reset, the rest keeps accumulating.
+		void accumulateSampleGradient( std::size_t sampleIndex ) {
+			if ( sampleIndex >= mNumSamples )
+				throw std::runtime_error( "Sample index exceeds the size of the SAGA gradient table." );
+			auto gradVec = this -> getGradientVec( ).segment( mTableBegin, mTableSize );
+			auto correctionVec = this -> viewState( mCorrectionSum ).segment( mTableBegin, mTableSize );
+			std::size_t rowOffset = sampleIndex * static_cast< std::size_t >( mTableSize );
+			if ( mTablePrecision == GradientTablePrecision::REDUCED ) {
+				// the step corrects with the full precision gradient, the mean moves by
+				// the change of the stored (rounded) row so that it stays the mean of the table
+				ReducedTableRowMapType row( mReducedTable.data( ) + rowOffset, mTableSize );
+				auto changeVec = this -> viewState( mTableChangeSum ).segment( mTableBegin, mTableSize );
+				correctionVec += gradVec - row.template cast< NumericType >( );
+				changeVec -= row.template cast< NumericType >( );
+				row = gradVec.template cast< ReducedType >( );
+				changeVec += row.template cast< NumericType >( );
+			}
+			else {
+				TableRowMapType row( mTable.data( ) + rowOffset, mTableSize );
+				correctionVec += gradVec - row;
+				row = gradVec;
+			}
+			gradVec.setZero( );
+		}
+
+		// interface
+		void applyRangeUpdate( IndexType begin, IndexType size, std::size_t batchSize ) override {
+			// the part of the range covered by the table takes variance reduced steps
+			IndexType tableBegin = std::clamp( mTableBegin, begin, begin + size );
+			IndexType tableEnd = std::clamp( mTableBegin + mTableSize, begin, begin + size );
+			applySGDUpdate( begin, tableBegin - begin, batchSize );
+			applySAGAUpdate( tableBegin, tableEnd - tableBegin, batchSize );
+			applySGDUpdate( tableEnd, begin + size - tableEnd, batchSize );
+		}
+
+	private: 	//private member functions
+		void applySAGAUpdate( IndexType begin, IndexType size, std::size_t batchSize ) {
+			auto weightVec = this -> getParameterVec( );
+			auto averageVec = this -> viewState( mAverageGradient );
+			auto correctionVec = this -> viewState( mCorrectionSum );
+			auto changeVec = this -> viewState( mTableChangeSum );
+			bool reduced = mTablePrecision == GradientTablePrecision::REDUCED;
+			NumericType coeff = 1.0 / static_cast< NumericType >( batchSize );
+			NumericType tableCoeff = 1.0 / static_cast< NumericType >( mNumSamples );
+			this -> forEachChunk( begin, size, [&,this]( IndexType chunkBegin, IndexType chunkSize ) {
+				auto average = averageVec.segment( chunkBegin, chunkSize );
+				auto correction = correctionVec.segment( chunkBegin, chunkSize );
+				weightVec.segment( chunkBegin, chunkSize ) -= mLearningRate * ( coeff * correction + average );
+				if ( reduced ) {
+					auto change = changeVec.segment( chunkBegin, chunkSize );
+					average += tableCoeff * change;
+					change.setZero( );
+				}
+				else {
+					average += tableCoeff * correction;
+				}
+				correction.setZero( );
+			} );
+		}
+		void applySGDUpdate( IndexType begin, IndexType size, std::size_t batchSize ) {
+			if ( size <= 0 )
+				return;
+			NumericType coeff = 1.0 / static_cast< NumericType >( batchSize );
+			this -> getParameterVec( ).segment( begin, size ) -= mLearningRate * coeff * this -> getGradientVec( ).segment( begin, size );
+		}
+
+	public: 	//public data members
+
+	private: 	//private data members
+		NumericType mLearningRate;
+		std::size_t mNumSamples;
+		GradientTableScope mTableScope;
+		GradientTablePrecision mTablePrecision;
+		IndexType mTableBegin = 0, mTableSize = 0;
+		StateBufferType mAverageGradient, mCorrectionSum;
+		// the summed change of the stored rows since the last step (REDUCED tables only)
+		StateBufferType mTableChangeSum;
+		StateBufferType mTable;
+		Utils::AlignedBuffer< ReducedType > mReducedTable;
+	}; // end of class SAGAOptimizer
+
+} // end NNet
+
+#endif // VARIANCE_REDUCED_OPTIMIZERS_HPP
@@ -0,0 +1,220 @@
+#ifndef SAMPLERS_HPP
+#define SAMPLERS_HPP
+
+// System includes --------------------
+#include <algorithm>
+#include <cstddef>
+#include <random>
+#include <vector>
+
+namespace NNet { // begin NNet
+
+	/**
+	 *BaseSampler. Chooses the training samples visited in an epoch and the
+	 *weight of their gradients. It keeps the last loss of every sample,
+	 *recorded by the network trainer from the forward passes of training.
+	 *With a loss threshold set, samples whose last loss is below it are
+	 *left out of the epochs (hard example mining), for at most revisitEpochs
+	 *epochs after their last visit so that their loss is refreshed.
+	 */
+	template< typename NumericType >
+	class BaseSampler {
+	public: 	// public typedefs
+		using RandomEngineType = std::mt19937;
+
+	private: 	// private typedefs
+
+	public: 	//public member functions
+		BaseSampler( ) = default;
+		BaseSampler( BaseSampler const& other ) = default;
+		virtual ~BaseSampler( ) = default;
+
+		// get/set member functions
+		NumericType getLossThreshold( ) const { return mLossThreshold; }
+		std::size_t getRevisitEpochs( ) const { return mRevisitEpochs; }
+		void setLossThreshold( NumericType lossThreshold, std::size_t revisitEpochs = 5 ) {
+			mLossThreshold = lossThreshold;
+			mRevisitEpochs = revisitEpochs;
+		}
+		std::size_t getNumSamples( ) const { return mLosses.size( ); }
+		// number of epochs drawn so far
+		std::size_t getEpoch( ) const { return mEpoch; }
+		bool isSeen( std::size_t sample ) const { return mSeen[sample] != 0; }
+		NumericType getLoss( std::size_t sample ) const { return mLosses[sample]; }
+		// samples of the last epoch drawn, indices into the training data
+		std::vector< std::size_t > const& getOrder( ) const { return mOrder; }
+
+		// Draws the samples of the next epoch over numSamples training samples, the loss
+		// table is reset when the number of samples changes.
+		std::vector< std::size_t > const& sampleEpoch( std::size_t numSamples, RandomEngineType& g ) {
+			if ( numSamples != mLosses.size( ) ) {
+				mLosses.assign( numSamples, 0.0 );
+				mSeen.assign( numSamples, 0 );
+				mLastVisit.assign( numSamples, 0 );
+			}
+			drawEpoch( mOrder, g );
+			++mEpoch;
+			return mOrder;
+		}
+
+		// records the loss of a sample of the current epoch
+		void recordLoss( std::size_t sample, NumericType loss ) {
+			if ( sample >= mLosses.size( ) )
+				return;
+			mLosses[sample] = loss;
+			mSeen[sample] = 1;
+			mLastVisit[sample] = mEpoch;
+		}
+
+		// the gradient (and loss) of a sample is multiplied by its weight
+		virtual NumericType getSampleWeight( std::size_t /* sample */ ) const { return 1.0; }
+
+	protected: 	//protected member functions
+		// fills order with the samples of the next epoch
+		virtual void drawEpoch( std::vector< std::size_t >& order, RandomEngineType& g ) = 0;
+
+		// false for samples left out by the loss threshold
+		bool isActive( std::size_t sample ) const {
+			if ( !( mLossThreshold > 0.0 ) || !mSeen[sample] || mLosses[sample] >= mLossThreshold )
+				return true;
+			return mEpoch - mLastVisit[sample] >= mRevisitEpochs;
+		}
+
+	private: 	//private member functions
+
+	public: 	//public data members
+
+	private: 	//private data members
+		NumericType mLossThreshold = 0.0;
+		std::size_t mRevisitEpochs = 5;
+		std::vector< NumericType > mLosses;
+		std::vector< char > mSeen;
+		std::vector< std::size_t > mLastVisit;
+		std::vector< std::size_t > mOrder;
+		std::size_t mEpoch = 0;
+	}; // end of class BaseSampler
+
+	/**
+	 *UniformSampler. Visits every (active) sample once per epoch in a
+	 *shuffled order.
+	 */
+	template< typename NumericType >
+	class UniformSampler
+		: public BaseSampler< NumericType > {
+	public: 	// public typedefs
+		using RandomEngineType = typename BaseSampler< NumericType >::RandomEngineType;
+
+	private: 	// private typedefs
+
+	public: 	//public member functions
+		UniformSampler( ) = default;
+		~UniformSampler( ) = default;
+
+	protected: 	//protected member functions
+		void drawEpoch( std::vector< std::size_t >& order, RandomEngineType& g ) override {
+			order.clear( );
+			for ( std::size_t sample = 0; sample < this -> getNumSamples( ); ++sample ) {
+				if ( this -> isActive( sample ) )
+					order.push_back( sample );
+			}
+			std::shuffle( order.begin( ), order.end( ), g );
+		}
+
+	private: 	//private member functions
+
+	public: 	//public data members
+
+	private: 	//private data members
+
+	}; // end of class UniformSampler
+
+	/**
+	 *ImportanceSampler. Draws as many samples as there are active ones, with
+	 *replacement, with probabilities proportional to their last loss mixed
+	 *with the uniform distribution,
+	 *  p_i = ( 1 - uniformMix ) loss_i / sum_j loss_j + uniformMix / M,
+	 *and weights their gradients by 1 / ( M p_i ) so that the weighted batch
+	 *gradient stays an unbiased estimate of the mean gradient over the M
+	 *active samples. The uniform part bounds the weights by 1 / uniformMix.
+	 *Samples without a recorded loss count with the largest recorded loss.
+	 */
+	template< typename NumericType >
+	class ImportanceSampler
+		: public BaseSampler< NumericType > {
+	public: 	// public typedefs
+		using RandomEngineType = typename BaseSampler< NumericType >::RandomEngineType;
+
+	private: 	// private typedefs
+
+	public: 	//public member functions
+		ImportanceSampler( ) = default;
+		explicit ImportanceSampler( NumericType uniformMix )
+			: mUniformMix( std::clamp< NumericType >( uniformMix, 0.0, 1.0 ) ) {
+		}
+		~ImportanceSampler( ) = default;
+
+		// get/set member functions
+		NumericType getUniformMix( ) const { return mUniformMix; }
+		void setUniformMix( NumericType uniformMix ) { mUniformMix = std::clamp< NumericType >( uniformMix, 0.0, 1.0 ); }
+		// probability of a sample in every draw of the last epoch
+		NumericType getProbability( std::size_t sample ) const { return mProbabilities[sample]; }
+
+		NumericType getSampleWeight( std::size_t sample ) const override {
+			return sample < mWeights.size( ) ? mWeights[sample] : 1.0;
+		}
+
+	protected: 	//protected member functions
+		void drawEpoch( std::vector< std::size_t >& order, RandomEngineType& g ) override {
+			std::size_t numSamples = this -> getNumSamples( );
+			mProbabilities.assign( numSamples, 0.0 );
+			mWeights.assign( numSamples, 1.0 );
+			mCumulative.resize( numSamples );
+			NumericType unseenLoss = 0.0;
+			for ( std::size_t sample = 0; sample < numSamples; ++sample ) {
+				if ( this -> isSeen( sample ) )
+					unseenLoss = std::max( unseenLoss, this -> getLoss( sample ) );
+			}
+			std::size_t numActive = 0;
+			NumericType lossSum = 0.0;
+			for ( std::size_t sample = 0; sample < numSamples; ++sample ) {
+				if ( this -> isActive( sample ) ) {
+					mProbabilities[sample] = this -> isSeen( sample ) ? std::max< NumericType >( this -> getLoss( sample ), 0.0 ) : unseenLoss;
+					lossSum += mProbabilities[sample];
+					++numActive;
+				}
+			}
+			order.clear( );
+			if ( numActive == 0 )
+				return;
+			// without any loss the draws are uniform
+			NumericType lossCoeff = lossSum > 0.0 ? ( 1.0 - mUniformMix ) / lossSum : 0.0;
+			NumericType uniformPart = lossSum > 0.0 ? mUniformMix / static_cast< NumericType >( numActive ) : 1.0 / static_cast< NumericType >( numActive );
+			NumericType total = 0.0;
+			for ( std::size_t sample = 0; sample < numSamples; ++sample ) {
+				if ( this -> isActive( sample ) ) {
+					mProbabilities[sample] = lossCoeff * mProbabilities[sample] + uniformPart;
+					if ( mProbabilities[sample] > 0.0 )
+						mWeights[sample] = 1.0 / ( static_cast< NumericType >( numActive ) * mProbabilities[sample] );
+				}
+				total += mProbabilities[sample];
+				mCumulative[sample] = total;
+			}
+			std::uniform_real_distribution< NumericType > uniform( 0.0, total );
+			for ( std::size_t draw = 0; draw < numActive; ++draw ) {
+				auto iter = std::upper_bound( mCumulative.begin( ), mCumulative.end( ), uniform( g ) );
+				order.push_back( std::min< std::size_t >( static_cast< std::size_t >( iter - mCumulative.begin( ) ), numSamples - 1 ) );
+			}
+		}
+
+	private: 	//private member functions
+
+	public: 	//public data members
+
+	private: 	//private data members
+		NumericType mUniformMix = 0.1;
+		std::vector< NumericType > mProbabilities, mWeights, mCumulative;
+	}; // end of class ImportanceSampler
+
+} // end NNet
+
+#endif // SAMPLERS_HPP
@@ -0,0 +1,101 @@
+#ifndef EARLY_STOPPING_HPP
+#define EARLY_STOPPING_HPP
+
+// System includes --------------------
+#include <algorithm>
+#include <limits>
+
+// Own includes --------------------
+#include "utils/aligned-buffer.hpp"
+
+namespace NNet { // begin NNet
+
+	/**
+	 *EarlyStopping. Tracks the monitored (validation) loss after every epoch
+	 *and asks for training to stop once it has not improved by more than
+	 *minDelta for patience epochs. With restoreBestWeights the parameters of
+	 *the best epoch are kept and restored when training stops.
+	 */
+	template< typename NumericType >
+	class EarlyStopping {
+	public: 	// public typedefs
+		using ParameterBufferType = Utils::AlignedBuffer< NumericType >;
+
+	private: 	// private typedefs
+
+	public: 	//public member functions
+		EarlyStopping( ) = delete;
+		explicit EarlyStopping( std::size_t patience, NumericType minDelta = 0.0, bool restoreBestWeights = true )
+			: mPatience( patience ), mMinDelta( minDelta ), mRestoreBestWeights( restoreBestWeights ) {
+		}
+		EarlyStopping( EarlyStopping const& other ) = default;
+		~EarlyStopping( ) = default;
+
+		// get/set member functions
+		std::size_t getPatience( ) const { return mPatience; }
+		void setPatience( std::size_t patience ) { mPatience = patience; }
+		NumericType getMinDelta( ) const { return mMinDelta; }
+		void setMinDelta( NumericType minDelta ) { mMinDelta = minDelta; }
+		bool getRestoreBestWeights( ) const { return mRestoreBestWeights; }
+		NumericType getBestLoss( ) const { return mBestLoss; }
+		// epochs are counted from zero
+		std::size_t getBestEpoch( ) const { return mBestEpoch; }
+		bool shouldStop( ) const { return mBadEpochs >= mPatience && mNumEpochs > 0; }
+
+		// records an epoch's monitored loss, parameterVec is the network's flat parameter
+		// buffer (copied when it is the best so far)
+		template< typename ParameterVecType >
+		bool update( NumericType monitoredLoss, ParameterVecType const& parameterVec ) {
+			bool improved = monitoredLoss < mBestLoss - mMinDelta;
+			if ( improved ) {
+				mBestLoss = monitoredLoss;
+				mBestEpoch = mNumEpochs;
+				mBadEpochs = 0;
+				if ( mRestoreBestWeights ) {
+					if ( mBestWeights.size( ) != static_cast< std::size_t >( parameterVec.size( ) ) )
+						mBestWeights = ParameterBufferType( parameterVec.size( ) );
+					std::copy( parameterVec.data( ), parameterVec.data( ) + parameterVec.size( ), mBestWeights.data( ) );
+				}
+			}
+			else {
+				++mBadEpochs;
+			}
+			++mNumEpochs;
+			return improved;
+		}
+
+		// writes the best parameters back, returns false when there are none
+		template< typename ParameterVecType >
+		bool restoreBestWeights( ParameterVecType&& parameterVec ) const {
+			if ( mBestWeights.empty( ) || mBestWeights.size( ) != static_cast< std::size_t >( parameterVec.size( ) ) )
+				return false;
+			std::copy( mBestWeights.data( ), mBestWeights.data( ) + mBestWeights.size( ), parameterVec.data( ) );
+			return true;
+		}
+
+		void reset( ) {
+			mBestLoss = std::numeric_limits< NumericType >::infinity( );
+			mBestEpoch = 0;
+			mBadEpochs = 0;
+			mNumEpochs = 0;
+			mBestWeights = ParameterBufferType( );
+		}
+
+	private: 	//private member functions
+
+	public: 	//public data members
+
+	private: 	//private data members
+		std::size_t mPatience;
+		NumericType mMinDelta;
+		bool mRestoreBestWeights;
+		NumericType mBestLoss = std::numeric_limits< NumericType >::infinity( );
+		std::size_t mBestEpoch = 0;
+		std::size_t mBadEpochs = 0;
+		std::size_t mNumEpochs = 0;
+		ParameterBufferType mBestWeights;
+	}; // end of class EarlyStopping
+
+} // end NNet
+
+#endif // EARLY_STOPPING_HPP
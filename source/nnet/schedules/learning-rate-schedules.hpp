@@ -0,0 +1,262 @@
+#ifndef LEARNING_RATE_SCHEDULES_HPP
+#define LEARNING_RATE_SCHEDULES_HPP
+
+// System includes --------------------
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace NNet { // begin NNet
+
+	/**
+	 *BaseLearningRateSchedule. A schedule is advanced by the network trainer,
+	 *step( ) after every optimizer step and endEpoch( loss ) after every epoch
+	 *with the monitored (validation or training) loss. The trainer sets the
+	 *optimizer's learning rate to getLearningRate( ) before every step.
+	 */
+	template< typename NumericType >
+	class BaseLearningRateSchedule {
+	public: 	// public typedefs
+
+	private: 	// private typedefs
+
+	public: 	//public member functions
+		BaseLearningRateSchedule( ) = default;
+		explicit BaseLearningRateSchedule( NumericType learningRate )
+			: mBaseLearningRate( learningRate ) {
+		}
+		BaseLearningRateSchedule( BaseLearningRateSchedule const& other ) = default;
+		virtual ~BaseLearningRateSchedule( ) = default;
+
+		// get/set member functions
+		NumericType getBaseLearningRate( ) const { return mBaseLearningRate; }
+		std::size_t getStep( ) const { return mStep; }
+		std::size_t getEpoch( ) const { return mEpoch; }
+
+		// interface
+		virtual NumericType getLearningRate( ) const = 0;
+		virtual void step( ) { ++mStep; }
+		virtual void endEpoch( NumericType /* monitoredLoss */ ) { ++mEpoch; }
+
+	private: 	//private member functions
+
+	public: 	//public data members
+
+	private: 	//private data members
+		NumericType mBaseLearningRate = 0.01;
+		std::size_t mStep = 0;
+		std::size_t mEpoch = 0;
+	}; // end of class BaseLearningRateSchedule
+
+	/**
+	 *StepSchedule. Multiplies the learning rate by gamma every stepEpochs epochs.
+	 */
+	template< typename NumericType >
+	class StepSchedule
+		: public BaseLearningRateSchedule< NumericType > {
+	public: 	// public typedefs
+
+	private: 	// private typedefs
+
+	public: 	//public member functions
+		StepSchedule( ) = delete;
+		explicit StepSchedule( NumericType learningRate, std::size_t stepEpochs, NumericType gamma = 0.1 )
+			: BaseLearningRateSchedule< NumericType >( learningRate ), mStepEpochs( std::max< std::size_t >( stepEpochs, 1 ) ), mGamma( gamma ) {
+		}
+		~StepSchedule( ) = default;
+
+		NumericType getLearningRate( ) const override {
+			return this -> getBaseLearningRate( ) * std::pow( mGamma, static_cast< NumericType >( this -> getEpoch( ) / mStepEpochs ) );
+		}
+
+	private: 	//private member functions
+
+	public: 	//public data members
+
+	private: 	//private data members
+		std::size_t mStepEpochs;
+		NumericType mGamma;
+	}; // end of class StepSchedule
+
+	/**
+	 *CosineSchedule. Anneals the learning rate from its base value to
+	 *minLearningRate over totalSteps optimizer steps along half a cosine.
+	 */
+	template< typename NumericType >
+	class CosineSchedule
+		: public BaseLearningRateSchedule< NumericType > {
+	public: 	// public typedefs
+
+	private: 	// private typedefs
+
+	public: 	//public member functions
+		CosineSchedule( ) = delete;
+		explicit CosineSchedule( NumericType learningRate, std::size_t totalSteps, NumericType minLearningRate = 0.0 )
+			: BaseLearningRateSchedule< NumericType >( learningRate ), mTotalSteps( std::max< std::size_t >( totalSteps, 1 ) ), mMinLearningRate( minLearningRate ) {
+		}
+		~CosineSchedule( ) = default;
+
+		NumericType getLearningRate( ) const override {
+			NumericType progress = std::min< NumericType >( 1.0, static_cast< NumericType >( this -> getStep( ) ) / static_cast< NumericType >( mTotalSteps ) );
+			return mMinLearningRate + 0.5 * ( this -> getBaseLearningRate( ) - mMinLearningRate ) * ( 1.0 + std::cos( pi * progress ) );
+		}
+
+	private: 	//private member functions
+
+	public: 	//public data members
+
+	private: 	//private data members
+		static constexpr NumericType pi = 3.14159265358979323846;
+		std::size_t mTotalSteps;
+		NumericType mMinLearningRate;
+	}; // end of class CosineSchedule
+
+	/**
+	 *WarmupSchedule. Ramps the learning rate linearly from zero to the wrapped
+	 *schedule's value over warmupSteps optimizer steps, then follows the
+	 *wrapped schedule (which only starts counting steps after the warmup).
+	 */
+	template< typename NumericType >
+	class WarmupSchedule
+		: public BaseLearningRateSchedule< NumericType > {
+	public: 	// public typedefs
+		using SchedulePtrType = std::shared_ptr< BaseLearningRateSchedule< NumericType > >;
+
+	private: 	// private typedefs
+
+	public: 	//public member functions
+		WarmupSchedule( ) = delete;
+		explicit WarmupSchedule( SchedulePtrType schedule, std::size_t warmupSteps )
+			: BaseLearningRateSchedule< NumericType >( schedule -> getBaseLearningRate( ) ), mSchedule( std::move( schedule ) ), mWarmupSteps( warmupSteps ) {
+		}
+		~WarmupSchedule( ) = default;
+
+		NumericType getLearningRate( ) const override {
+			if ( this -> getStep( ) < mWarmupSteps )
+				return mSchedule -> getLearningRate( ) * static_cast< NumericType >( this -> getStep( ) + 1 ) / static_cast< NumericType >( mWarmupSteps );
+			return mSchedule -> getLearningRate( );
+		}
+		void step( ) override {
+			if ( this -> getStep( ) >= mWarmupSteps )
+				mSchedule -> step( );
+			BaseLearningRateSchedule< NumericType >::step( );
+		}
+		void endEpoch( NumericType monitoredLoss ) override {
+			mSchedule -> endEpoch( monitoredLoss );
+			BaseLearningRateSchedule< NumericType >::endEpoch( monitoredLoss );
+		}
+
+	private: 	//private member functions
+
+	public: 	//public data members
+
+	private: 	//private data members
+		SchedulePtrType mSchedule;
+		std::size_t mWarmupSteps;
+	}; // end of class WarmupSchedule
+
+	/**
+	 *OneCycleSchedule. Rises from maxLearningRate / divFactor to
+	 *maxLearningRate over the first warmupFraction of totalSteps, then anneals
+	 *to maxLearningRate / finalDivFactor, both phases along half a cosine.
+	 */
+	template< typename NumericType >
+	class OneCycleSchedule
+		: public BaseLearningRateSchedule< NumericType > {
+	public: 	// public typedefs
+
+	private: 	// private typedefs
+
+	public: 	//public member functions
+		OneCycleSchedule( ) = delete;
+		explicit OneCycleSchedule( NumericType maxLearningRate, std::size_t totalSteps, NumericType warmupFraction = 0.3,
+								   NumericType divFactor = 25.0, NumericType finalDivFactor = 1.0e4 )
+			: BaseLearningRateSchedule< NumericType >( maxLearningRate ), mTotalSteps( std::max< std::size_t >( totalSteps, 1 ) ),
+			  mWarmupSteps( static_cast< std::size_t >( warmupFraction * static_cast< NumericType >( mTotalSteps ) ) ),
+			  mInitialLearningRate( maxLearningRate / divFactor ), mFinalLearningRate( maxLearningRate / finalDivFactor ) {
+		}
+		~OneCycleSchedule( ) = default;
+
+		NumericType getLearningRate( ) const override {
+			auto step = std::min( this -> getStep( ), mTotalSteps );
+			if ( step < mWarmupSteps )
+				return anneal( mInitialLearningRate, this -> getBaseLearningRate( ), static_cast< NumericType >( step ) / static_cast< NumericType >( mWarmupSteps ) );
+			auto annealSteps = std::max< std::size_t >( mTotalSteps - mWarmupSteps, 1 );
+			return anneal( this -> getBaseLearningRate( ), mFinalLearningRate, static_cast< NumericType >( step - mWarmupSteps ) / static_cast< NumericType >( annealSteps ) );
+		}
+
+	private: 	//private member functions
+		static NumericType anneal( NumericType from, NumericType to, NumericType progress ) {
+			return to + 0.5 * ( from - to ) * ( 1.0 + std::cos( pi * progress ) );
+		}
+
+	public: 	//public data members
+
+	private: 	//private data members
+		static constexpr NumericType pi = 3.14159265358979323846;
+		std::size_t mTotalSteps;
+		std::size_t mWarmupSteps;
+		NumericType mInitialLearningRate, mFinalLearningRate;
+	}; // end of class OneCycleSchedule
+
+	/**
+	 *ReduceOnPlateauSchedule. Multiplies the learning rate by factor when the
+	 *monitored loss has not improved by more than a relative threshold for
+	 *patience epochs, never going below minLearningRate.
+	 */
+	template< typename NumericType >
+	class ReduceOnPlateauSchedule
+		: public BaseLearningRateSchedule< NumericType > {
+	public: 	// public typedefs
+
+	private: 	// private typedefs
+
+	public: 	//public member functions
+		ReduceOnPlateauSchedule( ) = delete;
+		explicit ReduceOnPlateauSchedule( NumericType learningRate, NumericType factor = 0.1, std::size_t patience = 10,
+										  NumericType threshold = 1.0e-4, NumericType minLearningRate = 0.0 )
+			: BaseLearningRateSchedule< NumericType >( learningRate ), mFactor( factor ), mPatience( patience ),
+			  mThreshold( threshold ), mMinLearningRate( minLearningRate ), mLearningRate( learningRate ) {
+		}
+		~ReduceOnPlateauSchedule( ) = default;
+
+		NumericType getLearningRate( ) const override { return mLearningRate; }
+		void endEpoch( NumericType monitoredLoss ) override {
+			if ( monitoredLoss < mBestLoss * ( 1.0 - mThreshold ) ) {
+				mBestLoss = monitoredLoss;
+				mBadEpochs = 0;
+			}
+			else if ( ++mBadEpochs > mPatience ) {
+				mLearningRate = std::max( mLearningRate * mFactor, mMinLearningRate );
+				mBadEpochs = 0;
+			}
+			BaseLearningRateSchedule< NumericType >::endEpoch( monitoredLoss );
+		}
+
+	private: 	//private member functions
+
+	public: 	//public data members
+
+	private: 	//private data members
+		NumericType mFactor;
+		std::size_t mPatience;
+		NumericType mThreshold;
+		NumericType mMinLearningRate;
+		NumericType mLearningRate;
+		NumericType mBestLoss = std::numeric_limits< NumericType >::infinity( );
+		std::size_t mBadEpochs = 0;
+	}; // end of class ReduceOnPlateauSchedule
+
+	// true for optimizers with a setLearningRate( ) the schedules can drive
+	template< typename OptimizerType, typename = void >
+	struct has_learning_rate : std::false_type { };
+	template< typename OptimizerType >
+	struct has_learning_rate< OptimizerType, std::void_t< decltype( std::declval< OptimizerType& >( ).setLearningRate( 0.0 ) ) > > : std::true_type { };
+
+} // end NNet
+
+#endif // LEARNING_RATE_SCHEDULES_HPP
@@ -0,0 +1,129 @@
+#ifndef ALIGNED_BUFFER_HPP
+#define ALIGNED_BUFFER_HPP
+
+// System includes --------------------
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+// Boost includes --------------------
+#include <boost/serialization/array.hpp>
+#include <boost/serialization/split_free.hpp>
+
+namespace NNet::Utils { // begin NNet::Utils
+
+	constexpr std::size_t cache_line_size = 64;
+
+	/**
+	 *AlignedBuffer is a zero initialized, cache line aligned array of a
+	 *trivially copyable type. Copies are deep copies.
+	 */
+	template< typename ValueType >
+	class AlignedBuffer {
+		static_assert( std::is_trivially_copyable_v< ValueType >, "AlignedBuffer requires a trivially copyable type" );
+	public: 	// public typedefs
+
+	private: 	// private typedefs
+		struct FreeDeleter {
+			void operator( )( ValueType* ptr ) const { std::free( ptr ); }
+		};
+		using StoragePtrType = std::unique_ptr< ValueType[], FreeDeleter >;
+
+	public: 	//public member functions
+		AlignedBuffer( ) = default;
+		explicit AlignedBuffer( std::size_t size )
+			: mData( allocate( size ) ), mSize( size ) {
+			if ( mSize > 0 )
+				std::memset( mData.get( ), 0, mSize * sizeof( ValueType ) );
+		}
+		AlignedBuffer( AlignedBuffer const& other )
+			: mData( allocate( other.size( ) ) ), mSize( other.size( ) ) {
+			if ( mSize > 0 )
+				std::memcpy( mData.get( ), other.data( ), mSize * sizeof( ValueType ) );
+		}
+		AlignedBuffer( AlignedBuffer&& other ) = default;
+		AlignedBuffer& operator=( AlignedBuffer const& rhs ) {
+			if ( this != &rhs ) {
+				if ( mSize != rhs.size( ) ) {
+					mData = allocate( rhs.size( ) );
+					mSize = rhs.size( );
+				}
+				if ( mSize > 0 )
+					std::memcpy( mData.get( ), rhs.data( ), mSize * sizeof( ValueType ) );
+			}
+			return *this;
+		}
+		AlignedBuffer& operator=( AlignedBuffer&& rhs ) = default;
+		~AlignedBuffer( ) = default;
+
+		// get/set member functions
+		ValueType* data( ) { return mData.get( ); }
+		ValueType const* data( ) const { return mData.get( ); }
+		std::size_t size( ) const { return mSize; }
+		bool empty( ) const { return mSize == 0; }
+		ValueType& operator[]( std::size_t i ) { return mData[i]; }
+		ValueType const& operator[]( std::size_t i ) const { return mData[i]; }
+
+		void setZero( ) {
+			if ( mSize > 0 )
+				std::memset( mData.get( ), 0, mSize * sizeof( ValueType ) );
+		}
+
+		/// Number of elements rounded up to a whole number of cache lines
+		static constexpr std::size_t paddedSize( std::size_t size ) {
+			constexpr std::size_t lineElements = ( cache_line_size >= sizeof( ValueType ) ) ? cache_line_size / sizeof( ValueType ) : 1;
+			return ( ( size + lineElements - 1 ) / lineElements ) * lineElements;
+		}
+
+	private: 	//private member functions
+		static StoragePtrType allocate( std::size_t size ) {
+			if ( size == 0 )
+				return nullptr;
+			std::size_t numBytes = paddedSize( size ) * sizeof( ValueType );
+			numBytes = ( ( numBytes + cache_line_size - 1 ) / cache_line_size ) * cache_line_size;
+			void* ptr = std::aligned_alloc( cache_line_size, numBytes );
+			if ( !ptr )
+				throw std::bad_alloc( );
+			return StoragePtrType( static_cast< ValueType* >( ptr ) );
+		}
+
+	public: 	//public data members
+
+	private: 	//private data members
+		StoragePtrType mData = nullptr;
+		std::size_t mSize = 0;
+	}; // end of class AlignedBuffer
+
+} // end NNet::Utils
+
+namespace boost::serialization { // begin boost::serialization
+
+	template< typename ArchiveType, typename ValueType >
+	inline void save( ArchiveType& ar, NNet::Utils::AlignedBuffer< ValueType > const& buffer, unsigned const /* version */ ) {
+		std::size_t size = buffer.size( );
+		ar << size;
+		if ( size > 0 )
+			ar << make_array( buffer.data( ), size );
+	}
+
+	template< typename ArchiveType, typename ValueType >
+	inline void load( ArchiveType& ar, NNet::Utils::AlignedBuffer< ValueType >& buffer, unsigned const /* version */ ) {
+		std::size_t size;
+		ar >> size;
+		if ( size != buffer.size( ) )
+			buffer = NNet::Utils::AlignedBuffer< ValueType >( size );
+		if ( size > 0 )
+			ar >> make_array( buffer.data( ), size );
+	}
+
+	template< typename ArchiveType, typename ValueType >
+	inline void serialize( ArchiveType& ar, NNet::Utils::AlignedBuffer< ValueType >& buffer, unsigned const version ) {
+		split_free( ar, buffer, version );
+	}
+
+} // end boost::serialization
+
+#endif // ALIGNED_BUFFER_HPP
@@ -0,0 +1,85 @@
+// System includes --------------------
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+
+// Own includes --------------------
+#include "allocation-counter.hpp"
+
+#if defined( NNET_COUNT_ALLOCATIONS ) && defined( __GLIBC__ )
+#define NNET_ALLOCATION_COUNTER_ACTIVE 1
+#else
+#define NNET_ALLOCATION_COUNTER_ACTIVE 0
+#endif
+
+namespace NNet::Utils { // begin NNet::Utils
+
+	// constant initialized, so safe to use from allocations made before main
+	static std::atomic< std::size_t > allocation_count{ 0 };
+	static std::atomic< std::size_t > allocation_bytes{ 0 };
+
+	static inline void recordAllocation( std::size_t numBytes ) {
+		allocation_count.fetch_add( 1, std::memory_order_relaxed );
+		allocation_bytes.fetch_add( numBytes, std::memory_order_relaxed );
+	}
+
+	bool AllocationCounter::isEnabled( ) {
+		return NNET_ALLOCATION_COUNTER_ACTIVE;
+	}
+
+	AllocationStats AllocationCounter::getTotalStats( ) {
+		return { allocation_count.load( std::memory_order_relaxed ),
+				 allocation_bytes.load( std::memory_order_relaxed ) };
+	}
+
+} // end NNet::Utils
+
+#if NNET_ALLOCATION_COUNTER_ACTIVE
+// Interpose the malloc family so that operator new, Eigen's aligned_malloc and
+// plain C allocations are all counted. The real work is forwarded to glibc.
+extern "C" {
+	void* __libc_malloc( std::size_t size );
+	void* __libc_calloc( std::size_t num, std::size_t size );
+	void* __libc_realloc( void* ptr, std::size_t size );
+	void* __libc_memalign( std::size_t alignment, std::size_t size );
+	void __libc_free( void* ptr );
+
+	void* malloc( std::size_t size ) noexcept {
+		NNet::Utils::recordAllocation( size );
+		return __libc_malloc( size );
+	}
+
+	void* calloc( std::size_t num, std::size_t size ) noexcept {
+		NNet::Utils::recordAllocation( num * size );
+		return __libc_calloc( num, size );
+	}
+
+	void* realloc( void* ptr, std::size_t size ) noexcept {
+		NNet::Utils::recordAllocation( size );
+		return __libc_realloc( ptr, size );
+	}
+
+	void* memalign( std::size_t alignment, std::size_t size ) noexcept {
+		NNet::Utils::recordAllocation( size );
+		return __libc_memalign( alignment, size );
+	}
+
+	void* aligned_alloc( std::size_t alignment, std::size_t size ) noexcept {
+		NNet::Utils::recordAllocation( size );
+		return __libc_memalign( alignment, size );
+	}
+
+	int posix_memalign( void** ptr, std::size_t alignment, std::size_t size ) noexcept {
+		NNet::Utils::recordAllocation( size );
+		void* mem = __libc_memalign( alignment, size );
+		if ( !mem )
+			return ENOMEM;
+		*ptr = mem;
+		return 0;
+	}
+
+	void free( void* ptr ) noexcept {
+		__libc_free( ptr );
+	}
+}
+#endif
@@ -0,0 +1,83 @@
+#ifndef ALLOCATION_COUNTER_HPP
+#define ALLOCATION_COUNTER_HPP
+
+// System includes --------------------
+#include <cstddef>
+
+namespace NNet::Utils { // begin NNet::Utils
+
+	/**
+	 *AllocationStats holds a number of heap allocations and the total
+	 *number of bytes requested by them.
+	 */
+	struct AllocationStats {
+		std::size_t numAllocations = 0;
+		std::size_t numBytes = 0;
+
+		AllocationStats operator-( AllocationStats const& rhs ) const {
+			return { numAllocations - rhs.numAllocations, numBytes - rhs.numBytes };
+		}
+	};
+
+	/**
+	 *AllocationCounter reports process wide heap allocation totals. Counting
+	 *is a debug instrumentation that is only active when the utils library is
+	 *built with NNET_COUNT_ALLOCATIONS (glibc only), in which case every
+	 *malloc family call, including those made by operator new and Eigen's
+	 *aligned allocator, is counted. Otherwise all counts stay at zero.
+	 */
+	class AllocationCounter {
+	public: 	// public typedefs
+
+	private: 	// private typedefs
+
+	public: 	//public member functions
+		AllocationCounter( ) = delete;
+
+		/// True when allocations are actually being counted
+		static bool isEnabled( );
+
+		/// Allocations made since program start
+		static AllocationStats getTotalStats( );
+
+	private: 	//private member functions
+
+	public: 	//public data members
+
+	private: 	//private data members
+
+	}; // end of class AllocationCounter
+
+	/**
+	 *AllocationScope is a RAII class that measures the allocations made
+	 *between its construction and a call to getStats().
+	 */
+	class AllocationScope {
+	public: 	// public typedefs
+
+	private: 	// private typedefs
+
+	public: 	//public member functions
+		AllocationScope( )
+			: mStartStats( AllocationCounter::getTotalStats( ) ) {
+		}
+		AllocationScope( AllocationScope const& other ) = delete;
+		AllocationScope& operator=( AllocationScope const& rhs ) = delete;
+		~AllocationScope( ) = default;
+
+		/// Allocations made since this scope was opened
+		AllocationStats getStats( ) const {
+			return AllocationCounter::getTotalStats( ) - mStartStats;
+		}
+
+	private: 	//private member functions
+
+	public: 	//public data members
+
+	private: 	//private data members
+		AllocationStats mStartStats;
+	}; // end of class AllocationScope
+
+} // end NNet::Utils
+
+#endif // ALLOCATION_COUNTER_HPP
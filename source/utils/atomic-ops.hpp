@@ -0,0 +1,33 @@
+#ifndef ATOMIC_OPS_HPP
+#define ATOMIC_OPS_HPP
+
+// System includes --------------------
+#include <type_traits>
+
+namespace NNet::Utils { // begin NNet::Utils
+
+	// Relaxed atomic read-modify-write of a plain (non std::atomic) value, e.g. an
+	// element of a parameter buffer shared by lock free (Hogwild) training threads.
+	// Sets *ptr to f( *ptr ) with a compare exchange loop and returns the new value,
+	// concurrent updates of the same element are not lost. No ordering is implied
+	// for other memory locations.
+	template< typename ValueType, typename FunctionType >
+	inline ValueType atomicUpdateRelaxed( ValueType* ptr, FunctionType&& f ) {
+		static_assert( std::is_trivially_copyable_v< ValueType >, "atomicUpdateRelaxed requires a trivially copyable type" );
+		ValueType expected;
+		__atomic_load( ptr, &expected, __ATOMIC_RELAXED );
+		ValueType desired = f( expected );
+		while ( !__atomic_compare_exchange( ptr, &expected, &desired, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED ) ) {
+			desired = f( expected );
+		}
+		return desired;
+	}
+
+	template< typename ValueType >
+	inline void atomicAddRelaxed( ValueType* ptr, ValueType value ) {
+		atomicUpdateRelaxed( ptr, [value]( ValueType current ) { return current + value; } );
+	}
+
+} // end NNet::Utils
+
+#endif // ATOMIC_OPS_HPP
@@ -0,0 +1,35 @@
+// System includes --------------------
+#include <unistd.h>
+
+// Own includes --------------------
+#include "cache-info.hpp"
+
+namespace NNet::Utils { // begin NNet::Utils
+
+	std::size_t getCacheSize( unsigned level ) {
+		long reported = -1;
+		std::size_t fallback = 0;
+		switch ( level ) {
+		case 1:
+#ifdef _SC_LEVEL1_DCACHE_SIZE
+			reported = sysconf( _SC_LEVEL1_DCACHE_SIZE );
+#endif
+			fallback = 32 * 1024;
+			break;
+		case 2:
+#ifdef _SC_LEVEL2_CACHE_SIZE
+			reported = sysconf( _SC_LEVEL2_CACHE_SIZE );
+#endif
+			fallback = 1024 * 1024;
+			break;
+		default:
+#ifdef _SC_LEVEL3_CACHE_SIZE
+			reported = sysconf( _SC_LEVEL3_CACHE_SIZE );
+#endif
+			fallback = 8 * 1024 * 1024;
+			break;
+		}
+		return reported > 0 ? static_cast< std::size_t >( reported ) : fallback;
+	}
+
+} // end NNet::Utils
@@ -0,0 +1,15 @@
+#ifndef CACHE_INFO_HPP
+#define CACHE_INFO_HPP
+
+// System includes --------------------
+#include <cstddef>
+
+namespace NNet::Utils { // begin NNet::Utils
+
+	/// Size in bytes of the data (or unified) cache of the given level (1, 2 or 3)
+	/// of the calling core, a typical size when the system does not report it.
+	std::size_t getCacheSize( unsigned level );
+
+} // end NNet::Utils
+
+#endif // CACHE_INFO_HPP
@@ -0,0 +1,66 @@
+// System includes --------------------
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Own includes --------------------
+#include "mapped-file.hpp"
+
+namespace NNet::Utils { // begin NNet::Utils
+
+	MappedFile::MappedFile( std::size_t numBytes, std::string const& directory ) {
+		if ( numBytes == 0 )
+			return;
+		std::string pattern = directory + "/nnet-mapped-XXXXXX";
+		std::vector< char > path( pattern.begin( ), pattern.end( ) );
+		path.push_back( '\0' );
+		int fd = mkstemp( path.data( ) );
+		if ( fd < 0 )
+			throw std::runtime_error( "MappedFile can't create a file in " + directory + ": " + std::strerror( errno ) );
+		// the name is not needed once the file is open
+		unlink( path.data( ) );
+		if ( ftruncate( fd, static_cast< off_t >( numBytes ) ) != 0 ) {
+			int error = errno;
+			close( fd );
+			throw std::runtime_error( std::string( "MappedFile can't size the file: " ) + std::strerror( error ) );
+		}
+		void* ptr = mmap( nullptr, numBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+		int error = errno;
+		// the mapping keeps the file alive
+		close( fd );
+		if ( ptr == MAP_FAILED )
+			throw std::runtime_error( std::string( "MappedFile can't map the file: " ) + std::strerror( error ) );
+		mData = ptr;
+		mSize = numBytes;
+	}
+
+	MappedFile::MappedFile( MappedFile&& other ) noexcept
+		: mData( std::exchange( other.mData, nullptr ) ), mSize( std::exchange( other.mSize, 0 ) ) {
+	}
+
+	MappedFile& MappedFile::operator=( MappedFile&& rhs ) noexcept {
+		if ( this != &rhs ) {
+			release( );
+			mData = std::exchange( rhs.mData, nullptr );
+			mSize = std::exchange( rhs.mSize, 0 );
+		}
+		return *this;
+	}
+
+	MappedFile::~MappedFile( ) {
+		release( );
+	}
+
+	void MappedFile::release( ) {
+		if ( mData )
+			munmap( mData, mSize );
+		mData = nullptr;
+		mSize = 0;
+	}
+
+} // end NNet::Utils
@@ -0,0 +1,49 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+// System includes --------------------
+#include <cstddef>
+#include <string>
+
+namespace NNet::Utils { // begin NNet::Utils
+
+	/**
+	 *MappedFile is a zero initialized scratch area of numBytes backed by an
+	 *anonymous file in directory and mapped into memory (shared, read/write).
+	 *The file is unlinked as soon as it is mapped, so it disappears with the
+	 *mapping, and the kernel pages the data in and out of the page cache
+	 *instead of the data having to fit in memory.
+	 */
+	class MappedFile {
+	public: 	// public typedefs
+
+	private: 	// private typedefs
+
+	public: 	//public member functions
+		MappedFile( ) = default;
+		explicit MappedFile( std::size_t numBytes, std::string const& directory );
+
+		MappedFile( MappedFile const& other ) = delete;
+		MappedFile( MappedFile&& other ) noexcept;
+		MappedFile& operator=( MappedFile const& rhs ) = delete;
+		MappedFile& operator=( MappedFile&& rhs ) noexcept;
+		~MappedFile( );
+
+		void* data( ) { return mData; }
+		void const* data( ) const { return mData; }
+		std::size_t size( ) const { return mSize; }
+		bool empty( ) const { return mSize == 0; }
+
+	private: 	//private member functions
+		void release( );
+
+	public: 	//public data members
+
+	private: 	//private data members
+		void* mData = nullptr;
+		std::size_t mSize = 0;
+	}; // end of class MappedFile
+
+} // end NNet::Utils
+
+#endif // MAPPED_FILE_HPP
@@ -0,0 +1,188 @@
+// System includes --------------------
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Own includes --------------------
+#include "numa-topology.hpp"
+
+namespace NNet::Utils { // begin NNet::Utils
+
+	NumaTopology::NumaTopology( ) {
+		mNodeIds.push_back( 0 );
+		mNodeCpus.push_back( getAllowedCpus( ) );
+	}
+
+	NumaTopology::NumaTopology( std::vector< std::vector< std::size_t > > nodeCpus ) {
+		for ( std::size_t node = 0; node < nodeCpus.size( ); ++node ) {
+			if ( nodeCpus[node].empty( ) )
+				continue;
+			mNodeIds.push_back( node );
+			mNodeCpus.push_back( std::move( nodeCpus[node] ) );
+		}
+		if ( mNodeCpus.empty( ) )
+			throw std::runtime_error( "A NUMA topology needs cpus..." );
+	}
+
+	NumaTopology NumaTopology::detect( std::string const& sysfsPath ) {
+		std::vector< std::pair< std::size_t, std::vector< std::size_t > > > nodes;
+		auto allowedCpus = getAllowedCpus( );
+		// a cpu outside the cpuset can't be pinned to
+		auto notAllowed = [&allowedCpus]( std::size_t cpu ) { return !std::binary_search( allowedCpus.begin( ), allowedCpus.end( ), cpu ); };
+		std::error_code error;
+		for ( auto const& entry : std::filesystem::directory_iterator( sysfsPath, error ) ) {
+			std::string name = entry.path( ).filename( ).string( );
+			if ( name.size( ) <= 4 || name.compare( 0, 4, "node" ) != 0
+				 || !std::all_of( name.begin( ) + 4, name.end( ), []( char c ) { return c >= '0' && c <= '9'; } ) )
+				continue;
+			std::ifstream cpuListFile( entry.path( ) / "cpulist" );
+			std::string cpuList;
+			if ( !std::getline( cpuListFile, cpuList ) )
+				continue;
+			auto cpus = parseCpuList( cpuList );
+			cpus.erase( std::remove_if( cpus.begin( ), cpus.end( ), notAllowed ), cpus.end( ) );
+			if ( !cpus.empty( ) )
+				nodes.emplace_back( std::stoul( name.substr( 4 ) ), std::move( cpus ) );
+		}
+		if ( nodes.empty( ) )
+			return NumaTopology( );
+		std::sort( nodes.begin( ), nodes.end( ) );
+		NumaTopology topology;
+		topology.mNodeIds.clear( );
+		topology.mNodeCpus.clear( );
+		for ( auto& node : nodes ) {
+			topology.mNodeIds.push_back( node.first );
+			topology.mNodeCpus.push_back( std::move( node.second ) );
+		}
+		return topology;
+	}
+
+	std::vector< std::size_t > NumaTopology::parseCpuList( std::string const& cpuList ) {
+		std::vector< std::size_t > cpus;
+		std::size_t pos = 0;
+		auto readNumber = [&]( ) {
+			std::size_t end = pos;
+			while ( end < cpuList.size( ) && cpuList[end] >= '0' && cpuList[end] <= '9' ) {
+				++end;
+			}
+			if ( end == pos )
+				throw std::runtime_error( "Invalid cpu list " + cpuList );
+			std::size_t number = std::stoul( cpuList.substr( pos, end - pos ) );
+			pos = end;
+			return number;
+		};
+		while ( pos < cpuList.size( ) && cpuList[pos] != '\n' ) {
+			std::size_t first = readNumber( );
+			std::size_t last = first;
+			if ( pos < cpuList.size( ) && cpuList[pos] == '-' ) {
+				++pos;
+				last = readNumber( );
+			}
+			if ( last < first )
+				throw std::runtime_error( "Invalid cpu list " + cpuList );
+			for ( std::size_t cpu = first; cpu <= last; ++cpu ) {
+				cpus.push_back( cpu );
+			}
+			if ( pos < cpuList.size( ) && cpuList[pos] == ',' )
+				++pos;
+		}
+		return cpus;
+	}
+
+	std::size_t NumaTopology::getNodeOfCpu( std::size_t cpu ) const {
+		for ( std::size_t node = 0; node < mNodeCpus.size( ); ++node ) {
+			if ( std::find( mNodeCpus[node].begin( ), mNodeCpus[node].end( ), cpu ) != mNodeCpus[node].end( ) )
+				return node;
+		}
+		return 0;
+	}
+
+	std::size_t NumaTopology::getCurrentNode( ) const {
+		if ( !isNuma( ) )
+			return 0;
+#ifdef __linux__
+		int cpu = sched_getcpu( );
+		if ( cpu >= 0 )
+			return getNodeOfCpu( static_cast< std::size_t >( cpu ) );
+#endif
+		return 0;
+	}
+
+	std::size_t NumaTopology::getThreadCpu( std::size_t thread ) const {
+		auto const& cpus = mNodeCpus[getThreadNode( thread )];
+		return cpus[( thread / getNumNodes( ) ) % cpus.size( )];
+	}
+
+	std::vector< std::size_t > getAllowedCpus( ) {
+		std::vector< std::size_t > cpus;
+#ifdef __linux__
+		cpu_set_t cpuSet;
+		CPU_ZERO( &cpuSet );
+		if ( sched_getaffinity( 0, sizeof( cpu_set_t ), &cpuSet ) == 0 ) {
+			for ( std::size_t cpu = 0; cpu < CPU_SETSIZE; ++cpu ) {
+				if ( CPU_ISSET( cpu, &cpuSet ) )
+					cpus.push_back( cpu );
+			}
+		}
+#endif
+		if ( cpus.empty( ) ) {
+			std::size_t numCpus = std::max< std::size_t >( std::thread::hardware_concurrency( ), 1 );
+			for ( std::size_t cpu = 0; cpu < numCpus; ++cpu ) {
+				cpus.push_back( cpu );
+			}
+		}
+		return cpus;
+	}
+
+	bool pinCurrentThreadToCpus( std::vector< std::size_t > const& cpus ) {
+#ifdef __linux__
+		cpu_set_t cpuSet;
+		CPU_ZERO( &cpuSet );
+		for ( std::size_t cpu : cpus ) {
+			if ( cpu < CPU_SETSIZE )
+				CPU_SET( cpu, &cpuSet );
+		}
+		return CPU_COUNT( &cpuSet ) > 0 && pthread_setaffinity_np( pthread_self( ), sizeof( cpu_set_t ), &cpuSet ) == 0;
+#else
+		( void ) cpus;
+		return false;
+#endif
+	}
+
+	bool bindMemoryToNode( void const* data, std::size_t numBytes, std::size_t nodeId ) {
+#if defined( __linux__ ) && defined( SYS_mbind )
+		long pageSize = sysconf( _SC_PAGESIZE );
+		if ( pageSize <= 0 )
+			return false;
+		// only the pages wholly inside the range, its neighbours keep their placement
+		auto pageBytes = static_cast< std::uintptr_t >( pageSize );
+		auto begin = ( reinterpret_cast< std::uintptr_t >( data ) + pageBytes - 1 ) / pageBytes * pageBytes;
+		auto end = ( reinterpret_cast< std::uintptr_t >( data ) + numBytes ) / pageBytes * pageBytes;
+		if ( end <= begin )
+			return false;
+		constexpr std::size_t bitsPerWord = 8 * sizeof( unsigned long );
+		std::vector< unsigned long > nodeMask( nodeId / bitsPerWord + 1, 0 );
+		nodeMask[nodeId / bitsPerWord] = 1UL << ( nodeId % bitsPerWord );
+		// a preferred node rather than a strict binding, a full node falls back to the others
+		return syscall( SYS_mbind, begin, end - begin, MPOL_PREFERRED, nodeMask.data( ),
+						nodeMask.size( ) * bitsPerWord + 1, MPOL_MF_MOVE ) == 0;
+#else
+		( void ) data;
+		( void ) numBytes;
+		( void ) nodeId;
+		return false;
+#endif
+	}
+
+} // end NNet::Utils
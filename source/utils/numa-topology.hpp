@@ -0,0 +1,78 @@
+#ifndef NUMA_TOPOLOGY_HPP
+#define NUMA_TOPOLOGY_HPP
+
+// System includes --------------------
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace NNet::Utils { // begin NNet::Utils
+
+	/**
+	 *NumaTopology lists the NUMA nodes of the machine and the cpus of every
+	 *node, as read from sysfs (/sys/devices/system/node/node<id>/cpulist).
+	 *Only the cpus of the process's cpuset are kept and nodes without cpus are
+	 *left out. Where sysfs doesn't list any nodes the topology is a single node
+	 *with the cpuset, NUMA aware code then does what it does without a topology.
+	 */
+	class NumaTopology {
+	public: 	// public typedefs
+
+	private: 	// private typedefs
+
+	public: 	// public static data members
+		static constexpr char const* default_sysfs_path = "/sys/devices/system/node";
+
+	public: 	//public member functions
+		/// A single node with the cpus of the cpuset
+		NumaTopology( );
+		/// Nodes numbered 0, 1, ... with the given cpus
+		explicit NumaTopology( std::vector< std::vector< std::size_t > > nodeCpus );
+		~NumaTopology( ) = default;
+
+		/// The topology read from the node directories at sysfsPath
+		static NumaTopology detect( std::string const& sysfsPath = default_sysfs_path );
+		/// The cpus of a sysfs cpu list such as "0-3,8,10-11"
+		static std::vector< std::size_t > parseCpuList( std::string const& cpuList );
+
+		std::size_t getNumNodes( ) const { return mNodeCpus.size( ); }
+		bool isNuma( ) const { return getNumNodes( ) > 1; }
+		/// the kernel's id of the node-th node
+		std::size_t getNodeId( std::size_t node ) const { return mNodeIds[node]; }
+		std::vector< std::size_t > const& getCpus( std::size_t node ) const { return mNodeCpus[node]; }
+		/// the node of a cpu, 0 for a cpu that isn't listed
+		std::size_t getNodeOfCpu( std::size_t cpu ) const;
+		/// the node of the cpu the calling thread runs on
+		std::size_t getCurrentNode( ) const;
+
+		/// The cpu of the thread-th pinned thread. Threads go to the nodes in turn, so
+		/// that a few threads already use the memory bandwidth of every node.
+		std::size_t getThreadCpu( std::size_t thread ) const;
+		std::size_t getThreadNode( std::size_t thread ) const { return thread % getNumNodes( ); }
+
+	private: 	//private member functions
+
+	public: 	//public data members
+
+	private: 	//private data members
+		std::vector< std::size_t > mNodeIds;
+		std::vector< std::vector< std::size_t > > mNodeCpus;
+	}; // end of class NumaTopology
+
+	/// The cpus the calling thread may run on (its cpuset), all hardware threads
+	/// where the cpuset can't be read.
+	std::vector< std::size_t > getAllowedCpus( );
+
+	/// Binds the calling thread to the cpus, returns false where thread affinity
+	/// is not supported or the cpus are not available.
+	bool pinCurrentThreadToCpus( std::vector< std::size_t > const& cpus );
+
+	/// Asks the kernel to keep the whole pages of [data, data + numBytes) on the
+	/// node with the given kernel id, pages already touched are moved. Returns
+	/// false where memory policies are not supported (the memory then stays where
+	/// it was first touched).
+	bool bindMemoryToNode( void const* data, std::size_t numBytes, std::size_t nodeId );
+
+} // end NNet::Utils
+
+#endif // NUMA_TOPOLOGY_HPP
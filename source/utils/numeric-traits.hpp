@@ -1,8 +1,12 @@
 #ifndef NUMERIC_TRAITS_HPP
 #define NUMERIC_TRAITS_HPP
 
+// System includes --------------------
+#include <stdexcept>
+
 // Boost includes --------------------
 #include <boost/serialization/array.hpp>
+#include <boost/serialization/split_free.hpp>
 
 // Eigen includes --------------------
 #include <Eigen/Core>
@@ -19,6 +23,13 @@ namespace NNet { // begin NNet
 		using ArrayXXType = Eigen::Array< DataType,	Eigen::Dynamic, Eigen::Dynamic >;
 		using ArrayXType = Eigen::Array< DataType, Eigen::Dynamic, 1 >;
 		using RowArrayXType = Eigen::Array< DataType, 1, Eigen::Dynamic >;
+
+		// views into externally owned (e.g. flat parameter buffer) storage
+		using MatrixMapType = Eigen::Map< MatrixXType, Eigen::AlignedMax >;
+		using ConstMatrixMapType = Eigen::Map< MatrixXType const, Eigen::AlignedMax >;
+		using VectorMapType = Eigen::Map< VectorXType, Eigen::AlignedMax >;
+		using ConstVectorMapType = Eigen::Map< VectorXType const, Eigen::AlignedMax >;
+		using MatrixRefType = Eigen::Ref< MatrixXType >;
 	};
 
 } // end NNet
@@ -105,6 +116,23 @@ namespace boost::serialization { // begin boost::serialization
                           const unsigned int file_version ) {
       split_free(ar, M, file_version);
     }
+
+    // maps are views of fixed size, loading requires a matching shape
+    template<class Archive, typename _PlainObjectType, int _MapOptions, typename _StrideType>
+    inline void serialize(Archive & ar,
+                          Eigen::Map<_PlainObjectType, _MapOptions, _StrideType>& M,
+                          const unsigned int /* file_version */ ) {
+      typename _PlainObjectType::Index rows = M.rows();
+      typename _PlainObjectType::Index cols = M.cols();
+
+      ar & rows;
+      ar & cols;
+
+      if ( Archive::is_loading::value && ( rows != M.rows() || cols != M.cols() ) )
+        throw std::runtime_error( "Unexpected shape when loading an Eigen::Map" );
+
+      ar & make_array( M.data(), M.size() );
+    }
 } // end boost::serialization
 
 #endif // NUMERIC_TRAITS_HPP
@@ -0,0 +1,248 @@
+// System includes --------------------
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Own includes --------------------
+#include "parameter-socket.hpp"
+
+namespace NNet::Utils { // begin NNet::Utils
+
+	namespace { // begin anonymous
+
+		// every request and reply starts with this header
+		struct MessageHeader {
+			std::uint32_t type;
+			std::uint32_t flags;
+			std::uint64_t version;
+			std::uint64_t batchSize;
+			double loss;
+			std::uint64_t numBytes;
+		};
+		constexpr std::uint32_t reply_type = 3;
+		constexpr std::uint32_t accepted_flag = 1;
+		constexpr std::uint32_t stop_flag = 2;
+
+		std::string errorText( std::string const& what ) {
+			return what + ": " + std::strerror( errno );
+		}
+
+		sockaddr_un socketAddress( std::string const& path ) {
+			sockaddr_un address { };
+			address.sun_family = AF_UNIX;
+			if ( path.empty( ) || path.size( ) >= sizeof( address.sun_path ) )
+				throw std::runtime_error( "Invalid parameter server socket path " + path );
+			std::memcpy( address.sun_path, path.c_str( ), path.size( ) + 1 );
+			return address;
+		}
+
+		// false when the peer has gone
+		bool sendAll( int socketFd, void const* data, std::size_t numBytes ) {
+			auto bytes = static_cast< unsigned char const* >( data );
+			while ( numBytes > 0 ) {
+				ssize_t numSent = ::send( socketFd, bytes, numBytes, MSG_NOSIGNAL );
+				if ( numSent < 0 ) {
+					if ( errno == EINTR )
+						continue;
+					if ( errno == EPIPE || errno == ECONNRESET )
+						return false;
+					throw std::runtime_error( errorText( "Parameter server socket can't send" ) );
+				}
+				bytes += numSent;
+				numBytes -= static_cast< std::size_t >( numSent );
+			}
+			return true;
+		}
+
+		// false when the peer has gone
+		bool receiveAll( int socketFd, void* data, std::size_t numBytes ) {
+			auto bytes = static_cast< unsigned char* >( data );
+			while ( numBytes > 0 ) {
+				ssize_t numReceived = recv( socketFd, bytes, numBytes, 0 );
+				if ( numReceived < 0 ) {
+					if ( errno == EINTR )
+						continue;
+					if ( errno == ECONNRESET )
+						return false;
+					throw std::runtime_error( errorText( "Parameter server socket can't receive" ) );
+				}
+				if ( numReceived == 0 )
+					return false;
+				bytes += numReceived;
+				numBytes -= static_cast< std::size_t >( numReceived );
+			}
+			return true;
+		}
+
+	} // end anonymous
+
+	ParameterServerSocket::ParameterServerSocket( std::string const& path, std::size_t numWorkers, double timeoutSeconds ) {
+		if ( numWorkers == 0 )
+			throw std::runtime_error( "A parameter server needs workers..." );
+		sockaddr_un address = socketAddress( path );
+		int listenSocket = socket( AF_UNIX, SOCK_STREAM, 0 );
+		if ( listenSocket < 0 )
+			throw std::runtime_error( errorText( "ParameterServerSocket can't create a socket" ) );
+		auto fail = [&]( std::string const& what ) {
+			std::string error = errorText( "ParameterServerSocket " + what );
+			for ( int socketFd : mSockets ) {
+				close( socketFd );
+			}
+			mSockets.clear( );
+			close( listenSocket );
+			unlink( path.c_str( ) );
+			throw std::runtime_error( error );
+		};
+		unlink( path.c_str( ) );
+		if ( bind( listenSocket, reinterpret_cast< sockaddr* >( &address ), sizeof( address ) ) != 0
+			 || listen( listenSocket, static_cast< int >( numWorkers ) ) != 0 )
+			fail( "can't listen on " + path );
+		auto deadline = std::chrono::steady_clock::now( ) + std::chrono::duration< double >( timeoutSeconds );
+		while ( mSockets.size( ) < numWorkers ) {
+			auto remaining = std::chrono::duration_cast< std::chrono::milliseconds >( deadline - std::chrono::steady_clock::now( ) );
+			pollfd listenPoll { listenSocket, POLLIN, 0 };
+			if ( remaining.count( ) <= 0 || poll( &listenPoll, 1, static_cast< int >( remaining.count( ) ) ) == 0 ) {
+				errno = ETIMEDOUT;
+				fail( "timed out waiting for " + std::to_string( numWorkers - mSockets.size( ) ) + " workers" );
+			}
+			int workerSocket = accept( listenSocket, nullptr, nullptr );
+			if ( workerSocket < 0 ) {
+				if ( errno == EINTR || errno == ECONNABORTED )
+					continue;
+				fail( "can't accept a worker" );
+			}
+			mSockets.push_back( workerSocket );
+		}
+		mNumConnected = numWorkers;
+		close( listenSocket );
+		unlink( path.c_str( ) );
+	}
+
+	ParameterServerSocket::~ParameterServerSocket( ) {
+		for ( int socketFd : mSockets ) {
+			if ( socketFd >= 0 )
+				close( socketFd );
+		}
+	}
+
+	bool ParameterServerSocket::receiveRequest( Request& request, void* gradient, std::size_t numBytes ) {
+		std::size_t numWorkers = mSockets.size( );
+		auto& polls = mPolls;
+		polls.resize( numWorkers );
+		while ( mNumConnected > 0 ) {
+			// workers in turn from mNextWorker, disconnected ones are ignored by poll
+			for ( std::size_t i = 0; i < numWorkers; ++i ) {
+				polls[i] = { mSockets[( mNextWorker + i ) % numWorkers], POLLIN, 0 };
+			}
+			if ( poll( polls.data( ), numWorkers, -1 ) < 0 ) {
+				if ( errno == EINTR )
+					continue;
+				throw std::runtime_error( errorText( "ParameterServerSocket can't wait for requests" ) );
+			}
+			for ( std::size_t i = 0; i < numWorkers; ++i ) {
+				if ( polls[i].fd < 0 || polls[i].revents == 0 )
+					continue;
+				std::size_t worker = ( mNextWorker + i ) % numWorkers;
+				MessageHeader header;
+				if ( !receiveAll( mSockets[worker], &header, sizeof( header ) ) ) {
+					disconnect( worker );
+					continue;
+				}
+				auto type = static_cast< RequestType >( header.type );
+				if ( type == RequestType::PUSH ) {
+					if ( header.numBytes != numBytes )
+						throw std::runtime_error( "ParameterServerSocket: worker " + std::to_string( worker ) + " pushed a gradient of another size" );
+					if ( !receiveAll( mSockets[worker], gradient, numBytes ) ) {
+						disconnect( worker );
+						continue;
+					}
+				}
+				else if ( type != RequestType::PULL ) {
+					throw std::runtime_error( "ParameterServerSocket: unknown request from worker " + std::to_string( worker ) );
+				}
+				request = Request{ worker, type, header.version, header.batchSize, header.loss };
+				mNextWorker = ( worker + 1 ) % numWorkers;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void ParameterServerSocket::sendReply( std::size_t worker, std::uint64_t version, bool accepted, bool stop,
+										   void const* parameters, std::size_t numBytes ) {
+		if ( mSockets[worker] < 0 )
+			return;
+		std::uint32_t flags = ( accepted ? accepted_flag : 0 ) | ( stop ? stop_flag : 0 );
+		MessageHeader header{ reply_type, flags, version, 0, 0.0, numBytes };
+		if ( !sendAll( mSockets[worker], &header, sizeof( header ) ) || !sendAll( mSockets[worker], parameters, numBytes ) )
+			disconnect( worker );
+	}
+
+	void ParameterServerSocket::disconnect( std::size_t worker ) {
+		close( mSockets[worker] );
+		mSockets[worker] = -1;
+		--mNumConnected;
+	}
+
+	ParameterServerConnection::ParameterServerConnection( std::string const& path, double timeoutSeconds ) {
+		sockaddr_un address = socketAddress( path );
+		auto deadline = std::chrono::steady_clock::now( ) + std::chrono::duration< double >( timeoutSeconds );
+		while ( true ) {
+			mSocket = socket( AF_UNIX, SOCK_STREAM, 0 );
+			if ( mSocket < 0 )
+				throw std::runtime_error( errorText( "ParameterServerConnection can't create a socket" ) );
+			if ( connect( mSocket, reinterpret_cast< sockaddr* >( &address ), sizeof( address ) ) == 0 )
+				break;
+			close( mSocket );
+			mSocket = -1;
+			if ( std::chrono::steady_clock::now( ) > deadline )
+				throw std::runtime_error( errorText( "ParameterServerConnection timed out connecting to " + path ) );
+			std::this_thread::sleep_for( std::chrono::milliseconds( 5 ) );
+		}
+	}
+
+	ParameterServerConnection::~ParameterServerConnection( ) {
+		if ( mSocket >= 0 )
+			close( mSocket );
+	}
+
+	void ParameterServerConnection::pull( void* parameters, std::size_t numBytes ) {
+		MessageHeader header{ static_cast< std::uint32_t >( ParameterServerSocket::RequestType::PULL ), 0, mVersion, 0, 0.0, 0 };
+		if ( !sendAll( mSocket, &header, sizeof( header ) ) )
+			throw std::runtime_error( "ParameterServerConnection: the server has gone" );
+		bool accepted = false;
+		receiveReply( parameters, numBytes, accepted );
+	}
+
+	bool ParameterServerConnection::push( void const* gradient, std::size_t numBytes, std::size_t batchSize, double loss, void* parameters ) {
+		MessageHeader header{ static_cast< std::uint32_t >( ParameterServerSocket::RequestType::PUSH ), 0, mVersion, batchSize, loss, numBytes };
+		if ( !sendAll( mSocket, &header, sizeof( header ) ) || !sendAll( mSocket, gradient, numBytes ) )
+			throw std::runtime_error( "ParameterServerConnection: the server has gone" );
+		bool accepted = false;
+		receiveReply( parameters, numBytes, accepted );
+		++mNumPushed;
+		if ( !accepted && !mStopped )
+			++mNumDropped;
+		return accepted;
+	}
+
+	void ParameterServerConnection::receiveReply( void* parameters, std::size_t numBytes, bool& accepted ) {
+		MessageHeader header;
+		if ( !receiveAll( mSocket, &header, sizeof( header ) ) )
+			throw std::runtime_error( "ParameterServerConnection: the server has gone" );
+		if ( header.type != reply_type || header.numBytes != numBytes )
+			throw std::runtime_error( "ParameterServerConnection: the server's weights don't match the network" );
+		if ( !receiveAll( mSocket, parameters, numBytes ) )
+			throw std::runtime_error( "ParameterServerConnection: the server has gone" );
+		mVersion = header.version;
+		mStopped = ( header.flags & stop_flag ) != 0;
+		accepted = ( header.flags & accepted_flag ) != 0;
+	}
+
+} // end NNet::Utils
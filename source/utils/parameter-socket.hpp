@@ -0,0 +1,114 @@
+#ifndef PARAMETER_SOCKET_HPP
+#define PARAMETER_SOCKET_HPP
+
+// System includes --------------------
+#include <poll.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace NNet::Utils { // begin NNet::Utils
+
+	/**
+	 *ParameterServerSocket is the server end of parameter server training, a
+	 *Unix domain socket at path that numWorkers workers connect to (within
+	 *timeoutSeconds). Workers send pull requests (for the weights) and push
+	 *requests (a gradient, answered with the weights), the server answers
+	 *every request with a reply. Requests are taken from the workers in turn,
+	 *a worker that disconnects is dropped. The path is removed once all
+	 *workers are connected.
+	 */
+	class ParameterServerSocket {
+	public: 	// public typedefs
+		enum class RequestType : std::uint32_t { PULL = 1, PUSH = 2 };
+
+		struct Request {
+			std::size_t worker = 0;
+			RequestType type = RequestType::PULL;
+			// version of the weights a pushed gradient was computed at
+			std::uint64_t version = 0;
+			// samples the pushed gradient is summed over and their summed loss
+			std::uint64_t batchSize = 0;
+			double loss = 0.0;
+		};
+
+	private: 	// private typedefs
+
+	public: 	//public member functions
+		ParameterServerSocket( ) = delete;
+		explicit ParameterServerSocket( std::string const& path, std::size_t numWorkers, double timeoutSeconds = 30.0 );
+		ParameterServerSocket( ParameterServerSocket const& other ) = delete;
+		ParameterServerSocket& operator=( ParameterServerSocket const& rhs ) = delete;
+		~ParameterServerSocket( );
+
+		std::size_t getNumWorkers( ) const { return mSockets.size( ); }
+		std::size_t getNumConnected( ) const { return mNumConnected; }
+
+		/// Waits for the next request, the gradient of a push (numBytes) is received into
+		/// gradient. Returns false once all workers have disconnected.
+		bool receiveRequest( Request& request, void* gradient, std::size_t numBytes );
+		/// Answers worker's request with the weights of version
+		void sendReply( std::size_t worker, std::uint64_t version, bool accepted, bool stop, void const* parameters, std::size_t numBytes );
+
+	private: 	//private member functions
+		void disconnect( std::size_t worker );
+
+	public: 	//public data members
+
+	private: 	//private data members
+		std::vector< int > mSockets;
+		std::size_t mNumConnected = 0;
+		std::vector< pollfd > mPolls;
+		// the worker whose request is looked for first, so that no worker starves
+		std::size_t mNextWorker = 0;
+	}; // end of class ParameterServerSocket
+
+	/**
+	 *ParameterServerConnection is a worker's connection to a parameter server
+	 *socket at path, connecting is retried for up to timeoutSeconds while the
+	 *server is starting. The version counts the updates the server applied
+	 *before it sent the last weights received.
+	 */
+	class ParameterServerConnection {
+	public: 	// public typedefs
+
+	private: 	// private typedefs
+
+	public: 	//public member functions
+		ParameterServerConnection( ) = delete;
+		explicit ParameterServerConnection( std::string const& path, double timeoutSeconds = 30.0 );
+		ParameterServerConnection( ParameterServerConnection const& other ) = delete;
+		ParameterServerConnection& operator=( ParameterServerConnection const& rhs ) = delete;
+		~ParameterServerConnection( );
+
+		std::uint64_t getVersion( ) const { return mVersion; }
+		/// true once the server has asked the worker to stop
+		bool isStopped( ) const { return mStopped; }
+		std::size_t getNumPushed( ) const { return mNumPushed; }
+		/// pushed gradients the server dropped as too stale
+		std::size_t getNumDropped( ) const { return mNumDropped; }
+
+		/// Receives the current weights (numBytes) into parameters
+		void pull( void* parameters, std::size_t numBytes );
+		/// Sends a gradient summed over batchSize samples (with their summed loss) computed
+		/// at the weights last received, and receives the current weights into parameters.
+		/// Returns whether the server applied the gradient.
+		bool push( void const* gradient, std::size_t numBytes, std::size_t batchSize, double loss, void* parameters );
+
+	private: 	//private member functions
+		void receiveReply( void* parameters, std::size_t numBytes, bool& accepted );
+
+	public: 	//public data members
+
+	private: 	//private data members
+		int mSocket = -1;
+		std::uint64_t mVersion = 0;
+		bool mStopped = false;
+		std::size_t mNumPushed = 0;
+		std::size_t mNumDropped = 0;
+	}; // end of class ParameterServerConnection
+
+} // end NNet::Utils
+
+#endif // PARAMETER_SOCKET_HPP
@@ -0,0 +1,376 @@
+// System includes --------------------
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Own includes --------------------
+#include "aligned-buffer.hpp"
+#include "process-group.hpp"
+
+namespace NNet::Utils { // begin NNet::Utils
+
+	namespace { // begin anonymous
+
+		// polls before a waiting rank starts yielding its core
+		constexpr std::size_t spin_polls = 64;
+
+		void waitPoll( std::size_t& numPolls ) {
+			if ( ++numPolls > spin_polls )
+				std::this_thread::yield( );
+		}
+
+		std::string errorText( std::string const& what ) {
+			return what + ": " + std::strerror( errno );
+		}
+
+		std::size_t nextPowerOfTwo( std::size_t n ) {
+			std::size_t power = 1;
+			while ( power < n ) {
+				power *= 2;
+			}
+			return power;
+		}
+
+		// the shared memory object starts with this header, the channels follow
+		struct SharedHeader {
+			std::atomic< std::uint64_t > magic;
+			std::uint64_t size;
+			std::uint64_t channelBytes;
+		};
+		constexpr std::uint64_t shared_magic = 0x4e4e6574504700ull;
+
+	} // end anonymous
+
+	ProcessGroup::ProcessGroup( std::size_t rank, std::size_t size )
+		: mRank( rank ), mSize( size ) {
+		if ( size == 0 || rank >= size )
+			throw std::runtime_error( "ProcessGroup rank " + std::to_string( rank ) + " is not in a group of " + std::to_string( size ) );
+	}
+
+	void ProcessGroup::send( void const* data, std::size_t numBytes ) {
+		auto bytes = static_cast< unsigned char const* >( data );
+		std::size_t numPolls = 0;
+		while ( numBytes > 0 ) {
+			std::size_t numSent = trySend( bytes, numBytes );
+			bytes += numSent;
+			numBytes -= numSent;
+			if ( numSent == 0 ) {
+				// the next rank may itself be waiting for its next rank, keep ours going
+				fillBacklog( );
+				waitPoll( numPolls );
+			}
+		}
+	}
+
+	void ProcessGroup::receive( void* data, std::size_t numBytes ) {
+		auto bytes = static_cast< unsigned char* >( data );
+		std::size_t numBacklog = std::min( numBytes, mBacklog.size( ) - mBacklogBegin );
+		std::copy( mBacklog.begin( ) + mBacklogBegin, mBacklog.begin( ) + mBacklogBegin + numBacklog, bytes );
+		mBacklogBegin += numBacklog;
+		if ( mBacklogBegin == mBacklog.size( ) ) {
+			mBacklog.clear( );
+			mBacklogBegin = 0;
+		}
+		bytes += numBacklog;
+		numBytes -= numBacklog;
+		std::size_t numPolls = 0;
+		while ( numBytes > 0 ) {
+			std::size_t numReceived = tryReceive( bytes, numBytes );
+			bytes += numReceived;
+			numBytes -= numReceived;
+			if ( numReceived == 0 )
+				waitPoll( numPolls );
+		}
+	}
+
+	void ProcessGroup::barrier( ) {
+		std::uint64_t token = 0;
+		allReduceSum( &token, 1 );
+	}
+
+	void ProcessGroup::fillBacklog( ) {
+		constexpr std::size_t block_size = 4096;
+		std::size_t size = mBacklog.size( );
+		mBacklog.resize( size + block_size );
+		mBacklog.resize( size + tryReceive( mBacklog.data( ) + size, block_size ) );
+	}
+
+	// a channel's bytes follow its state, head and tail count the bytes written and
+	// read so far (on their own cache lines)
+	struct SharedMemoryProcessGroup::Channel {
+		alignas( cache_line_size ) std::atomic< std::size_t > head;
+		alignas( cache_line_size ) std::atomic< std::size_t > tail;
+
+		unsigned char* bytes( ) { return reinterpret_cast< unsigned char* >( this + 1 ); }
+	};
+
+	SharedMemoryProcessGroup::SharedMemoryProcessGroup( std::string const& name, std::size_t rank, std::size_t size,
+														std::size_t channelBytes, double timeoutSeconds )
+		: ProcessGroup( rank, size ), mName( name.empty( ) || name[0] != '/' ? "/" + name : name ),
+		  mChannelBytes( nextPowerOfTwo( std::max< std::size_t >( channelBytes, cache_line_size ) ) ) {
+		static_assert( std::atomic< std::size_t >::is_always_lock_free && std::atomic< std::uint64_t >::is_always_lock_free,
+					   "Shared memory channels need address free atomics" );
+		if ( size == 1 )
+			return;
+		std::size_t channelStride = sizeof( Channel ) + mChannelBytes;
+		std::size_t headerBytes = ( ( sizeof( SharedHeader ) + cache_line_size - 1 ) / cache_line_size ) * cache_line_size;
+		mMappingBytes = headerBytes + size * channelStride;
+		auto deadline = std::chrono::steady_clock::now( ) + std::chrono::duration< double >( timeoutSeconds );
+		int fd = -1;
+		if ( rank == 0 ) {
+			shm_unlink( mName.c_str( ) );
+			fd = shm_open( mName.c_str( ), O_CREAT | O_EXCL | O_RDWR, 0600 );
+			if ( fd < 0 )
+				throw std::runtime_error( errorText( "SharedMemoryProcessGroup can't create " + mName ) );
+			if ( ftruncate( fd, static_cast< off_t >( mMappingBytes ) ) != 0 ) {
+				std::string error = errorText( "SharedMemoryProcessGroup can't size " + mName );
+				close( fd );
+				shm_unlink( mName.c_str( ) );
+				throw std::runtime_error( error );
+			}
+		}
+		else {
+			// wait until rank 0 has created and sized the object
+			while ( true ) {
+				fd = shm_open( mName.c_str( ), O_RDWR, 0600 );
+				struct stat status;
+				if ( fd >= 0 && fstat( fd, &status ) == 0 && static_cast< std::size_t >( status.st_size ) >= mMappingBytes )
+					break;
+				if ( fd >= 0 )
+					close( fd );
+				if ( std::chrono::steady_clock::now( ) > deadline )
+					throw std::runtime_error( "SharedMemoryProcessGroup timed out waiting for " + mName );
+				std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+			}
+		}
+		mMapping = mmap( nullptr, mMappingBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+		std::string error = errorText( "SharedMemoryProcessGroup can't map " + mName );
+		close( fd );
+		if ( mMapping == MAP_FAILED ) {
+			mMapping = nullptr;
+			if ( rank == 0 )
+				shm_unlink( mName.c_str( ) );
+			throw std::runtime_error( error );
+		}
+		auto base = static_cast< unsigned char* >( mMapping );
+		auto header = reinterpret_cast< SharedHeader* >( base );
+		auto channel = [&]( std::size_t r ) { return reinterpret_cast< Channel* >( base + headerBytes + r * channelStride ); };
+		if ( rank == 0 ) {
+			// the object is zero filled, the atomics only need constructing
+			new ( header ) SharedHeader{ { 0 }, size, mChannelBytes };
+			for ( std::size_t r = 0; r < size; ++r ) {
+				new ( channel( r ) ) Channel{ { 0 }, { 0 } };
+			}
+			header -> magic.store( shared_magic, std::memory_order_release );
+		}
+		else {
+			std::size_t numPolls = 0;
+			while ( header -> magic.load( std::memory_order_acquire ) != shared_magic ) {
+				if ( std::chrono::steady_clock::now( ) > deadline ) {
+					munmap( mMapping, mMappingBytes );
+					throw std::runtime_error( "SharedMemoryProcessGroup timed out waiting for rank 0 of " + mName );
+				}
+				waitPoll( numPolls );
+			}
+			if ( header -> size != size || header -> channelBytes != mChannelBytes ) {
+				munmap( mMapping, mMappingBytes );
+				throw std::runtime_error( "SharedMemoryProcessGroup " + mName + " was made for another group" );
+			}
+		}
+		mSendChannel = channel( rank );
+		mReceiveChannel = channel( ( rank + size - 1 ) % size );
+		// everyone is attached, the name is no longer needed
+		barrier( );
+		if ( rank == 0 ) {
+			shm_unlink( mName.c_str( ) );
+			mUnlinked = true;
+		}
+	}
+
+	SharedMemoryProcessGroup::~SharedMemoryProcessGroup( ) {
+		if ( getRank( ) == 0 && mMapping && !mUnlinked )
+			shm_unlink( mName.c_str( ) );
+		if ( mMapping )
+			munmap( mMapping, mMappingBytes );
+	}
+
+	std::size_t SharedMemoryProcessGroup::trySend( void const* data, std::size_t numBytes ) {
+		std::size_t head = mSendChannel -> head.load( std::memory_order_relaxed );
+		std::size_t tail = mSendChannel -> tail.load( std::memory_order_acquire );
+		std::size_t numSent = std::min( numBytes, mChannelBytes - ( head - tail ) );
+		std::size_t offset = head & ( mChannelBytes - 1 );
+		std::size_t first = std::min( numSent, mChannelBytes - offset );
+		auto bytes = static_cast< unsigned char const* >( data );
+		std::memcpy( mSendChannel -> bytes( ) + offset, bytes, first );
+		std::memcpy( mSendChannel -> bytes( ), bytes + first, numSent - first );
+		mSendChannel -> head.store( head + numSent, std::memory_order_release );
+		return numSent;
+	}
+
+	std::size_t SharedMemoryProcessGroup::tryReceive( void* data, std::size_t numBytes ) {
+		std::size_t tail = mReceiveChannel -> tail.load( std::memory_order_relaxed );
+		std::size_t head = mReceiveChannel -> head.load( std::memory_order_acquire );
+		std::size_t numReceived = std::min( numBytes, head - tail );
+		std::size_t offset = tail & ( mChannelBytes - 1 );
+		std::size_t first = std::min( numReceived, mChannelBytes - offset );
+		auto bytes = static_cast< unsigned char* >( data );
+		std::memcpy( bytes, mReceiveChannel -> bytes( ) + offset, first );
+		std::memcpy( bytes + first, mReceiveChannel -> bytes( ), numReceived - first );
+		mReceiveChannel -> tail.store( tail + numReceived, std::memory_order_release );
+		return numReceived;
+	}
+
+	TcpProcessGroup::TcpProcessGroup( std::string const& host, std::uint16_t basePort, std::size_t rank, std::size_t size,
+									  double timeoutSeconds )
+		: ProcessGroup( rank, size ) {
+		if ( size == 1 )
+			return;
+		auto deadline = std::chrono::steady_clock::now( ) + std::chrono::duration< double >( timeoutSeconds );
+		auto fail = [this]( std::string const& what, int fd ) {
+			std::string error = errorText( "TcpProcessGroup " + what );
+			for ( int socketFd : { fd, mSendSocket, mReceiveSocket } ) {
+				if ( socketFd >= 0 )
+					close( socketFd );
+			}
+			mSendSocket = mReceiveSocket = -1;
+			throw std::runtime_error( error );
+		};
+		// listen first, the previous rank's connection then waits in the backlog
+		int listenSocket = socket( AF_INET, SOCK_STREAM, 0 );
+		if ( listenSocket < 0 )
+			fail( "can't create a socket", -1 );
+		int one = 1;
+		setsockopt( listenSocket, SOL_SOCKET, SO_REUSEADDR, &one, sizeof( one ) );
+		sockaddr_in address { };
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl( INADDR_ANY );
+		address.sin_port = htons( static_cast< std::uint16_t >( basePort + rank ) );
+		if ( bind( listenSocket, reinterpret_cast< sockaddr* >( &address ), sizeof( address ) ) != 0 || listen( listenSocket, 1 ) != 0 )
+			fail( "can't listen on port " + std::to_string( basePort + rank ), listenSocket );
+		// connect to the next rank
+		addrinfo hints { };
+		hints.ai_family = AF_INET;
+		hints.ai_socktype = SOCK_STREAM;
+		addrinfo* addresses = nullptr;
+		std::string port = std::to_string( basePort + ( rank + 1 ) % size );
+		if ( getaddrinfo( host.c_str( ), port.c_str( ), &hints, &addresses ) != 0 || !addresses )
+			fail( "can't resolve " + host, listenSocket );
+		while ( true ) {
+			mSendSocket = socket( AF_INET, SOCK_STREAM, 0 );
+			if ( mSendSocket >= 0 && connect( mSendSocket, addresses -> ai_addr, addresses -> ai_addrlen ) == 0 )
+				break;
+			if ( mSendSocket >= 0 )
+				close( mSendSocket );
+			mSendSocket = -1;
+			if ( std::chrono::steady_clock::now( ) > deadline ) {
+				freeaddrinfo( addresses );
+				fail( "timed out connecting to " + host + ":" + port, listenSocket );
+			}
+			std::this_thread::sleep_for( std::chrono::milliseconds( 5 ) );
+		}
+		freeaddrinfo( addresses );
+		mReceiveSocket = accept( listenSocket, nullptr, nullptr );
+		if ( mReceiveSocket < 0 )
+			fail( "can't accept the previous rank", listenSocket );
+		close( listenSocket );
+		for ( int socketFd : { mSendSocket, mReceiveSocket } ) {
+			setsockopt( socketFd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof( one ) );
+			fcntl( socketFd, F_SETFL, fcntl( socketFd, F_GETFL ) | O_NONBLOCK );
+		}
+	}
+
+	TcpProcessGroup::~TcpProcessGroup( ) {
+		if ( mSendSocket >= 0 )
+			close( mSendSocket );
+		if ( mReceiveSocket >= 0 )
+			close( mReceiveSocket );
+	}
+
+	std::size_t TcpProcessGroup::trySend( void const* data, std::size_t numBytes ) {
+		ssize_t numSent = ::send( mSendSocket, data, numBytes, MSG_NOSIGNAL );
+		if ( numSent < 0 ) {
+			if ( errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR )
+				return 0;
+			throw std::runtime_error( errorText( "TcpProcessGroup can't send to the next rank" ) );
+		}
+		return static_cast< std::size_t >( numSent );
+	}
+
+	std::size_t TcpProcessGroup::tryReceive( void* data, std::size_t numBytes ) {
+		ssize_t numReceived = recv( mReceiveSocket, data, numBytes, 0 );
+		if ( numReceived < 0 ) {
+			if ( errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR )
+				return 0;
+			throw std::runtime_error( errorText( "TcpProcessGroup can't receive from the previous rank" ) );
+		}
+		if ( numReceived == 0 && numBytes > 0 )
+			throw std::runtime_error( "TcpProcessGroup: the previous rank closed its connection" );
+		return static_cast< std::size_t >( numReceived );
+	}
+
+	std::size_t launchProcesses( std::size_t numProcesses, std::function< int( std::size_t ) > const& task ) {
+		std::vector< pid_t > children;
+		std::fflush( nullptr );
+		for ( std::size_t rank = 0; rank < numProcesses; ++rank ) {
+			pid_t pid = fork( );
+			if ( pid == 0 ) {
+				int result = 1;
+				try {
+					result = task( rank );
+				}
+				catch ( std::exception const& exception ) {
+					std::fprintf( stderr, "rank %zu: %s\n", rank, exception.what( ) );
+				}
+				catch ( ... ) {
+				}
+				std::fflush( nullptr );
+				// skip the parent's exit handlers
+				_exit( result );
+			}
+			if ( pid < 0 ) {
+				for ( pid_t child : children ) {
+					kill( child, SIGKILL );
+					waitpid( child, nullptr, 0 );
+				}
+				throw std::runtime_error( errorText( "launchProcesses can't fork" ) );
+			}
+			children.push_back( pid );
+		}
+		std::size_t numFailed = 0;
+		for ( std::size_t numRunning = children.size( ); numRunning > 0; ) {
+			int status = 0;
+			pid_t pid = waitpid( -1, &status, 0 );
+			if ( pid < 0 )
+				break;
+			auto child = std::find( children.begin( ), children.end( ), pid );
+			if ( child == children.end( ) )
+				continue;
+			*child = 0;
+			--numRunning;
+			if ( !WIFEXITED( status ) || WEXITSTATUS( status ) != 0 ) {
+				++numFailed;
+				for ( pid_t child : children ) {
+					if ( child != 0 )
+						kill( child, SIGKILL );
+				}
+			}
+		}
+		return numFailed;
+	}
+
+} // end NNet::Utils
@@ -0,0 +1,206 @@
+#ifndef PROCESS_GROUP_HPP
+#define PROCESS_GROUP_HPP
+
+// System includes --------------------
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace NNet::Utils { // begin NNet::Utils
+
+	/**
+	 *ProcessGroup connects size processes (ranks) in a ring, every rank sends
+	 *to the next rank and receives from the previous one. send and receive
+	 *block, a rank waiting to send keeps taking in what its previous rank
+	 *sends (into a backlog), so ranks can't deadlock on full channels. A group
+	 *is used by one thread at a time. The transports (shared memory, TCP)
+	 *implement the non blocking trySend and tryReceive.
+	 */
+	class ProcessGroup {
+	public: 	// public typedefs
+
+	private: 	// private typedefs
+
+	public: 	// public static data members
+		static constexpr std::size_t default_chunk_bytes = std::size_t( 1 ) << 16;
+
+	public: 	//public member functions
+		ProcessGroup( ) = delete;
+		explicit ProcessGroup( std::size_t rank, std::size_t size );
+		ProcessGroup( ProcessGroup const& other ) = delete;
+		ProcessGroup& operator=( ProcessGroup const& rhs ) = delete;
+		virtual ~ProcessGroup( ) = default;
+
+		std::size_t getRank( ) const { return mRank; }
+		std::size_t getSize( ) const { return mSize; }
+		/// Size of the pieces the all-reduce passes around the ring
+		std::size_t getChunkBytes( ) const { return mChunkBytes; }
+		void setChunkBytes( std::size_t chunkBytes ) { mChunkBytes = std::max< std::size_t >( chunkBytes, 64 ); }
+
+		/// Sends numBytes to the next rank
+		void send( void const* data, std::size_t numBytes );
+		/// Receives numBytes from the previous rank
+		void receive( void* data, std::size_t numBytes );
+		/// Returns once every rank has called barrier
+		void barrier( );
+
+		/// Replaces data[0, count) on every rank by the sum over the ranks, summed in
+		/// rank order ( ( data_0 + data_1 ) + data_2 ) + ... for every element (the
+		/// same bits on every rank, for any chunk size). Chunk k is reduced along the
+		/// ring from rank 0 to rank size - 1, which passes the sum on around the ring
+		/// to ranks 0 ... size - 2. Rank r handles chunk t - r at step t, so all ranks
+		/// work on different chunks at once.
+		template< typename ValueType >
+		void allReduceSum( ValueType* data, std::size_t count ) {
+			if ( mSize == 1 || count == 0 )
+				return;
+			std::size_t chunkSize = std::max< std::size_t >( mChunkBytes / sizeof( ValueType ), 1 );
+			std::size_t numChunks = ( count + chunkSize - 1 ) / chunkSize;
+			if ( mPartialSums.size( ) < chunkSize * sizeof( ValueType ) )
+				mPartialSums.resize( chunkSize * sizeof( ValueType ) );
+			ValueType* partialSums = reinterpret_cast< ValueType* >( mPartialSums.data( ) );
+			auto chunkLength = [&]( std::size_t k ) { return std::min( chunkSize, count - k * chunkSize ); };
+			for ( std::size_t step = 0; step < numChunks + 2 * mSize; ++step ) {
+				// the partial sum of chunk step - rank arrives, is added to and passed on
+				if ( step >= mRank && step - mRank < numChunks ) {
+					std::size_t k = step - mRank;
+					ValueType* chunk = data + k * chunkSize;
+					if ( mRank > 0 ) {
+						receive( partialSums, chunkLength( k ) * sizeof( ValueType ) );
+						for ( std::size_t i = 0; i < chunkLength( k ); ++i ) {
+							chunk[i] = partialSums[i] + chunk[i];
+						}
+					}
+					send( chunk, chunkLength( k ) * sizeof( ValueType ) );
+				}
+				// the sum of chunk step - size - rank comes around
+				if ( mRank + 1 < mSize && step >= mSize + mRank && step - mSize - mRank < numChunks ) {
+					std::size_t k = step - mSize - mRank;
+					ValueType* chunk = data + k * chunkSize;
+					receive( chunk, chunkLength( k ) * sizeof( ValueType ) );
+					if ( mRank + 2 < mSize )
+						send( chunk, chunkLength( k ) * sizeof( ValueType ) );
+				}
+			}
+		}
+
+		/// Replaces data[0, count) on every rank by rank 0's, passed along the ring in chunks
+		template< typename ValueType >
+		void broadcast( ValueType* data, std::size_t count ) {
+			std::size_t chunkSize = std::max< std::size_t >( mChunkBytes / sizeof( ValueType ), 1 );
+			for ( std::size_t begin = 0; begin < count && mSize > 1; begin += chunkSize ) {
+				std::size_t numBytes = std::min( chunkSize, count - begin ) * sizeof( ValueType );
+				if ( mRank > 0 )
+					receive( data + begin, numBytes );
+				if ( mRank + 1 < mSize )
+					send( data + begin, numBytes );
+			}
+		}
+
+	protected: 	//protected member functions
+		/// Sends up to numBytes without blocking, returns the number of bytes sent
+		virtual std::size_t trySend( void const* data, std::size_t numBytes ) = 0;
+		/// Receives up to numBytes without blocking, returns the number of bytes received
+		virtual std::size_t tryReceive( void* data, std::size_t numBytes ) = 0;
+
+	private: 	//private member functions
+		// takes in what the previous rank has sent so far
+		void fillBacklog( );
+
+	public: 	//public data members
+
+	private: 	//private data members
+		std::size_t mRank;
+		std::size_t mSize;
+		std::size_t mChunkBytes = default_chunk_bytes;
+		// received bytes not asked for yet, [mBacklogBegin, mBacklog.size( ))
+		std::vector< unsigned char > mBacklog;
+		std::size_t mBacklogBegin = 0;
+		std::vector< unsigned char > mPartialSums;
+	}; // end of class ProcessGroup
+
+	/**
+	 *SharedMemoryProcessGroup connects processes on one machine through a
+	 *POSIX shared memory object called name (unique to the group, e.g. with
+	 *the launching process id in it). Rank 0 creates it, the others wait for
+	 *it for up to timeoutSeconds. Every rank owns a lock free single producer
+	 *single consumer byte ring of channelBytes towards the next rank. The name
+	 *is removed once all ranks are attached.
+	 */
+	class SharedMemoryProcessGroup
+		: public ProcessGroup {
+	public: 	// public typedefs
+
+	private: 	// private typedefs
+		struct Channel;
+
+	public: 	// public static data members
+		static constexpr std::size_t default_channel_bytes = std::size_t( 1 ) << 20;
+
+	public: 	//public member functions
+		SharedMemoryProcessGroup( ) = delete;
+		explicit SharedMemoryProcessGroup( std::string const& name, std::size_t rank, std::size_t size,
+										   std::size_t channelBytes = default_channel_bytes, double timeoutSeconds = 30.0 );
+		~SharedMemoryProcessGroup( );
+
+	protected: 	//protected member functions
+		std::size_t trySend( void const* data, std::size_t numBytes ) override;
+		std::size_t tryReceive( void* data, std::size_t numBytes ) override;
+
+	private: 	//private member functions
+
+	public: 	//public data members
+
+	private: 	//private data members
+		std::string mName;
+		void* mMapping = nullptr;
+		std::size_t mMappingBytes = 0;
+		std::size_t mChannelBytes = 0;
+		Channel* mSendChannel = nullptr;
+		Channel* mReceiveChannel = nullptr;
+		bool mUnlinked = false;
+	}; // end of class SharedMemoryProcessGroup
+
+	/**
+	 *TcpProcessGroup connects processes over TCP, the fallback where shared
+	 *memory is not available (and the way to other machines). Rank r listens
+	 *on basePort + r and connects to the next rank on host, retrying for up to
+	 *timeoutSeconds while that rank is starting.
+	 */
+	class TcpProcessGroup
+		: public ProcessGroup {
+	public: 	// public typedefs
+
+	private: 	// private typedefs
+
+	public: 	//public member functions
+		TcpProcessGroup( ) = delete;
+		explicit TcpProcessGroup( std::string const& host, std::uint16_t basePort, std::size_t rank, std::size_t size,
+								  double timeoutSeconds = 30.0 );
+		~TcpProcessGroup( );
+
+	protected: 	//protected member functions
+		std::size_t trySend( void const* data, std::size_t numBytes ) override;
+		std::size_t tryReceive( void* data, std::size_t numBytes ) override;
+
+	private: 	//private member functions
+
+	public: 	//public data members
+
+	private: 	//private data members
+		int mSendSocket = -1;
+		int mReceiveSocket = -1;
+	}; // end of class TcpProcessGroup
+
+	/// Forks numProcesses processes that run task( rank ) and exit with its result
+	/// (1 when it throws), and waits for them. When one fails the others are killed,
+	/// they would wait for it forever. Returns the number of processes that failed.
+	/// Fork before starting threads, the children only get the calling thread.
+	std::size_t launchProcesses( std::size_t numProcesses, std::function< int( std::size_t ) > const& task );
+
+} // end NNet::Utils
+
+#endif // PROCESS_GROUP_HPP
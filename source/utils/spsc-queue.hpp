@@ -0,0 +1,84 @@
+#ifndef SPSC_QUEUE_HPP
+#define SPSC_QUEUE_HPP
+
+// System includes --------------------
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Own includes --------------------
+#include "utils/aligned-buffer.hpp"
+
+namespace NNet::Utils { // begin NNet::Utils
+
+	/**
+	 *SpscQueue is a bounded lock free queue between one producer thread and
+	 *one consumer thread. The capacity is rounded up to a power of two, the
+	 *producer's and the consumer's positions live on separate cache lines.
+	 */
+	template< typename ValueType >
+	class SpscQueue {
+	public: 	// public typedefs
+
+	private: 	// private typedefs
+
+	public: 	//public member functions
+		explicit SpscQueue( std::size_t capacity = 64 )
+			: mSlots( roundUpCapacity( capacity ) ), mMask( mSlots.size( ) - 1 ) {
+		}
+		SpscQueue( SpscQueue const& other ) = delete;
+		SpscQueue& operator=( SpscQueue const& rhs ) = delete;
+		~SpscQueue( ) = default;
+
+		std::size_t capacity( ) const { return mSlots.size( ); }
+		// only exact when neither thread is running
+		std::size_t size( ) const { return mTail.load( std::memory_order_acquire ) - mHead.load( std::memory_order_acquire ); }
+		bool empty( ) const { return size( ) == 0; }
+
+		// producer side, false when the queue is full
+		bool tryPush( ValueType const& value ) {
+			std::size_t tail = mTail.load( std::memory_order_relaxed );
+			if ( tail - mHead.load( std::memory_order_acquire ) == mSlots.size( ) )
+				return false;
+			mSlots[tail & mMask] = value;
+			mTail.store( tail + 1, std::memory_order_release );
+			return true;
+		}
+
+		// consumer side, false when the queue is empty
+		bool tryPop( ValueType& value ) {
+			std::size_t head = mHead.load( std::memory_order_relaxed );
+			if ( head == mTail.load( std::memory_order_acquire ) )
+				return false;
+			value = mSlots[head & mMask];
+			mHead.store( head + 1, std::memory_order_release );
+			return true;
+		}
+
+		// empties the queue, neither thread may be running
+		void clear( ) {
+			mHead.store( 0, std::memory_order_relaxed );
+			mTail.store( 0, std::memory_order_relaxed );
+		}
+
+	private: 	//private member functions
+		static std::size_t roundUpCapacity( std::size_t capacity ) {
+			std::size_t rounded = 1;
+			while ( rounded < capacity ) {
+				rounded *= 2;
+			}
+			return rounded;
+		}
+
+	public: 	//public data members
+
+	private: 	//private data members
+		std::vector< ValueType > mSlots;
+		std::size_t mMask;
+		alignas( cache_line_size ) std::atomic< std::size_t > mHead { 0 };
+		alignas( cache_line_size ) std::atomic< std::size_t > mTail { 0 };
+	}; // end of class SpscQueue
+
+} // end NNet::Utils
+
+#endif // SPSC_QUEUE_HPP
@@ -0,0 +1,245 @@
+// System includes --------------------
+#include <utility>
+
+// Eigen includes --------------------
+#include <Eigen/Core>
+
+// Own includes --------------------
+#include "aligned-buffer.hpp"
+#include "task-scheduler.hpp"
+
+namespace NNet::Utils { // begin NNet::Utils
+
+	namespace { // begin anonymous
+
+		// polls of an idle thread before it yields, and of an idle worker before it sleeps
+		constexpr std::size_t spin_polls = 64;
+		constexpr std::size_t sleep_polls = 1 << 12;
+
+		// the scheduler and deque of a worker thread
+		thread_local TaskScheduler const* tlsScheduler = nullptr;
+		thread_local std::size_t tlsDeque = 0;
+
+		std::mutex defaultMutex;
+		std::shared_ptr< TaskScheduler > defaultScheduler;
+
+	} // end anonymous
+
+	// a ring buffer of tasks that only grows when it is full, on its own cache lines
+	struct alignas( cache_line_size ) TaskScheduler::Deque {
+		struct Entry {
+			TaskType task;
+			TaskGroup* group = nullptr;
+		};
+
+		std::mutex mutex;
+		std::vector< Entry > entries;
+		std::size_t head = 0;
+		std::size_t size = 0;
+
+		explicit Deque( std::size_t capacity )
+			: entries( std::max< std::size_t >( capacity, 1 ) ) {
+		}
+
+		void pushBack( TaskType&& task, TaskGroup* group ) {
+			std::lock_guard< std::mutex > lock( mutex );
+			if ( size == entries.size( ) ) {
+				// full, unroll the ring into a buffer twice as large
+				std::vector< Entry > grown( 2 * entries.size( ) );
+				for ( std::size_t i = 0; i < size; ++i ) {
+					grown[i] = std::move( entries[( head + i ) % entries.size( )] );
+				}
+				entries.swap( grown );
+				head = 0;
+			}
+			auto& entry = entries[( head + size ) % entries.size( )];
+			entry.task = std::move( task );
+			entry.group = group;
+			++size;
+		}
+
+		// the newest task, for the owner
+		bool popBack( Entry& entry ) {
+			std::lock_guard< std::mutex > lock( mutex );
+			if ( size == 0 )
+				return false;
+			--size;
+			entry = std::move( entries[( head + size ) % entries.size( )] );
+			return true;
+		}
+
+		// the oldest task, for thieves
+		bool popFront( Entry& entry ) {
+			std::lock_guard< std::mutex > lock( mutex );
+			if ( size == 0 )
+				return false;
+			entry = std::move( entries[head] );
+			head = ( head + 1 ) % entries.size( );
+			--size;
+			return true;
+		}
+	};
+
+	TaskScheduler::TaskScheduler( std::size_t numThreads, std::size_t dequeCapacity, std::shared_ptr< NumaTopology const > topology ) {
+		// the scheduler owns the parallelism, Eigen's matrix products stay on their thread
+		Eigen::setNbThreads( 1 );
+		if ( topology && topology -> isNuma( ) )
+			mTopology = std::move( topology );
+		std::size_t numWorkers = std::max< std::size_t >( numThreads, 1 ) - 1;
+		// one deque per worker and one shared by the other threads
+		for ( std::size_t i = 0; i <= numWorkers; ++i ) {
+			mDeques.push_back( std::make_unique< Deque >( dequeCapacity ) );
+		}
+		// worker w runs on the pinned thread w + 1, thread 0 is the caller's
+		auto workerNode = [this]( std::size_t deque ) { return mTopology -> getThreadNode( deque + 1 ); };
+		mStealOrders.resize( mDeques.size( ) );
+		for ( std::size_t self = 0; self < mDeques.size( ); ++self ) {
+			auto& order = mStealOrders[self];
+			for ( std::size_t i = 1; i < mDeques.size( ); ++i ) {
+				order.push_back( ( self + i ) % mDeques.size( ) );
+			}
+			if ( mTopology && self < numWorkers ) {
+				std::stable_partition( order.begin( ), order.end( ), [&]( std::size_t other ) {
+					return other < numWorkers && workerNode( other ) == workerNode( self );
+				} );
+			}
+		}
+		mWorkers.reserve( numWorkers );
+		for ( std::size_t worker = 0; worker < numWorkers; ++worker ) {
+			mWorkers.emplace_back( [this, worker]( ) {
+				if ( mTopology )
+					pinCurrentThreadToCpus( { mTopology -> getThreadCpu( worker + 1 ) } );
+				workerLoop( worker );
+			} );
+		}
+	}
+
+	TaskScheduler::~TaskScheduler( ) {
+		{
+			std::lock_guard< std::mutex > lock( mSleepMutex );
+			mStopping.store( true );
+		}
+		mTaskAvailable.notify_all( );
+		for ( auto& worker : mWorkers ) {
+			worker.join( );
+		}
+	}
+
+	void TaskScheduler::run( TaskGroup& group, TaskType task ) {
+		group.mNumPending.fetch_add( 1, std::memory_order_relaxed );
+		mDeques[getOwnDeque( )] -> pushBack( std::move( task ), &group );
+		mNumQueued.fetch_add( 1 );
+		if ( mNumSleeping.load( ) > 0 ) {
+			// taking the mutex orders this against a worker about to sleep
+			std::lock_guard< std::mutex > lock( mSleepMutex );
+			mTaskAvailable.notify_one( );
+		}
+	}
+
+	void TaskScheduler::runOn( std::size_t deque, TaskGroup& group, TaskType task ) {
+		group.mNumPending.fetch_add( 1, std::memory_order_relaxed );
+		mDeques[deque] -> pushBack( std::move( task ), &group );
+		mNumQueued.fetch_add( 1 );
+		if ( mNumSleeping.load( ) > 0 ) {
+			// the owner of the deque may be asleep, any other would have to steal
+			std::lock_guard< std::mutex > lock( mSleepMutex );
+			mTaskAvailable.notify_all( );
+		}
+	}
+
+	void TaskScheduler::wait( TaskGroup& group ) {
+		waitQuietly( group );
+		std::exception_ptr exception;
+		{
+			std::lock_guard< std::mutex > lock( group.mMutex );
+			exception = std::exchange( group.mException, nullptr );
+		}
+		if ( exception )
+			std::rethrow_exception( exception );
+	}
+
+	std::shared_ptr< TaskScheduler > TaskScheduler::getDefault( ) {
+		std::lock_guard< std::mutex > lock( defaultMutex );
+		if ( !defaultScheduler )
+			defaultScheduler = std::make_shared< TaskScheduler >( std::max< std::size_t >( std::thread::hardware_concurrency( ), 1 ) );
+		return defaultScheduler;
+	}
+
+	void TaskScheduler::setDefault( std::shared_ptr< TaskScheduler > scheduler ) {
+		std::lock_guard< std::mutex > lock( defaultMutex );
+		defaultScheduler = std::move( scheduler );
+	}
+
+	std::size_t TaskScheduler::getCurrentNode( ) const {
+		if ( !mTopology )
+			return 0;
+		std::size_t self = getOwnDeque( );
+		return self < mWorkers.size( ) ? mTopology -> getThreadNode( self + 1 ) : mTopology -> getCurrentNode( );
+	}
+
+	std::size_t TaskScheduler::getOwnDeque( ) const {
+		return tlsScheduler == this ? tlsDeque : mWorkers.size( );
+	}
+
+	bool TaskScheduler::runOneTask( std::size_t self ) {
+		if ( mNumQueued.load( std::memory_order_relaxed ) == 0 )
+			return false;
+		Deque::Entry entry;
+		bool found = mDeques[self] -> popBack( entry );
+		for ( auto victim = mStealOrders[self].begin( ); !found && victim != mStealOrders[self].end( ); ++victim ) {
+			found = mDeques[*victim] -> popFront( entry );
+		}
+		if ( !found )
+			return false;
+		mNumQueued.fetch_sub( 1, std::memory_order_relaxed );
+		TaskGroup& group = *entry.group;
+		try {
+			entry.task( );
+		}
+		catch ( ... ) {
+			std::lock_guard< std::mutex > lock( group.mMutex );
+			if ( !group.mException )
+				group.mException = std::current_exception( );
+		}
+		// the captures may refer to the waiting thread's stack, done before it may return
+		entry.task = nullptr;
+		group.mNumPending.fetch_sub( 1, std::memory_order_release );
+		return true;
+	}
+
+	void TaskScheduler::waitQuietly( TaskGroup& group ) {
+		std::size_t self = getOwnDeque( );
+		std::size_t numPolls = 0;
+		while ( !group.isDone( ) ) {
+			if ( runOneTask( self ) )
+				numPolls = 0;
+			else if ( ++numPolls > spin_polls )
+				std::this_thread::yield( );
+		}
+	}
+
+	void TaskScheduler::workerLoop( std::size_t worker ) {
+		tlsScheduler = this;
+		tlsDeque = worker;
+		std::size_t numPolls = 0;
+		while ( true ) {
+			if ( runOneTask( worker ) ) {
+				numPolls = 0;
+				continue;
+			}
+			if ( mStopping.load( ) )
+				return;
+			if ( ++numPolls < sleep_polls ) {
+				if ( numPolls > spin_polls )
+					std::this_thread::yield( );
+				continue;
+			}
+			std::unique_lock< std::mutex > lock( mSleepMutex );
+			mNumSleeping.fetch_add( 1 );
+			mTaskAvailable.wait( lock, [this]( ) { return mStopping.load( ) || mNumQueued.load( ) > 0; } );
+			mNumSleeping.fetch_sub( 1 );
+			numPolls = 0;
+		}
+	}
+
+} // end NNet::Utils
@@ -0,0 +1,223 @@
+#ifndef TASK_SCHEDULER_HPP
+#define TASK_SCHEDULER_HPP
+
+// System includes --------------------
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Own includes --------------------
+#include "utils/numa-topology.hpp"
+
+namespace NNet::Utils { // begin NNet::Utils
+
+	/**
+	 *TaskGroup counts the unfinished tasks run in it on a TaskScheduler and
+	 *keeps the first exception one of them threw. A group must be waited for
+	 *before it goes out of scope.
+	 */
+	class TaskGroup {
+	public: 	// public typedefs
+
+	private: 	// private typedefs
+
+	public: 	//public member functions
+		TaskGroup( ) = default;
+		TaskGroup( TaskGroup const& other ) = delete;
+		TaskGroup& operator=( TaskGroup const& rhs ) = delete;
+		~TaskGroup( ) = default;
+
+		bool isDone( ) const { return mNumPending.load( std::memory_order_acquire ) == 0; }
+
+	private: 	//private member functions
+		friend class TaskScheduler;
+
+	public: 	//public data members
+
+	private: 	//private data members
+		std::atomic< std::size_t > mNumPending { 0 };
+		std::exception_ptr mException = nullptr;
+		std::mutex mMutex;
+	}; // end of class TaskGroup
+
+	/**
+	 *TaskScheduler is a work stealing task scheduler with numThreads - 1 worker
+	 *threads. Every worker owns a deque of tasks, the threads that are not
+	 *workers share one more. A thread runs the tasks of its own deque newest
+	 *first and, out of tasks, steals the oldest task of another deque. A
+	 *thread waiting for a task group runs tasks meanwhile, so tasks may run
+	 *and wait for groups of their own. Idle workers spin for a while before
+	 *they sleep. Running a small task (std::function with at most two
+	 *pointers captured) makes no heap allocations once the deques have grown.
+	 *The library's parallelism runs on schedulers (by default the shared
+	 *getDefault( )), creating one turns Eigen's own threading off so the two
+	 *don't oversubscribe the cores. Given a topology with more than one NUMA
+	 *node the workers are pinned to cores of the nodes in turn (see
+	 *NumaTopology::getThreadCpu, the calling thread is left alone) and steal
+	 *from the workers of their own node first. On a single node a topology
+	 *changes nothing.
+	 */
+	class TaskScheduler {
+	public: 	// public typedefs
+		using TaskType = std::function< void( ) >;
+
+	private: 	// private typedefs
+		struct Deque;
+
+	public: 	// public static data members
+		static constexpr std::size_t default_deque_capacity = 64;
+
+	public: 	//public member functions
+		TaskScheduler( ) = delete;
+		explicit TaskScheduler( std::size_t numThreads, std::size_t dequeCapacity = default_deque_capacity,
+								std::shared_ptr< NumaTopology const > topology = nullptr );
+		TaskScheduler( TaskScheduler const& other ) = delete;
+		TaskScheduler( TaskScheduler && other ) = delete;
+		TaskScheduler& operator=( TaskScheduler const& rhs ) = delete;
+		TaskScheduler& operator=( TaskScheduler&& rhs ) = delete;
+		/// Joins the workers, all task groups must have been waited for
+		~TaskScheduler( );
+
+		/// The workers and a calling thread
+		std::size_t getNumThreads( ) const { return mWorkers.size( ) + 1; }
+		/// The topology the workers are pinned to, nullptr unless there is more than one node
+		std::shared_ptr< NumaTopology const > const& getTopology( ) const { return mTopology; }
+		bool isNumaAware( ) const { return mTopology != nullptr; }
+		/// The thread the caller is, the index of its worker or getNumThreads( ) - 1
+		/// for threads that are not workers
+		std::size_t getCurrentThread( ) const { return getOwnDeque( ); }
+		/// The NUMA node of the caller, 0 unless NUMA aware
+		std::size_t getCurrentNode( ) const;
+
+		/// Queues task in group on the calling thread's deque
+		void run( TaskGroup& group, TaskType task );
+
+		/// Runs tasks until all tasks of group have finished, rethrows the first
+		/// exception thrown by one of them
+		void wait( TaskGroup& group );
+
+		/// Calls body( chunkBegin, chunkEnd ) for the chunks of grainSize indices of
+		/// [begin, end), the calling thread takes part
+		template< typename BodyType >
+		void parallelFor( std::size_t begin, std::size_t end, std::size_t grainSize, BodyType const& body ) {
+			if ( begin >= end )
+				return;
+			grainSize = std::max< std::size_t >( grainSize, 1 );
+			std::size_t numChunks = ( end - begin + grainSize - 1 ) / grainSize;
+			// the tasks only capture the range and a chunk index
+			struct Range {
+				BodyType const& body;
+				std::size_t begin, end, grainSize;
+
+				void operator()( std::size_t chunk ) const {
+					std::size_t chunkBegin = begin + chunk * grainSize;
+					body( chunkBegin, std::min( end, chunkBegin + grainSize ) );
+				}
+			} range{ body, begin, end, grainSize };
+			TaskGroup group;
+			for ( std::size_t chunk = 1; chunk < numChunks; ++chunk ) {
+				run( group, [&range, chunk]( ) { range( chunk ); } );
+			}
+			try {
+				range( 0 );
+			}
+			catch ( ... ) {
+				// the queued tasks refer to range
+				waitQuietly( group );
+				throw;
+			}
+			wait( group );
+		}
+
+		/// Calls body( part ) for every part of [0, numParts), part p is queued on the
+		/// deque of thread ( p + getNumThreads( ) - 1 ) mod getNumThreads( ) (part 0 and
+		/// every getNumThreads( )-th part on the calling thread). A part only moves when
+		/// it is stolen, so the same part of repeated loops mostly runs on the same thread
+		/// (and node) and finds the memory it first touched there.
+		template< typename BodyType >
+		void parallelForAffine( std::size_t numParts, BodyType const& body ) {
+			std::size_t numThreads = getNumThreads( );
+			std::size_t self = getOwnDeque( );
+			TaskGroup group;
+			for ( std::size_t part = 0; part < numParts; ++part ) {
+				std::size_t thread = ( part + numThreads - 1 ) % numThreads;
+				if ( thread != self )
+					runOn( thread, group, [&body, part]( ) { body( part ); } );
+			}
+			try {
+				for ( std::size_t part = 0; part < numParts; ++part ) {
+					if ( ( part + numThreads - 1 ) % numThreads == self )
+						body( part );
+				}
+			}
+			catch ( ... ) {
+				// the queued tasks refer to body
+				waitQuietly( group );
+				throw;
+			}
+			wait( group );
+		}
+
+		/// Reduces [begin, end) in chunks of grainSize indices, map( chunkBegin, chunkEnd )
+		/// gives a chunk's value and the values are combined in chunk order starting
+		/// from identity, so the result does not depend on scheduling
+		template< typename ValueType, typename MapType, typename CombineType >
+		ValueType parallelReduce( std::size_t begin, std::size_t end, std::size_t grainSize, ValueType identity,
+								  MapType const& map, CombineType const& combine ) {
+			if ( begin >= end )
+				return identity;
+			grainSize = std::max< std::size_t >( grainSize, 1 );
+			std::size_t numChunks = ( end - begin + grainSize - 1 ) / grainSize;
+			std::vector< ValueType > values( numChunks, identity );
+			parallelFor( 0, numChunks, 1, [&]( std::size_t chunk, std::size_t ) {
+				std::size_t chunkBegin = begin + chunk * grainSize;
+				values[chunk] = map( chunkBegin, std::min( end, chunkBegin + grainSize ) );
+			} );
+			ValueType result = identity;
+			for ( auto const& value : values ) {
+				result = combine( result, value );
+			}
+			return result;
+		}
+
+		/// The scheduler shared by default, with a thread per hardware thread
+		static std::shared_ptr< TaskScheduler > getDefault( );
+		/// Replaces the shared scheduler (users of the old one keep it)
+		static void setDefault( std::shared_ptr< TaskScheduler > scheduler );
+
+	private: 	//private member functions
+		// the deque of the calling thread
+		std::size_t getOwnDeque( ) const;
+		// queues task on the given deque
+		void runOn( std::size_t deque, TaskGroup& group, TaskType task );
+		// runs a task of deque self or, without one, a task stolen from another deque,
+		// returns false when there was none
+		bool runOneTask( std::size_t self );
+		void waitQuietly( TaskGroup& group );
+		void workerLoop( std::size_t worker );
+
+	public: 	//public data members
+
+	private: 	//private data members
+		std::vector< std::unique_ptr< Deque > > mDeques;
+		// the deques a thread looks at after its own, own node first
+		std::vector< std::vector< std::size_t > > mStealOrders;
+		std::shared_ptr< NumaTopology const > mTopology;
+		std::vector< std::thread > mWorkers;
+		std::atomic< std::size_t > mNumQueued { 0 };
+		std::atomic< std::size_t > mNumSleeping { 0 };
+		std::atomic< bool > mStopping { false };
+		std::mutex mSleepMutex;
+		std::condition_variable mTaskAvailable;
+	}; // end of class TaskScheduler
+
+} // end NNet::Utils
+
+#endif // TASK_SCHEDULER_HPP
@@ -0,0 +1,91 @@
+// System includes --------------------
+#include <algorithm>
+#include <utility>
+
+// Own includes --------------------
+#include "thread-pool.hpp"
+
+namespace NNet::Utils { // begin NNet::Utils
+
+	ThreadPool::ThreadPool( std::size_t numThreads, std::size_t taskCapacity )
+		: mTasks( std::max< std::size_t >( taskCapacity, 1 ) ) {
+		mWorkers.reserve( numThreads );
+		for ( std::size_t i = 0; i < numThreads; ++i ) {
+			mWorkers.emplace_back( [this]( ) { workerLoop( ); } );
+		}
+	}
+
+	ThreadPool::~ThreadPool( ) {
+		{
+			std::lock_guard< std::mutex > lock( mMutex );
+			mStopping = true;
+		}
+		mTaskAvailable.notify_all( );
+		for ( auto& worker : mWorkers ) {
+			worker.join( );
+		}
+	}
+
+	void ThreadPool::submit( TaskType task ) {
+		if ( mWorkers.empty( ) ) {
+			// no workers, run in the calling thread
+			task( );
+			return;
+		}
+		{
+			std::lock_guard< std::mutex > lock( mMutex );
+			if ( mNumQueued == mTasks.size( ) ) {
+				// full, unroll the ring into a buffer twice as large
+				std::vector< TaskType > tasks( 2 * mTasks.size( ) );
+				for ( std::size_t i = 0; i < mNumQueued; ++i ) {
+					tasks[i] = std::move( mTasks[( mTaskHead + i ) % mTasks.size( )] );
+				}
+				mTasks.swap( tasks );
+				mTaskHead = 0;
+			}
+			mTasks[( mTaskHead + mNumQueued ) % mTasks.size( )] = std::move( task );
+			++mNumQueued;
+			++mNumUnfinished;
+		}
+		mTaskAvailable.notify_one( );
+	}
+
+	void ThreadPool::wait( ) {
+		std::unique_lock< std::mutex > lock( mMutex );
+		mTasksFinished.wait( lock, [this]( ) { return mNumUnfinished == 0; } );
+		if ( mException ) {
+			auto exception = std::exchange( mException, nullptr );
+			std::rethrow_exception( exception );
+		}
+	}
+
+	void ThreadPool::workerLoop( ) {
+		std::unique_lock< std::mutex > lock( mMutex );
+		while ( true ) {
+			mTaskAvailable.wait( lock, [this]( ) { return mStopping || mNumQueued > 0; } );
+			if ( mNumQueued == 0 ) {
+				// stopping and drained
+				return;
+			}
+			TaskType task = std::move( mTasks[mTaskHead] );
+			mTaskHead = ( mTaskHead + 1 ) % mTasks.size( );
+			--mNumQueued;
+			lock.unlock( );
+			std::exception_ptr exception = nullptr;
+			try {
+				task( );
+			}
+			catch ( ... ) {
+				exception = std::current_exception( );
+			}
+			lock.lock( );
+			if ( exception && !mException ) {
+				mException = exception;
+			}
+			if ( --mNumUnfinished == 0 ) {
+				mTasksFinished.notify_all( );
+			}
+		}
+	}
+
+} // end NNet::Utils
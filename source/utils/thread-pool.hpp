@@ -0,0 +1,67 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+// System includes --------------------
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace NNet::Utils { // begin NNet::Utils
+
+	/**
+	 *ThreadPool runs submitted tasks on a fixed set of worker threads. Tasks
+	 *are kept in a ring buffer that only grows when it is full, so submitting
+	 *small tasks (std::function with at most two pointers captured) makes no
+	 *heap allocations once the pool is warmed up.
+	 */
+	class ThreadPool {
+	public: 	// public typedefs
+		using TaskType = std::function< void( ) >;
+
+	private: 	// private typedefs
+
+	public: 	//public member functions
+		ThreadPool( ) = delete;
+		explicit ThreadPool( std::size_t numThreads, std::size_t taskCapacity = 64 );
+
+		ThreadPool( ThreadPool const& other ) = delete;
+		ThreadPool( ThreadPool && other ) = delete;
+		ThreadPool& operator=( ThreadPool const& rhs ) = delete;
+		ThreadPool& operator=( ThreadPool&& rhs ) = delete;
+		/// Finishes all pending tasks and joins the workers
+		~ThreadPool( );
+
+		std::size_t getNumThreads( ) const { return mWorkers.size( ); }
+
+		/// Queue a task for execution on one of the workers
+		void submit( TaskType task );
+
+		/// Block until all submitted tasks have finished, rethrows the first
+		/// exception thrown by a task
+		void wait( );
+
+	private: 	//private member functions
+		void workerLoop( );
+
+	public: 	//public data members
+
+	private: 	//private data members
+		std::vector< std::thread > mWorkers;
+		std::vector< TaskType > mTasks;
+		std::size_t mTaskHead = 0;
+		std::size_t mNumQueued = 0;
+		std::size_t mNumUnfinished = 0;
+		bool mStopping = false;
+		std::exception_ptr mException = nullptr;
+		std::mutex mMutex;
+		std::condition_variable mTaskAvailable;
+		std::condition_variable mTasksFinished;
+	}; // end of class ThreadPool
+
+} // end NNet::Utils
+
+#endif // THREAD_POOL_HPP
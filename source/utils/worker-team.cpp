@@ -0,0 +1,107 @@
+// System includes --------------------
+#include <algorithm>
+#include <utility>
+
+// Own includes --------------------
+#include "worker-team.hpp"
+
+namespace NNet::Utils { // begin NNet::Utils
+
+	namespace { // begin anonymous
+
+		// tells the core that the thread is spin waiting
+		inline void cpuRelax( ) {
+#if defined( __x86_64__ ) || defined( __i386__ )
+			__builtin_ia32_pause( );
+#endif
+		}
+
+	} // end anonymous
+
+	WorkerTeam::WorkerTeam( std::size_t numThreads, std::size_t spinCount, bool pinThreads,
+							std::shared_ptr< NumaTopology const > topology )
+		: mSpinCount( spinCount ) {
+		if ( pinThreads )
+			mTopology = topology ? std::move( topology ) : std::make_shared< NumaTopology >( );
+		numThreads = std::max< std::size_t >( numThreads, 1 );
+		mWorkers.reserve( numThreads - 1 );
+		for ( std::size_t member = 1; member < numThreads; ++member ) {
+			mWorkers.emplace_back( [this, member]( ) { workerLoop( member ); } );
+		}
+	}
+
+	WorkerTeam::~WorkerTeam( ) {
+		{
+			std::lock_guard< std::mutex > lock( mMutex );
+			mStopping.store( true );
+			mGeneration.fetch_add( 1 );
+		}
+		mTaskAvailable.notify_all( );
+		for ( auto& worker : mWorkers ) {
+			worker.join( );
+		}
+	}
+
+	void WorkerTeam::runTask( InvokeType invoke, void const* task ) {
+		mInvoke = invoke;
+		mTask = task;
+		mNumPending.store( mWorkers.size( ) );
+		// the workers read the task after they see the new generation
+		mGeneration.fetch_add( 1 );
+		if ( mNumSleeping.load( ) > 0 ) {
+			std::lock_guard< std::mutex > lock( mMutex );
+			mTaskAvailable.notify_all( );
+		}
+		runMember( 0 );
+		for ( std::size_t spin = 0; spin < mSpinCount && mNumPending.load( std::memory_order_acquire ) > 0; ++spin ) {
+			cpuRelax( );
+		}
+		if ( mNumPending.load( ) > 0 ) {
+			std::unique_lock< std::mutex > lock( mMutex );
+			mCallerSleeping.store( true );
+			mTaskFinished.wait( lock, [this]( ) { return mNumPending.load( ) == 0; } );
+			mCallerSleeping.store( false );
+		}
+		if ( mException ) {
+			auto exception = std::exchange( mException, nullptr );
+			std::rethrow_exception( exception );
+		}
+	}
+
+	void WorkerTeam::runMember( std::size_t member ) {
+		try {
+			mInvoke( mTask, member );
+		}
+		catch ( ... ) {
+			std::lock_guard< std::mutex > lock( mMutex );
+			if ( !mException )
+				mException = std::current_exception( );
+		}
+	}
+
+	void WorkerTeam::workerLoop( std::size_t member ) {
+		if ( mTopology )
+			pinCurrentThreadToCpus( { mTopology -> getThreadCpu( member ) } );
+		std::size_t seenGeneration = 0;
+		while ( true ) {
+			for ( std::size_t spin = 0; spin < mSpinCount && mGeneration.load( std::memory_order_acquire ) == seenGeneration; ++spin ) {
+				cpuRelax( );
+			}
+			if ( mGeneration.load( ) == seenGeneration ) {
+				std::unique_lock< std::mutex > lock( mMutex );
+				mNumSleeping.fetch_add( 1 );
+				mTaskAvailable.wait( lock, [this, seenGeneration]( ) { return mGeneration.load( ) != seenGeneration; } );
+				mNumSleeping.fetch_sub( 1 );
+			}
+			seenGeneration = mGeneration.load( );
+			if ( mStopping.load( ) )
+				return;
+			runMember( member );
+			if ( mNumPending.fetch_sub( 1 ) == 1 && mCallerSleeping.load( ) ) {
+				std::lock_guard< std::mutex > lock( mMutex );
+				mTaskFinished.notify_one( );
+			}
+		}
+	}
+
+} // end NNet::Utils
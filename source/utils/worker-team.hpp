@@ -0,0 +1,87 @@
+#ifndef WORKER_TEAM_HPP
+#define WORKER_TEAM_HPP
+
+// System includes --------------------
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Own includes --------------------
+#include "utils/aligned-buffer.hpp"
+#include "utils/numa-topology.hpp"
+
+namespace NNet::Utils { // begin NNet::Utils
+
+	/**
+	 *WorkerTeam is a fixed team of numThreads members, the calling thread is
+	 *member 0 and numThreads - 1 persistent workers are the others. run( task )
+	 *calls task( member ) on every member at once and returns when all have
+	 *finished, a member always runs on the same thread. Waiting members spin
+	 *for spinCount polls before they block, with pinThreads member m is bound
+	 *to the cpu topology.getThreadCpu( m ) like the workers of a TaskScheduler
+	 *(the calling thread is left alone, the default topology is the cpuset).
+	 *run makes no heap allocations.
+	 */
+	class WorkerTeam {
+	public: 	// public typedefs
+
+	private: 	// private typedefs
+		using InvokeType = void (*)( void const*, std::size_t );
+
+	public: 	// public static data members
+		static constexpr std::size_t default_spin_count = 1 << 14;
+
+	public: 	//public member functions
+		WorkerTeam( ) = delete;
+		explicit WorkerTeam( std::size_t numThreads, std::size_t spinCount = 0, bool pinThreads = false,
+							 std::shared_ptr< NumaTopology const > topology = nullptr );
+		WorkerTeam( WorkerTeam const& other ) = delete;
+		WorkerTeam( WorkerTeam && other ) = delete;
+		WorkerTeam& operator=( WorkerTeam const& rhs ) = delete;
+		WorkerTeam& operator=( WorkerTeam&& rhs ) = delete;
+		/// Joins the workers
+		~WorkerTeam( );
+
+		std::size_t getNumThreads( ) const { return mWorkers.size( ) + 1; }
+		std::size_t getSpinCount( ) const { return mSpinCount; }
+		void setSpinCount( std::size_t spinCount ) { mSpinCount = spinCount; }
+
+		/// Run task( member ) on all members, rethrows the first exception thrown
+		/// by a member
+		template< typename TaskType >
+		void run( TaskType const& task ) {
+			runTask( []( void const* taskPtr, std::size_t member ) { ( *static_cast< TaskType const* >( taskPtr ) )( member ); }, &task );
+		}
+
+	private: 	//private member functions
+		void runTask( InvokeType invoke, void const* task );
+		void runMember( std::size_t member );
+		void workerLoop( std::size_t member );
+
+	public: 	//public data members
+
+	private: 	//private data members
+		std::shared_ptr< NumaTopology const > mTopology;
+		std::vector< std::thread > mWorkers;
+		std::size_t mSpinCount;
+		InvokeType mInvoke = nullptr;
+		void const* mTask = nullptr;
+		alignas( cache_line_size ) std::atomic< std::size_t > mGeneration { 0 };
+		alignas( cache_line_size ) std::atomic< std::size_t > mNumPending { 0 };
+		std::atomic< std::size_t > mNumSleeping { 0 };
+		std::atomic< bool > mCallerSleeping { false };
+		std::atomic< bool > mStopping { false };
+		std::exception_ptr mException = nullptr;
+		std::mutex mMutex;
+		std::condition_variable mTaskAvailable;
+		std::condition_variable mTaskFinished;
+	}; // end of class WorkerTeam
+
+} // end NNet::Utils
+
+#endif // WORKER_TEAM_HPP
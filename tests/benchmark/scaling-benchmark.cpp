@@ -0,0 +1,111 @@
+// System includes --------------------
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Own includes --------------------
+#include "layers/activation-layer.hpp"
+#include "layers/fully-connected-layer.hpp"
+#include "networks/neural-network.hpp"
+#include "initializers/weight-initializer.hpp"
+#include "networks/network-trainer.hpp"
+#include "optimizers/optimizers.hpp"
+#include "data-handlers/data-handlers.hpp"
+
+using namespace NNet;
+
+// Data parallel scaling of NetworkTrainer::trainEpoch on the minst network
+// (784-300-100-10), timed for 1, 2, 4, ... gradient threads. Uses the minst
+// training images when found, random images otherwise.
+//   usage: benchmark [num_samples] [batch_size] [micro_batch_size]
+int main( int argc, char** argv ) {
+
+	using NumericTraitsType = NumericTraits< double >;
+	using VectorXType = NumericTraitsType::VectorXType;
+	using DataHandlerType = RegressionDataHandler< VectorXType, VectorXType >;
+	using FullyConnectedLayerType = FullyConnectedLayer< NumericTraitsType >;
+	using ActLayerType = ActivationLayer< NumericTraitsType, LogisticActivation >;
+	using SoftMaxActLayerType = ActivationLayer< NumericTraitsType, SoftMaxActivation >;
+	using InitializerType = GlorotInitializer< NumericTraitsType >;
+	using NetworkType = NeuralNetwork< NumericTraitsType, InitializerType >;
+	using OptimizerType = NesterovMomentumOptimizer< NetworkType >;
+	using NetworkTrainerType = NetworkTrainer< NetworkType, OptimizerType, CrossEntropyLossFuction, DataHandlerType >;
+
+	std::size_t numSamples = argc > 1 ? std::strtoul( argv[1], nullptr, 10 ) : 10000;
+	std::size_t batchSize = argc > 2 ? std::strtoul( argv[2], nullptr, 10 ) : 256;
+	std::size_t microBatchSize = argc > 3 ? std::strtoul( argv[3], nullptr, 10 ) : 32;
+
+	// import data
+	DataHandlerType dataHandler;
+	std::string trainingImagesPath = "../tests/data/minst/train-images.idx3-ubyte";
+	std::string trainingLabelsPath = "../tests/data/minst/train-labels.idx1-ubyte";
+	std::string testImagesPath = "../tests/data/minst/t10k-images.idx3-ubyte";
+	std::string testLabelsPath = "../tests/data/minst/t10k-labels.idx1-ubyte";
+	if ( std::filesystem::exists( trainingImagesPath ) && std::filesystem::exists( trainingLabelsPath ) ) {
+		MINSTDataHandler< VectorXType, VectorXType > minstDataHandler( trainingImagesPath, trainingLabelsPath, testImagesPath, testLabelsPath );
+		auto const& trainingData = minstDataHandler.getTrainingData( );
+		dataHandler.getTrainingData( ).assign( trainingData.begin( ), trainingData.begin( ) + std::min( numSamples, trainingData.size( ) ) );
+	}
+	else {
+		std::cout << "minst data not found, using random images" << std::endl;
+		std::mt19937 g( 7 );
+		std::uniform_real_distribution< double > pixel( 0.0, 1.0 );
+		for ( std::size_t i = 0; i < numSamples; ++i ) {
+			VectorXType input( 784 ), target = VectorXType::Zero( 10 );
+			for ( auto& value : input ) {
+				value = pixel( g );
+			}
+			target( i % 10 ) = 1.0;
+			dataHandler.getTrainingData( ).emplace_back( input, target );
+		}
+	}
+	numSamples = dataHandler.getTrainingData( ).size( );
+
+	std::size_t maxThreads = std::max< std::size_t >( std::thread::hardware_concurrency( ), 1 );
+	std::vector< std::size_t > threadCounts;
+	for ( std::size_t numThreads = 1; numThreads < maxThreads; numThreads *= 2 ) {
+		threadCounts.push_back( numThreads );
+	}
+	threadCounts.push_back( maxThreads );
+
+	std::cout << numSamples << " samples, batch size " << batchSize << ", micro batch size " << microBatchSize << std::endl;
+	std::cout << std::setw( 8 ) << "threads" << std::setw( 14 ) << "epoch [s]" << std::setw( 14 ) << "samples/s"
+			  << std::setw( 10 ) << "speedup" << std::setw( 12 ) << "efficiency" << std::setw( 12 ) << "loss" << std::endl;
+	double baseTime = 0.0;
+	for ( auto numThreads : threadCounts ) {
+		NetworkType nnet;
+		nnet.getInitializer( ).getRandomEngine( ).seed( 7 );
+		nnet.addLayer( std::make_shared< FullyConnectedLayerType >( 784, 300, LayerType::INPUT ) );
+		nnet.addLayer( std::make_shared< ActLayerType >( 300 ) );
+		nnet.addLayer( std::make_shared< FullyConnectedLayerType >( 300, 100, LayerType::HIDDEN ) );
+		nnet.addLayer( std::make_shared< ActLayerType >( 100 ) );
+		nnet.addLayer( std::make_shared< FullyConnectedLayerType >( 100, 10, LayerType::HIDDEN ) );
+		nnet.addLayer( std::make_shared< SoftMaxActLayerType >( 10 ) );
+		nnet.finalize( );
+		OptimizerType optimizer( nnet );
+		DataHandlerType trainerDataHandler( dataHandler );
+		NetworkTrainerType networkTrainer( nnet, optimizer, trainerDataHandler );
+		networkTrainer.setNumGradientThreads( numThreads );
+		networkTrainer.setMicroBatchSize( microBatchSize );
+		networkTrainer.setDataParallel( true );
+
+		// the first epoch sizes the replicas and work buffers
+		networkTrainer.trainEpoch( batchSize );
+		auto start = std::chrono::steady_clock::now( );
+		double loss = networkTrainer.trainEpoch( batchSize );
+		double seconds = std::chrono::duration< double >( std::chrono::steady_clock::now( ) - start ).count( );
+		if ( numThreads == 1 )
+			baseTime = seconds;
+		double speedup = baseTime / seconds;
+		std::cout << std::setw( 8 ) << numThreads << std::setw( 14 ) << seconds << std::setw( 14 ) << static_cast< double >( numSamples ) / seconds
+				  << std::setw( 10 ) << speedup << std::setw( 12 ) << speedup / static_cast< double >( numThreads ) << std::setw( 12 ) << loss << std::endl;
+	}
+
+	return 0;
+}
@@ -1,5 +1,14 @@
 // System includes --------------------
 #include <numeric>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <tuple>
+#include <sched.h>
+#include <unistd.h>
 
 // GTest includes --------------------
 #include "gtest/gtest.h"
@@ -11,9 +20,61 @@
 #include "nnet/layers/fully-connected-layer.hpp"
 #include "nnet/initializers/weight-initializer.hpp"
 #include "nnet/networks/neural-network.hpp"
+#include "nnet/networks/network-trainer.hpp"
+#include "nnet/networks/hyperparameter-search.hpp"
+#include "nnet/networks/network-ensemble.hpp"
+#include "nnet/networks/numa-predictor.hpp"
+#include "nnet/networks/parameter-server.hpp"
+#include "nnet/optimizers/optimizers.hpp"
+#include "nnet/optimizers/variance-reduced-optimizers.hpp"
+#include "nnet/optimizers/quasi-newton-optimizers.hpp"
+#include "nnet/data-handlers/data-handlers.hpp"
+#include "nnet/schedules/learning-rate-schedules.hpp"
+#include "nnet/schedules/early-stopping.hpp"
+#include "utils/allocation-counter.hpp"
+#include "utils/aligned-buffer.hpp"
+#include "utils/mapped-file.hpp"
+#include "utils/process-group.hpp"
+#include "utils/parameter-socket.hpp"
+#include "utils/task-scheduler.hpp"
+#include "utils/numa-topology.hpp"
+#include "utils/worker-team.hpp"
 
 using namespace NNet;
 
+// Fixtures shared by the training tests --------------------
+
+using WaveDataHandlerType = RegressionDataHandler< NumericTraits< double >::VectorXType, NumericTraits< double >::VectorXType >;
+
+// numSamples samples of smooth curves of the sample index i, the inputs are the leading
+// numInputs of ( 0.1 i, cos( 0.3 i ), sin( 0.2 i ) ), the targets the leading numTargets
+// of ( sin( 0.1 i ), cos( 0.3 i ), 0.5 - 0.5 sin( 0.1 i ) )
+WaveDataHandlerType makeWaveData( std::size_t numSamples, std::size_t numInputs = 2, std::size_t numTargets = 1 ) {
+	WaveDataHandlerType dataHandler;
+	for ( std::size_t i = 0; i < numSamples; ++i ) {
+		Eigen::VectorXd input( 3 ), target( 3 );
+		input << 0.1 * i, std::cos( 0.3 * i ), std::sin( 0.2 * i );
+		target << std::sin( 0.1 * i ), std::cos( 0.3 * i ), 0.5 - 0.5 * std::sin( 0.1 * i );
+		dataHandler.getTrainingData( ).emplace_back( input.head( numInputs ), target.head( numTargets ) );
+	}
+	return dataHandler;
+}
+
+// dense layers of the given sizes with ActLayerType activations between them, finalized
+// unless more layers follow
+template< typename ActLayerType, typename NetworkType >
+void buildDenseNetwork( NetworkType& nnet, std::vector< std::size_t > const& layerSizes, bool finalize = true ) {
+	using FullyConnectedLayerType = FullyConnectedLayer< typename NetworkType::NumericTraitsType >;
+	for ( std::size_t i = 0; i + 1 < layerSizes.size( ); ++i ) {
+		if ( i > 0 )
+			nnet.addLayer( std::make_shared< ActLayerType >( layerSizes[i] ) );
+		LayerType layerType = i == 0 ? LayerType::INPUT : ( i + 2 == layerSizes.size( ) && finalize ? LayerType::OUTPUT : LayerType::HIDDEN );
+		nnet.addLayer( std::make_shared< FullyConnectedLayerType >( layerSizes[i], layerSizes[i + 1], layerType ) );
+	}
+	if ( finalize )
+		nnet.finalize( );
+}
+
 TEST( Eigen, UnaryExpr ) {
 	Eigen::MatrixXd mat( 2, 2 );
 	mat << 2, 2, 2, 2;
@@ -32,6 +93,144 @@ TEST( Eigen, UnaryExpr ) {
 	ASSERT_EQ( mat_inv_base, mat_inv );
 }
 
+TEST( Utils, TaskScheduler ) {
+	Utils::TaskScheduler scheduler( 4 ), serialScheduler( 1 );
+	ASSERT_EQ( scheduler.getNumThreads( ), 4u );
+
+	// every index exactly once, also with nested loops run by the waiting threads
+	std::vector< std::atomic< int > > counts( 10000 );
+	scheduler.parallelFor( 0, counts.size( ), 7, [&]( std::size_t begin, std::size_t end ) {
+		for ( std::size_t i = begin; i < end; ++i ) {
+			counts[i].fetch_add( 1 );
+		}
+	} );
+	scheduler.parallelFor( 0, 10, 1, [&]( std::size_t outer, std::size_t ) {
+		scheduler.parallelFor( outer * 1000, ( outer + 1 ) * 1000, 16, [&]( std::size_t begin, std::size_t end ) {
+			for ( std::size_t i = begin; i < end; ++i ) {
+				counts[i].fetch_add( 1 );
+			}
+		} );
+	} );
+	ASSERT_TRUE( std::all_of( counts.begin( ), counts.end( ), []( auto const& count ) { return count.load( ) == 2; } ) );
+
+	// reductions combine in chunk order, the same bits on any number of threads
+	std::vector< double > values( 5000 );
+	for ( std::size_t i = 0; i < values.size( ); ++i ) {
+		values[i] = std::sin( 0.37 * i ) * std::pow( 10.0, static_cast< double >( i % 17 ) - 8.0 );
+	}
+	auto sumChunk = [&values]( std::size_t begin, std::size_t end ) { return std::accumulate( values.begin( ) + begin, values.begin( ) + end, 0.0 ); };
+	auto plus = []( double lhs, double rhs ) { return lhs + rhs; };
+	double sum = scheduler.parallelReduce( 0, values.size( ), 64, 0.0, sumChunk, plus );
+	ASSERT_EQ( sum, serialScheduler.parallelReduce( 0, values.size( ), 64, 0.0, sumChunk, plus ) );
+	double chunkSum = 0.0;
+	for ( std::size_t begin = 0; begin < values.size( ); begin += 64 ) {
+		chunkSum += sumChunk( begin, std::min( values.size( ), begin + 64 ) );
+	}
+	ASSERT_EQ( sum, chunkSum );
+
+	// a task's exception reaches the waiting thread, the scheduler stays usable
+	ASSERT_THROW( scheduler.parallelFor( 0, 100, 1, []( std::size_t begin, std::size_t ) {
+		if ( begin == 57 )
+			throw std::runtime_error( "task 57 fails" );
+	} ), std::runtime_error );
+	Utils::TaskGroup group;
+	std::atomic< std::size_t > numRun { 0 };
+	for ( std::size_t i = 0; i < 200; ++i ) {
+		scheduler.run( group, [&numRun]( ) { numRun.fetch_add( 1 ); } );
+	}
+	scheduler.wait( group );
+	ASSERT_EQ( numRun.load( ), 200u );
+
+	// once the deques have grown, small tasks make no allocations
+	if ( Utils::AllocationCounter::isEnabled( ) ) {
+		Utils::AllocationScope scope;
+		for ( std::size_t i = 0; i < 200; ++i ) {
+			scheduler.run( group, [&numRun]( ) { numRun.fetch_add( 1 ); } );
+		}
+		scheduler.wait( group );
+		ASSERT_EQ( scope.getStats( ).numAllocations, 0u );
+	}
+}
+
+// a sysfs node directory of two nodes (sharing the first cpu of the cpuset, so it can be pinned anywhere)
+// and a memory only node
+std::shared_ptr< Utils::NumaTopology const > makeTwoNodeTopology( ) {
+	auto sysfsPath = std::filesystem::temp_directory_path( ) / ( "nnet-numa-" + std::to_string( getpid( ) ) );
+	std::string cpuList = std::to_string( Utils::getAllowedCpus( ).front( ) ) + "\n";
+	for ( auto const& [node, nodeCpuList] : { std::pair{ "node0", cpuList }, std::pair{ "node1", cpuList }, std::pair{ "node3", std::string( "\n" ) } } ) {
+		std::filesystem::create_directories( sysfsPath / node );
+		std::ofstream( sysfsPath / node / "cpulist" ) << nodeCpuList;
+	}
+	std::ofstream( sysfsPath / "online" ) << "0-1,3\n";
+	auto topology = std::make_shared< Utils::NumaTopology >( Utils::NumaTopology::detect( sysfsPath.string( ) ) );
+	std::filesystem::remove_all( sysfsPath );
+	return topology;
+}
+
+TEST( Utils, NumaTopology ) {
+	ASSERT_EQ( Utils::NumaTopology::parseCpuList( "0-3,8,10-11\n" ), ( std::vector< std::size_t >{ 0, 1, 2, 3, 8, 10, 11 } ) );
+	ASSERT_TRUE( Utils::NumaTopology::parseCpuList( "" ).empty( ) );
+	ASSERT_THROW( Utils::NumaTopology::parseCpuList( "0-" ), std::runtime_error );
+	ASSERT_THROW( Utils::NumaTopology::parseCpuList( "3-1" ), std::runtime_error );
+
+	// nodes without cpus are left out
+	auto topology = makeTwoNodeTopology( );
+	ASSERT_TRUE( topology -> isNuma( ) );
+	ASSERT_EQ( topology -> getNumNodes( ), 2u );
+	ASSERT_EQ( topology -> getNodeId( 1 ), 1u );
+	ASSERT_EQ( topology -> getThreadNode( 3 ), 1u );
+	ASSERT_EQ( topology -> getThreadCpu( 3 ), Utils::getAllowedCpus( ).front( ) );
+	Utils::NumaTopology explicitTopology( { { 0, 1 }, { }, { 2, 3 } } );
+	ASSERT_EQ( explicitTopology.getNumNodes( ), 2u );
+	ASSERT_EQ( explicitTopology.getNodeId( 1 ), 2u );
+	ASSERT_EQ( explicitTopology.getNodeOfCpu( 3 ), 1u );
+	// threads go to the nodes in turn
+	ASSERT_EQ( explicitTopology.getThreadCpu( 0 ), 0u );
+	ASSERT_EQ( explicitTopology.getThreadCpu( 1 ), 2u );
+	ASSERT_EQ( explicitTopology.getThreadCpu( 2 ), 1u );
+
+	// without sysfs nodes, and on a single node, NUMA awareness is a no-op
+	auto fallback = Utils::NumaTopology::detect( "/nonexistent/sys/devices/system/node" );
+	ASSERT_EQ( fallback.getNumNodes( ), 1u );
+	ASSERT_EQ( fallback.getCpus( 0 ), Utils::getAllowedCpus( ) );
+	ASSERT_FALSE( fallback.isNuma( ) );
+	Utils::TaskScheduler singleNodeScheduler( 2, Utils::TaskScheduler::default_deque_capacity, std::make_shared< Utils::NumaTopology >( fallback ) );
+	ASSERT_FALSE( singleNodeScheduler.isNumaAware( ) );
+	ASSERT_EQ( singleNodeScheduler.getCurrentNode( ), 0u );
+
+	// pinned workers, every part exactly once and part 0 on the calling thread
+	Utils::TaskScheduler scheduler( 4, Utils::TaskScheduler::default_deque_capacity, topology );
+	ASSERT_TRUE( scheduler.isNumaAware( ) );
+	std::vector< std::atomic< int > > counts( 11 );
+	std::size_t callerThread = scheduler.getCurrentThread( );
+	std::size_t partZeroThread = 0;
+	for ( std::size_t loop = 0; loop < 3; ++loop ) {
+		scheduler.parallelForAffine( counts.size( ), [&]( std::size_t part ) {
+			counts[part].fetch_add( 1 );
+			if ( part == 0 )
+				partZeroThread = scheduler.getCurrentThread( );
+			ASSERT_LT( scheduler.getCurrentNode( ), 2u );
+		} );
+	}
+	ASSERT_EQ( callerThread, 3u );
+	ASSERT_EQ( partZeroThread, callerThread );
+	ASSERT_TRUE( std::all_of( counts.begin( ), counts.end( ), []( auto const& count ) { return count.load( ) == 3; } ) );
+
+	// a pinned worker team places its members like the scheduler, on cpus of the cpuset
+	Utils::WorkerTeam team( 3, 0, true, topology );
+	std::vector< int > memberCpus( 3, -1 );
+	team.run( [&memberCpus]( std::size_t member ) { memberCpus[member] = sched_getcpu( ); } );
+	ASSERT_EQ( memberCpus[1], static_cast< int >( topology -> getThreadCpu( 1 ) ) );
+	ASSERT_EQ( memberCpus[2], static_cast< int >( topology -> getThreadCpu( 2 ) ) );
+
+	// binding is best effort, the memory keeps its contents either way
+	Utils::AlignedBuffer< double > buffer( 1 << 16 );
+	buffer[12345] = 1.5;
+	Utils::bindMemoryToNode( buffer.data( ), buffer.size( ) * sizeof( double ), 0 );
+	ASSERT_FALSE( Utils::bindMemoryToNode( buffer.data( ) + 1, 16, 0 ) );
+	ASSERT_EQ( buffer[12345], 1.5 );
+}
+
 TEST( Serialization, ArchiveStreams ) {
 	using ArchiveOutType = boost::archive::text_oarchive;
 	std::vector< std::size_t > data( 10 );
@@ -130,3 +329,1821 @@ TEST( Serialization, NeuralNetwork ) {
 	}
 	ASSERT_EQ( nnet_in, nnet_out );
 }
+
+TEST( Serialization, BlockDiagonalLayer ) {
+	using ArchiveType = boost::archive::text_oarchive;
+	using NumericTraitsType = NumericTraits< double >;
+	using VectorXType = NumericTraitsType::VectorXType;
+	using ActLayerType = ActivationLayer< NumericTraitsType, TanHActivation >;
+	using InitializerType = GlorotInitializer< NumericTraitsType >;
+	using NetworkType = NeuralNetwork< NumericTraitsType, InitializerType >;
+	using BlockDiagonalLayerType = BlockDiagonalLayer< NumericTraitsType >;
+
+	// the stacked network of an ensemble, its later fully connected layers are block diagonal
+	std::vector< std::unique_ptr< NetworkType > > members;
+	std::vector< NetworkType* > memberPtrs;
+	for ( std::size_t m = 0; m < 3; ++m ) {
+		members.push_back( std::make_unique< NetworkType >( ) );
+		buildDenseNetwork< ActLayerType >( *members.back( ), { 2, 6, 5, 1 } );
+		memberPtrs.push_back( members.back( ).get( ) );
+	}
+	NetworkEnsemble< NetworkType > ensemble( memberPtrs );
+	auto& nnet_in = ensemble.getNetwork( );
+	ASSERT_TRUE( std::dynamic_pointer_cast< BlockDiagonalLayerType >( nnet_in.getLayer( 2 ) ) );
+	{
+	SerializationArchive< ArchiveType > ar( "nnet_ser.txt" );
+	ar.OpenOutArchive( );
+	ar.Save( nnet_in );
+	}
+
+	NetworkType nnet_out;
+	{
+	SerializationArchive< ArchiveType > ar( "nnet_ser.txt" );
+	ar.OpenInArchive( );
+	ar.Load( nnet_out );
+	}
+	ASSERT_EQ( nnet_in, nnet_out );
+	ASSERT_TRUE( std::dynamic_pointer_cast< BlockDiagonalLayerType >( nnet_out.getLayer( 4 ) ) );
+
+	// the loaded layers view the loaded network's packed parameters
+	auto predict = []( NetworkType& network, VectorXType const& inputVec ) {
+		VectorXType const* layerInput = &inputVec;
+		for ( auto& layer : network ) {
+			layer -> forwardCompute( *layerInput, layer -> getOutputVec( ) );
+			layerInput = &layer -> getOutputVec( );
+		}
+		return VectorXType( *layerInput );
+	};
+	ASSERT_TRUE( nnet_out.isPacked( ) );
+	VectorXType inputVec = VectorXType::Random( 2 );
+	ASSERT_TRUE( predict( nnet_in, inputVec ) == predict( nnet_out, inputVec ) );
+}
+
+TEST( NeuralNetwork, PackedParameters ) {
+	using NumericTraitsType = NumericTraits< double >;
+	using FullyConnectedLayerType = FullyConnectedLayer< NumericTraitsType >;
+	using ActLayerType = ActivationLayer< NumericTraitsType, ArcTanActivation >;
+	using InitializerType = GlorotInitializer< NumericTraitsType >;
+	using NetworkType = NeuralNetwork< NumericTraitsType, InitializerType >;
+
+	NetworkType nnet;
+	nnet.addLayer( std::make_shared< FullyConnectedLayerType >( 3, 7, LayerType::INPUT ) );
+	nnet.addLayer( std::make_shared< ActLayerType >( 7 ) );
+	nnet.addLayer( std::make_shared< FullyConnectedLayerType >( 7, 5, LayerType::HIDDEN ) );
+	nnet.finalize( );
+	ASSERT_TRUE( nnet.isPacked( ) );
+
+	auto parameterVec = nnet.getParameterVec( );
+	auto gradientVec = nnet.getGradientVec( );
+	auto const& ranges = nnet.getParameterRanges( );
+	auto const& layers = nnet.getTrainableLayers( );
+	ASSERT_EQ( ranges.size( ), 2u );
+	for ( std::size_t i = 0; i < layers.size( ); ++i ) {
+		// every layer views its own cache line aligned slice of the flat buffers
+		ASSERT_EQ( layers[i] -> getWeightMat( ).data( ), parameterVec.data( ) + ranges[i].offset );
+		ASSERT_EQ( layers[i] -> getWeightGradMat( ).data( ), gradientVec.data( ) + ranges[i].offset );
+		ASSERT_EQ( reinterpret_cast< std::uintptr_t >( layers[i] -> getWeightMat( ).data( ) ) % Utils::cache_line_size, 0u );
+		ASSERT_EQ( ranges[i].size, layers[i] -> getNumParameters( ) );
+	}
+
+	// writes through the flat buffer are seen by the layers
+	parameterVec.setConstant( 0.5 );
+	ASSERT_EQ( layers[1] -> getWeightMat( )( 2, 3 ), 0.5 );
+}
+
+template< template< typename > class OptimizerTemplate >
+void checkSteadyStateAllocations( std::size_t numUpdateThreads ) {
+	using NumericTraitsType = NumericTraits< double >;
+	using VectorXType = NumericTraitsType::VectorXType;
+	using FullyConnectedLayerType = FullyConnectedLayer< NumericTraitsType >;
+	using ActLayerType = ActivationLayer< NumericTraitsType, ArcTanActivation >;
+	using InitializerType = GlorotInitializer< NumericTraitsType >;
+	using NetworkType = NeuralNetwork< NumericTraitsType, InitializerType >;
+	using OptimizerType = OptimizerTemplate< NetworkType >;
+	using DataHandlerType = RegressionDataHandler< VectorXType, VectorXType >;
+	using NetworkTrainerType = NetworkTrainer< NetworkType, OptimizerType, MSELossFuction, DataHandlerType >;
+
+	DataHandlerType dataHandler;
+	for ( std::size_t i = 0; i < 64; ++i ) {
+		VectorXType input( 1 ), target( 1 );
+		input << 0.1 * i;
+		target << std::sin( 0.1 * i );
+		dataHandler.getTrainingData( ).emplace_back( input, target );
+	}
+
+	NetworkType nnet;
+	nnet.addLayer( std::make_shared< FullyConnectedLayerType >( 1, 30, LayerType::INPUT ) );
+	nnet.addLayer( std::make_shared< ActLayerType >( 30 ) );
+	nnet.addLayer( std::make_shared< FullyConnectedLayerType >( 30, 20, LayerType::HIDDEN ) );
+	nnet.addLayer( std::make_shared< ActLayerType >( 20 ) );
+	nnet.addLayer( std::make_shared< FullyConnectedLayerType >( 20, 1, LayerType::HIDDEN ) );
+	nnet.finalize( );
+	OptimizerType optimizer( nnet );
+	NetworkTrainerType networkTrainer( nnet, optimizer, dataHandler );
+	networkTrainer.setNumUpdateThreads( numUpdateThreads );
+
+	auto& data = dataHandler.getTrainingData( );
+	// the first batch sizes all work buffers
+	networkTrainer.trainBatch( data.begin( ), data.begin( ) + 16 );
+
+	Utils::AllocationScope scope;
+	for ( auto iter = data.begin( ) + 16; iter != data.end( ); iter += 16 ) {
+		networkTrainer.trainBatch( iter, iter + 16 );
+		ASSERT_EQ( networkTrainer.getStepAllocationStats( ).numAllocations, 0u );
+	}
+	networkTrainer.trainSingleSample( data.front( ).first, data.front( ).second );
+	ASSERT_EQ( scope.getStats( ).numAllocations, 0u );
+	ASSERT_EQ( scope.getStats( ).numBytes, 0u );
+}
+
+TEST( Training, SteadyStateAllocations ) {
+	if ( !Utils::AllocationCounter::isEnabled( ) )
+		GTEST_SKIP( ) << "Build with NNET_COUNT_ALLOCATIONS to count allocations.";
+	for ( std::size_t numUpdateThreads : { 0, 2 } ) {
+		checkSteadyStateAllocations< SGDOptimizer >( numUpdateThreads );
+		checkSteadyStateAllocations< MomentumOptimizer >( numUpdateThreads );
+		checkSteadyStateAllocations< NesterovMomentumOptimizer >( numUpdateThreads );
+		checkSteadyStateAllocations< AdaGradOptimizer >( numUpdateThreads );
+		checkSteadyStateAllocations< RMSPropOptimizer >( numUpdateThreads );
+		checkSteadyStateAllocations< RMSPropNestMomOptimizer >( numUpdateThreads );
+		checkSteadyStateAllocations< AdamOptimizer >( numUpdateThreads );
+		checkSteadyStateAllocations< AdamWOptimizer >( numUpdateThreads );
+		checkSteadyStateAllocations< LAMBOptimizer >( numUpdateThreads );
+		checkSteadyStateAllocations< LARSOptimizer >( numUpdateThreads );
+	}
+}
+
+template< template< typename > class OptimizerTemplate >
+void checkOverlappedUpdates( ) {
+	using NumericTraitsType = NumericTraits< double >;
+	using VectorXType = NumericTraitsType::VectorXType;
+	using FullyConnectedLayerType = FullyConnectedLayer< NumericTraitsType >;
+	using ActLayerType = ActivationLayer< NumericTraitsType, TanHActivation >;
+	using InitializerType = GlorotInitializer< NumericTraitsType >;
+	using NetworkType = NeuralNetwork< NumericTraitsType, InitializerType >;
+	using OptimizerType = OptimizerTemplate< NetworkType >;
+	using DataHandlerType = RegressionDataHandler< VectorXType, VectorXType >;
+	using NetworkTrainerType = NetworkTrainer< NetworkType, OptimizerType, MSELossFuction, DataHandlerType >;
+
+	DataHandlerType dataHandler;
+	for ( std::size_t i = 0; i < 60; ++i ) {
+		VectorXType input( 2 ), target( 1 );
+		input << 0.1 * i, std::cos( 0.1 * i );
+		target << std::sin( 0.1 * i );
+		dataHandler.getTrainingData( ).emplace_back( input, target );
+	}
+
+	auto buildNetwork = [ ]( NetworkType& nnet ) {
+		nnet.addLayer( std::make_shared< FullyConnectedLayerType >( 2, 40, LayerType::INPUT ) );
+		nnet.addLayer( std::make_shared< ActLayerType >( 40 ) );
+		nnet.addLayer( std::make_shared< FullyConnectedLayerType >( 40, 30, LayerType::HIDDEN ) );
+		nnet.addLayer( std::make_shared< ActLayerType >( 30 ) );
+		nnet.addLayer( std::make_shared< FullyConnectedLayerType >( 30, 1, LayerType::HIDDEN ) );
+		nnet.finalize( );
+	};
+	NetworkType sequentialNet, overlappedNet;
+	buildNetwork( sequentialNet );
+	buildNetwork( overlappedNet );
+	overlappedNet.getParameterVec( ) = sequentialNet.getParameterVec( );
+
+	OptimizerType sequentialOptimizer( sequentialNet ), overlappedOptimizer( overlappedNet );
+	NetworkTrainerType sequentialTrainer( sequentialNet, sequentialOptimizer, dataHandler );
+	NetworkTrainerType overlappedTrainer( overlappedNet, overlappedOptimizer, dataHandler );
+	sequentialTrainer.setNumUpdateThreads( 0 );
+	overlappedTrainer.setNumUpdateThreads( 3 );
+	overlappedTrainer.setScheduler( std::make_shared< Utils::TaskScheduler >( 4 ) );
+
+	auto& data = dataHandler.getTrainingData( );
+	for ( std::size_t epoch = 0; epoch < 3; ++epoch ) {
+		for ( auto iter = data.begin( ); iter != data.end( ); iter += 12 ) {
+			sequentialTrainer.trainBatch( iter, iter + 12 );
+			overlappedTrainer.trainBatch( iter, iter + 12 );
+		}
+	}
+	// per layer updates apply the same element wise rules, results are bit identical
+	ASSERT_TRUE( overlappedNet.getParameterVec( ) == sequentialNet.getParameterVec( ) );
+	ASSERT_TRUE( overlappedNet.getGradientVec( ).isZero( 0.0 ) );
+}
+
+TEST( Training, OverlappedUpdates ) {
+	checkOverlappedUpdates< SGDOptimizer >( );
+	checkOverlappedUpdates< NesterovMomentumOptimizer >( );
+	checkOverlappedUpdates< AdaGradOptimizer >( );
+	checkOverlappedUpdates< RMSPropNestMomOptimizer >( );
+	checkOverlappedUpdates< AdamWOptimizer >( );
+	checkOverlappedUpdates< LAMBOptimizer >( );
+	checkOverlappedUpdates< LARSOptimizer >( );
+}
+
+TEST( Training, ConcurrentWeightGradients ) {
+	using NumericTraitsType = NumericTraits< double >;
+	using VectorXType = NumericTraitsType::VectorXType;
+	using FullyConnectedLayerType = FullyConnectedLayer< NumericTraitsType >;
+	using ActLayerType = ActivationLayer< NumericTraitsType, TanHActivation >;
+	using InitializerType = GlorotInitializer< NumericTraitsType >;
+	using NetworkType = NeuralNetwork< NumericTraitsType, InitializerType >;
+	using OptimizerType = AdamOptimizer< NetworkType >;
+	using DataHandlerType = RegressionDataHandler< VectorXType, VectorXType >;
+	using NetworkTrainerType = NetworkTrainer< NetworkType, OptimizerType, MSELossFuction, DataHandlerType >;
+
+	DataHandlerType dataHandler = makeWaveData( 48, 3, 2 );
+	// two dense layers in a row at the end
+	auto buildNetwork = [ ]( NetworkType& nnet ) {
+		buildDenseNetwork< ActLayerType >( nnet, { 3, 40, 40, 30 }, false );
+		nnet.addLayer( std::make_shared< FullyConnectedLayerType >( 30, 2, LayerType::OUTPUT ) );
+		nnet.finalize( );
+	};
+	auto& data = dataHandler.getTrainingData( );
+	auto scheduler = std::make_shared< Utils::TaskScheduler >( 4 );
+	// sample by sample and in micro batches, with overlapped updates and data parallel
+	for ( std::size_t mode = 0; mode < 4; ++mode ) {
+		NetworkType sequentialNet, concurrentNet;
+		buildNetwork( sequentialNet );
+		buildNetwork( concurrentNet );
+		concurrentNet.getParameterVec( ) = sequentialNet.getParameterVec( );
+		OptimizerType sequentialOptimizer( sequentialNet ), concurrentOptimizer( concurrentNet );
+		NetworkTrainerType sequentialTrainer( sequentialNet, sequentialOptimizer, dataHandler );
+		NetworkTrainerType concurrentTrainer( concurrentNet, concurrentOptimizer, dataHandler );
+		sequentialTrainer.setMinWeightGradTaskWork( std::numeric_limits< std::size_t >::max( ) );
+		concurrentTrainer.setMinWeightGradTaskWork( 0 );
+		concurrentTrainer.setScheduler( scheduler );
+		for ( auto trainer : { &sequentialTrainer, &concurrentTrainer } ) {
+			trainer -> setNumUpdateThreads( mode == 1 ? 2 : 0 );
+			trainer -> setMicroBatchSize( mode >= 2 ? 4 : 0 );
+			trainer -> setNumGradientThreads( 2 );
+			trainer -> setDataParallel( mode == 3 );
+		}
+		for ( std::size_t epoch = 0; epoch < 2; ++epoch ) {
+			for ( auto iter = data.begin( ); iter != data.end( ); iter += 12 ) {
+				ASSERT_EQ( concurrentTrainer.trainBatch( iter, iter + 12 ), sequentialTrainer.trainBatch( iter, iter + 12 ) );
+			}
+		}
+		// every weight gradient is summed in the same order, the weights are bit identical
+		ASSERT_TRUE( concurrentNet.getParameterVec( ) == sequentialNet.getParameterVec( ) );
+		if ( Utils::AllocationCounter::isEnabled( ) && mode < 3 ) {
+			concurrentTrainer.trainBatch( data.begin( ), data.begin( ) + 12 );
+			ASSERT_EQ( concurrentTrainer.getStepAllocationStats( ).numAllocations, 0u );
+		}
+	}
+}
+
+TEST( Training, ActivationCheckpointing ) {
+	using NumericTraitsType = NumericTraits< double >;
+	using VectorXType = NumericTraitsType::VectorXType;
+	using ActLayerType = ActivationLayer< NumericTraitsType, TanHActivation >;
+	using InitializerType = GlorotInitializer< NumericTraitsType >;
+	using NetworkType = NeuralNetwork< NumericTraitsType, InitializerType >;
+	using OptimizerType = AdamOptimizer< NetworkType >;
+	using DataHandlerType = RegressionDataHandler< VectorXType, VectorXType >;
+	using NetworkTrainerType = NetworkTrainer< NetworkType, OptimizerType, MSELossFuction, DataHandlerType >;
+
+	DataHandlerType dataHandler = makeWaveData( 48, 3, 2 );
+	std::vector< std::size_t > layerSizes = { 3, 30, 30, 30, 30, 30, 2 };
+	auto& data = dataHandler.getTrainingData( );
+	std::size_t microBatchSize = 4;
+	auto scheduler = std::make_shared< Utils::TaskScheduler >( 4 );
+	// every other layer, under a budget with concurrent weight gradients and overlapped
+	// updates, and data parallel
+	for ( std::size_t mode = 0; mode < 3; ++mode ) {
+		NetworkType net, checkpointedNet;
+		buildDenseNetwork< ActLayerType >( net, layerSizes );
+		buildDenseNetwork< ActLayerType >( checkpointedNet, layerSizes );
+		checkpointedNet.getParameterVec( ) = net.getParameterVec( );
+		std::size_t fullMemory = net.getActivationMemory( microBatchSize );
+		if ( mode == 1 ) {
+			ASSERT_THROW( checkpointedNet.setActivationMemoryBudget( fullMemory / 100, microBatchSize ), std::runtime_error );
+			checkpointedNet.setActivationMemoryBudget( fullMemory, microBatchSize );
+			ASSERT_FALSE( checkpointedNet.isCheckpointing( ) );
+			checkpointedNet.setActivationMemoryBudget( fullMemory / 2, microBatchSize );
+		}
+		else {
+			checkpointedNet.setCheckpointInterval( 2 );
+		}
+		ASSERT_TRUE( checkpointedNet.isCheckpointing( ) );
+		ASSERT_LE( checkpointedNet.getActivationMemory( microBatchSize ), fullMemory / 2 );
+		OptimizerType optimizer( net ), checkpointedOptimizer( checkpointedNet );
+		NetworkTrainerType netTrainer( net, optimizer, dataHandler );
+		NetworkTrainerType checkpointedTrainer( checkpointedNet, checkpointedOptimizer, dataHandler );
+		checkpointedTrainer.setScheduler( scheduler );
+		checkpointedTrainer.setMinWeightGradTaskWork( mode == 1 ? 0 : std::numeric_limits< std::size_t >::max( ) );
+		for ( auto trainer : { &netTrainer, &checkpointedTrainer } ) {
+			trainer -> setMicroBatchSize( microBatchSize );
+			trainer -> setNumUpdateThreads( mode == 1 ? 2 : 0 );
+			trainer -> setNumGradientThreads( 2 );
+			trainer -> setDataParallel( mode == 2 );
+		}
+		for ( std::size_t epoch = 0; epoch < 2; ++epoch ) {
+			for ( auto iter = data.begin( ); iter != data.end( ); iter += 12 ) {
+				ASSERT_EQ( checkpointedTrainer.trainBatch( iter, iter + 12 ), netTrainer.trainBatch( iter, iter + 12 ) );
+			}
+		}
+		// the recomputed activations are the stored ones, the weights are bit identical
+		ASSERT_TRUE( checkpointedNet.getParameterVec( ) == net.getParameterVec( ) );
+		if ( mode == 0 ) {
+			// the segments after the first are released again by the end of the step
+			ASSERT_EQ( checkpointedNet.getLayer( 5 ) -> getOutputMat( ).size( ), 0 );
+			ASSERT_GT( net.getLayer( 5 ) -> getOutputMat( ).size( ), 0 );
+		}
+	}
+}
+
+template< template< typename > class OptimizerTemplate >
+void checkOptimizerResume( ) {
+	using NumericTraitsType = NumericTraits< double >;
+	using VectorXType = NumericTraitsType::VectorXType;
+	using FullyConnectedLayerType = FullyConnectedLayer< NumericTraitsType >;
+	using ActLayerType = ActivationLayer< NumericTraitsType, TanHActivation >;
+	using InitializerType = GlorotInitializer< NumericTraitsType >;
+	using NetworkType = NeuralNetwork< NumericTraitsType, InitializerType >;
+	using OptimizerType = OptimizerTemplate< NetworkType >;
+	using DataHandlerType = RegressionDataHandler< VectorXType, VectorXType >;
+	using NetworkTrainerType = NetworkTrainer< NetworkType, OptimizerType, MSELossFuction, DataHandlerType >;
+	using ArchiveType = boost::archive::text_oarchive;
+
+	DataHandlerType dataHandler;
+	for ( std::size_t i = 0; i < 48; ++i ) {
+		VectorXType input( 1 ), target( 1 );
+		input << 0.1 * i;
+		target << std::sin( 0.1 * i );
+		dataHandler.getTrainingData( ).emplace_back( input, target );
+	}
+	auto buildNetwork = [ ]( NetworkType& nnet ) {
+		nnet.addLayer( std::make_shared< FullyConnectedLayerType >( 1, 20, LayerType::INPUT ) );
+		nnet.addLayer( std::make_shared< ActLayerType >( 20 ) );
+		nnet.addLayer( std::make_shared< FullyConnectedLayerType >( 20, 1, LayerType::HIDDEN ) );
+		nnet.finalize( );
+	};
+	auto& data = dataHandler.getTrainingData( );
+	auto trainEpoch = [ &data ]( NetworkTrainerType& trainer ) {
+		for ( auto iter = data.begin( ); iter != data.end( ); iter += 16 )
+			trainer.trainBatch( iter, iter + 16 );
+	};
+
+	NetworkType nnet;
+	buildNetwork( nnet );
+	OptimizerType optimizer( nnet );
+	NetworkTrainerType trainer( nnet, optimizer, dataHandler );
+	trainEpoch( trainer );
+	{
+	SerializationArchive< ArchiveType > ar( "optimizer_ser.txt" );
+	ar.OpenOutArchive( );
+	ar.Save( nnet, optimizer );
+	}
+
+	NetworkType resumedNet;
+	buildNetwork( resumedNet );
+	OptimizerType resumedOptimizer( resumedNet );
+	{
+	SerializationArchive< ArchiveType > ar( "optimizer_ser.txt" );
+	ar.OpenInArchive( );
+	ar.Load( resumedNet, resumedOptimizer );
+	}
+	NetworkTrainerType resumedTrainer( resumedNet, resumedOptimizer, dataHandler );
+	ASSERT_TRUE( resumedNet.getParameterVec( ) == nnet.getParameterVec( ) );
+
+	for ( std::size_t epoch = 0; epoch < 2; ++epoch ) {
+		trainEpoch( trainer );
+		trainEpoch( resumedTrainer );
+	}
+	ASSERT_TRUE( resumedNet.getParameterVec( ) == nnet.getParameterVec( ) );
+}
+
+TEST( Serialization, OptimizerResume ) {
+	checkOptimizerResume< AdamOptimizer >( );
+	checkOptimizerResume< AdamWOptimizer >( );
+	checkOptimizerResume< LAMBOptimizer >( );
+	checkOptimizerResume< LARSOptimizer >( );
+}
+
+TEST( Training, LayerwiseTrustRatiosExcludeBiases ) {
+	using NumericTraitsType = NumericTraits< double >;
+	using MatrixXType = NumericTraitsType::MatrixXType;
+	using FullyConnectedLayerType = FullyConnectedLayer< NumericTraitsType >;
+	using InitializerType = GlorotInitializer< NumericTraitsType >;
+	using NetworkType = NeuralNetwork< NumericTraitsType, InitializerType >;
+
+	// one step of a single 2-3 layer from a gradient, the last row of the weight matrix holds the biases
+	auto takeStep = [ ]( auto makeOptimizer, MatrixXType& weights, MatrixXType& gradient ) {
+		NetworkType nnet;
+		nnet.addLayer( std::make_shared< FullyConnectedLayerType >( 2, 3, LayerType::INPUT ) );
+		nnet.finalize( );
+		auto optimizer = makeOptimizer( nnet );
+		auto layer = std::static_pointer_cast< FullyConnectedLayerType >( nnet.getLayer( 0 ) );
+		weights = layer -> getWeightMat( );
+		gradient = MatrixXType::Random( 3, 3 );
+		layer -> getWeightGradMat( ) = gradient;
+		optimizer -> applyWeightUpdate( 1 );
+		return MatrixXType( layer -> getWeightMat( ) - weights );
+	};
+	double learningRate = 0.01, weightDecay = 0.1, trustCoefficient = 0.001;
+	MatrixXType w, g;
+
+	auto lambStep = takeStep( [&]( NetworkType& nnet ) { return std::make_unique< LAMBOptimizer< NetworkType > >( nnet, learningRate, weightDecay ); }, w, g );
+	// the first bias corrected Adam step is g / ( |g| + epsilon )
+	MatrixXType adamStep = ( g.array( ) / ( g.array( ).abs( ) + 1.0e-6 ) ).matrix( );
+	MatrixXType weightStep = adamStep.topRows( 2 ) + weightDecay * w.topRows( 2 );
+	double trustRatio = w.topRows( 2 ).norm( ) / weightStep.norm( );
+	ASSERT_LT( ( lambStep.topRows( 2 ) + learningRate * trustRatio * weightStep ).norm( ), 1.0e-12 );
+	ASSERT_LT( ( lambStep.bottomRows( 1 ) + learningRate * adamStep.bottomRows( 1 ) ).norm( ), 1.0e-12 );
+
+	auto larsStep = takeStep( [&]( NetworkType& nnet ) { return std::make_unique< LARSOptimizer< NetworkType > >( nnet, learningRate, 0.9, weightDecay, trustCoefficient ); }, w, g );
+	double localRate = trustCoefficient * w.topRows( 2 ).norm( ) / ( g.topRows( 2 ).norm( ) + weightDecay * w.topRows( 2 ).norm( ) );
+	ASSERT_LT( ( larsStep.topRows( 2 ) + learningRate * localRate * ( g.topRows( 2 ) + weightDecay * w.topRows( 2 ) ) ).norm( ), 1.0e-12 );
+	ASSERT_LT( ( larsStep.bottomRows( 1 ) + learningRate * g.bottomRows( 1 ) ).norm( ), 1.0e-12 );
+}
+
+TEST( Training, SVRGFirstStepUsesFullGradient ) {
+	using NumericTraitsType = NumericTraits< double >;
+	using VectorXType = NumericTraitsType::VectorXType;
+	using FullyConnectedLayerType = FullyConnectedLayer< NumericTraitsType >;
+	using ActLayerType = ActivationLayer< NumericTraitsType, TanHActivation >;
+	using InitializerType = GlorotInitializer< NumericTraitsType >;
+	using NetworkType = NeuralNetwork< NumericTraitsType, InitializerType >;
+	using DataHandlerType = RegressionDataHandler< VectorXType, VectorXType >;
+
+	DataHandlerType dataHandler;
+	for ( std::size_t i = 0; i < 24; ++i ) {
+		VectorXType input( 1 ), target( 1 );
+		input << 0.1 * i;
+		target << std::sin( 0.1 * i );
+		dataHandler.getTrainingData( ).emplace_back( input, target );
+	}
+	auto buildNetwork = [ ]( NetworkType& nnet ) {
+		nnet.addLayer( std::make_shared< FullyConnectedLayerType >( 1, 8, LayerType::INPUT ) );
+		nnet.addLayer( std::make_shared< ActLayerType >( 8 ) );
+		nnet.addLayer( std::make_shared< FullyConnectedLayerType >( 8, 1, LayerType::HIDDEN ) );
+		nnet.finalize( );
+	};
+	NetworkType svrgNet, fullBatchNet;
+	buildNetwork( svrgNet );
+	buildNetwork( fullBatchNet );
+	fullBatchNet.getParameterVec( ) = svrgNet.getParameterVec( );
+	VectorXType initialWeights = svrgNet.getParameterVec( );
+
+	// a full batch SGD step of rate one gives the full gradient
+	using SGDOptimizerType = SGDOptimizer< NetworkType >;
+	SGDOptimizerType sgdOptimizer( fullBatchNet, 1.0 );
+	NetworkTrainer< NetworkType, SGDOptimizerType, MSELossFuction, DataHandlerType > sgdTrainer( fullBatchNet, sgdOptimizer, dataHandler );
+	auto& data = dataHandler.getTrainingData( );
+	sgdTrainer.trainBatch( data.begin( ), data.end( ) );
+	VectorXType fullGradient = initialWeights - fullBatchNet.getParameterVec( );
+
+	// at the snapshot the variance reduced gradient of any batch is the full gradient
+	using SVRGOptimizerType = SVRGOptimizer< NetworkType >;
+	SVRGOptimizerType svrgOptimizer( svrgNet, 0.05 );
+	NetworkTrainer< NetworkType, SVRGOptimizerType, MSELossFuction, DataHandlerType > svrgTrainer( svrgNet, svrgOptimizer, dataHandler );
+	svrgTrainer.trainBatch( data.begin( ) + 3, data.begin( ) + 7 );
+	VectorXType expectedWeights = initialWeights - 0.05 * fullGradient;
+	ASSERT_TRUE( svrgNet.getParameterVec( ).isApprox( expectedWeights, 1.0e-12 ) );
+
+	// training keeps reducing the loss
+	double firstLoss = svrgTrainer.trainEpoch( 4 );
+	double lastLoss = firstLoss;
+	for ( std::size_t epoch = 0; epoch < 20; ++epoch )
+		lastLoss = svrgTrainer.trainEpoch( 4 );
+	ASSERT_LT( lastLoss, firstLoss );
+}
+
+TEST( Training, SAGAConvergesOnLeastSquares ) {
+	using NumericTraitsType = NumericTraits< double >;
+	using VectorXType = NumericTraitsType::VectorXType;
+	using FullyConnectedLayerType = FullyConnectedLayer< NumericTraitsType >;
+	using ActLayerType = ActivationLayer< NumericTraitsType, TanHActivation >;
+	using InitializerType = GlorotInitializer< NumericTraitsType >;
+	using NetworkType = NeuralNetwork< NumericTraitsType, InitializerType >;
+	using DataHandlerType = RegressionDataHandler< VectorXType, VectorXType >;
+	using SAGAOptimizerType = SAGAOptimizer< NetworkType >;
+	using SGDOptimizerType = SGDOptimizer< NetworkType >;
+
+	// noisy line, the least squares fit is the unique minimum
+	DataHandlerType dataHandler;
+	std::size_t numSamples = 40;
+	for ( std::size_t i = 0; i < numSamples; ++i ) {
+		VectorXType input( 1 ), target( 1 );
+		double x = -1.0 + 0.05 * i;
+		input << x;
+		target << 2.0 * x + 1.0 + 0.3 * std::sin( 37.0 * x );
+		dataHandler.getTrainingData( ).emplace_back( input, target );
+	}
+	Eigen::MatrixXd A( numSamples, 2 );
+	Eigen::VectorXd b( numSamples );
+	for ( std::size_t i = 0; i < numSamples; ++i ) {
+		A( i, 0 ) = dataHandler.getTrainingData( )[i].first( 0 );
+		A( i, 1 ) = 1.0;
+		b( i ) = dataHandler.getTrainingData( )[i].second( 0 );
+	}
+	Eigen::VectorXd solution = A.colPivHouseholderQr( ).solve( b );
+
+	auto fitError = [&]( auto&& makeOptimizer ) {
+		NetworkType nnet;
+		nnet.addLayer( std::make_shared< FullyConnectedLayerType >( 1, 1, LayerType::INPUT ) );
+		nnet.finalize( );
+		auto optimizer = makeOptimizer( nnet );
+		using OptimizerType = typename std::decay_t< decltype( optimizer ) >::element_type;
+		NetworkTrainer< NetworkType, OptimizerType, MSELossFuction, DataHandlerType > trainer( nnet, *optimizer, dataHandler );
+		for ( std::size_t epoch = 0; epoch < 300; ++epoch )
+			trainer.trainEpoch( 4 );
+		auto const& weightMat = nnet.getTrainableLayers( ).front( ) -> getWeightMat( );
+		return ( Eigen::Vector2d( weightMat( 0, 0 ), weightMat( 1, 0 ) ) - solution ).norm( );
+	};
+
+	double sgdError = fitError( [ ]( NetworkType& nnet ) { return std::make_unique< SGDOptimizerType >( nnet, 0.1 ); } );
+	double sagaError = fitError( [=]( NetworkType& nnet ) { return std::make_unique< SAGAOptimizerType >( nnet, numSamples, 0.1 ); } );
+	double reducedError = fitError( [=]( NetworkType& nnet ) {
+		return std::make_unique< SAGAOptimizerType >( nnet, numSamples, 0.1, GradientTableScope::ALL_LAYERS, GradientTablePrecision::REDUCED );
+	} );
+	ASSERT_LT( sagaError, 1.0e-8 );
+	ASSERT_LT( reducedError, 1.0e-5 );
+	ASSERT_LT( sagaError, sgdError );
+
+	// the table may cover the last layer only and be stored in single precision
+	NetworkType nnet;
+	nnet.addLayer( std::make_shared< FullyConnectedLayerType >( 1, 16, LayerType::INPUT ) );
+	nnet.addLayer( std::make_shared< ActLayerType >( 16 ) );
+	nnet.addLayer( std::make_shared< FullyConnectedLayerType >( 16, 1, LayerType::HIDDEN ) );
+	nnet.finalize( );
+	SAGAOptimizerType fullTable( nnet, numSamples, 0.05 );
+	SAGAOptimizerType lastLayerTable( nnet, numSamples, 0.05, GradientTableScope::LAST_LAYER, GradientTablePrecision::REDUCED );
+	ASSERT_EQ( fullTable.getTableBytes( ), numSamples * nnet.getNumParameters( ) * sizeof( double ) );
+	ASSERT_EQ( lastLayerTable.getTableBytes( ), numSamples * 17 * sizeof( float ) );
+	NetworkTrainer< NetworkType, SAGAOptimizerType, MSELossFuction, DataHandlerType > trainer( nnet, lastLayerTable, dataHandler );
+	double firstLoss = trainer.trainEpoch( 4 );
+	double lastLoss = firstLoss;
+	for ( std::size_t epoch = 0; epoch < 50; ++epoch )
+		lastLoss = trainer.trainEpoch( 4 );
+	ASSERT_LT( lastLoss, firstLoss );
+	// the mean tracks the rounded rows the table stores
+	VectorXType tableMean = VectorXType::Zero( lastLayerTable.getTableSize( ) );
+	for ( std::size_t i = 0; i < numSamples; ++i )
+		tableMean += lastLayerTable.getTableRow( i ) / static_cast< double >( numSamples );
+	auto averageVec = Eigen::Map< VectorXType >( lastLayerTable.getAverageGradient( ).data( ), nnet.getNumParameters( ) );
+	ASSERT_LT( ( averageVec.segment( lastLayerTable.getTableBegin( ), lastLayerTable.getTableSize( ) ) - tableMean ).norm( ), 1.0e-12 );
+}
+
+TEST( Training, LBFGSFullBatch ) {
+	using NumericTraitsType = NumericTraits< double >;
+	using VectorXType = NumericTraitsType::VectorXType;
+	using FullyConnectedLayerType = FullyConnectedLayer< NumericTraitsType >;
+	using ActLayerType = ActivationLayer< NumericTraitsType, TanHActivation >;
+	using InitializerType = GlorotInitializer< NumericTraitsType >;
+	using NetworkType = NeuralNetwork< NumericTraitsType, InitializerType >;
+	using DataHandlerType = RegressionDataHandler< VectorXType, VectorXType >;
+	using LBFGSOptimizerType = LBFGSOptimizer< NetworkType >;
+	using SGDOptimizerType = SGDOptimizer< NetworkType >;
+
+	DataHandlerType dataHandler;
+	for ( std::size_t i = 0; i < 50; ++i ) {
+		VectorXType input( 1 ), target( 1 );
+		double x = -1.0 + 0.04 * i;
+		input << x;
+		target << std::sin( 3.0 * x );
+		dataHandler.getTrainingData( ).emplace_back( input, target );
+	}
+	auto buildNetwork = []( NetworkType& nnet ) {
+		nnet.addLayer( std::make_shared< FullyConnectedLayerType >( 1, 8, LayerType::INPUT ) );
+		nnet.addLayer( std::make_shared< ActLayerType >( 8 ) );
+		nnet.addLayer( std::make_shared< FullyConnectedLayerType >( 8, 1, LayerType::HIDDEN ) );
+		nnet.finalize( );
+	};
+	NetworkType lbfgsNet, sgdNet;
+	buildNetwork( lbfgsNet );
+	buildNetwork( sgdNet );
+	sgdNet.getParameterVec( ) = lbfgsNet.getParameterVec( );
+
+	// the multithreaded gradient matches the sequential sum over the samples
+	LBFGSOptimizerType lbfgs( lbfgsNet, 5 );
+	NetworkTrainer< NetworkType, LBFGSOptimizerType, MSELossFuction, DataHandlerType > trainer( lbfgsNet, lbfgs, dataHandler );
+	double expectedLoss = 0.0;
+	lbfgsNet.getGradientVec( ).setZero( );
+	for ( auto const& dataPair : dataHandler.getTrainingData( ) )
+		expectedLoss += trainer.runSingleSample( dataPair.first, dataPair.second );
+	expectedLoss /= 50.0;
+	Eigen::VectorXd expectedGradient = lbfgsNet.getGradientVec( ) / 50.0;
+	for ( std::size_t numThreads : { 1, 3 } ) {
+		trainer.setNumGradientThreads( numThreads );
+		lbfgsNet.getGradientVec( ).setZero( );
+		ASSERT_NEAR( trainer.computeFullBatchGradient( ), expectedLoss, 1.0e-12 );
+		ASSERT_LT( ( lbfgsNet.getGradientVec( ) - expectedGradient ).norm( ), 1.0e-12 );
+	}
+
+	// the line search never increases the loss, and L-BFGS needs far fewer passes than SGD
+	double lastLoss = expectedLoss;
+	for ( std::size_t iter = 0; iter < 100; ++iter ) {
+		double loss = trainer.trainEpoch( 0 );
+		ASSERT_LE( loss, lastLoss );
+		lastLoss = loss;
+	}
+	ASSERT_LE( lbfgs.getNumStoredPairs( ), 5u );
+	ASSERT_EQ( trainer.getStepAllocationStats( ).numAllocations, 0u );
+	SGDOptimizerType sgd( sgdNet, 0.05 );
+	NetworkTrainer< NetworkType, SGDOptimizerType, MSELossFuction, DataHandlerType > sgdTrainer( sgdNet, sgd, dataHandler );
+	double sgdLoss = 0.0;
+	for ( std::size_t epoch = 0; epoch < 100; ++epoch )
+		sgdLoss = sgdTrainer.trainEpoch( 4 );
+	ASSERT_LT( lastLoss, 1.0e-2 );
+	ASSERT_LT( lastLoss, sgdLoss );
+	ASSERT_THROW( trainer.trainBatch( dataHandler.getTrainingData( ).begin( ), dataHandler.getTrainingData( ).end( ) ), std::runtime_error );
+}
+
+TEST( Training, SolveOutputLayer ) {
+	using NumericTraitsType = NumericTraits< double >;
+	using VectorXType = NumericTraitsType::VectorXType;
+	using FullyConnectedLayerType = FullyConnectedLayer< NumericTraitsType >;
+	using ActLayerType = ActivationLayer< NumericTraitsType, TanHActivation >;
+	using InitializerType = GlorotInitializer< NumericTraitsType >;
+	using NetworkType = NeuralNetwork< NumericTraitsType, InitializerType >;
+	using DataHandlerType = RegressionDataHandler< VectorXType, VectorXType >;
+	using OptimizerType = SGDOptimizer< NetworkType >;
+
+	DataHandlerType dataHandler;
+	for ( std::size_t i = 0; i < 100; ++i ) {
+		VectorXType input( 1 ), target( 2 );
+		double x = -1.0 + 0.02 * i;
+		input << x;
+		target << std::sin( 3.0 * x ), x * x;
+		dataHandler.getTrainingData( ).emplace_back( input, target );
+	}
+	// random features, only the output layer is fitted
+	NetworkType nnet;
+	nnet.addLayer( std::make_shared< FullyConnectedLayerType >( 1, 24, LayerType::INPUT ) );
+	nnet.addLayer( std::make_shared< ActLayerType >( 24 ) );
+	nnet.addLayer( std::make_shared< FullyConnectedLayerType >( 24, 2, LayerType::HIDDEN ) );
+	nnet.finalize( );
+	OptimizerType optimizer( nnet );
+	NetworkTrainer< NetworkType, OptimizerType, MSELossFuction, DataHandlerType > trainer( nnet, optimizer, dataHandler );
+
+	trainer.setNumGradientThreads( 1 );
+	double initialLoss = trainer.computeFullBatchGradient( );
+	double loss = trainer.solveOutputLayer( 1.0e-10, 16 );
+	Eigen::MatrixXd weightMat = nnet.getTrainableLayers( ).back( ) -> getWeightMat( );
+	double expectedLoss = 0.0;
+	for ( auto const& dataPair : dataHandler.getTrainingData( ) )
+		expectedLoss += ( trainer.computePrediction( dataPair.first ) - dataPair.second ).squaredNorm( );
+	expectedLoss /= 100.0;
+	ASSERT_NEAR( loss, expectedLoss, 1.0e-8 );
+	ASSERT_LT( loss, initialLoss );
+
+	// the output layer's gradient vanishes at the least squares solution
+	trainer.computeFullBatchGradient( );
+	ASSERT_LT( nnet.getTrainableLayers( ).back( ) -> getWeightGradMat( ).norm( ), 1.0e-6 );
+
+	// the threaded accumulation gives the same solution
+	trainer.setNumGradientThreads( 3 );
+	ASSERT_NEAR( trainer.solveOutputLayer( 1.0e-10, 7 ), loss, 1.0e-10 );
+	ASSERT_LT( ( nnet.getTrainableLayers( ).back( ) -> getWeightMat( ) - weightMat ).norm( ), 1.0e-4 * weightMat.norm( ) );
+}
+
+TEST( Training, LearningRateSchedules ) {
+	StepSchedule< double > stepSchedule( 0.1, 2, 0.5 );
+	ASSERT_DOUBLE_EQ( stepSchedule.getLearningRate( ), 0.1 );
+	stepSchedule.endEpoch( 1.0 );
+	stepSchedule.endEpoch( 1.0 );
+	ASSERT_DOUBLE_EQ( stepSchedule.getLearningRate( ), 0.05 );
+
+	auto cosineSchedule = std::make_shared< CosineSchedule< double > >( 1.0, 10 );
+	WarmupSchedule< double > warmupSchedule( cosineSchedule, 4 );
+	ASSERT_DOUBLE_EQ( warmupSchedule.getLearningRate( ), 0.25 );
+	for ( std::size_t i = 0; i < 4; ++i )
+		warmupSchedule.step( );
+	ASSERT_DOUBLE_EQ( warmupSchedule.getLearningRate( ), 1.0 );
+	for ( std::size_t i = 0; i < 5; ++i )
+		warmupSchedule.step( );
+	ASSERT_NEAR( warmupSchedule.getLearningRate( ), 0.5, 1.0e-12 );
+
+	OneCycleSchedule< double > oneCycleSchedule( 1.0, 100, 0.3 );
+	ASSERT_NEAR( oneCycleSchedule.getLearningRate( ), 0.04, 1.0e-12 );
+	for ( std::size_t i = 0; i < 30; ++i )
+		oneCycleSchedule.step( );
+	ASSERT_DOUBLE_EQ( oneCycleSchedule.getLearningRate( ), 1.0 );
+	for ( std::size_t i = 0; i < 70; ++i )
+		oneCycleSchedule.step( );
+	ASSERT_NEAR( oneCycleSchedule.getLearningRate( ), 1.0e-4, 1.0e-12 );
+
+	ReduceOnPlateauSchedule< double > plateauSchedule( 1.0, 0.5, 2 );
+	for ( std::size_t i = 0; i < 3; ++i )
+		plateauSchedule.endEpoch( 1.0 );
+	ASSERT_DOUBLE_EQ( plateauSchedule.getLearningRate( ), 1.0 );
+	plateauSchedule.endEpoch( 1.0 );
+	ASSERT_DOUBLE_EQ( plateauSchedule.getLearningRate( ), 0.5 );
+}
+
+TEST( Training, EarlyStoppingRestoresBestWeights ) {
+	using NumericTraitsType = NumericTraits< double >;
+	using VectorXType = NumericTraitsType::VectorXType;
+	using FullyConnectedLayerType = FullyConnectedLayer< NumericTraitsType >;
+	using ActLayerType = ActivationLayer< NumericTraitsType, TanHActivation >;
+	using InitializerType = GlorotInitializer< NumericTraitsType >;
+	using NetworkType = NeuralNetwork< NumericTraitsType, InitializerType >;
+	using DataHandlerType = RegressionDataHandler< VectorXType, VectorXType >;
+	using OptimizerType = SGDOptimizer< NetworkType >;
+	using TrainerType = NetworkTrainer< NetworkType, OptimizerType, MSELossFuction, DataHandlerType >;
+
+	DataHandlerType dataHandler;
+	for ( std::size_t i = 0; i < 50; ++i ) {
+		VectorXType input( 1 ), target( 1 );
+		double x = -1.0 + 0.04 * i;
+		input << x;
+		target << std::sin( 3.0 * x );
+		dataHandler.getTrainingData( ).emplace_back( input, target );
+	}
+	NetworkType nnet;
+	nnet.addLayer( std::make_shared< FullyConnectedLayerType >( 1, 8, LayerType::INPUT ) );
+	nnet.addLayer( std::make_shared< ActLayerType >( 8 ) );
+	nnet.addLayer( std::make_shared< FullyConnectedLayerType >( 8, 1, LayerType::HIDDEN ) );
+	nnet.finalize( );
+	dataHandler.splitValidationData( 0.2, nnet.getInitializer( ).getRandomEngine( ) );
+	ASSERT_EQ( dataHandler.getTrainingData( ).size( ), 40u );
+	ASSERT_EQ( dataHandler.getValidationData( ).size( ), 10u );
+
+	// the learning rate drops to zero after three epochs, the validation loss then stalls
+	OptimizerType optimizer( nnet );
+	TrainerType trainer( nnet, optimizer, dataHandler );
+	trainer.setLearningRateSchedule( std::make_shared< StepSchedule< double > >( 0.05, 3, 0.0 ) );
+	auto earlyStopping = std::make_shared< EarlyStopping< double > >( 3 );
+	trainer.setEarlyStopping( earlyStopping );
+	std::size_t numCallbacks = 0;
+	auto history = trainer.train( 100, 4, [&]( std::size_t epoch, double, double ) {
+		ASSERT_EQ( epoch, numCallbacks++ );
+		ASSERT_DOUBLE_EQ( optimizer.getLearningRate( ), epoch < 3 ? 0.05 : 0.0 );
+	} );
+	ASSERT_TRUE( history.stoppedEarly );
+	ASSERT_LE( history.bestEpoch, 2u );
+	ASSERT_EQ( history.trainingLoss.size( ), history.bestEpoch + 4 );
+	ASSERT_EQ( history.validationLoss.size( ), history.trainingLoss.size( ) );
+	ASSERT_EQ( numCallbacks, history.trainingLoss.size( ) );
+	ASSERT_DOUBLE_EQ( trainer.evaluateLoss( dataHandler.getValidationData( ) ), earlyStopping -> getBestLoss( ) );
+}
+
+TEST( Training, BackgroundEvaluation ) {
+	using NumericTraitsType = NumericTraits< double >;
+	using VectorXType = NumericTraitsType::VectorXType;
+	using ActLayerType = ActivationLayer< NumericTraitsType, TanHActivation >;
+	using InitializerType = GlorotInitializer< NumericTraitsType >;
+	using NetworkType = NeuralNetwork< NumericTraitsType, InitializerType >;
+	using DataHandlerType = RegressionDataHandler< VectorXType, VectorXType >;
+	using OptimizerType = AdamOptimizer< NetworkType >;
+	using TrainerType = NetworkTrainer< NetworkType, OptimizerType, MSELossFuction, DataHandlerType >;
+	using ResultType = TrainerType::EvaluationResultType;
+
+	// three classes by the angle of a point
+	DataHandlerType dataHandler;
+	for ( std::size_t i = 0; i < 90; ++i ) {
+		VectorXType input( 2 ), target = VectorXType::Zero( 3 );
+		double angle = 0.07 * i;
+		input << std::cos( angle ), std::sin( angle );
+		target( static_cast< Eigen::Index >( angle / 2.1 ) % 3 ) = 1.0;
+		( i % 5 == 4 ? dataHandler.getTestingData( ) : dataHandler.getTrainingData( ) ).emplace_back( input, target );
+	}
+	std::mt19937 g( 7 );
+	dataHandler.splitValidationData( 0.2, g );
+	// two equal networks (weights and shuffling), the second one evaluated in the background
+	// and shuffling a data handler of its own
+	DataHandlerType backgroundDataHandler = dataHandler;
+	NetworkType nnet, backgroundNet;
+	buildDenseNetwork< ActLayerType >( nnet, { 2, 16, 3 } );
+	buildDenseNetwork< ActLayerType >( backgroundNet, { 2, 16, 3 } );
+	backgroundNet.getParameterVec( ) = nnet.getParameterVec( );
+	nnet.getInitializer( ).getRandomEngine( ).seed( 11 );
+	backgroundNet.getInitializer( ).getRandomEngine( ).seed( 11 );
+
+	OptimizerType optimizer( nnet ), backgroundOptimizer( backgroundNet );
+	TrainerType trainer( nnet, optimizer, dataHandler ), backgroundTrainer( backgroundNet, backgroundOptimizer, backgroundDataHandler );
+	std::vector< DataSet > dataSets = { DataSet::VALIDATION, DataSet::TESTING };
+	// the weights at the end of an epoch, as evaluated on the training thread
+	std::vector< std::vector< ResultType > > expectedResults;
+	auto history = trainer.train( 4, 8, [&]( std::size_t, double, double ) {
+		expectedResults.emplace_back( );
+		for ( DataSet dataSet : dataSets ) {
+			auto const& data = dataSet == DataSet::VALIDATION ? dataHandler.getValidationData( ) : dataHandler.getTestingData( );
+			ResultType expected{ dataSet };
+			for ( auto const& [input, target] : data ) {
+				VectorXType output = trainer.computePrediction( input );
+				Eigen::Index outputLabel, targetLabel;
+				output.maxCoeff( &outputLabel );
+				target.maxCoeff( &targetLabel );
+				expected.loss += trainer.getLossFun( ).loss( output, target ) / static_cast< double >( data.size( ) );
+				expected.numCorrect += outputLabel == targetLabel;
+				++expected.numSamples;
+			}
+			expectedResults.back( ).push_back( expected );
+		}
+	} );
+
+	// the callback only collects, the results are looked at on the training thread
+	std::vector< std::vector< ResultType > > results;
+	backgroundTrainer.setBackgroundEvaluation( dataSets, [&]( std::size_t epoch, std::vector< ResultType > const& epochResults ) {
+		ASSERT_EQ( epoch, results.size( ) );
+		results.push_back( epochResults );
+	}, 2 );
+	// the validation loss of an epoch is the background one, it is not evaluated again
+	std::vector< std::size_t > doneEpochs;
+	auto backgroundHistory = backgroundTrainer.train( 4, 8, [&]( std::size_t epoch, double, double validationLoss ) {
+		ASSERT_LT( epoch, results.size( ) );
+		ASSERT_EQ( validationLoss, results[epoch][0].loss );
+		doneEpochs.push_back( epoch );
+	} );
+	// train( ) returns once the last epoch's results are in
+	ASSERT_EQ( results.size( ), 4u );
+	ASSERT_EQ( doneEpochs, ( std::vector< std::size_t >{ 0, 1, 2, 3 } ) );
+	ASSERT_EQ( backgroundHistory.validationLoss.size( ), 4u );
+	for ( std::size_t epoch = 0; epoch < results.size( ); ++epoch ) {
+		ASSERT_EQ( results[epoch].size( ), dataSets.size( ) );
+		for ( std::size_t set = 0; set < dataSets.size( ); ++set ) {
+			auto const& result = results[epoch][set];
+			auto const& expected = expectedResults[epoch][set];
+			ASSERT_EQ( result.dataSet, dataSets[set] );
+			ASSERT_EQ( result.numSamples, expected.numSamples );
+			ASSERT_EQ( result.numCorrect, expected.numCorrect );
+			ASSERT_NEAR( result.loss, expected.loss, 1e-12 );
+		}
+		ASSERT_NEAR( backgroundHistory.validationLoss[epoch], history.validationLoss[epoch], 1e-12 );
+	}
+	ASSERT_TRUE( backgroundNet.getParameterVec( ) == nnet.getParameterVec( ) );
+	ASSERT_GT( results.back( )[1].getAccuracy( ), results.front( )[1].getAccuracy( ) );
+}
+
+TEST( Training, MicroBatchesMatchSampleBySample ) {
+	using NumericTraitsType = NumericTraits< double >;
+	using VectorXType = NumericTraitsType::VectorXType;
+	using ActLayerType = ActivationLayer< NumericTraitsType, ArcTanActivation >;
+	using SoftMaxLayerType = ActivationLayer< NumericTraitsType, SoftMaxActivation >;
+	using InitializerType = GlorotInitializer< NumericTraitsType >;
+	using NetworkType = NeuralNetwork< NumericTraitsType, InitializerType >;
+	using DataHandlerType = RegressionDataHandler< VectorXType, VectorXType >;
+	using OptimizerType = NesterovMomentumOptimizer< NetworkType >;
+	using NetworkTrainerType = NetworkTrainer< NetworkType, OptimizerType, MSELossFuction, DataHandlerType >;
+
+	DataHandlerType dataHandler = makeWaveData( 40, 2, 3 );
+	auto buildNetwork = []( NetworkType& nnet ) {
+		buildDenseNetwork< ActLayerType >( nnet, { 2, 12, 3 }, false );
+		nnet.addLayer( std::make_shared< SoftMaxLayerType >( 3 ) );
+		nnet.finalize( );
+	};
+	NetworkType sampleNet, microNet;
+	buildNetwork( sampleNet );
+	buildNetwork( microNet );
+	microNet.getParameterVec( ) = sampleNet.getParameterVec( );
+	OptimizerType sampleOptimizer( sampleNet, 0.05 ), microOptimizer( microNet, 0.05 );
+	NetworkTrainerType sampleTrainer( sampleNet, sampleOptimizer, dataHandler );
+	NetworkTrainerType microTrainer( microNet, microOptimizer, dataHandler );
+	sampleTrainer.setNumUpdateThreads( 0 );
+	microTrainer.setNumUpdateThreads( 2 );
+	// batches of 16 run as micro batches of 6, 6 and 4 samples, the last batch has 8
+	microTrainer.setMicroBatchSize( 6 );
+
+	auto& data = dataHandler.getTrainingData( );
+	for ( std::size_t epoch = 0; epoch < 3; ++epoch ) {
+		for ( auto iter = data.begin( ); iter != data.end( ); ) {
+			auto batchEnd = std::min( iter + 16, data.end( ) );
+			ASSERT_NEAR( microTrainer.trainBatch( iter, batchEnd ), sampleTrainer.trainBatch( iter, batchEnd ), 1.0e-12 );
+			if ( epoch > 0 ) {
+				ASSERT_EQ( microTrainer.getStepAllocationStats( ).numAllocations, 0u );
+			}
+			iter = batchEnd;
+		}
+	}
+	ASSERT_LT( ( microNet.getParameterVec( ) - sampleNet.getParameterVec( ) ).norm( ), 1.0e-12 );
+
+	std::size_t microBatchSize = microTrainer.chooseMicroBatchSize( );
+	ASSERT_GE( microBatchSize, 1u );
+	ASSERT_LE( microBatchSize, 256u );
+}
+
+TEST( Training, DataParallelBatches ) {
+	using NumericTraitsType = NumericTraits< double >;
+	using VectorXType = NumericTraitsType::VectorXType;
+	using ActLayerType = ActivationLayer< NumericTraitsType, ArcTanActivation >;
+	using InitializerType = GlorotInitializer< NumericTraitsType >;
+	using NetworkType = NeuralNetwork< NumericTraitsType, InitializerType >;
+	using DataHandlerType = RegressionDataHandler< VectorXType, VectorXType >;
+	using OptimizerType = NesterovMomentumOptimizer< NetworkType >;
+	using NetworkTrainerType = NetworkTrainer< NetworkType, OptimizerType, MSELossFuction, DataHandlerType >;
+
+	DataHandlerType dataHandler = makeWaveData( 50 );
+	std::vector< std::size_t > layerSizes = { 2, 10, 1 };
+	// sequential against data parallel sample by sample and in micro batches (twice)
+	NetworkType sequentialNet, parallelNet, microNet, microNet2;
+	buildDenseNetwork< ActLayerType >( sequentialNet, layerSizes );
+	buildDenseNetwork< ActLayerType >( parallelNet, layerSizes );
+	buildDenseNetwork< ActLayerType >( microNet, layerSizes );
+	buildDenseNetwork< ActLayerType >( microNet2, layerSizes );
+	parallelNet.getParameterVec( ) = sequentialNet.getParameterVec( );
+	microNet.getParameterVec( ) = sequentialNet.getParameterVec( );
+	microNet2.getParameterVec( ) = sequentialNet.getParameterVec( );
+	OptimizerType sequentialOptimizer( sequentialNet, 0.05 ), parallelOptimizer( parallelNet, 0.05 );
+	OptimizerType microOptimizer( microNet, 0.05 ), microOptimizer2( microNet2, 0.05 );
+	NetworkTrainerType sequentialTrainer( sequentialNet, sequentialOptimizer, dataHandler );
+	NetworkTrainerType parallelTrainer( parallelNet, parallelOptimizer, dataHandler );
+	NetworkTrainerType microTrainer( microNet, microOptimizer, dataHandler );
+	NetworkTrainerType microTrainer2( microNet2, microOptimizer2, dataHandler );
+	parallelTrainer.setNumGradientThreads( 3 );
+	parallelTrainer.setDataParallel( true );
+	for ( auto trainer : { &microTrainer, &microTrainer2 } ) {
+		trainer -> setNumGradientThreads( 4 );
+		trainer -> setMicroBatchSize( 3 );
+		trainer -> setDataParallel( true );
+	}
+	microTrainer2.setScheduler( std::make_shared< Utils::TaskScheduler >( 4 ) );
+
+	auto& data = dataHandler.getTrainingData( );
+	for ( std::size_t epoch = 0; epoch < 3; ++epoch ) {
+		for ( auto iter = data.begin( ); iter != data.end( ); ) {
+			auto batchEnd = std::min( iter + 16, data.end( ) );
+			double sequentialLoss = sequentialTrainer.trainBatch( iter, batchEnd );
+			ASSERT_NEAR( parallelTrainer.trainBatch( iter, batchEnd ), sequentialLoss, 1.0e-12 );
+			double microLoss = microTrainer.trainBatch( iter, batchEnd );
+			ASSERT_NEAR( microLoss, sequentialLoss, 1.0e-12 );
+			ASSERT_EQ( microTrainer2.trainBatch( iter, batchEnd ), microLoss );
+			iter = batchEnd;
+		}
+	}
+	ASSERT_LT( ( parallelNet.getParameterVec( ) - sequentialNet.getParameterVec( ) ).norm( ), 1.0e-12 );
+	ASSERT_LT( ( microNet.getParameterVec( ) - sequentialNet.getParameterVec( ) ).norm( ), 1.0e-12 );
+	// the same number of gradient threads gives bitwise identical weights, on any scheduler
+	ASSERT_TRUE( microNet.getParameterVec( ) == microNet2.getParameterVec( ) );
+
+	// per sample gradients are kept by the trainer's thread only
+	using SAGAOptimizerType = SAGAOptimizer< NetworkType >;
+	SAGAOptimizerType sagaOptimizer( sequentialNet, data.size( ) );
+	NetworkTrainer< NetworkType, SAGAOptimizerType, MSELossFuction, DataHandlerType > sagaTrainer( sequentialNet, sagaOptimizer, dataHandler );
+	ASSERT_THROW( sagaTrainer.setDataParallel( true ), std::runtime_error );
+}
+
+TEST( Training, MultiProcessDataParallel ) {
+	using NumericTraitsType = NumericTraits< double >;
+	using VectorXType = NumericTraitsType::VectorXType;
+	using ActLayerType = ActivationLayer< NumericTraitsType, ArcTanActivation >;
+	using InitializerType = GlorotInitializer< NumericTraitsType >;
+	using NetworkType = NeuralNetwork< NumericTraitsType, InitializerType >;
+	using DataHandlerType = RegressionDataHandler< VectorXType, VectorXType >;
+	using OptimizerType = NesterovMomentumOptimizer< NetworkType >;
+	using NetworkTrainerType = NetworkTrainer< NetworkType, OptimizerType, MSELossFuction, DataHandlerType >;
+
+	DataHandlerType dataHandler = makeWaveData( 50 );
+	auto& data = dataHandler.getTrainingData( );
+	// three epochs in batches of 16 and a batch of 3 (leaving processes without samples),
+	// the batch losses are written to losses
+	auto train = [&data]( NetworkTrainerType& trainer, double* losses ) {
+		for ( std::size_t epoch = 0; epoch < 3; ++epoch ) {
+			for ( auto iter = data.begin( ); iter != data.end( ); ) {
+				auto batchEnd = std::min( iter + 16, data.end( ) );
+				*losses++ = trainer.trainBatch( iter, batchEnd );
+				iter = batchEnd;
+			}
+		}
+		*losses = trainer.trainBatch( data.begin( ), data.begin( ) + 3 );
+	};
+	constexpr std::size_t num_losses = 3 * 4 + 1;
+	std::vector< std::size_t > layerSizes = { 2, 10, 1 };
+	std::size_t numParameters = 0;
+	{
+		NetworkType nnet;
+		buildDenseNetwork< ActLayerType >( nnet, layerSizes );
+		numParameters = nnet.getParameterVec( ).size( );
+	}
+
+	for ( auto [numProcesses, microBatchSize, useTcp] : { std::make_tuple( 2, 0, false ), std::make_tuple( 4, 3, false ), std::make_tuple( 3, 0, true ) } ) {
+		// the processes write their initial and final weights and losses to a shared mapping
+		std::size_t numValues = 2 * numParameters + num_losses;
+		Utils::MappedFile results( numProcesses * numValues * sizeof( double ), std::filesystem::temp_directory_path( ).string( ) );
+		std::string name = "/nnet-test-" + std::to_string( getpid( ) ) + "-" + std::to_string( numProcesses );
+		std::uint16_t basePort = static_cast< std::uint16_t >( 20000 + getpid( ) % 20000 );
+		std::size_t numFailed = Utils::launchProcesses( numProcesses, [&]( std::size_t rank ) {
+			std::shared_ptr< Utils::ProcessGroup > processGroup;
+			if ( useTcp )
+				processGroup = std::make_shared< Utils::TcpProcessGroup >( "127.0.0.1", basePort, rank, numProcesses );
+			else
+				processGroup = std::make_shared< Utils::SharedMemoryProcessGroup >( name, rank, numProcesses );
+			// small chunks, several per layer
+			processGroup -> setChunkBytes( 128 );
+			NetworkType nnet;
+			buildDenseNetwork< ActLayerType >( nnet, layerSizes );
+			OptimizerType optimizer( nnet, 0.05 );
+			NetworkTrainerType trainer( nnet, optimizer, dataHandler );
+			trainer.setMicroBatchSize( microBatchSize );
+			// every process starts from rank 0's weights
+			trainer.setProcessGroup( processGroup );
+			double* values = static_cast< double* >( results.data( ) ) + rank * numValues;
+			std::copy( nnet.getParameterVec( ).data( ), nnet.getParameterVec( ).data( ) + numParameters, values );
+			train( trainer, values + 2 * numParameters );
+			std::copy( nnet.getParameterVec( ).data( ), nnet.getParameterVec( ).data( ) + numParameters, values + numParameters );
+			return 0;
+		} );
+		ASSERT_EQ( numFailed, 0u );
+
+		// bitwise the single process data parallel training on as many threads
+		NetworkType nnet;
+		buildDenseNetwork< ActLayerType >( nnet, layerSizes );
+		double const* initialValues = static_cast< double const* >( results.data( ) );
+		std::copy( initialValues, initialValues + numParameters, nnet.getParameterVec( ).data( ) );
+		OptimizerType optimizer( nnet, 0.05 );
+		NetworkTrainerType trainer( nnet, optimizer, dataHandler );
+		trainer.setNumGradientThreads( numProcesses );
+		trainer.setMicroBatchSize( microBatchSize );
+		trainer.setDataParallel( true );
+		std::vector< double > losses( num_losses );
+		train( trainer, losses.data( ) );
+		for ( int rank = 0; rank < numProcesses; ++rank ) {
+			double const* values = static_cast< double const* >( results.data( ) ) + rank * numValues;
+			ASSERT_TRUE( std::equal( values, values + numParameters, initialValues ) );
+			ASSERT_TRUE( std::equal( values + numParameters, values + 2 * numParameters, nnet.getParameterVec( ).data( ) ) );
+			ASSERT_TRUE( std::equal( values + 2 * numParameters, values + numValues, losses.begin( ) ) );
+		}
+	}
+
+	// a failing process takes the group down instead of leaving it waiting
+	ASSERT_EQ( Utils::launchProcesses( 2, [&]( std::size_t rank ) {
+		Utils::SharedMemoryProcessGroup processGroup( "/nnet-test-fail-" + std::to_string( getppid( ) ), rank, 2 );
+		if ( rank == 1 )
+			throw std::runtime_error( "rank 1 fails" );
+		double value = 1.0;
+		processGroup.allReduceSum( &value, 1 );
+		return 0;
+	} ), 2u );
+}
+
+TEST( Training, ParameterServer ) {
+	using NumericTraitsType = NumericTraits< double >;
+	using VectorXType = NumericTraitsType::VectorXType;
+	using ActLayerType = ActivationLayer< NumericTraitsType, ArcTanActivation >;
+	using InitializerType = GlorotInitializer< NumericTraitsType >;
+	using NetworkType = NeuralNetwork< NumericTraitsType, InitializerType >;
+	using DataHandlerType = RegressionDataHandler< VectorXType, VectorXType >;
+	using OptimizerType = NesterovMomentumOptimizer< NetworkType >;
+	using NetworkTrainerType = NetworkTrainer< NetworkType, OptimizerType, MSELossFuction, DataHandlerType >;
+	using ParameterServerType = ParameterServer< NetworkType, OptimizerType >;
+
+	DataHandlerType dataHandler = makeWaveData( 60 );
+	auto& data = dataHandler.getTrainingData( );
+	std::vector< std::size_t > layerSizes = { 2, 10, 1 };
+	std::size_t numParameters = 0;
+	{
+		NetworkType nnet;
+		buildDenseNetwork< ActLayerType >( nnet, layerSizes );
+		numParameters = nnet.getParameterVec( ).size( );
+	}
+	auto socketPath = []( std::string const& test ) {
+		return ( std::filesystem::temp_directory_path( ) / ( "nnet-ps-" + std::to_string( getpid( ) ) + "-" + test ) ).string( );
+	};
+	// batches of 16 from begin, round and round the data until the server says stop
+	auto work = []( NetworkTrainerType& trainer, auto begin, auto end, bool straggle ) {
+		for ( auto iter = begin; !trainer.getParameterServer( ) -> isStopped( ); ) {
+			auto batchEnd = std::min( iter + 16, end );
+			trainer.trainBatch( iter, batchEnd );
+			iter = batchEnd == end ? begin : batchEnd;
+			if ( straggle )
+				std::this_thread::sleep_for( std::chrono::milliseconds( 2 ) );
+		}
+	};
+
+	// a single worker with no staleness allowed trains exactly like local training
+	{
+		constexpr std::size_t num_updates = 10;
+		Utils::MappedFile results( ( 2 * numParameters + num_updates ) * sizeof( double ), std::filesystem::temp_directory_path( ).string( ) );
+		std::string path = socketPath( "single" );
+		ASSERT_EQ( Utils::launchProcesses( 2, [&]( std::size_t rank ) {
+			NetworkType nnet;
+			buildDenseNetwork< ActLayerType >( nnet, layerSizes );
+			OptimizerType optimizer( nnet, 0.05 );
+			double* values = static_cast< double* >( results.data( ) );
+			if ( rank == 0 ) {
+				ParameterServerType server( nnet, optimizer, path, 1, 0 );
+				std::copy( nnet.getParameterVec( ).data( ), nnet.getParameterVec( ).data( ) + numParameters, values );
+				server.serve( num_updates );
+				std::copy( nnet.getParameterVec( ).data( ), nnet.getParameterVec( ).data( ) + numParameters, values + numParameters );
+				std::copy( server.getLosses( ).begin( ), server.getLosses( ).end( ), values + 2 * numParameters );
+				return server.getLosses( ).size( ) == num_updates && server.getNumDropped( ) == 0 ? 0 : 1;
+			}
+			NetworkTrainerType trainer( nnet, optimizer, dataHandler );
+			trainer.setParameterServer( std::make_shared< Utils::ParameterServerConnection >( path ) );
+			work( trainer, data.begin( ), data.end( ), false );
+			return 0;
+		} ), 0u );
+
+		double const* values = static_cast< double const* >( results.data( ) );
+		NetworkType nnet;
+		buildDenseNetwork< ActLayerType >( nnet, layerSizes );
+		std::copy( values, values + numParameters, nnet.getParameterVec( ).data( ) );
+		OptimizerType optimizer( nnet, 0.05 );
+		NetworkTrainerType trainer( nnet, optimizer, dataHandler );
+		trainer.setNumGradientThreads( 1 );
+		trainer.setDataParallel( true );
+		auto iter = data.begin( );
+		for ( std::size_t update = 0; update < num_updates; ++update ) {
+			auto batchEnd = std::min( iter + 16, data.end( ) );
+			ASSERT_EQ( trainer.trainBatch( iter, batchEnd ), values[2 * numParameters + update] );
+			iter = batchEnd == data.end( ) ? data.begin( ) : batchEnd;
+		}
+		ASSERT_TRUE( std::equal( values + numParameters, values + 2 * numParameters, nnet.getParameterVec( ).data( ) ) );
+	}
+
+	// three workers on shards of the data, one of them slow, with staleness up to one
+	{
+		constexpr std::size_t num_updates = 60;
+		constexpr std::size_t num_workers = 3;
+		std::size_t numValues = 2 * numParameters + num_workers + 1;
+		Utils::MappedFile results( numValues * sizeof( double ), std::filesystem::temp_directory_path( ).string( ) );
+		std::string path = socketPath( "shards" );
+		ASSERT_EQ( Utils::launchProcesses( num_workers + 1, [&]( std::size_t rank ) {
+			NetworkType nnet;
+			buildDenseNetwork< ActLayerType >( nnet, layerSizes );
+			OptimizerType optimizer( nnet, 0.01 );
+			double* values = static_cast< double* >( results.data( ) );
+			if ( rank == 0 ) {
+				ParameterServerType server( nnet, optimizer, path, num_workers, 1 );
+				std::copy( nnet.getParameterVec( ).data( ), nnet.getParameterVec( ).data( ) + numParameters, values );
+				server.serve( num_updates );
+				std::copy( nnet.getParameterVec( ).data( ), nnet.getParameterVec( ).data( ) + numParameters, values + numParameters );
+				values[2 * numParameters + num_workers] = static_cast< double >( server.getNumDropped( ) );
+				return server.getLosses( ).size( ) == num_updates ? 0 : 1;
+			}
+			std::size_t worker = rank - 1;
+			DataHandlerType shardHandler;
+			for ( std::size_t i = worker; i < data.size( ); i += num_workers ) {
+				shardHandler.getTrainingData( ).push_back( data[i] );
+			}
+			auto& shard = shardHandler.getTrainingData( );
+			NetworkTrainerType trainer( nnet, optimizer, shardHandler );
+			auto connection = std::make_shared< Utils::ParameterServerConnection >( path );
+			trainer.setParameterServer( connection );
+			work( trainer, shard.begin( ), shard.end( ), worker == num_workers - 1 );
+			values[2 * numParameters + worker] = static_cast< double >( connection -> getNumDropped( ) );
+			return 0;
+		} ), 0u );
+
+		double const* values = static_cast< double const* >( results.data( ) );
+		ASSERT_EQ( values[2 * numParameters] + values[2 * numParameters + 1] + values[2 * numParameters + 2], values[2 * numParameters + num_workers] );
+		NetworkType nnet;
+		buildDenseNetwork< ActLayerType >( nnet, layerSizes );
+		OptimizerType optimizer( nnet, 0.01 );
+		NetworkTrainerType trainer( nnet, optimizer, dataHandler );
+		std::copy( values, values + numParameters, nnet.getParameterVec( ).data( ) );
+		double initialLoss = trainer.evaluateLoss( data );
+		std::copy( values + numParameters, values + 2 * numParameters, nnet.getParameterVec( ).data( ) );
+		ASSERT_LT( trainer.evaluateLoss( data ), initialLoss );
+	}
+}
+
+TEST( Training, AsyncUpdates ) {
+	using NumericTraitsType = NumericTraits< double >;
+	using VectorXType = NumericTraitsType::VectorXType;
+	using ActLayerType = ActivationLayer< NumericTraitsType, ArcTanActivation >;
+	using InitializerType = GlorotInitializer< NumericTraitsType >;
+	using NetworkType = NeuralNetwork< NumericTraitsType, InitializerType >;
+	using DataHandlerType = RegressionDataHandler< VectorXType, VectorXType >;
+	using OptimizerType = MomentumOptimizer< NetworkType >;
+	using NetworkTrainerType = NetworkTrainer< NetworkType, OptimizerType, MSELossFuction, DataHandlerType >;
+
+	DataHandlerType dataHandler = makeWaveData( 60 );
+	std::vector< std::size_t > layerSizes = { 2, 10, 1 };
+	// a single asynchronous thread takes the same steps as the synchronous trainer
+	NetworkType syncNet, asyncNet, atomicNet;
+	buildDenseNetwork< ActLayerType >( syncNet, layerSizes );
+	buildDenseNetwork< ActLayerType >( asyncNet, layerSizes );
+	buildDenseNetwork< ActLayerType >( atomicNet, layerSizes );
+	asyncNet.getParameterVec( ) = syncNet.getParameterVec( );
+	atomicNet.getParameterVec( ) = syncNet.getParameterVec( );
+	syncNet.getInitializer( ).getRandomEngine( ).seed( 3 );
+	asyncNet.getInitializer( ).getRandomEngine( ).seed( 3 );
+	OptimizerType syncOptimizer( syncNet, 0.05, 0.5 ), asyncOptimizer( asyncNet, 0.05, 0.5 ), atomicOptimizer( atomicNet, 0.05, 0.5 );
+	DataHandlerType asyncDataHandler( dataHandler ), atomicDataHandler( dataHandler );
+	NetworkTrainerType syncTrainer( syncNet, syncOptimizer, dataHandler );
+	NetworkTrainerType asyncTrainer( asyncNet, asyncOptimizer, asyncDataHandler );
+	NetworkTrainerType atomicTrainer( atomicNet, atomicOptimizer, atomicDataHandler );
+	asyncTrainer.setNumGradientThreads( 1 );
+	asyncTrainer.setAsyncUpdateMode( AsyncUpdateMode::RACY );
+	atomicTrainer.setNumGradientThreads( 3 );
+	atomicTrainer.setAsyncUpdateMode( AsyncUpdateMode::RELAXED_ATOMIC );
+
+	double initialLoss = atomicTrainer.evaluateLoss( dataHandler.getTrainingData( ) );
+	for ( std::size_t epoch = 0; epoch < 5; ++epoch ) {
+		syncTrainer.trainEpoch( 4 );
+		asyncTrainer.trainEpoch( 4 );
+		atomicTrainer.trainEpoch( 4 );
+	}
+	ASSERT_LT( ( asyncNet.getParameterVec( ) - syncNet.getParameterVec( ) ).norm( ), 1.0e-12 );
+	ASSERT_LT( atomicTrainer.evaluateLoss( dataHandler.getTrainingData( ) ), initialLoss );
+
+	using NesterovOptimizerType = NesterovMomentumOptimizer< NetworkType >;
+	NesterovOptimizerType nesterovOptimizer( syncNet );
+	NetworkTrainer< NetworkType, NesterovOptimizerType, MSELossFuction, DataHandlerType > nesterovTrainer( syncNet, nesterovOptimizer, dataHandler );
+	ASSERT_THROW( nesterovTrainer.setAsyncUpdateMode( AsyncUpdateMode::RACY ), std::runtime_error );
+}
+
+TEST( Training, PipelineStages ) {
+	using NumericTraitsType = NumericTraits< double >;
+	using VectorXType = NumericTraitsType::VectorXType;
+	using MatrixXType = NumericTraitsType::MatrixXType;
+	using ActLayerType = ActivationLayer< NumericTraitsType, ArcTanActivation >;
+	using InitializerType = GlorotInitializer< NumericTraitsType >;
+	using NetworkType = NeuralNetwork< NumericTraitsType, InitializerType >;
+	using DataHandlerType = RegressionDataHandler< VectorXType, VectorXType >;
+	using OptimizerType = NesterovMomentumOptimizer< NetworkType >;
+	using NetworkTrainerType = NetworkTrainer< NetworkType, OptimizerType, MSELossFuction, DataHandlerType >;
+
+	DataHandlerType dataHandler = makeWaveData( 40, 2, 2 );
+	std::vector< std::size_t > layerSizes = { 2, 12, 8, 2 };
+	// micro batches on one thread against GPipe and 1F1B schedules on three stages
+	NetworkType microNet, gpipeNet, oneFOneBNet;
+	buildDenseNetwork< ActLayerType >( microNet, layerSizes );
+	buildDenseNetwork< ActLayerType >( gpipeNet, layerSizes );
+	buildDenseNetwork< ActLayerType >( oneFOneBNet, layerSizes );
+	gpipeNet.getParameterVec( ) = microNet.getParameterVec( );
+	oneFOneBNet.getParameterVec( ) = microNet.getParameterVec( );
+	OptimizerType microOptimizer( microNet, 0.05 ), gpipeOptimizer( gpipeNet, 0.05 ), oneFOneBOptimizer( oneFOneBNet, 0.05 );
+	NetworkTrainerType microTrainer( microNet, microOptimizer, dataHandler );
+	NetworkTrainerType gpipeTrainer( gpipeNet, gpipeOptimizer, dataHandler );
+	NetworkTrainerType oneFOneBTrainer( oneFOneBNet, oneFOneBOptimizer, dataHandler );
+	for ( auto trainer : { &microTrainer, &gpipeTrainer, &oneFOneBTrainer } ) {
+		trainer -> setMicroBatchSize( 3 );
+	}
+	gpipeTrainer.setPipelineStages( 3, PipelineSchedule::GPIPE );
+	oneFOneBTrainer.setPipelineStages( 3, PipelineSchedule::ONE_F_ONE_B );
+	auto const& boundaries = gpipeTrainer.getPipeline( ) -> getStageBoundaries( );
+	ASSERT_EQ( boundaries.size( ), 4u );
+	ASSERT_EQ( boundaries.front( ), 0u );
+	ASSERT_EQ( boundaries.back( ), 5u );
+	ASSERT_TRUE( std::is_sorted( boundaries.begin( ), boundaries.end( ) ) );
+	ASSERT_THROW( gpipeTrainer.getPipeline( ) -> setStageBoundaries( { 0, 2, 2, 5 } ), std::runtime_error );
+
+	auto& data = dataHandler.getTrainingData( );
+	for ( std::size_t epoch = 0; epoch < 3; ++epoch ) {
+		for ( auto iter = data.begin( ); iter != data.end( ); ) {
+			auto batchEnd = std::min( iter + 16, data.end( ) );
+			double microLoss = microTrainer.trainBatch( iter, batchEnd );
+			ASSERT_NEAR( gpipeTrainer.trainBatch( iter, batchEnd ), microLoss, 1.0e-12 );
+			ASSERT_NEAR( oneFOneBTrainer.trainBatch( iter, batchEnd ), microLoss, 1.0e-12 );
+			iter = batchEnd;
+		}
+	}
+	ASSERT_LT( ( gpipeNet.getParameterVec( ) - microNet.getParameterVec( ) ).norm( ), 1.0e-12 );
+	ASSERT_LT( ( oneFOneBNet.getParameterVec( ) - microNet.getParameterVec( ) ).norm( ), 1.0e-12 );
+
+	// streamed inference matches the batched forward pass
+	MatrixXType inputMat( 2, 11 ), outputMat;
+	for ( Eigen::Index col = 0; col < inputMat.cols( ); ++col ) {
+		inputMat.col( col ) = data[col].first;
+	}
+	oneFOneBTrainer.getPipeline( ) -> predict( inputMat, outputMat, 4 );
+	microTrainer.computeForwardBatch( microNet, inputMat );
+	ASSERT_LT( ( outputMat - microNet.getLayers( ).back( ) -> getOutputMat( ).leftCols( 11 ) ).norm( ), 1.0e-12 );
+}
+
+TEST( NeuralNetwork, TensorParallelInference ) {
+	using NumericTraitsType = NumericTraits< double >;
+	using VectorXType = NumericTraitsType::VectorXType;
+	using FullyConnectedLayerType = FullyConnectedLayer< NumericTraitsType >;
+	using ReLULayerType = ActivationLayer< NumericTraitsType, ReLUActivation >;
+	using LogisticLayerType = ActivationLayer< NumericTraitsType, LogisticActivation >;
+	using SoftMaxLayerType = ActivationLayer< NumericTraitsType, SoftMaxActivation >;
+	using InitializerType = GlorotInitializer< NumericTraitsType >;
+	using NetworkType = NeuralNetwork< NumericTraitsType, InitializerType >;
+	using DataHandlerType = RegressionDataHandler< VectorXType, VectorXType >;
+	using OptimizerType = SGDOptimizer< NetworkType >;
+	using NetworkTrainerType = NetworkTrainer< NetworkType, OptimizerType, CrossEntropyLossFuction, DataHandlerType >;
+	using PredictorType = TensorParallelPredictor< NetworkType >;
+
+	NetworkType nnet;
+	nnet.addLayer( std::make_shared< FullyConnectedLayerType >( 30, 100, LayerType::INPUT ) );
+	nnet.addLayer( std::make_shared< ReLULayerType >( 100 ) );
+	nnet.addLayer( std::make_shared< FullyConnectedLayerType >( 100, 45, LayerType::HIDDEN ) );
+	nnet.addLayer( std::make_shared< LogisticLayerType >( 45 ) );
+	nnet.addLayer( std::make_shared< FullyConnectedLayerType >( 45, 10, LayerType::OUTPUT ) );
+	nnet.addLayer( std::make_shared< SoftMaxLayerType >( 10 ) );
+	nnet.finalize( );
+	nnet.getParameterVec( ).setRandom( );
+	DataHandlerType dataHandler;
+	OptimizerType optimizer( nnet, 0.1 );
+	NetworkTrainerType trainer( nnet, optimizer, dataHandler );
+
+	// three slices of the wide layers, the softmax and the small layers stay whole
+	PredictorType predictor( nnet, 3, 256, false );
+	ASSERT_EQ( predictor.getNumSlices( 0 ), 3u );
+	ASSERT_EQ( predictor.getNumSlices( 2 ), 3u );
+	ASSERT_EQ( predictor.getNumSlices( 3 ), 1u );
+	ASSERT_EQ( predictor.getNumSlices( 5 ), 1u );
+	PredictorType serialPredictor( nnet, 3, std::size_t( 1 ) << 20, false );
+	for ( std::size_t i = 0; i < nnet.getNumLayers( ); ++i ) {
+		ASSERT_EQ( serialPredictor.getNumSlices( i ), 1u );
+	}
+	for ( std::size_t sample = 0; sample < 20; ++sample ) {
+		VectorXType input = VectorXType::Random( 30 );
+		VectorXType expected = trainer.computePrediction( input );
+		ASSERT_LT( ( predictor.predict( input ) - expected ).norm( ), 1.0e-12 );
+		ASSERT_LT( ( serialPredictor.predict( input ) - expected ).norm( ), 1.0e-12 );
+	}
+
+	// through the trainer
+	VectorXType input = VectorXType::Random( 30 );
+	VectorXType expected = trainer.computePrediction( input );
+	trainer.setInferenceThreads( 2, 256 );
+	ASSERT_NE( trainer.getTensorParallel( ), nullptr );
+	ASSERT_LT( ( trainer.computePrediction( input ) - expected ).norm( ), 1.0e-12 );
+	trainer.setInferenceThreads( 1 );
+	ASSERT_EQ( trainer.getTensorParallel( ), nullptr );
+}
+
+TEST( Training, NumaPlacement ) {
+	using NumericTraitsType = NumericTraits< double >;
+	using VectorXType = NumericTraitsType::VectorXType;
+	using ActLayerType = ActivationLayer< NumericTraitsType, TanHActivation >;
+	using InitializerType = GlorotInitializer< NumericTraitsType >;
+	using NetworkType = NeuralNetwork< NumericTraitsType, InitializerType >;
+	using DataHandlerType = RegressionDataHandler< VectorXType, VectorXType >;
+	using OptimizerType = SGDOptimizer< NetworkType >;
+	using NetworkTrainerType = NetworkTrainer< NetworkType, OptimizerType, MSELossFuction, DataHandlerType >;
+	using PredictorType = NumaPredictor< NetworkType >;
+
+	DataHandlerType dataHandler = makeWaveData( 40, 3, 2 );
+	std::vector< std::size_t > layerSizes = { 3, 12, 2 };
+	NetworkType nnet, numaNet;
+	buildDenseNetwork< ActLayerType >( nnet, layerSizes );
+	buildDenseNetwork< ActLayerType >( numaNet, layerSizes );
+	numaNet.getParameterVec( ) = nnet.getParameterVec( );
+	OptimizerType optimizer( nnet, 0.05 ), numaOptimizer( numaNet, 0.05 );
+	NetworkTrainerType trainer( nnet, optimizer, dataHandler ), numaTrainer( numaNet, numaOptimizer, dataHandler );
+	auto numaScheduler = std::make_shared< Utils::TaskScheduler >( 3, Utils::TaskScheduler::default_deque_capacity, makeTwoNodeTopology( ) );
+	numaTrainer.setScheduler( numaScheduler );
+	for ( auto t : { &trainer, &numaTrainer } ) {
+		t -> setNumGradientThreads( 4 );
+		t -> setDataParallel( true );
+	}
+
+	// replicas placed on the nodes train the same bits as anywhere else
+	auto& data = dataHandler.getTrainingData( );
+	for ( std::size_t epoch = 0; epoch < 2; ++epoch ) {
+		for ( auto iter = data.begin( ); iter != data.end( ); iter += 10 ) {
+			ASSERT_EQ( numaTrainer.trainBatch( iter, iter + 10 ), trainer.trainBatch( iter, iter + 10 ) );
+		}
+	}
+	ASSERT_TRUE( numaNet.getParameterVec( ) == nnet.getParameterVec( ) );
+	ASSERT_EQ( numaTrainer.evaluateLoss( data ), trainer.evaluateLoss( data ) );
+
+	// a weight copy per node, the predictions don't depend on which one a part reads
+	PredictorType numaPredictor( numaNet, numaScheduler ), predictor( nnet, std::make_shared< Utils::TaskScheduler >( 2 ) );
+	ASSERT_EQ( numaPredictor.getNumCopies( ), 2u );
+	ASSERT_EQ( predictor.getNumCopies( ), 0u );
+	ASSERT_FALSE( numaPredictor.getCopy( 1 ).sharesParameters( numaNet ) );
+	ASSERT_TRUE( numaPredictor.getCopy( 1 ).getParameterVec( ) == numaNet.getParameterVec( ) );
+	std::vector< VectorXType > inputs, outputs, numaOutputs;
+	for ( auto const& [input, target] : data ) {
+		inputs.push_back( input );
+	}
+	auto checkPredictions = [&]( ) {
+		predictor.predict( inputs, outputs );
+		numaPredictor.predict( inputs, numaOutputs );
+		ASSERT_EQ( outputs.size( ), inputs.size( ) );
+		for ( std::size_t i = 0; i < inputs.size( ); ++i ) {
+			ASSERT_TRUE( numaOutputs[i] == outputs[i] );
+			ASSERT_LT( ( outputs[i] - trainer.computePrediction( inputs[i] ) ).norm( ), 1.0e-12 );
+		}
+	};
+	checkPredictions( );
+	// the copies follow further training once synced
+	trainer.trainBatch( data.begin( ), data.end( ) );
+	numaTrainer.trainBatch( data.begin( ), data.end( ) );
+	predictor.syncWeights( );
+	numaPredictor.syncWeights( );
+	checkPredictions( );
+}
+
+TEST( Training, FrozenLayersKeepTheirWeights ) {
+	using NumericTraitsType = NumericTraits< double >;
+	using VectorXType = NumericTraitsType::VectorXType;
+	using ActLayerType = ActivationLayer< NumericTraitsType, ArcTanActivation >;
+	using InitializerType = GlorotInitializer< NumericTraitsType >;
+	using NetworkType = NeuralNetwork< NumericTraitsType, InitializerType >;
+	using DataHandlerType = RegressionDataHandler< VectorXType, VectorXType >;
+	using OptimizerType = NesterovMomentumOptimizer< NetworkType >;
+	using NetworkTrainerType = NetworkTrainer< NetworkType, OptimizerType, MSELossFuction, DataHandlerType >;
+
+	DataHandlerType dataHandler = makeWaveData( 32 );
+	std::vector< std::size_t > layerSizes = { 2, 8, 8, 1 };
+	NetworkType sampleNet, microNet;
+	buildDenseNetwork< ActLayerType >( sampleNet, layerSizes );
+	buildDenseNetwork< ActLayerType >( microNet, layerSizes );
+	microNet.getParameterVec( ) = sampleNet.getParameterVec( );
+
+	// the first layer never propagates a delta, all layers are visited
+	ASSERT_EQ( sampleNet.getNumBackwardLayers( ), 5u );
+	ASSERT_FALSE( sampleNet.getLayer( 0 ) -> getPropagatesDelta( ) );
+	ASSERT_TRUE( sampleNet.getLayer( 2 ) -> getPropagatesDelta( ) );
+
+	// with the first two dense layers frozen backprop stops at the output layer
+	sampleNet.setFrozen( 0 );
+	sampleNet.setFrozen( 1 );
+	microNet.setFrozen( 0 );
+	microNet.setFrozen( 1 );
+	ASSERT_EQ( sampleNet.getNumBackwardLayers( ), 1u );
+	ASSERT_FALSE( sampleNet.getLayer( 4 ) -> getPropagatesDelta( ) );
+
+	OptimizerType sampleOptimizer( sampleNet, 0.05 ), microOptimizer( microNet, 0.05 );
+	NetworkTrainerType sampleTrainer( sampleNet, sampleOptimizer, dataHandler );
+	NetworkTrainerType microTrainer( microNet, microOptimizer, dataHandler );
+	sampleTrainer.setNumUpdateThreads( 0 );
+	microTrainer.setNumUpdateThreads( 2 );
+	microTrainer.setMicroBatchSize( 4 );
+
+	auto const& ranges = sampleNet.getParameterRanges( );
+	VectorXType frozenWeights = sampleNet.getParameterVec( ).head( ranges[2].offset );
+	VectorXType outputWeights = sampleNet.getParameterVec( ).segment( ranges[2].offset, ranges[2].size );
+	auto& data = dataHandler.getTrainingData( );
+	for ( std::size_t epoch = 0; epoch < 3; ++epoch ) {
+		for ( auto iter = data.begin( ); iter != data.end( ); iter += 8 ) {
+			ASSERT_NEAR( microTrainer.trainBatch( iter, iter + 8 ), sampleTrainer.trainBatch( iter, iter + 8 ), 1.0e-12 );
+		}
+	}
+	ASSERT_EQ( VectorXType( sampleNet.getParameterVec( ).head( ranges[2].offset ) ), frozenWeights );
+	ASSERT_EQ( VectorXType( microNet.getParameterVec( ).head( ranges[2].offset ) ), frozenWeights );
+	ASSERT_GT( ( sampleNet.getParameterVec( ).segment( ranges[2].offset, ranges[2].size ) - outputWeights ).norm( ), 0.0 );
+	ASSERT_LT( ( microNet.getParameterVec( ) - sampleNet.getParameterVec( ) ).norm( ), 1.0e-12 );
+
+	// unfreezing the middle layer extends the backward pass down to it
+	sampleNet.setFrozen( 1, false );
+	ASSERT_EQ( sampleNet.getNumBackwardLayers( ), 3u );
+	ASSERT_FALSE( sampleNet.getLayer( 2 ) -> getPropagatesDelta( ) );
+	sampleTrainer.trainBatch( data.begin( ), data.end( ) );
+	ASSERT_EQ( VectorXType( sampleNet.getParameterVec( ).head( ranges[1].offset ) ), frozenWeights.head( ranges[1].offset ) );
+	ASSERT_NE( VectorXType( sampleNet.getParameterVec( ).segment( ranges[1].offset, ranges[1].size ) ),
+			   VectorXType( frozenWeights.segment( ranges[1].offset, ranges[1].size ) ) );
+}
+
+TEST( Training, FrozenPrefixFeatureCache ) {
+	using NumericTraitsType = NumericTraits< double >;
+	using VectorXType = NumericTraitsType::VectorXType;
+	using ActLayerType = ActivationLayer< NumericTraitsType, ArcTanActivation >;
+	using InitializerType = GlorotInitializer< NumericTraitsType >;
+	using NetworkType = NeuralNetwork< NumericTraitsType, InitializerType >;
+	using DataHandlerType = RegressionDataHandler< VectorXType, VectorXType >;
+	using OptimizerType = SGDOptimizer< NetworkType >;
+	using NetworkTrainerType = NetworkTrainer< NetworkType, OptimizerType, MSELossFuction, DataHandlerType >;
+
+	DataHandlerType dataHandler = makeWaveData( 30 );
+	std::vector< std::size_t > layerSizes = { 2, 8, 6, 1 };
+	// in memory and memory mapped caches against no cache, the same shuffles are drawn
+	NetworkType plainNet, cachedNet, mappedNet;
+	buildDenseNetwork< ActLayerType >( plainNet, layerSizes );
+	plainNet.setFrozen( 0 );
+	buildDenseNetwork< ActLayerType >( cachedNet, layerSizes );
+	cachedNet.setFrozen( 0 );
+	buildDenseNetwork< ActLayerType >( mappedNet, layerSizes );
+	mappedNet.setFrozen( 0 );
+	cachedNet.getParameterVec( ) = plainNet.getParameterVec( );
+	mappedNet.getParameterVec( ) = plainNet.getParameterVec( );
+	plainNet.getInitializer( ).getRandomEngine( ).seed( 7 );
+	cachedNet.getInitializer( ).getRandomEngine( ).seed( 7 );
+	mappedNet.getInitializer( ).getRandomEngine( ).seed( 7 );
+	OptimizerType plainOptimizer( plainNet, 0.05 ), cachedOptimizer( cachedNet, 0.05 ), mappedOptimizer( mappedNet, 0.05 );
+	// the training order is kept by the data handler
+	DataHandlerType cachedDataHandler( dataHandler ), mappedDataHandler( dataHandler );
+	NetworkTrainerType plainTrainer( plainNet, plainOptimizer, dataHandler );
+	NetworkTrainerType cachedTrainer( cachedNet, cachedOptimizer, cachedDataHandler );
+	NetworkTrainerType mappedTrainer( mappedNet, mappedOptimizer, mappedDataHandler );
+	ASSERT_FALSE( plainTrainer.getCacheFrozenFeatures( ) );
+	cachedTrainer.setCacheFrozenFeatures( true );
+	mappedTrainer.setCacheFrozenFeatures( true );
+	mappedTrainer.getFeatureCache( ).setMemoryLimit( 0 );
+	mappedTrainer.setMicroBatchSize( 3 );
+
+	for ( std::size_t epoch = 0; epoch < 3; ++epoch ) {
+		double plainLoss = plainTrainer.trainEpoch( 8 );
+		ASSERT_NEAR( cachedTrainer.trainEpoch( 8 ), plainLoss, 1.0e-12 );
+		ASSERT_NEAR( mappedTrainer.trainEpoch( 8 ), plainLoss, 1.0e-12 );
+	}
+	ASSERT_FALSE( plainTrainer.getFeatureCache( ).isValid( ) );
+	ASSERT_TRUE( cachedTrainer.getFeatureCache( ).isValid( ) );
+	ASSERT_FALSE( cachedTrainer.getFeatureCache( ).isMapped( ) );
+	ASSERT_TRUE( mappedTrainer.getFeatureCache( ).isMapped( ) );
+	ASSERT_EQ( cachedTrainer.getFeatureCache( ).getNumPrefixLayers( ), 2u );
+	ASSERT_LT( ( cachedNet.getParameterVec( ) - plainNet.getParameterVec( ) ).norm( ), 1.0e-12 );
+	ASSERT_LT( ( mappedNet.getParameterVec( ) - plainNet.getParameterVec( ) ).norm( ), 1.0e-12 );
+
+	// shuffling the training data in place (same address and size) rebuilds the cache
+	for ( std::size_t epoch = 0; epoch < 2; ++epoch ) {
+		std::mt19937 plainEngine( 11 + epoch ), cachedEngine( 11 + epoch ), mappedEngine( 11 + epoch );
+		auto dataAddress = cachedDataHandler.getTrainingData( ).data( );
+		dataHandler.shuffleTrainingData( plainEngine );
+		cachedDataHandler.shuffleTrainingData( cachedEngine );
+		mappedDataHandler.shuffleTrainingData( mappedEngine );
+		ASSERT_EQ( cachedDataHandler.getTrainingData( ).data( ), dataAddress );
+		double plainLoss = plainTrainer.trainEpoch( 8 );
+		ASSERT_NEAR( cachedTrainer.trainEpoch( 8 ), plainLoss, 1.0e-12 );
+		ASSERT_NEAR( mappedTrainer.trainEpoch( 8 ), plainLoss, 1.0e-12 );
+	}
+	ASSERT_LT( ( cachedNet.getParameterVec( ) - plainNet.getParameterVec( ) ).norm( ), 1.0e-12 );
+	ASSERT_LT( ( mappedNet.getParameterVec( ) - plainNet.getParameterVec( ) ).norm( ), 1.0e-12 );
+
+	// changing the frozen weights rebuilds the cache
+	auto const& range = cachedNet.getParameterRanges( )[0];
+	cachedNet.getParameterVec( ).segment( range.offset, range.size ).array( ) += 0.01;
+	plainNet.getParameterVec( ).segment( range.offset, range.size ).array( ) += 0.01;
+	ASSERT_NEAR( cachedTrainer.trainEpoch( 8 ), plainTrainer.trainEpoch( 8 ), 1.0e-12 );
+	ASSERT_LT( ( cachedNet.getParameterVec( ) - plainNet.getParameterVec( ) ).norm( ), 1.0e-12 );
+}
+
+TEST( Training, ImportanceSampling ) {
+	using NumericTraitsType = NumericTraits< double >;
+	using VectorXType = NumericTraitsType::VectorXType;
+	using FullyConnectedLayerType = FullyConnectedLayer< NumericTraitsType >;
+	using ActLayerType = ActivationLayer< NumericTraitsType, ArcTanActivation >;
+	using InitializerType = GlorotInitializer< NumericTraitsType >;
+	using NetworkType = NeuralNetwork< NumericTraitsType, InitializerType >;
+	using DataHandlerType = RegressionDataHandler< VectorXType, VectorXType >;
+	using OptimizerType = AdamOptimizer< NetworkType >;
+	using NetworkTrainerType = NetworkTrainer< NetworkType, OptimizerType, MSELossFuction, DataHandlerType >;
+
+	// loss proportional probabilities with unbiased weights
+	std::mt19937 g( 3 );
+	ImportanceSampler< double > sampler( 0.2 );
+	sampler.sampleEpoch( 4, g );
+	ASSERT_EQ( sampler.getOrder( ).size( ), 4u );
+	for ( std::size_t i = 0; i < 4; ++i ) {
+		ASSERT_DOUBLE_EQ( sampler.getProbability( i ), 0.25 );
+		sampler.recordLoss( i, 1.0 + 3.0 * i );
+	}
+	sampler.sampleEpoch( 4, g );
+	double probabilitySum = 0.0;
+	for ( std::size_t i = 0; i < 4; ++i ) {
+		probabilitySum += sampler.getProbability( i );
+		ASSERT_NEAR( 4.0 * sampler.getProbability( i ) * sampler.getSampleWeight( i ), 1.0, 1.0e-12 );
+		if ( i > 0 ) {
+			ASSERT_GT( sampler.getProbability( i ), sampler.getProbability( i - 1 ) );
+		}
+	}
+	ASSERT_NEAR( probabilitySum, 1.0, 1.0e-12 );
+	ASSERT_NEAR( sampler.getProbability( 0 ), 0.8 * 1.0 / 22.0 + 0.05, 1.0e-12 );
+
+	// samples below the loss threshold are skipped until they are revisited
+	UniformSampler< double > uniformSampler;
+	uniformSampler.setLossThreshold( 0.5, 2 );
+	uniformSampler.sampleEpoch( 5, g );
+	for ( std::size_t i = 0; i < 5; ++i ) {
+		uniformSampler.recordLoss( i, i < 2 ? 0.1 : 1.0 );
+	}
+	for ( std::size_t epoch = 0; epoch < 2; ++epoch ) {
+		auto order = uniformSampler.sampleEpoch( 5, g );
+		std::sort( order.begin( ), order.end( ) );
+		ASSERT_EQ( order, ( std::vector< std::size_t >{ 2, 3, 4 } ) );
+	}
+	ASSERT_EQ( uniformSampler.sampleEpoch( 5, g ).size( ), 5u );
+
+	// training on the sampled epochs
+	DataHandlerType dataHandler;
+	for ( std::size_t i = 0; i < 40; ++i ) {
+		VectorXType input( 1 ), target( 1 );
+		input << 0.1 * i;
+		target << ( i % 10 == 0 ? 1.0 : 0.1 * std::sin( 0.1 * i ) );
+		dataHandler.getTrainingData( ).emplace_back( input, target );
+	}
+	NetworkType nnet;
+	nnet.addLayer( std::make_shared< FullyConnectedLayerType >( 1, 16, LayerType::INPUT ) );
+	nnet.addLayer( std::make_shared< ActLayerType >( 16 ) );
+	nnet.addLayer( std::make_shared< FullyConnectedLayerType >( 16, 1, LayerType::OUTPUT ) );
+	nnet.finalize( );
+	OptimizerType optimizer( nnet, 0.01 );
+	NetworkTrainerType trainer( nnet, optimizer, dataHandler );
+	auto trainingSampler = std::make_shared< ImportanceSampler< double > >( 0.3 );
+	trainer.setSampler( trainingSampler );
+	trainer.setMicroBatchSize( 4 );
+	double initialLoss = trainer.evaluateLoss( dataHandler.getTrainingData( ) );
+	for ( std::size_t epoch = 0; epoch < 40; ++epoch ) {
+		trainer.trainEpoch( 8 );
+	}
+	ASSERT_EQ( trainingSampler -> getEpoch( ), 40u );
+	ASSERT_LT( trainer.evaluateLoss( dataHandler.getTrainingData( ) ), initialLoss );
+}
+
+TEST( NeuralNetwork, NetworkEnsemble ) {
+	using NumericTraitsType = NumericTraits< double >;
+	using VectorXType = NumericTraitsType::VectorXType;
+	using MatrixXType = NumericTraitsType::MatrixXType;
+	using FullyConnectedLayerType = FullyConnectedLayer< NumericTraitsType >;
+	using TanHLayerType = ActivationLayer< NumericTraitsType, TanHActivation >;
+	using SoftMaxLayerType = ActivationLayer< NumericTraitsType, SoftMaxActivation >;
+	using InitializerType = GlorotInitializer< NumericTraitsType >;
+	using NetworkType = NeuralNetwork< NumericTraitsType, InitializerType >;
+	using OptimizerType = AdamOptimizer< NetworkType >;
+	using LossFunctionType = LossFunction< NumericTraitsType, MSELossFuction >;
+	using EnsembleType = NetworkEnsemble< NetworkType >;
+
+	auto makeNetwork = []( std::size_t numHidden ) {
+		auto nnet = std::make_unique< NetworkType >( );
+		nnet -> addLayer( std::make_shared< FullyConnectedLayerType >( 3, 8, LayerType::INPUT ) );
+		nnet -> addLayer( std::make_shared< TanHLayerType >( 8 ) );
+		nnet -> addLayer( std::make_shared< FullyConnectedLayerType >( 8, numHidden, LayerType::HIDDEN ) );
+		nnet -> addLayer( std::make_shared< TanHLayerType >( numHidden ) );
+		nnet -> addLayer( std::make_shared< FullyConnectedLayerType >( numHidden, 4, LayerType::OUTPUT ) );
+		nnet -> addLayer( std::make_shared< SoftMaxLayerType >( 4 ) );
+		nnet -> finalize( );
+		nnet -> getParameterVec( ).setRandom( );
+		return nnet;
+	};
+	// the members' own passes, a column at a time and batched
+	auto predict = []( NetworkType& network, MatrixXType const& inputMat ) {
+		MatrixXType outputMat( network.getLayers( ).back( ) -> getNumOutputs( ), inputMat.cols( ) );
+		for ( Eigen::Index col = 0; col < inputMat.cols( ); ++col ) {
+			VectorXType inputVec = inputMat.col( col );
+			VectorXType const* layerInput = &inputVec;
+			for ( auto& layer : network ) {
+				layer -> forwardCompute( *layerInput, layer -> getOutputVec( ) );
+				layerInput = &layer -> getOutputVec( );
+			}
+			outputMat.col( col ) = *layerInput;
+		}
+		return outputMat;
+	};
+	LossFunctionType lossFun;
+	auto trainBatch = [&]( NetworkType& network, OptimizerType& optimizer, MatrixXType const& inputMat, MatrixXType const& targetMat ) {
+		auto batchSize = inputMat.cols( );
+		auto numLayers = network.getNumLayers( );
+		network.getLayer( 0 ) -> forwardComputeBatch( inputMat );
+		for ( std::size_t i = 1; i < numLayers; ++i ) {
+			network.getLayer( i ) -> forwardComputeBatch( network.getLayer( i - 1 ) -> getOutputMat( ).leftCols( batchSize ) );
+		}
+		MatrixXType gradLossMat( targetMat.rows( ), batchSize );
+		VectorXType outputVec, targetVec, gradLossVec;
+		double loss = 0.0;
+		for ( Eigen::Index col = 0; col < batchSize; ++col ) {
+			outputVec = network.getLayers( ).back( ) -> getOutputMat( ).col( col );
+			targetVec = targetMat.col( col );
+			loss += lossFun.loss( outputVec, targetVec );
+			lossFun.gradLoss( outputVec, targetVec, gradLossVec );
+			gradLossMat.col( col ) = gradLossVec;
+		}
+		network.getLayer( numLayers - 1 ) -> backwardComputeBatch( gradLossMat );
+		for ( std::size_t i = numLayers - 1; i-- > 0; ) {
+			network.getLayer( i ) -> backwardComputeBatch( network.getLayer( i + 1 ) -> getOutputDeltaMat( ).leftCols( batchSize ) );
+		}
+		optimizer.applyWeightUpdate( static_cast< std::size_t >( batchSize ) );
+		optimizer.resetGradients( );
+		return loss;
+	};
+
+	std::size_t numMembers = 5;
+	std::vector< std::unique_ptr< NetworkType > > members;
+	std::vector< NetworkType* > memberPtrs;
+	for ( std::size_t m = 0; m < numMembers; ++m ) {
+		members.emplace_back( makeNetwork( 6 ) );
+		memberPtrs.push_back( members.back( ).get( ) );
+	}
+	EnsembleType ensemble( memberPtrs, std::make_shared< Utils::TaskScheduler >( 3 ) );
+	ASSERT_EQ( ensemble.getNetwork( ).getNumLayers( ), 6u );
+	ASSERT_NE( dynamic_cast< FullyConnectedLayerType* >( ensemble.getNetwork( ).getLayer( 0 ).get( ) ), nullptr );
+	ASSERT_NE( dynamic_cast< BlockDiagonalLayer< NumericTraitsType >* >( ensemble.getNetwork( ).getLayer( 2 ).get( ) ), nullptr );
+	ASSERT_EQ( ensemble.getNetwork( ).getLayer( 4 ) -> getNumOutputs( ), 4 * numMembers );
+
+	// predictions, the softmax is taken per member
+	MatrixXType inputMat = MatrixXType::Random( 3, 10 ), outputMat, meanMat;
+	ensemble.predictBatch( inputMat, outputMat );
+	ASSERT_EQ( outputMat.rows( ), static_cast< Eigen::Index >( 4 * numMembers ) );
+	MatrixXType expectedMean = MatrixXType::Zero( 4, 10 );
+	for ( std::size_t m = 0; m < numMembers; ++m ) {
+		MatrixXType expected = predict( *members[m], inputMat );
+		ASSERT_LT( ( outputMat.middleRows( 4 * m, 4 ) - expected ).norm( ), 1.0e-12 );
+		expectedMean += expected / static_cast< double >( numMembers );
+	}
+	ensemble.predictMean( inputMat, meanMat );
+	ASSERT_LT( ( meanMat - expectedMean ).norm( ), 1.0e-12 );
+
+	// a step of the ensemble is a step of every member on its own
+	OptimizerType optimizer( ensemble.getNetwork( ), 0.01 );
+	std::vector< std::unique_ptr< OptimizerType > > memberOptimizers;
+	for ( auto& member : members ) {
+		memberOptimizers.emplace_back( std::make_unique< OptimizerType >( *member, 0.01 ) );
+	}
+	for ( std::size_t step = 0; step < 5; ++step ) {
+		inputMat = MatrixXType::Random( 3, 16 );
+		MatrixXType targetMat = MatrixXType::Random( 4, 16 );
+		VectorXType losses = ensemble.trainBatch( optimizer, lossFun, inputMat, targetMat );
+		for ( std::size_t m = 0; m < numMembers; ++m ) {
+			ASSERT_NEAR( losses( m ), trainBatch( *members[m], *memberOptimizers[m], inputMat, targetMat ), 1.0e-10 );
+		}
+	}
+	for ( std::size_t m = 0; m < numMembers; ++m ) {
+		auto extracted = ensemble.extract( m );
+		ASSERT_EQ( extracted -> getTrainableLayers( ).size( ), 3u );
+		for ( std::size_t t = 0; t < 3; ++t ) {
+			ASSERT_LT( ( extracted -> getTrainableLayers( )[t] -> getWeightMat( ) - members[m] -> getTrainableLayers( )[t] -> getWeightMat( ) ).norm( ), 1.0e-10 );
+		}
+		ASSERT_LT( ( predict( *extracted, inputMat ) - predict( *members[m], inputMat ) ).norm( ), 1.0e-10 );
+	}
+
+	// members with other layers
+	auto other = makeNetwork( 5 );
+	std::vector< NetworkType* > mismatched{ members[0].get( ), other.get( ) };
+	ASSERT_THROW( EnsembleType ensembleOfOthers( mismatched ), std::runtime_error );
+	OptimizerType otherOptimizer( *other );
+	ASSERT_THROW( ensemble.trainBatch( otherOptimizer, lossFun, inputMat, MatrixXType::Random( 4, 16 ) ), std::runtime_error );
+}
+
+TEST( Training, HyperparameterSearch ) {
+	using NumericTraitsType = NumericTraits< double >;
+	using VectorXType = NumericTraitsType::VectorXType;
+	using FullyConnectedLayerType = FullyConnectedLayer< NumericTraitsType >;
+	using ActLayerType = ActivationLayer< NumericTraitsType, TanHActivation >;
+	using InitializerType = GlorotInitializer< NumericTraitsType >;
+	using NetworkType = NeuralNetwork< NumericTraitsType, InitializerType >;
+	using DataHandlerType = RegressionDataHandler< VectorXType, VectorXType >;
+	using OptimizerType = SGDOptimizer< NetworkType >;
+	using TrainerType = NetworkTrainer< NetworkType, OptimizerType, MSELossFuction, DataHandlerType >;
+	using SearchType = HyperparameterSearch< NetworkType, OptimizerType, MSELossFuction, DataHandlerType >;
+	using ConfigurationType = SearchType::ConfigurationType;
+
+	DataHandlerType dataHandler;
+	for ( std::size_t i = 0; i < 60; ++i ) {
+		VectorXType input( 1 ), target( 1 );
+		double x = -1.0 + 2.0 * static_cast< double >( i ) / 60.0;
+		input << x;
+		target << std::sin( 3.0 * x );
+		dataHandler.getTrainingData( ).emplace_back( input, target );
+	}
+	std::mt19937 splitEngine( 3 );
+	dataHandler.splitValidationData( 0.25, splitEngine );
+	SharedDataHandler< DataHandlerType > view( dataHandler );
+	ASSERT_EQ( &view.getTrainingData( ), &dataHandler.getTrainingData( ) );
+
+	auto makeNetwork = []( ConfigurationType const& configuration ) {
+		auto nnet = std::make_unique< NetworkType >( );
+		auto numHidden = static_cast< std::size_t >( configuration.at( "hidden" ) );
+		nnet -> getInitializer( ).getRandomEngine( ).seed( 11 );
+		nnet -> addLayer( std::make_shared< FullyConnectedLayerType >( 1, numHidden, LayerType::INPUT ) );
+		nnet -> addLayer( std::make_shared< ActLayerType >( numHidden ) );
+		nnet -> addLayer( std::make_shared< FullyConnectedLayerType >( numHidden, 1, LayerType::HIDDEN ) );
+		nnet -> finalize( );
+		return nnet;
+	};
+	auto makeOptimizer = []( NetworkType& nnet, ConfigurationType const& configuration ) {
+		return std::make_unique< OptimizerType >( nnet, configuration.at( "learning_rate" ) );
+	};
+
+	// the grid, the last hyperparameter varies fastest
+	SearchSpace space;
+	space.addValues( "hidden", { 4, 8, 16 } ).addValues( "learning_rate", { 0.0, 0.02, 0.05 } );
+	auto grid = space.getGrid( );
+	ASSERT_EQ( grid.size( ), 9u );
+	ASSERT_EQ( grid[1].at( "hidden" ), 4.0 );
+	ASSERT_EQ( grid[1].at( "learning_rate" ), 0.02 );
+	ASSERT_EQ( grid[3].at( "hidden" ), 8.0 );
+	SearchSpace rangeSpace;
+	rangeSpace.addRange( "learning_rate", 1.0e-3, 1.0e-1, true ).addValues( "hidden", { 4, 8 } );
+	std::mt19937 g( 5 );
+	for ( auto const& configuration : rangeSpace.sample( 20, g ) ) {
+		ASSERT_GE( configuration.at( "learning_rate" ), 1.0e-3 );
+		ASSERT_LE( configuration.at( "learning_rate" ), 1.0e-1 );
+	}
+	ASSERT_THROW( rangeSpace.getGrid( ), std::runtime_error );
+
+	// successive halving, 9 trials for an epoch, 3 for 3 and 1 for 9
+	SearchType search( dataHandler, makeNetwork, makeOptimizer, 3 );
+	search.setBatchSize( 4 );
+	// the trials run on the search's threads and draw no progress bars
+	std::size_t numQuietTrials = 0;
+	search.setTrainerSetup( [&]( SearchType::TrainerType& trialTrainer, ConfigurationType const& ) {
+		numQuietTrials += !trialTrainer.getShowProgress( ) && trialTrainer.getScheduler( ) -> getNumThreads( ) == search.getNumThreads( );
+	} );
+	auto& results = search.successiveHalving( grid, 1, 9, 3 );
+	ASSERT_EQ( results.size( ), 9u );
+	ASSERT_EQ( numQuietTrials, 9u );
+	std::size_t numStoppedFirst = 0, numStoppedSecond = 0, numFinished = 0;
+	for ( auto const& result : results ) {
+		if ( result.stopped ) {
+			ASSERT_EQ( result.network, nullptr );
+			( result.numEpochs == 1 ? numStoppedFirst : numStoppedSecond ) += 1;
+		}
+		else {
+			ASSERT_EQ( result.numEpochs, 9u );
+			ASSERT_NE( result.network, nullptr );
+			++numFinished;
+		}
+	}
+	ASSERT_EQ( numStoppedFirst, 6u );
+	ASSERT_EQ( numStoppedSecond, 2u );
+	ASSERT_EQ( numFinished, 1u );
+	auto& best = search.getBest( );
+	ASSERT_GT( best.configuration.at( "learning_rate" ), 0.0 );
+
+	// the trial trained as a trainer of its own on the data handler
+	auto nnet = makeNetwork( best.configuration );
+	auto optimizer = makeOptimizer( *nnet, best.configuration );
+	TrainerType trainer( *nnet, *optimizer, dataHandler );
+	trainer.setNumGradientThreads( 1 );
+	for ( std::size_t epoch = 0; epoch < 9; ++epoch ) {
+		trainer.trainEpoch( 4 );
+	}
+	ASSERT_NEAR( trainer.evaluateLoss( dataHandler.getValidationData( ) ), best.loss, 1.0e-12 );
+	ASSERT_LT( ( best.network -> getParameterVec( ) - nnet -> getParameterVec( ) ).norm( ), 1.0e-12 );
+
+	// hyperband brackets of 9 trials from an epoch, 5 from 3 and 3 from 9
+	space = SearchSpace( );
+	space.addValues( "hidden", { 4, 8 } ).addRange( "learning_rate", 0.01, 0.1, true );
+	search.hyperband( space, 9, 3, 1 );
+	ASSERT_EQ( search.getResults( ).size( ), 17u );
+	ASSERT_EQ( std::count_if( search.getResults( ).begin( ), search.getResults( ).end( ), []( auto const& result ) { return !result.stopped; } ), 5 );
+	ASSERT_EQ( search.getBest( ).numEpochs, 9u );
+
+	// the trials are ranked on validation data
+	DataHandlerType trainingOnly;
+	trainingOnly.getTrainingData( ) = dataHandler.getTrainingData( );
+	SearchType unvalidated( trainingOnly, makeNetwork, makeOptimizer, 2 );
+	ASSERT_THROW( unvalidated.gridSearch( SearchSpace( ).addValues( "hidden", { 4 } ).addValues( "learning_rate", { 0.01 } ), 1 ), std::runtime_error );
+}
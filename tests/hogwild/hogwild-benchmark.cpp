@@ -0,0 +1,123 @@
+// System includes --------------------
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+
+// Own includes --------------------
+#include "layers/activation-layer.hpp"
+#include "layers/fully-connected-layer.hpp"
+#include "networks/neural-network.hpp"
+#include "initializers/weight-initializer.hpp"
+#include "networks/network-trainer.hpp"
+#include "optimizers/optimizers.hpp"
+#include "data-handlers/data-handlers.hpp"
+
+using namespace NNet;
+
+// Convergence against throughput of asynchronous (Hogwild) SGD, with racy and
+// with relaxed atomic updates, and of synchronous data parallel SGD on the
+// minst network (784-300-100-10), all on every hardware thread. Uses the minst
+// training images when found, random images otherwise.
+//   usage: hogwild [num_samples] [num_epochs] [sync_batch_size] [async_batch_size]
+int main( int argc, char** argv ) {
+
+	using NumericTraitsType = NumericTraits< double >;
+	using VectorXType = NumericTraitsType::VectorXType;
+	using DataHandlerType = RegressionDataHandler< VectorXType, VectorXType >;
+	using FullyConnectedLayerType = FullyConnectedLayer< NumericTraitsType >;
+	using ActLayerType = ActivationLayer< NumericTraitsType, LogisticActivation >;
+	using SoftMaxActLayerType = ActivationLayer< NumericTraitsType, SoftMaxActivation >;
+	using InitializerType = GlorotInitializer< NumericTraitsType >;
+	using NetworkType = NeuralNetwork< NumericTraitsType, InitializerType >;
+	using OptimizerType = SGDOptimizer< NetworkType >;
+	using NetworkTrainerType = NetworkTrainer< NetworkType, OptimizerType, CrossEntropyLossFuction, DataHandlerType >;
+
+	std::size_t numSamples = argc > 1 ? std::strtoul( argv[1], nullptr, 10 ) : 20000;
+	std::size_t numEpochs = argc > 2 ? std::strtoul( argv[2], nullptr, 10 ) : 5;
+	std::size_t syncBatchSize = argc > 3 ? std::strtoul( argv[3], nullptr, 10 ) : 64;
+	std::size_t asyncBatchSize = argc > 4 ? std::strtoul( argv[4], nullptr, 10 ) : 4;
+
+	// import data
+	DataHandlerType dataHandler;
+	std::string trainingImagesPath = "../tests/data/minst/train-images.idx3-ubyte";
+	std::string trainingLabelsPath = "../tests/data/minst/train-labels.idx1-ubyte";
+	std::string testImagesPath = "../tests/data/minst/t10k-images.idx3-ubyte";
+	std::string testLabelsPath = "../tests/data/minst/t10k-labels.idx1-ubyte";
+	if ( std::filesystem::exists( trainingImagesPath ) && std::filesystem::exists( trainingLabelsPath ) ) {
+		MINSTDataHandler< VectorXType, VectorXType > minstDataHandler( trainingImagesPath, trainingLabelsPath, testImagesPath, testLabelsPath );
+		auto const& trainingData = minstDataHandler.getTrainingData( );
+		dataHandler.getTrainingData( ).assign( trainingData.begin( ), trainingData.begin( ) + std::min( numSamples, trainingData.size( ) ) );
+	}
+	else {
+		// sparse random images, the label is the block of pixels that is lit
+		std::cout << "minst data not found, using random images" << std::endl;
+		std::mt19937 g( 7 );
+		std::uniform_real_distribution< double > pixel( 0.0, 1.0 );
+		std::uniform_int_distribution< int > position( 0, 783 );
+		for ( std::size_t i = 0; i < numSamples; ++i ) {
+			VectorXType input = VectorXType::Zero( 784 ), target = VectorXType::Zero( 10 );
+			for ( int k = 0; k < 78; ++k ) {
+				input( 78 * ( i % 10 ) + k ) = pixel( g );
+				input( position( g ) ) = pixel( g );
+			}
+			target( i % 10 ) = 1.0;
+			dataHandler.getTrainingData( ).emplace_back( input, target );
+		}
+	}
+	std::mt19937 splitEngine( 11 );
+	dataHandler.splitValidationData( 0.1, splitEngine );
+	std::size_t numThreads = std::max< std::size_t >( std::thread::hardware_concurrency( ), 1 );
+
+	auto validationAccuracy = []( NetworkTrainerType& networkTrainer, DataHandlerType const& data ) {
+		std::size_t correct = 0;
+		for ( auto const& [input,target] : data.getValidationData( ) ) {
+			auto const& output = networkTrainer.computePrediction( input );
+			if ( std::distance( output.begin( ), std::max_element( output.begin( ), output.end( ) ) )
+				 == std::distance( target.begin( ), std::max_element( target.begin( ), target.end( ) ) ) )
+				++correct;
+		}
+		return 100.0 * static_cast< double >( correct ) / static_cast< double >( data.getValidationData( ).size( ) );
+	};
+
+	std::cout << dataHandler.getTrainingData( ).size( ) << " training samples, " << numThreads << " threads" << std::endl;
+	std::cout << std::right << std::setw( 16 ) << "mode" << std::setw( 7 ) << "epoch" << std::setw( 12 ) << "time [s]" << std::setw( 14 ) << "samples/s"
+			  << std::setw( 12 ) << "val. loss" << std::setw( 12 ) << "val. acc." << std::endl;
+	for ( auto mode : { AsyncUpdateMode::OFF, AsyncUpdateMode::RACY, AsyncUpdateMode::RELAXED_ATOMIC } ) {
+		std::string modeName = mode == AsyncUpdateMode::OFF ? "synchronous" : mode == AsyncUpdateMode::RACY ? "hogwild racy" : "hogwild atomic";
+		NetworkType nnet;
+		nnet.getInitializer( ).getRandomEngine( ).seed( 7 );
+		nnet.addLayer( std::make_shared< FullyConnectedLayerType >( 784, 300, LayerType::INPUT ) );
+		nnet.addLayer( std::make_shared< ActLayerType >( 300 ) );
+		nnet.addLayer( std::make_shared< FullyConnectedLayerType >( 300, 100, LayerType::HIDDEN ) );
+		nnet.addLayer( std::make_shared< ActLayerType >( 100 ) );
+		nnet.addLayer( std::make_shared< FullyConnectedLayerType >( 100, 10, LayerType::HIDDEN ) );
+		nnet.addLayer( std::make_shared< SoftMaxActLayerType >( 10 ) );
+		nnet.finalize( );
+		OptimizerType optimizer( nnet, 0.5 );
+		DataHandlerType trainerDataHandler( dataHandler );
+		NetworkTrainerType networkTrainer( nnet, optimizer, trainerDataHandler );
+		networkTrainer.setNumGradientThreads( numThreads );
+		networkTrainer.setDataParallel( mode == AsyncUpdateMode::OFF );
+		networkTrainer.setAsyncUpdateMode( mode );
+		std::size_t batchSize = mode == AsyncUpdateMode::OFF ? syncBatchSize : asyncBatchSize;
+
+		double totalSeconds = 0.0;
+		for ( std::size_t epoch = 0; epoch < numEpochs; ++epoch ) {
+			auto start = std::chrono::steady_clock::now( );
+			networkTrainer.trainEpoch( batchSize );
+			totalSeconds += std::chrono::duration< double >( std::chrono::steady_clock::now( ) - start ).count( );
+			double samplesPerSecond = static_cast< double >( ( epoch + 1 ) * trainerDataHandler.getTrainingData( ).size( ) ) / totalSeconds;
+			std::cout << std::right << std::setw( 16 ) << modeName << std::setw( 7 ) << epoch + 1 << std::setw( 12 ) << totalSeconds << std::setw( 14 ) << samplesPerSecond
+					  << std::setw( 12 ) << networkTrainer.evaluateLoss( trainerDataHandler.getValidationData( ) )
+					  << std::setw( 12 ) << validationAccuracy( networkTrainer, trainerDataHandler ) << std::endl;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,88 @@
+// System includes --------------------
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// Own includes --------------------
+#include "layers/activation-layer.hpp"
+#include "layers/fully-connected-layer.hpp"
+#include "networks/neural-network.hpp"
+#include "initializers/weight-initializer.hpp"
+#include "networks/tensor-parallel.hpp"
+
+using namespace NNet;
+
+// Single sample inference latency (p50, p99) of a wide network (784-width-width-10)
+// with its layers split across 1, 2, 4, ... threads by the tensor parallel
+// predictor, against the layers' own forward compute.
+//   usage: latency [width] [num_samples] [min_parallel_work]
+int main( int argc, char** argv ) {
+
+	using NumericTraitsType = NumericTraits< double >;
+	using VectorXType = NumericTraitsType::VectorXType;
+	using FullyConnectedLayerType = FullyConnectedLayer< NumericTraitsType >;
+	using ActLayerType = ActivationLayer< NumericTraitsType, ReLUActivation >;
+	using SoftMaxActLayerType = ActivationLayer< NumericTraitsType, SoftMaxActivation >;
+	using InitializerType = GlorotInitializer< NumericTraitsType >;
+	using NetworkType = NeuralNetwork< NumericTraitsType, InitializerType >;
+	using PredictorType = TensorParallelPredictor< NetworkType >;
+
+	std::size_t width = argc > 1 ? std::strtoul( argv[1], nullptr, 10 ) : 2048;
+	std::size_t numSamples = argc > 2 ? std::strtoul( argv[2], nullptr, 10 ) : 2000;
+	std::size_t minParallelWork = argc > 3 ? std::strtoul( argv[3], nullptr, 10 ) : PredictorType::default_min_parallel_work;
+
+	NetworkType nnet;
+	nnet.getInitializer( ).getRandomEngine( ).seed( 7 );
+	nnet.addLayer( std::make_shared< FullyConnectedLayerType >( 784, width, LayerType::INPUT ) );
+	nnet.addLayer( std::make_shared< ActLayerType >( width ) );
+	nnet.addLayer( std::make_shared< FullyConnectedLayerType >( width, width, LayerType::HIDDEN ) );
+	nnet.addLayer( std::make_shared< ActLayerType >( width ) );
+	nnet.addLayer( std::make_shared< FullyConnectedLayerType >( width, 10, LayerType::OUTPUT ) );
+	nnet.addLayer( std::make_shared< SoftMaxActLayerType >( 10 ) );
+	nnet.finalize( );
+	std::vector< VectorXType > inputs( 64 );
+	for ( auto& input : inputs ) {
+		input = VectorXType::Random( 784 );
+	}
+
+	// p50 and p99 in microseconds of numSamples predictions after a warmup
+	auto measure = [&]( auto&& predict ) {
+		std::vector< double > latencies;
+		latencies.reserve( numSamples );
+		for ( std::size_t i = 0; i < numSamples + numSamples / 10; ++i ) {
+			auto start = std::chrono::steady_clock::now( );
+			volatile double output = predict( inputs[i % inputs.size( )] )( 0 );
+			static_cast< void >( output );
+			double micros = std::chrono::duration< double, std::micro >( std::chrono::steady_clock::now( ) - start ).count( );
+			if ( i >= numSamples / 10 )
+				latencies.push_back( micros );
+		}
+		std::sort( latencies.begin( ), latencies.end( ) );
+		auto percentile = [&latencies]( double p ) { return latencies[std::min( latencies.size( ) - 1, static_cast< std::size_t >( p * static_cast< double >( latencies.size( ) ) ) )]; };
+		return std::make_pair( percentile( 0.5 ), percentile( 0.99 ) );
+	};
+
+	std::size_t maxThreads = std::max< std::size_t >( std::thread::hardware_concurrency( ), 1 );
+	std::cout << "784-" << width << "-" << width << "-10, " << numSamples << " samples, " << maxThreads << " threads" << std::endl;
+	std::cout << std::right << std::setw( 16 ) << "mode" << std::setw( 9 ) << "threads" << std::setw( 12 ) << "p50 [us]" << std::setw( 12 ) << "p99 [us]" << std::endl;
+	auto [serialP50, serialP99] = measure( [&]( VectorXType const& input ) -> VectorXType const& {
+		VectorXType const* layerInput = &input;
+		for ( auto& layer : nnet ) {
+			layer -> forwardCompute( *layerInput, layer -> getOutputVec( ) );
+			layerInput = &layer -> getOutputVec( );
+		}
+		return *layerInput;
+	} );
+	std::cout << std::right << std::setw( 16 ) << "layers" << std::setw( 9 ) << 1 << std::setw( 12 ) << serialP50 << std::setw( 12 ) << serialP99 << std::endl;
+	for ( std::size_t numThreads = 1; numThreads <= maxThreads; numThreads *= 2 ) {
+		PredictorType predictor( nnet, numThreads, minParallelWork, true );
+		auto [p50, p99] = measure( [&predictor]( VectorXType const& input ) -> VectorXType const& { return predictor.predict( input ); } );
+		std::cout << std::right << std::setw( 16 ) << "tensor parallel" << std::setw( 9 ) << numThreads << std::setw( 12 ) << p50 << std::setw( 12 ) << p99 << std::endl;
+	}
+
+	return 0;
+}
@@ -56,6 +56,9 @@ int main(int /* argc */, char ** /* argv */ ) {
 	nnet.finalize( );
 	nnet.printNetworkInfo( );
 
+	// hold out 10% of the training data for validation
+	dataHandler.splitValidationData( 0.1, nnet.getInitializer( ).getRandomEngine( ) );
+
 	// create the network trainer
 	// using OptimizerType = SGDOptimizer< NetworkType >;
 	using OptimizerType = NesterovMomentumOptimizer< NetworkType >;
@@ -65,6 +68,9 @@ int main(int /* argc */, char ** /* argv */ ) {
 	OptimizerType optimizer( nnet );
 	using NetworkTrainerType = NetworkTrainer< NetworkType, OptimizerType, CrossEntropyLossFuction, DataHandlerType >;
 	NetworkTrainerType networkTrainer( nnet, optimizer, dataHandler );
+	// halve the learning rate when the validation loss stalls, stop when it no longer improves
+	networkTrainer.setLearningRateSchedule( std::make_shared< ReduceOnPlateauSchedule< double > >( optimizer.getLearningRate( ), 0.5, 1 ) );
+	networkTrainer.setEarlyStopping( std::make_shared< EarlyStopping< double > >( 3 ) );
 
 	auto computePrediction = []( auto& network_trainer, auto const& data, std::size_t& correct, std::size_t& incorrect, double& totalLoss, std::ostream&  /* os */, std::optional< std::reference_wrapper< std::ostream > > pred_out = {} ) {
 		for ( auto const& [input,target] : data ) {
@@ -94,20 +100,27 @@ int main(int /* argc */, char ** /* argv */ ) {
 	// Train the network
 	std::ofstream OFS_LC( "learning-curves-minst.txt" );
 	OFS_LC << "#Epoch Training Validation Testing" << std::endl;
-	std::size_t num_epochs = 32, batch_size = 64;
-	for ( std::size_t epoch = 1; epoch <= num_epochs; ++epoch ) {
-		// train a single epoch with given batch_size
-		networkTrainer.trainEpoch( batch_size );
-		// training accuracy
-		double train_acc = computeAccuracy( networkTrainer, dataHandler.getTrainingData(), "Training accuracy = ", std::cout );
-		// validation acuracy
-		double valid_acc = 0;
-		// testing accuracy
-		double test_acc = computeAccuracy( networkTrainer, dataHandler.getTestingData(), "Testing accuracy = ", std::cout );
-		// save learning curve data
-		OFS_LC << epoch << " " << train_acc << " " << valid_acc << " " << test_acc << std::endl;
-	}
+	std::size_t max_epochs = 32, batch_size = 64;
+	// the accuracies of every epoch are evaluated on a snapshot of its weights while the next epoch trains,
+	// the callback runs on a thread of the scheduler and only keeps them
+	std::vector< std::vector< NetworkTrainerType::EvaluationResultType > > evaluations;
+	networkTrainer.setBackgroundEvaluation( { DataSet::TRAINING, DataSet::VALIDATION, DataSet::TESTING },
+											[&evaluations]( std::size_t, auto const& results ) { evaluations.push_back( results ); }, 2 );
+	// an epoch is done once its evaluation is in, print it from the training thread
+	auto history = networkTrainer.train( max_epochs, batch_size, [&]( std::size_t epoch, double, double ) {
+		char const* headers[] = { "Training accuracy = ", "Validation accuracy = ", "Testing accuracy = " };
+		OFS_LC << epoch + 1;
+		for ( std::size_t i = 0; i < evaluations[epoch].size( ); ++i ) {
+			auto const& result = evaluations[epoch][i];
+			std::cout << headers[i] << " " << result.getAccuracy( ) * 100. << ", " << result.numCorrect << "/" << result.numSamples
+					  << ", Total Loss = " << result.loss * double( result.numSamples ) << std::endl;
+			// save learning curve data
+			OFS_LC << " " << result.getAccuracy( ) * 100.;
+		}
+		OFS_LC << std::endl;
+	} );
 	OFS_LC.close();
+	std::cout << "Trained " << history.trainingLoss.size( ) << " epochs, best epoch " << history.bestEpoch + 1 << std::endl;
 
 	// Output the final prediction after training
 	std::ofstream OFS_PREDICT( "prediction-minst.txt" );